@@ -0,0 +1,183 @@
+/* Measure how fast libbpf runs packets through a filter
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Run the same TCP/IPv4 frame through pfinet's Ethernet filter, and
+   through a longer one picking out TCP traffic to port 80, first with
+   bpf_interpret and then with the decoded filter bpf_compile makes, and
+   print the number of packets each gets through in a second.  */
+
+#include <argp.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mach.h>
+#include <device/net_status.h>
+
+#include "bpf_impl.h"
+
+static int count = 10000000;
+
+static const struct argp_option options[] =
+{
+  {"count", 'n', "N", 0, "Run N packets through each filter"
+   " (default 10000000)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'n':
+      count = atoi (arg);
+      if (count < 1)
+	argp_error (state, "%s: Invalid number of packets", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static struct bpf_insn ether_filter[] =
+{
+  {NETF_IN|NETF_BPF, 0, 0, 0},
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 12},
+  {BPF_JMP|BPF_JEQ|BPF_K, 2, 0, 0x0806},
+  {BPF_JMP|BPF_JEQ|BPF_K, 1, 0, 0x0800},
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 1, 0x86DD},
+  {BPF_RET|BPF_K, 0, 0, 1500},
+  {BPF_RET|BPF_K, 0, 0, 0},
+};
+
+/* What tcpdump makes of `ip and tcp dst port 80'.  */
+static struct bpf_insn http_filter[] =
+{
+  {NETF_IN|NETF_BPF, 0, 0, 0},
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 12},
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 8, 0x0800},
+  {BPF_LD|BPF_B|BPF_ABS, 0, 0, 23},
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 6, 6},
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 20},
+  {BPF_JMP|BPF_JSET|BPF_K, 4, 0, 0x1fff},
+  {BPF_LDX|BPF_MSH|BPF_B, 0, 0, 14},
+  {BPF_LD|BPF_H|BPF_IND, 0, 0, 16},
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 1, 80},
+  {BPF_RET|BPF_K, 0, 0, 1500},
+  {BPF_RET|BPF_K, 0, 0, 0},
+};
+
+#define HLEN 14
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+run (const char *name, struct net_rcv_port *infp, int decoded,
+     char *header, char *p, unsigned int len)
+{
+  struct timespec start;
+  net_hash_entry_t *headp, ent;
+  int i, accepted = 0;
+  double ns;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      headp = 0;
+      if (decoded)
+	accepted += bpf_run (infp->prog, infp, p, len, header, HLEN,
+			     &headp, &ent) != 0;
+      else
+	accepted += bpf_interpret (infp, p, len, header, HLEN,
+				   &headp, &ent) != 0;
+    }
+  ns = elapsed_ns (&start);
+
+  if (accepted != count)
+    error (1, 0, "%s: the filter turned down the packet", name);
+  printf ("%-6s %-12s %6.1f ns/packet %12.0f packets/s\n", name,
+	  decoded ? "decoded:" : "interpreted:",
+	  ns / count, count / ns * 1e9);
+}
+
+static void
+bench (const char *name, struct bpf_insn *f, int bytes,
+       char *header, char *p, unsigned int len)
+{
+  struct net_rcv_port *infp;
+  bpf_insn_t match = 0;
+
+  if (! bpf_validate (f, bytes, &match))
+    error (1, 0, "%s: bpf_validate turned down the filter", name);
+
+  infp = calloc (1, sizeof *infp);
+  if (! infp)
+    error (1, ENOMEM, "filter");
+  memcpy (infp->filter, f, bytes);
+  infp->filter_end = (filter_t *) ((char *) infp->filter + bytes);
+  infp->rcv_port = 1;
+  infp->prog = bpf_compile ((bpf_insn_t) infp->filter, bytes);
+  if (! infp->prog)
+    error (1, ENOMEM, "bpf_compile");
+
+  run (name, infp, 0, header, p, len);
+  run (name, infp, 1, header, p, len);
+
+  bpf_prog_free (infp->prog);
+  free (infp);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure how fast libbpf runs packets through a"
+		       " filter." };
+  static char p[NET_RCV_MAX];
+  char header[HLEN];
+  unsigned int len = 1500;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  /* An Ethernet header, then an IPv4 header of 20 bytes and a TCP one
+     for port 80.  */
+  memset (header, 0, sizeof header);
+  header[12] = 0x08;
+  header[13] = 0x00;
+  p[0] = 0x45;
+  p[9] = 6;
+  p[22] = 0;
+  p[23] = 80;
+
+  bench ("ether", ether_filter, sizeof ether_filter, header, p, len);
+  bench ("http", http_filter, sizeof http_filter, header, p, len);
+
+  return 0;
+}
@@ -0,0 +1,259 @@
+/* Measure the throughput of device_read on a disk
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Open a disk through a device master, by default the one rumpdisk
+   provides, and read a fixed amount of data from it sequentially with
+   device_read, in transfers of 4 KiB up to 1 MiB, timing each size.
+   This is the path every disk file system's store takes, so it measures
+   how fast the disk driver moves data, more than the disk itself once
+   the data is in the disk's cache.
+
+   With --threads, several threads read at once, each taking every Nth
+   transfer, the way several clients of a disk read interleaved parts of
+   it.  If the device is served by libmachdev, how many of the requests
+   it merged, and how long they waited on its queue, is printed too.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <hurd.h>
+#include <mach.h>
+#include <device/device.h>
+
+#include "machdev.h"
+
+static const char *master_file = "/dev/rumpdisk";
+static const char *device_name = "wd0";
+static size_t total = 64 * 1024 * 1024;
+static int threads = 1;
+
+static const struct argp_option options[] =
+{
+  {"master", 'm', "FILE", 0, "Open the device through the device master"
+   " FILE (default /dev/rumpdisk)"},
+  {"device", 'd', "NAME", 0, "Read from device NAME (default wd0)"},
+  {"bytes", 'b', "BYTES", 0, "Read BYTES for each size (default 64 MiB)"},
+  {"threads", 't', "N", 0, "Read with N threads at once (default 1)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'm':
+      master_file = arg;
+      break;
+
+    case 'd':
+      device_name = arg;
+      break;
+
+    case 'b':
+      total = strtoul (arg, 0, 0);
+      if (total == 0)
+	argp_error (state, "%s: Invalid number of bytes", arg);
+      break;
+
+    case 't':
+      threads = atoi (arg);
+      if (threads < 1)
+	argp_error (state, "%s: Invalid number of threads", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+struct reader
+{
+  pthread_t thread;
+  device_t dev;
+  size_t size;
+  recnum_t per_read;
+  unsigned long long records;
+  int first;			/* The first transfer this thread does.  */
+  size_t got;
+  int reads;
+};
+
+/* Do every THREADS-th transfer of SIZE bytes, starting with the FIRST-th,
+   until TOTAL bytes have been read by all threads together, starting over
+   at the beginning of the device whenever the next transfer would go past
+   its end.  */
+static void *
+reader (void *arg)
+{
+  struct reader *r = arg;
+  unsigned long long per_pass = r->records / r->per_read;
+  unsigned long long i;
+
+  for (i = r->first; i * r->size < total; i += threads)
+    {
+      recnum_t recnum = (i % per_pass) * r->per_read;
+      io_buf_ptr_t data;
+      mach_msg_type_number_t len;
+      error_t err;
+
+      err = device_read (r->dev, 0, recnum, r->size, &data, &len);
+      if (err)
+	error (1, err, "device_read");
+      if (len == 0)
+	error (1, 0, "device_read: no data at record %u", recnum);
+      vm_deallocate (mach_task_self (), (vm_address_t) data, len);
+
+      r->got += len;
+      r->reads++;
+    }
+
+  return NULL;
+}
+
+/* Fill STATUS in with DEV's libmachdev queue statistics.  Return
+   whether it has them.  */
+static int
+queue_status (device_t dev, int *status)
+{
+  mach_msg_type_number_t count = MACHDEV_QUEUE_STATUS_COUNT;
+
+  return (device_get_status (dev, MACHDEV_GET_QUEUE_STATUS,
+			     status, &count) == 0
+	  && count >= MACHDEV_QUEUE_STATUS_COUNT);
+}
+
+/* Read TOTAL bytes from DEV, which has RECORDS records of RECORD_SIZE
+   bytes, in transfers of SIZE bytes, with THREADS threads.  */
+static void
+run (device_t dev, size_t size, unsigned int record_size,
+     unsigned long long records)
+{
+  recnum_t per_read = size / record_size;
+  struct reader r[threads];
+  int before[MACHDEV_QUEUE_STATUS_COUNT], after[MACHDEV_QUEUE_STATUS_COUNT];
+  int have_status;
+  struct timespec start;
+  size_t got = 0;
+  int reads = 0;
+  double ns;
+  int i;
+
+  if (per_read == 0 || per_read > records)
+    return;
+
+  have_status = queue_status (dev, before);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < threads; i++)
+    {
+      memset (&r[i], 0, sizeof r[i]);
+      r[i].dev = dev;
+      r[i].size = size;
+      r[i].per_read = per_read;
+      r[i].records = records;
+      r[i].first = i;
+      if (threads == 1)
+	reader (&r[i]);
+      else if (pthread_create (&r[i].thread, NULL, reader, &r[i]))
+	error (1, errno, "pthread_create");
+    }
+  for (i = 0; i < threads; i++)
+    {
+      if (threads > 1)
+	pthread_join (r[i].thread, NULL);
+      got += r[i].got;
+      reads += r[i].reads;
+    }
+  ns = elapsed_ns (&start);
+
+  printf ("%5zu KiB reads: %9.1f MiB/s %9.1f us/read",
+	  size / 1024, got / ns * 1e9 / (1024 * 1024), ns / reads / 1e3);
+  if (have_status && queue_status (dev, after))
+    {
+      int requests = (after[MACHDEV_QUEUE_STATUS_REQUESTS]
+		      - before[MACHDEV_QUEUE_STATUS_REQUESTS]);
+      int calls = (after[MACHDEV_QUEUE_STATUS_CALLS]
+		   - before[MACHDEV_QUEUE_STATUS_CALLS]);
+      /* The device gives the mean wait since it was opened.  */
+      double wait = ((double) after[MACHDEV_QUEUE_STATUS_WAIT_AVG]
+		     * after[MACHDEV_QUEUE_STATUS_REQUESTS]
+		     - (double) before[MACHDEV_QUEUE_STATUS_WAIT_AVG]
+		     * before[MACHDEV_QUEUE_STATUS_REQUESTS]);
+
+      printf (" %6.2f requests/call %9.1f us mean wait",
+	      calls ? (double) requests / calls : 0.0,
+	      requests ? wait / requests : 0.0);
+    }
+  putchar ('\n');
+}
+
+int
+main (int argc, char **argv)
+{
+  static const size_t sizes[] =
+    { 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure the throughput of device_read on a disk." };
+  int status[DEV_GET_RECORDS_COUNT];
+  mach_msg_type_number_t count = DEV_GET_RECORDS_COUNT;
+  mach_port_t master;
+  device_t dev;
+  error_t err;
+  int i;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  master = file_name_lookup (master_file, O_READ, 0);
+  if (master == MACH_PORT_NULL)
+    error (1, errno, "%s", master_file);
+
+  err = device_open (master, D_READ, device_name, &dev);
+  if (err)
+    error (1, err, "%s", device_name);
+
+  err = device_get_status (dev, DEV_GET_RECORDS, status, &count);
+  if (err)
+    error (1, err, "%s: device_get_status", device_name);
+  if (status[DEV_GET_RECORDS_RECORD_SIZE] <= 0)
+    error (1, 0, "%s: Invalid record size", device_name);
+
+  for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+    run (dev, sizes[i], status[DEV_GET_RECORDS_RECORD_SIZE],
+	 (unsigned int) status[DEV_GET_RECORDS_DEVICE_RECORDS]);
+
+  device_close (dev);
+  return 0;
+}
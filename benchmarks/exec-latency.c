@@ -0,0 +1,148 @@
+/* Measure how long execing a program takes
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Fork a child that exits right away, a number of times, then fork a
+   child that execs a program, /bin/true by default, then one that execs
+   a #! script running that program, and print the mean and best time of
+   each.  What the exec costs is the difference with the first, which
+   includes the dynamic linking of the program, not only the work of the
+   exec server.
+
+   Run it once as is and once after `fsysopts /servers/exec
+   --cache-size=0' to see what the exec server's cache of checked
+   executables saves.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static const char *program = "/bin/true";
+static int count = 1000;
+
+static const struct argp_option options[] =
+{
+  {"program", 'p', "FILE", 0, "Exec FILE (default /bin/true)"},
+  {"count", 'n', "N", 0, "Exec it N times (default 1000)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'p':
+      program = arg;
+      break;
+
+    case 'n':
+      count = atoi (arg);
+      if (count < 1)
+	argp_error (state, "%s: Invalid number of execs", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+/* Fork a child that execs FILE, or just exits if FILE is null, and wait
+   for it, COUNT times.  */
+static void
+run (const char *name, const char *file)
+{
+  struct timespec start;
+  double ns, total = 0, best = 0;
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid;
+      int status;
+
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      pid = fork ();
+      if (pid < 0)
+	error (1, errno, "fork");
+      if (pid == 0)
+	{
+	  if (file)
+	    execl (file, file, (char *) NULL);
+	  _exit (127);
+	}
+      if (waitpid (pid, &status, 0) < 0)
+	error (1, errno, "waitpid");
+      ns = elapsed_ns (&start);
+
+      if (file && (! WIFEXITED (status) || WEXITSTATUS (status) == 127))
+	error (1, 0, "%s: Could not exec", file);
+      total += ns;
+      if (i == 0 || ns < best)
+	best = ns;
+    }
+
+  printf ("%-13s %9.1f us mean %9.1f us best\n", name,
+	  total / count / 1e3, best / 1e3);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure how long execing a program takes." };
+  char script[] = "/tmp/exec-latencyXXXXXX";
+  FILE *f;
+  int fd;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  fd = mkstemp (script);
+  if (fd < 0)
+    error (1, errno, "%s", script);
+  f = fdopen (fd, "w");
+  if (! f)
+    error (1, errno, "%s", script);
+  fprintf (f, "#!%s\n", program);
+  if (fchmod (fd, 0700) || fclose (f))
+    error (1, errno, "%s", script);
+
+  printf ("%d times %s:\n", count, program);
+  run ("fork:", NULL);
+  run ("fork+exec:", program);
+  run ("fork+script:", script);
+
+  unlink (script);
+  return 0;
+}
@@ -0,0 +1,749 @@
+/* Measure the basic operations of the Hurd
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Time each of a number of operations the Hurd is made of, one by one,
+   and print how the times are spread, in nanoseconds, as a table, CSV
+   or JSON, so that runs on different builds can be compared:
+
+   rpc     an RPC that does nothing, to a libports server in a thread of
+	   this program
+   io      io_write and io_read of BLOCK bytes on a file in DIR, which is
+	   written all over first, so that it is all allocated, and then
+	   is in the file system's cache
+   lookup  dir_lookup of that file in DIR
+   create  creating files in DIR, then unlinking them
+   pipe    writing BLOCK bytes into a pipe, then into a local stream
+	   socket, while a thread reads them out
+   exec    forking a child that execs a program, and waiting for it
+   fault   touching pages of anonymous memory, then reading pages of a
+	   file in DIR, each for the first time
+
+   The ones done in a directory are done in each DIR given with --dir,
+   /tmp by default; give it a tmpfs directory as well to compare it with
+   the disk file system.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <hurd.h>
+#include <hurd/fs.h>
+#include <hurd/io.h>
+#include <hurd/ports.h>
+#include <mach.h>
+#include <mach/mig_errors.h>
+
+enum format { TEXT, CSV, JSON };
+
+static enum format format = TEXT;
+static const char *groups;
+static int count;		/* 0 for the defaults of each.  */
+static size_t block_size = 64 * 1024;
+static size_t file_size = 16 * 1024 * 1024;
+static const char *program = "/bin/true";
+static const char **dirs;
+static int ndirs;
+
+static const struct argp_option options[] =
+{
+  {"bench", 'b', "LIST", 0, "Only run the comma-separated groups in LIST,"
+   " of rpc, io, lookup, create, pipe, exec and fault (default all)"},
+  {"dir", 'd', "DIR", 0, "Do the file system ones in DIR, which may be"
+   " given several times (default /tmp)"},
+  {"count", 'n', "N", 0, "Time each operation N times (default depends"
+   " on the operation)"},
+  {"block", 's', "BYTES", 0, "Read and write BYTES at a time"
+   " (default 64 KiB)"},
+  {"file-size", 'S', "BYTES", 0, "Read and write a file of BYTES"
+   " (default 16 MiB)"},
+  {"program", 'p', "FILE", 0, "Exec FILE (default /bin/true)"},
+  {"format", 'f', "FORMAT", 0, "Print text, csv or json (default text)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'b':
+      groups = arg;
+      break;
+
+    case 'd':
+      dirs = realloc (dirs, (ndirs + 1) * sizeof *dirs);
+      if (! dirs)
+	error (1, ENOMEM, "dirs");
+      dirs[ndirs++] = arg;
+      break;
+
+    case 'n':
+      count = atoi (arg);
+      if (count < 1)
+	argp_error (state, "%s: Invalid count", arg);
+      break;
+
+    case 's':
+      block_size = strtoul (arg, 0, 0);
+      if (block_size == 0)
+	argp_error (state, "%s: Invalid block size", arg);
+      break;
+
+    case 'S':
+      file_size = strtoul (arg, 0, 0);
+      if (file_size == 0)
+	argp_error (state, "%s: Invalid file size", arg);
+      break;
+
+    case 'p':
+      program = arg;
+      break;
+
+    case 'f':
+      if (! strcmp (arg, "text"))
+	format = TEXT;
+      else if (! strcmp (arg, "csv"))
+	format = CSV;
+      else if (! strcmp (arg, "json"))
+	format = JSON;
+      else
+	argp_error (state, "%s: Invalid format", arg);
+      break;
+
+    case ARGP_KEY_END:
+      if (block_size > file_size)
+	argp_error (state, "The block size is larger than the file");
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+/* Return whether GROUP is to be run.  */
+static int
+wanted (const char *group)
+{
+  const char *p = groups;
+  size_t len = strlen (group);
+
+  if (! p)
+    return 1;
+  while (*p)
+    {
+      size_t n = strcspn (p, ",");
+      if (n == len && ! strncmp (p, group, len))
+	return 1;
+      p += n;
+      if (*p)
+	p++;
+    }
+  return 0;
+}
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+/* Print S as a JSON string.  */
+static void
+json_string (const char *s)
+{
+  putchar ('"');
+  for (; *s; s++)
+    if (*s == '"' || *s == '\\')
+      printf ("\\%c", *s);
+    else if ((unsigned char) *s < ' ')
+      printf ("\\u%04x", *s);
+    else
+      putchar (*s);
+  putchar ('"');
+}
+
+static int reported;
+
+static void
+report_start (void)
+{
+  switch (format)
+    {
+    case TEXT:
+      printf ("%-12s %-12s %7s %9s %9s %9s %9s %9s %9s %11s %9s\n",
+	      "benchmark", "target", "count", "mean ns", "min ns", "p50 ns",
+	      "p90 ns", "p99 ns", "max ns", "ops/s", "MiB/s");
+      break;
+    case CSV:
+      printf ("benchmark,target,count,bytes,mean_ns,min_ns,p50_ns,p90_ns,"
+	      "p99_ns,max_ns,ops_per_s,mib_per_s\n");
+      break;
+    case JSON:
+      printf ("[");
+      break;
+    }
+}
+
+static void
+report_end (void)
+{
+  if (format == JSON)
+    printf ("%s]\n", reported ? "\n" : "");
+}
+
+/* Report the N times in NS, in nanoseconds, of the operation NAME on
+   TARGET, which each moved BYTES.  NS gets sorted.  */
+static void
+report (const char *name, const char *target, size_t bytes,
+	double *ns, int n)
+{
+  double total = 0, ops, mib;
+  int i;
+
+  for (i = 0; i < n; i++)
+    total += ns[i];
+  qsort (ns, n, sizeof *ns, compare_doubles);
+  ops = n / total * 1e9;
+  mib = bytes * ops / (1024 * 1024);
+
+  switch (format)
+    {
+    case TEXT:
+      printf ("%-12s %-12s %7d %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f %11.0f",
+	      name, target, n, total / n, ns[0], ns[n / 2], ns[n * 9 / 10],
+	      ns[n * 99 / 100], ns[n - 1], ops);
+      if (bytes)
+	printf (" %9.1f", mib);
+      putchar ('\n');
+      break;
+
+    case CSV:
+      /* TARGET is quoted, with its quotes doubled, the CSV way.  */
+      printf ("%s,\"", name);
+      for (; *target; target++)
+	{
+	  if (*target == '"')
+	    putchar ('"');
+	  putchar (*target);
+	}
+      printf ("\",%d,%zu,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.1f\n",
+	      n, bytes, total / n, ns[0], ns[n / 2], ns[n * 9 / 10],
+	      ns[n * 99 / 100], ns[n - 1], ops, mib);
+      break;
+
+    case JSON:
+      printf ("%s\n  {\"benchmark\": ", reported ? "," : "");
+      json_string (name);
+      printf (", \"target\": ");
+      json_string (target);
+      printf (", \"count\": %d, \"bytes\": %zu, \"mean_ns\": %.0f,"
+	      " \"min_ns\": %.0f, \"p50_ns\": %.0f, \"p90_ns\": %.0f,"
+	      " \"p99_ns\": %.0f, \"max_ns\": %.0f, \"ops_per_s\": %.0f,"
+	      " \"mib_per_s\": %.1f}",
+	      n, bytes, total / n, ns[0], ns[n / 2], ns[n * 9 / 10],
+	      ns[n * 99 / 100], ns[n - 1], ops, mib);
+      break;
+    }
+
+  reported++;
+  fflush (stdout);
+}
+
+/* Do OP with ARG and 0 up to N - 1, N being COUNT if it was given, or
+   else DEFAULT_N, timing each, and report it as NAME on TARGET.  */
+static void
+measure (const char *name, const char *target, size_t bytes, int default_n,
+	 void (*op) (void *arg, int i), void *arg)
+{
+  int n = count ?: default_n;
+  double *ns, start;
+  int i;
+
+  ns = calloc (n, sizeof *ns);
+  if (! ns)
+    error (1, ENOMEM, "%s", name);
+
+  for (i = 0; i < n; i++)
+    {
+      start = now_ns ();
+      op (arg, i);
+      ns[i] = now_ns () - start;
+    }
+
+  report (name, target, bytes, ns, n);
+  free (ns);
+}
+
+/* The number of times measure will do an operation with default N.  */
+#define COUNT(default_n) (count ?: (default_n))
+
+
+/* rpc */
+
+#define NULL_RPC_ID	424242
+
+static struct port_bucket *null_bucket;
+
+static int
+null_demuxer (mach_msg_header_t *inp, mach_msg_header_t *outp)
+{
+  if (inp->msgh_id != NULL_RPC_ID)
+    return 0;
+  ((mig_reply_header_t *) outp)->RetCode = 0;
+  return 1;
+}
+
+static void *
+null_server (void *arg)
+{
+  ports_manage_port_operations_multithread (null_bucket, null_demuxer,
+					    0, 0, 0);
+  return NULL;
+}
+
+struct null_client
+{
+  mach_port_t server, reply;
+};
+
+static void
+null_rpc (void *arg, int i)
+{
+  struct null_client *c = arg;
+  union
+  {
+    mach_msg_header_t request;
+    mig_reply_header_t reply;
+    char space[256];
+  } msg;
+  error_t err;
+
+  msg.request.msgh_bits = MACH_MSGH_BITS (MACH_MSG_TYPE_COPY_SEND,
+					  MACH_MSG_TYPE_MAKE_SEND_ONCE);
+  msg.request.msgh_size = sizeof msg.request;
+  msg.request.msgh_remote_port = c->server;
+  msg.request.msgh_local_port = c->reply;
+  msg.request.msgh_seqno = 0;
+  msg.request.msgh_id = NULL_RPC_ID;
+
+  /* The reply is received into the same buffer.  */
+  err = mach_msg (&msg.request, MACH_SEND_MSG | MACH_RCV_MSG,
+		  sizeof msg.request, sizeof msg, c->reply,
+		  MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+  if (! err)
+    err = msg.reply.RetCode;
+  if (err)
+    error (1, err, "null RPC");
+}
+
+static void
+bench_rpc (void)
+{
+  struct port_class *class;
+  struct port_info *pi;
+  struct null_client c;
+  pthread_t thread;
+  error_t err;
+
+  null_bucket = ports_create_bucket ();
+  class = ports_create_class (0, 0);
+  if (! null_bucket || ! class)
+    error (1, errno, "ports_create_bucket");
+  err = ports_create_port (class, null_bucket, sizeof *pi, &pi);
+  if (err)
+    error (1, err, "ports_create_port");
+  c.server = ports_get_send_right (pi);
+  c.reply = mach_reply_port ();
+
+  err = pthread_create (&thread, NULL, null_server, NULL);
+  if (err)
+    error (1, err, "pthread_create");
+  pthread_detach (thread);
+
+  measure ("null-rpc", "libports", 0, 100000, null_rpc, &c);
+
+  mach_port_deallocate (mach_task_self (), c.server);
+  mach_port_mod_refs (mach_task_self (), c.reply, MACH_PORT_RIGHT_RECEIVE, -1);
+  ports_destroy_right (pi);
+  ports_port_deref (pi);
+}
+
+
+/* io and lookup */
+
+struct io
+{
+  file_t file;
+  char *buf;
+};
+
+static void
+io_write_block (void *arg, int i)
+{
+  struct io *io = arg;
+  off_t offset = (off_t) i * block_size % (file_size - block_size + 1);
+  vm_size_t amount;
+  error_t err;
+
+  err = io_write (io->file, io->buf, block_size, offset, &amount);
+  if (! err && amount != block_size)
+    err = EIO;
+  if (err)
+    error (1, err, "io_write");
+}
+
+static void
+io_read_block (void *arg, int i)
+{
+  struct io *io = arg;
+  off_t offset = (off_t) i * block_size % (file_size - block_size + 1);
+  data_t data = io->buf;
+  mach_msg_type_number_t len = block_size;
+  error_t err;
+
+  err = io_read (io->file, &data, &len, offset, block_size);
+  if (err)
+    error (1, err, "io_read");
+  if (data != io->buf)
+    vm_deallocate (mach_task_self (), (vm_address_t) data, len);
+  if (len != block_size)
+    error (1, 0, "io_read: short read at %lld", (long long) offset);
+}
+
+struct lookup
+{
+  file_t dir;
+  const char *name;
+};
+
+static void
+lookup_file (void *arg, int i)
+{
+  struct lookup *l = arg;
+  retry_type retry;
+  string_t retry_name;
+  mach_port_t port;
+  error_t err;
+
+  err = dir_lookup (l->dir, l->name, O_READ, 0, &retry, retry_name, &port);
+  if (err)
+    error (1, err, "dir_lookup");
+  mach_port_deallocate (mach_task_self (), port);
+}
+
+static void
+bench_io (const char *dir)
+{
+  struct io io;
+  char *name;
+  size_t done;
+  int fd;
+
+  if (asprintf (&name, "%s/hurdbench.io", dir) < 0)
+    error (1, ENOMEM, "%s", dir);
+  fd = open (name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    error (1, errno, "%s", name);
+
+  io.buf = mmap (0, block_size, PROT_READ | PROT_WRITE,
+		 MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (io.buf == MAP_FAILED)
+    error (1, errno, "mmap");
+  memset (io.buf, 'x', block_size);
+  for (done = 0; done < file_size; done += block_size)
+    if (write (fd, io.buf, MIN (block_size, file_size - done)) < 0)
+      error (1, errno, "%s", name);
+
+  io.file = getdport (fd);
+  if (wanted ("io"))
+    {
+      measure ("io-write", dir, block_size, file_size / block_size * 4,
+	       io_write_block, &io);
+      measure ("io-read", dir, block_size, file_size / block_size * 4,
+	       io_read_block, &io);
+    }
+  mach_port_deallocate (mach_task_self (), io.file);
+  munmap (io.buf, block_size);
+  close (fd);
+
+  if (wanted ("lookup"))
+    {
+      struct lookup l = { .name = "hurdbench.io" };
+
+      l.dir = file_name_lookup (dir, O_READ, 0);
+      if (l.dir == MACH_PORT_NULL)
+	error (1, errno, "%s", dir);
+      measure ("dir-lookup", dir, 0, 20000, lookup_file, &l);
+      mach_port_deallocate (mach_task_self (), l.dir);
+    }
+
+  unlink (name);
+  free (name);
+}
+
+
+/* create */
+
+static void
+create_file (void *arg, int i)
+{
+  char name[strlen (arg) + sizeof "/hurdbench." + 3 * sizeof i];
+  int fd;
+
+  snprintf (name, sizeof name, "%s/hurdbench.%d", (char *) arg, i);
+  fd = open (name, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    error (1, errno, "%s", name);
+  close (fd);
+}
+
+static void
+unlink_file (void *arg, int i)
+{
+  char name[strlen (arg) + sizeof "/hurdbench." + 3 * sizeof i];
+
+  snprintf (name, sizeof name, "%s/hurdbench.%d", (char *) arg, i);
+  if (unlink (name) < 0)
+    error (1, errno, "%s", name);
+}
+
+static void
+bench_create (const char *dir)
+{
+  measure ("create", dir, 0, 2000, create_file, (void *) dir);
+  measure ("unlink", dir, 0, 2000, unlink_file, (void *) dir);
+}
+
+
+/* pipe */
+
+static void *
+drain (void *arg)
+{
+  int fd = (long) arg;
+  char *buf = malloc (block_size);
+  ssize_t n;
+
+  if (! buf)
+    error (1, ENOMEM, "buffer");
+  while ((n = read (fd, buf, block_size)) > 0)
+    ;
+  if (n < 0)
+    error (1, errno, "read");
+  free (buf);
+  return NULL;
+}
+
+struct pipe
+{
+  int fd;
+  char *buf;
+};
+
+static void
+pipe_write (void *arg, int i)
+{
+  struct pipe *p = arg;
+  size_t done = 0;
+
+  while (done < block_size)
+    {
+      ssize_t n = write (p->fd, p->buf + done, block_size - done);
+      if (n < 0)
+	error (1, errno, "write");
+      done += n;
+    }
+}
+
+static void
+bench_pipe_1 (const char *name, int fds[2])
+{
+  struct pipe p = { .fd = fds[1] };
+  pthread_t thread;
+  error_t err;
+
+  p.buf = mmap (0, block_size, PROT_READ | PROT_WRITE,
+		MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (p.buf == MAP_FAILED)
+    error (1, errno, "mmap");
+  memset (p.buf, 'x', block_size);
+
+  err = pthread_create (&thread, NULL, drain, (void *) (long) fds[0]);
+  if (err)
+    error (1, err, "pthread_create");
+  measure (name, "pflocal", block_size, 256 * 1024 * 1024 / block_size ?: 1,
+	   pipe_write, &p);
+  close (fds[1]);
+  pthread_join (thread, NULL);
+  close (fds[0]);
+  munmap (p.buf, block_size);
+}
+
+static void
+bench_pipe (void)
+{
+  int fds[2];
+
+  if (pipe (fds) < 0)
+    error (1, errno, "pipe");
+  bench_pipe_1 ("pipe", fds);
+
+  if (socketpair (PF_LOCAL, SOCK_STREAM, 0, fds) < 0)
+    error (1, errno, "socketpair");
+  bench_pipe_1 ("socketpair", fds);
+}
+
+
+/* exec */
+
+static void
+fork_exec (void *arg, int i)
+{
+  pid_t pid;
+  int status;
+
+  pid = fork ();
+  if (pid < 0)
+    error (1, errno, "fork");
+  if (pid == 0)
+    {
+      execl (program, program, (char *) NULL);
+      _exit (127);
+    }
+  if (waitpid (pid, &status, 0) < 0)
+    error (1, errno, "waitpid");
+  if (! WIFEXITED (status) || WEXITSTATUS (status) == 127)
+    error (1, 0, "%s: Could not exec", program);
+}
+
+static void
+bench_exec (void)
+{
+  measure ("fork-exec", program, 0, 200, fork_exec, NULL);
+}
+
+
+/* fault */
+
+static void
+touch (void *arg, int i)
+{
+  volatile char *p = arg;
+  (void) p[(size_t) i * vm_page_size];
+}
+
+static void
+bench_fault_anon (void)
+{
+  size_t size = COUNT (16384) * vm_page_size;
+  char *p;
+
+  p = mmap (0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (p == MAP_FAILED)
+    error (1, errno, "mmap");
+  measure ("fault-anon", "kernel", vm_page_size, 16384, touch, p);
+  munmap (p, size);
+}
+
+static void
+bench_fault_file (const char *dir)
+{
+  size_t size = COUNT (4096) * vm_page_size;
+  char *name, *p;
+  int fd;
+
+  if (asprintf (&name, "%s/hurdbench.fault", dir) < 0)
+    error (1, ENOMEM, "%s", dir);
+  fd = open (name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0 || ftruncate (fd, size) < 0)
+    error (1, errno, "%s", name);
+
+  p = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED)
+    error (1, errno, "mmap");
+  measure ("fault-file", dir, vm_page_size, 4096, touch, p);
+
+  munmap (p, size);
+  close (fd);
+  unlink (name);
+  free (name);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  static const char *default_dirs[] = { "/tmp" };
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure the basic operations of the Hurd." };
+  int i;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+  if (ndirs == 0)
+    {
+      dirs = default_dirs;
+      ndirs = 1;
+    }
+
+  report_start ();
+
+  if (wanted ("rpc"))
+    bench_rpc ();
+  for (i = 0; i < ndirs; i++)
+    {
+      if (wanted ("io") || wanted ("lookup"))
+	bench_io (dirs[i]);
+      if (wanted ("create"))
+	bench_create (dirs[i]);
+    }
+  if (wanted ("pipe"))
+    bench_pipe ();
+  if (wanted ("exec"))
+    bench_exec ();
+  if (wanted ("fault"))
+    {
+      bench_fault_anon ();
+      for (i = 0; i < ndirs; i++)
+	bench_fault_file (dirs[i]);
+    }
+
+  report_end ();
+  return 0;
+}
@@ -0,0 +1,276 @@
+/* Measure the cost of lwip's Ethernet receive path
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* This links lwip/port/netif/hurdethif.c in and feeds it synthetic
+   UDP frames, laid out as the kernel delivers them, for an lwIP stack
+   running in this process.  No device is involved: the time measured
+   is that of turning frames into pbufs, handing them to the TCP/IP
+   thread and taking them up to a UDP socket, once copying them into
+   pbufs and once handing them over in place.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lwip/tcpip.h>
+#include <lwip/udp.h>
+#include <lwip/etharp.h>
+#include <netif/hurdethif.h>
+
+#define UDP_PORT 9
+
+static int frames = 1000000;
+static int payload_size = 64;
+
+static struct netif bench_netif;
+static unsigned long received;
+
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static int done;
+
+/* The frame fed each time, as a device would send it.  */
+static struct net_rcv_msg frame;
+
+static const struct argp_option options[] =
+{
+  {"frames", 'n', "N", 0, "Feed N frames in each mode (default 1000000)"},
+  {"size", 's', "BYTES", 0, "Carry BYTES of UDP payload (default 64)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'n':
+      frames = atoi (arg);
+      if (frames < 1)
+	argp_error (state, "%s: Invalid number of frames", arg);
+      break;
+
+    case 's':
+      payload_size = atoi (arg);
+      if (payload_size < 0 || payload_size > 1472)
+	argp_error (state, "%s: Invalid payload size", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static void
+signal_done (void *arg)
+{
+  pthread_mutex_lock (&done_lock);
+  done = 1;
+  pthread_cond_signal (&done_cond);
+  pthread_mutex_unlock (&done_lock);
+}
+
+static void
+wait_done (void)
+{
+  pthread_mutex_lock (&done_lock);
+  while (! done)
+    pthread_cond_wait (&done_cond, &done_lock);
+  done = 0;
+  pthread_mutex_unlock (&done_lock);
+}
+
+static err_t
+bench_linkoutput (struct netif *netif, struct pbuf *p)
+{
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init (struct netif *netif)
+{
+  static const uint8_t hwaddr[] = { 0x02, 0, 0, 0, 0, 1 };
+
+  netif->hwaddr_len = ETHARP_HWADDR_LEN;
+  memcpy (netif->hwaddr, hwaddr, sizeof hwaddr);
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP
+    | NETIF_FLAG_LINK_UP;
+  netif->output = etharp_output;
+  netif->linkoutput = bench_linkoutput;
+  return ERR_OK;
+}
+
+static void
+bench_recv (void *arg, struct udp_pcb *pcb, struct pbuf *p,
+	    const ip_addr_t *addr, u16_t port)
+{
+  received++;
+  pbuf_free (p);
+}
+
+/* Called in the TCP/IP thread once it is running.  */
+static void
+setup (void *arg)
+{
+  ip4_addr_t addr, mask, gw;
+  struct udp_pcb *pcb;
+
+  IP4_ADDR (&addr, 10, 0, 0, 1);
+  IP4_ADDR (&mask, 255, 255, 255, 0);
+  IP4_ADDR (&gw, 10, 0, 0, 254);
+  if (! netif_add (&bench_netif, &addr, &mask, &gw, NULL,
+		   bench_netif_init, tcpip_input))
+    error (1, 0, "netif_add failed");
+  netif_set_up (&bench_netif);
+
+  pcb = udp_new ();
+  if (! pcb || udp_bind (pcb, IP_ANY_TYPE, UDP_PORT) != ERR_OK)
+    error (1, 0, "cannot bind UDP port %d", UDP_PORT);
+  udp_recv (pcb, bench_recv, NULL);
+
+  signal_done (NULL);
+}
+
+static uint16_t
+ip_checksum (const uint8_t *p, int len)
+{
+  uint32_t sum = 0;
+
+  for (; len > 1; p += 2, len -= 2)
+    sum += (p[0] << 8) | p[1];
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return ~sum;
+}
+
+/* Lay out a UDP datagram from 10.0.0.2 to our interface in FRAME.  */
+static void
+make_frame (void)
+{
+  struct packet_header *ph = (struct packet_header *) frame.packet;
+  uint8_t *eth = (uint8_t *) frame.header;
+  uint8_t *ip = (uint8_t *) frame.packet + sizeof *ph;
+  uint8_t *udp = ip + 20;
+  int iplen = 20 + 8 + payload_size;
+  uint16_t sum;
+
+  memcpy (eth, bench_netif.hwaddr, 6);
+  memcpy (eth + 6, "\x02\0\0\0\0\x02", 6);
+  eth[12] = 0x08;
+  eth[13] = 0x00;
+
+  ph->type = PP_HTONS (0x0800);
+  ph->length = sizeof *ph + iplen;
+
+  memset (ip, 0, iplen);
+  ip[0] = 0x45;
+  ip[2] = iplen >> 8;
+  ip[3] = iplen;
+  ip[8] = 64;
+  ip[9] = 17;
+  memcpy (ip + 12, "\x0a\0\0\x02", 4);
+  memcpy (ip + 16, "\x0a\0\0\x01", 4);
+  sum = ip_checksum (ip, 20);
+  ip[10] = sum >> 8;
+  ip[11] = sum;
+
+  udp[0] = 1234 >> 8;
+  udp[1] = 1234 & 0xff;
+  udp[2] = UDP_PORT >> 8;
+  udp[3] = UDP_PORT & 0xff;
+  udp[4] = (8 + payload_size) >> 8;
+  udp[5] = 8 + payload_size;
+  /* No UDP checksum.  */
+
+  frame.packet_type.msgt_number = sizeof *ph + iplen;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+run (int zero_copy, const char *name)
+{
+  size_t packet_len = frame.packet_type.msgt_number;
+  struct timespec start;
+  double ns;
+  int i;
+
+  hurdethif_zero_copy = zero_copy;
+  received = 0;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < frames; i++)
+    {
+      struct hurdethif_rxbuf *buf = hurdethif_rxbuf_get ();
+      if (! buf)
+	error (1, ENOMEM, "receive buffer");
+
+      /* What the kernel does when it delivers a frame.  */
+      memcpy (buf->msg.header, frame.header, sizeof frame.header);
+      buf->msg.packet_type = frame.packet_type;
+      memcpy (buf->msg.packet, frame.packet, packet_len);
+
+      hurdethif_input (&bench_netif, buf);
+    }
+  hurdethif_input_flush ();
+
+  /* This runs after all the frames have gone up the stack.  */
+  tcpip_callback (signal_done, NULL);
+  wait_done ();
+  ns = elapsed_ns (&start);
+
+  printf ("%-10s %8.1f ns per frame, %8.0f frames/s, %lu of %d delivered\n",
+	  name, ns / frames, frames / ns * 1e9, received, frames);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Feed synthetic frames to lwip's Ethernet receive path"
+		       " in this process." };
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  tcpip_init (setup, NULL);
+  wait_done ();
+  make_frame ();
+
+  run (0, "copy:");
+#if LWIP_SUPPORT_CUSTOM_PBUF
+  run (1, "in place:");
+#else
+  printf ("in place:  not supported by this lwIP\n");
+#endif
+
+  return 0;
+}
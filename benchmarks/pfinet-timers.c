@@ -0,0 +1,210 @@
+/* Measure the cost of pfinet's timer wheel with many armed timers
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* This links pfinet/timer-wheel.c in and drives it the way TCP does:
+   every connection keeps a retransmit, a delayed ACK and a keepalive
+   timer armed, and resets them as segments come and go, while simulated
+   time moves on and the earliest ones expire.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timer-wheel.h"
+
+#define HZ 100
+
+static int num_timers = 100000;
+static int rounds = 1000000;
+
+static unsigned long now;
+static unsigned long expired;
+static unsigned long early;
+
+static struct timer_list *timers;
+
+static const struct argp_option options[] =
+{
+  {"timers", 'n', "N", 0, "Keep N timers armed (default 100000)"},
+  {"rounds", 'r', "N", 0, "Rearm timers N times (default 1000000)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'n':
+      num_timers = atoi (arg);
+      if (num_timers < 1)
+	argp_error (state, "%s: Invalid number of timers", arg);
+      break;
+
+    case 'r':
+      rounds = atoi (arg);
+      if (rounds < 1)
+	argp_error (state, "%s: Invalid number of rounds", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+/* A timeout like the ones TCP uses: mostly delayed ACKs and
+   retransmissions, a few keepalives.  */
+static unsigned long
+timeout (void)
+{
+  switch (random () % 3)
+    {
+    case 0:
+      return HZ / 50 + random () % (HZ / 5);
+    case 1:
+      return HZ / 5 + random () % (3 * HZ);
+    default:
+      return 7200 * HZ + random () % HZ;
+    }
+}
+
+static void
+timer_expired (unsigned long data)
+{
+  struct timer_list *t = &timers[data];
+
+  /* Most timers are armed again when they go off.  */
+  expired++;
+  if (time_after (t->expires, now))
+    early++;
+  t->expires = now + timeout ();
+  timer_wheel_add (t);
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+/* Arm all the timers at jiffy START and let a minute go by.  Return 1
+   if some timer went off early or was left behind.  */
+static int
+wrap (unsigned long start)
+{
+  unsigned long late = 0;
+  int i;
+
+  now = start;
+  expired = early = 0;
+  timer_wheel_init (now);
+  for (i = 0; i < num_timers; i++)
+    {
+      timers[i].expires = now + timeout ();
+      timer_wheel_add (&timers[i]);
+    }
+  for (i = 0; i < 60 * HZ; i++)
+    {
+      now++;
+      timer_wheel_run (now);
+    }
+  for (i = 0; i < num_timers; i++)
+    if (timer_wheel_del (&timers[i])
+	&& time_before_eq (timers[i].expires, now))
+      late++;
+
+  printf ("wrap:     %lu timers expired at %#lx, %lu early, %lu late\n",
+	  expired, start, early, late);
+  return early != 0 || late != 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure pfinet's timer wheel with many armed timers." };
+  struct timespec start;
+  double ns;
+  int i, failures = 0;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  timers = calloc (num_timers, sizeof *timers);
+  if (! timers)
+    error (1, ENOMEM, "timers");
+  srandom (1);
+  timer_wheel_init (now);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < num_timers; i++)
+    {
+      timers[i].function = timer_expired;
+      timers[i].data = i;
+      timers[i].expires = now + timeout ();
+      timer_wheel_add (&timers[i]);
+    }
+  ns = elapsed_ns (&start);
+  printf ("add:      %8.1f ns per timer\n", ns / num_timers);
+
+  /* Like mod_timer: every packet moves some connection's timer.  */
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < rounds; i++)
+    {
+      struct timer_list *t = &timers[random () % num_timers];
+      timer_wheel_del (t);
+      t->expires = now + timeout ();
+      timer_wheel_add (t);
+    }
+  ns = elapsed_ns (&start);
+  printf ("mod:      %8.1f ns per timer\n", ns / rounds);
+
+  /* Let a simulated minute go by, one jiffy at a time, asking for the
+     next slot as the timer thread does.  */
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < 60 * HZ; i++)
+    {
+      unsigned long when;
+      now++;
+      timer_wheel_run (now);
+      timer_wheel_next (&when);
+    }
+  ns = elapsed_ns (&start);
+  printf ("run:      %8.1f ns per jiffy, %lu timers expired\n",
+	  ns / (60 * HZ), expired);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < num_timers; i++)
+    timer_wheel_del (&timers[i]);
+  ns = elapsed_ns (&start);
+  printf ("del:      %8.1f ns per timer\n", ns / num_timers);
+
+  /* Where unsigned jiffies wrap, and where they would if they were
+     signed.  */
+  failures += wrap (-30UL * HZ);
+  failures += wrap (LONG_MAX - 30UL * HZ);
+
+  return failures != 0;
+}
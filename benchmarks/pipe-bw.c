@@ -0,0 +1,189 @@
+/* Measure the bandwidth of pipes and local stream sockets
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* A thread writes a fixed amount of data into a pipe, and then into a
+   local stream socket, in writes of 4 KiB, 64 KiB and 1 MiB, while the
+   main thread reads it out again.  Both are served by pflocal, so this
+   measures how fast libpipe moves data from io_write to io_read.  The
+   writer's buffer is page-aligned, unless --unaligned is given, which
+   shows what it costs when the pages can't be passed along as they
+   are.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define READ_SIZE (1024 * 1024)
+
+static size_t total = 256 * 1024 * 1024;
+static int unaligned;
+
+static const struct argp_option options[] =
+{
+  {"bytes", 'b', "BYTES", 0, "Move BYTES for each size (default 256 MiB)"},
+  {"unaligned", 'u', 0, 0, "Write from a buffer that is not page-aligned"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'b':
+      total = strtoul (arg, 0, 0);
+      if (total == 0)
+	argp_error (state, "%s: Invalid number of bytes", arg);
+      break;
+
+    case 'u':
+      unaligned = 1;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+struct writer
+{
+  int fd;
+  char *buf;
+  size_t size;
+};
+
+static void *
+writer (void *arg)
+{
+  struct writer *w = arg;
+  size_t left = total;
+
+  while (left > 0)
+    {
+      size_t len = left < w->size ? left : w->size;
+      size_t done = 0;
+
+      while (done < len)
+	{
+	  ssize_t n = write (w->fd, w->buf + done, len - done);
+	  if (n < 0)
+	    {
+	      if (errno == EINTR)
+		continue;
+	      error (1, errno, "write");
+	    }
+	  done += n;
+	}
+      left -= len;
+    }
+
+  close (w->fd);
+  return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+run (const char *name, int fds[2], char *wbuf, char *rbuf, size_t size)
+{
+  struct writer w = { fds[1], wbuf, size };
+  struct timespec start;
+  pthread_t thread;
+  size_t got = 0;
+  ssize_t n;
+  double ns;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  errno = pthread_create (&thread, 0, writer, &w);
+  if (errno)
+    error (1, errno, "pthread_create");
+
+  while ((n = read (fds[0], rbuf, READ_SIZE)) != 0)
+    {
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  error (1, errno, "read");
+	}
+      got += n;
+    }
+
+  pthread_join (thread, 0);
+  ns = elapsed_ns (&start);
+  close (fds[0]);
+
+  if (got != total)
+    error (1, 0, "%s: read %zu bytes instead of %zu", name, got, total);
+  printf ("%-7s %5zu KiB writes: %9.1f MiB/s\n",
+	  name, size / 1024, total / ns * 1e9 / (1024 * 1024));
+}
+
+int
+main (int argc, char **argv)
+{
+  static const size_t sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure the bandwidth of pipes and local stream"
+		       " sockets." };
+  long page_size = sysconf (_SC_PAGESIZE);
+  char *wbuf, *rbuf;
+  int i, fds[2];
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  if (posix_memalign ((void **) &wbuf, page_size, sizes[2] + page_size))
+    error (1, ENOMEM, "buffers");
+  rbuf = malloc (READ_SIZE);
+  if (! rbuf)
+    error (1, ENOMEM, "buffers");
+  memset (wbuf, 'x', sizes[2] + page_size);
+  if (unaligned)
+    wbuf++;
+
+  for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+    {
+      if (pipe (fds) < 0)
+	error (1, errno, "pipe");
+      run ("pipe:", fds, wbuf, rbuf, sizes[i]);
+    }
+
+  for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+    {
+      if (socketpair (PF_LOCAL, SOCK_STREAM, 0, fds) < 0)
+	error (1, errno, "socketpair");
+      run ("socket:", fds, wbuf, rbuf, sizes[i]);
+    }
+
+  return 0;
+}
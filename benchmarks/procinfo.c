@@ -0,0 +1,239 @@
+/* Measure how long fetching the procinfo of many processes takes
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Fork a number of children, 5000 by default, that just wait to be
+   killed, and get the procinfo of all of them, the way ps and procfs do:
+   first with a proc_getprocinfo for each, then with a single
+   proc_getprocinfos, then through a libps proc_stat_list, which uses
+   proc_getprocinfos when the proc server has it.  Each is repeated a few
+   times and the best time printed.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <hurd.h>
+#include <mach.h>
+
+#include "ps.h"
+
+static int nprocs = 5000;
+static int rounds = 5;
+static int pi_flags = PI_FETCH_TASKINFO;
+
+static const struct argp_option options[] =
+{
+  {"processes", 'n', "N", 0, "Fork N processes (default 5000)"},
+  {"rounds", 'r', "N", 0, "Take the best of N rounds (default 5)"},
+  {"threads", 't', 0, 0, "Get the basic info of their threads too"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'n':
+      nprocs = atoi (arg);
+      if (nprocs < 1)
+	argp_error (state, "%s: Invalid number of processes", arg);
+      break;
+
+    case 'r':
+      rounds = atoi (arg);
+      if (rounds < 1)
+	argp_error (state, "%s: Invalid number of rounds", arg);
+      break;
+
+    case 't':
+      pi_flags |= PI_FETCH_THREADS | PI_FETCH_THREAD_BASIC;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static process_t proc;
+static pid_t *pids;
+
+/* Get the procinfo of each child with its own proc_getprocinfo.  */
+static void
+one_by_one (void)
+{
+  int i;
+
+  for (i = 0; i < nprocs; i++)
+    {
+      int buf[256];
+      procinfo_t pi = buf;
+      mach_msg_type_number_t pi_len = sizeof buf / sizeof buf[0];
+      data_t waits = NULL;
+      mach_msg_type_number_t waits_len = 0;
+      int flags = pi_flags;
+      error_t err;
+
+      err = proc_getprocinfo (proc, pids[i], &flags, &pi, &pi_len,
+			      &waits, &waits_len);
+      if (err)
+	error (1, err, "proc_getprocinfo (%d)", pids[i]);
+      if (pi != buf)
+	munmap (pi, pi_len * sizeof (int));
+      if (waits_len > 0)
+	munmap (waits, waits_len);
+    }
+}
+
+static struct ps_context *pc;
+
+/* Get the procinfo of all the children with one proc_getprocinfos.  */
+static void
+batched (void)
+{
+  ps_flags_t flags = PSTAT_TASK_BASIC;
+  procinfo_t procinfos;
+  mach_msg_type_number_t procinfos_len;
+  int asked;
+  error_t err;
+
+  if (pi_flags & PI_FETCH_THREAD_BASIC)
+    flags |= PSTAT_THREAD_BASIC;
+  err = ps_context_get_procinfos (pc, pids, nprocs, flags, &asked,
+				  &procinfos, &procinfos_len);
+  if (err)
+    error (1, err, "proc_getprocinfos");
+  munmap (procinfos, procinfos_len * sizeof (int));
+}
+
+/* Get the procinfo of all the children through a proc_stat_list, as ps
+   does.  The proc_stats are made afresh each time, so that all of it is
+   fetched again.  */
+static void
+through_libps (void)
+{
+  struct ps_context *context;
+  struct proc_stat_list *pp;
+  ps_flags_t flags = PSTAT_TASK_BASIC | PSTAT_OWNER_UID;
+  error_t err;
+
+  if (pi_flags & PI_FETCH_THREAD_BASIC)
+    flags |= PSTAT_THREAD_BASIC;
+
+  err = ps_context_create (proc, &context);
+  if (! err)
+    err = proc_stat_list_create (context, &pp);
+  if (! err)
+    err = proc_stat_list_add_pids (pp, pids, nprocs, 0);
+  if (! err)
+    err = proc_stat_list_set_flags (pp, flags);
+  if (err)
+    error (1, err, "proc_stat_list_set_flags");
+
+  proc_stat_list_free (pp);
+  ps_context_free (context);
+}
+
+static void
+run (const char *name, void (*fn) (void))
+{
+  struct timespec start;
+  double ns, best = 0;
+  int i;
+
+  for (i = 0; i < rounds; i++)
+    {
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      fn ();
+      ns = elapsed_ns (&start);
+      if (i == 0 || ns < best)
+	best = ns;
+    }
+
+  printf ("%-13s %10.1f ms %9.1f us/process\n", name,
+	  best / 1e6, best / nprocs / 1e3);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure how long fetching the procinfo of many"
+		       " processes takes." };
+  error_t err;
+  int i;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  pids = calloc (nprocs, sizeof *pids);
+  if (! pids)
+    error (1, ENOMEM, "pids");
+
+  for (i = 0; i < nprocs; i++)
+    {
+      pids[i] = fork ();
+      if (pids[i] < 0)
+	{
+	  int forked = i;
+	  err = errno;
+	  while (i-- > 0)
+	    kill (pids[i], SIGKILL);
+	  error (1, err, "fork (%d processes so far)", forked);
+	}
+      if (pids[i] == 0)
+	{
+	  pause ();
+	  _exit (0);
+	}
+    }
+
+  proc = getproc ();
+  err = ps_context_create (proc, &pc);
+  if (err)
+    error (1, err, "ps_context_create");
+
+  printf ("%d processes:\n", nprocs);
+  run ("getprocinfo:", one_by_one);
+  run ("getprocinfos:", batched);
+  run ("libps:", through_libps);
+
+  for (i = 0; i < nprocs; i++)
+    kill (pids[i], SIGKILL);
+  for (i = 0; i < nprocs; i++)
+    waitpid (pids[i], NULL, 0);
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/* Measure how libhurd-slab does with many threads
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Have 1, 2, 4 and up to --threads threads allocate a batch of objects
+   from the same slab space, write to them and deallocate them again,
+   over and over, the way the worker threads of a server would, first
+   with the slab space's lock taken for every object, then with
+   magazines for each thread, and print the time each allocation and
+   deallocation took.  With --stats, print what the slab space holds
+   after each run as well.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "slab.h"
+
+static int max_threads = 8;
+static int count = 1000000;
+static int batch = 16;
+static size_t object_size = 64;
+static int magazine_size = 32;
+static int print_stats;
+
+static const struct argp_option options[] =
+{
+  {"threads", 't', "N", 0, "Go up to N threads (default 8)"},
+  {"count", 'n', "N", 0, "Allocate N objects in each thread (default"
+   " 1000000)"},
+  {"batch", 'b', "N", 0, "Allocate N objects before deallocating them"
+   " (default 16)"},
+  {"size", 's', "BYTES", 0, "Allocate objects of BYTES (default 64)"},
+  {"magazine", 'm', "N", 0, "Put N objects in a magazine (default 32)"},
+  {"stats", 'S', 0, 0, "Print what the slab space holds after each run"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 't':
+      max_threads = atoi (arg);
+      if (max_threads < 1)
+	argp_error (state, "%s: Invalid number of threads", arg);
+      break;
+
+    case 'n':
+      count = atoi (arg);
+      if (count < 1)
+	argp_error (state, "%s: Invalid number of objects", arg);
+      break;
+
+    case 'b':
+      batch = atoi (arg);
+      if (batch < 1)
+	argp_error (state, "%s: Invalid batch size", arg);
+      break;
+
+    case 's':
+      object_size = strtoul (arg, 0, 0);
+      if (object_size == 0)
+	argp_error (state, "%s: Invalid object size", arg);
+      break;
+
+    case 'm':
+      magazine_size = atoi (arg);
+      if (magazine_size < 1 || magazine_size > HURD_SLAB_MAGAZINE_MAX)
+	argp_error (state, "%s: Invalid magazine size", arg);
+      break;
+
+    case 'S':
+      print_stats = 1;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static hurd_slab_space_t space;
+static pthread_barrier_t barrier;
+
+static void *
+worker (void *arg)
+{
+  void *objs[batch];
+  int done, i;
+  error_t err;
+
+  pthread_barrier_wait (&barrier);
+  for (done = 0; done < count; done += batch)
+    {
+      for (i = 0; i < batch; i++)
+	{
+	  err = hurd_slab_alloc (space, &objs[i]);
+	  if (err)
+	    error (1, err, "hurd_slab_alloc");
+	  memset (objs[i], i, object_size);
+	}
+      for (i = batch - 1; i >= 0; i--)
+	hurd_slab_dealloc (space, objs[i]);
+    }
+
+  return NULL;
+}
+
+static void
+run (int magazines, int threads)
+{
+  pthread_t thread[threads];
+  struct timespec start;
+  double ns;
+  error_t err;
+  int i;
+
+  err = hurd_slab_create (object_size, 0, NULL, NULL, NULL, NULL, NULL,
+			  &space);
+  if (! err && magazines)
+    err = hurd_slab_set_magazine_size (space, magazine_size);
+  if (err)
+    error (1, err, "hurd_slab_create");
+  hurd_slab_set_name (space, magazines ? "slab-mt magazines"
+				      : "slab-mt locked");
+
+  pthread_barrier_init (&barrier, NULL, threads + 1);
+  for (i = 0; i < threads; i++)
+    {
+      err = pthread_create (&thread[i], NULL, worker, NULL);
+      if (err)
+	error (1, err, "pthread_create");
+    }
+
+  pthread_barrier_wait (&barrier);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < threads; i++)
+    pthread_join (thread[i], NULL);
+  ns = elapsed_ns (&start);
+  pthread_barrier_destroy (&barrier);
+
+  printf ("%-10s %3d threads: %8.1f ns/object %12.0f objects/s\n",
+	  magazines ? "magazines:" : "locked:", threads,
+	  ns / count, (double) count * threads / ns * 1e9);
+
+  if (print_stats)
+    hurd_slab_print_stats (stdout);
+
+  /* The threads have exited, so all the objects are back in the
+     depot.  */
+  err = hurd_slab_free (space);
+  if (err)
+    error (1, err, "hurd_slab_free");
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure how libhurd-slab does with many threads." };
+  int threads;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  for (threads = 1; threads <= max_threads; threads *= 2)
+    {
+      run (0, threads);
+      run (1, threads);
+    }
+
+  return 0;
+}
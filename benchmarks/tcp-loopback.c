@@ -0,0 +1,217 @@
+/* Measure TCP throughput over the loopback interface
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Each connection has a thread writing to it as fast as it can and one
+   reading from it, for a fixed time; the total and per-connection
+   throughput are printed at the end.  Running this with one connection
+   and then with several shows how well the TCP/IP server serves
+   connections in parallel.  pfinet still runs the sending and receiving
+   of every socket under its one global_lock, so there the connections
+   share the throughput of a single one rather than adding up.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+static int connections = 4;
+static size_t write_size = 65536;
+static int seconds = 5;
+
+static volatile int stop;
+
+struct conn
+{
+  int wfd, rfd;
+  pthread_t writer, reader;
+  unsigned long long received;
+};
+
+static const struct argp_option options[] =
+{
+  {"connections", 'c', "N", 0, "Use N connections in parallel (default 4)"},
+  {"size", 's', "BYTES", 0, "Write BYTES at a time (default 65536)"},
+  {"time", 't', "SECONDS", 0, "Run for SECONDS (default 5)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'c':
+      connections = atoi (arg);
+      if (connections < 1)
+	argp_error (state, "%s: Invalid number of connections", arg);
+      break;
+
+    case 's':
+      write_size = strtoul (arg, 0, 0);
+      if (write_size == 0)
+	argp_error (state, "%s: Invalid write size", arg);
+      break;
+
+    case 't':
+      seconds = atoi (arg);
+      if (seconds < 1)
+	argp_error (state, "%s: Invalid time", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static void *
+writer (void *arg)
+{
+  struct conn *c = arg;
+  char *buf = malloc (write_size);
+
+  if (! buf)
+    error (1, ENOMEM, "writer");
+  memset (buf, 0x5a, write_size);
+
+  while (! stop)
+    if (write (c->wfd, buf, write_size) < 0)
+      {
+	if (errno != EINTR)
+	  error (1, errno, "write");
+      }
+
+  shutdown (c->wfd, SHUT_WR);
+  free (buf);
+  return 0;
+}
+
+static void *
+reader (void *arg)
+{
+  struct conn *c = arg;
+  char *buf = malloc (write_size);
+  ssize_t n;
+
+  if (! buf)
+    error (1, ENOMEM, "reader");
+
+  while ((n = read (c->rfd, buf, write_size)) != 0)
+    if (n < 0)
+      {
+	if (errno != EINTR)
+	  error (1, errno, "read");
+      }
+    else if (! stop)
+      c->received += n;
+
+  free (buf);
+  return 0;
+}
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure TCP throughput over the loopback interface"
+		       " with several connections in parallel." };
+  struct sockaddr_in sin;
+  socklen_t len = sizeof sin;
+  struct conn *conns;
+  unsigned long long total = 0;
+  double start, elapsed;
+  int lfd, i, one = 1;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  conns = calloc (connections, sizeof *conns);
+  if (! conns)
+    error (1, ENOMEM, "connections");
+
+  lfd = socket (PF_INET, SOCK_STREAM, 0);
+  if (lfd < 0)
+    error (1, errno, "socket");
+  memset (&sin, 0, sizeof sin);
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (bind (lfd, (struct sockaddr *) &sin, sizeof sin) < 0
+      || getsockname (lfd, (struct sockaddr *) &sin, &len) < 0
+      || listen (lfd, connections) < 0)
+    error (1, errno, "listening socket");
+
+  for (i = 0; i < connections; i++)
+    {
+      struct conn *c = &conns[i];
+
+      c->wfd = socket (PF_INET, SOCK_STREAM, 0);
+      if (c->wfd < 0)
+	error (1, errno, "socket");
+      if (connect (c->wfd, (struct sockaddr *) &sin, sizeof sin) < 0)
+	error (1, errno, "connect");
+      c->rfd = accept (lfd, 0, 0);
+      if (c->rfd < 0)
+	error (1, errno, "accept");
+      setsockopt (c->wfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+
+  start = now ();
+  for (i = 0; i < connections; i++)
+    if ((errno = pthread_create (&conns[i].reader, 0, reader, &conns[i]))
+	|| (errno = pthread_create (&conns[i].writer, 0, writer, &conns[i])))
+      error (1, errno, "pthread_create");
+
+  sleep (seconds);
+  stop = 1;
+  elapsed = now () - start;
+
+  for (i = 0; i < connections; i++)
+    {
+      pthread_join (conns[i].writer, 0);
+      pthread_join (conns[i].reader, 0);
+      close (conns[i].wfd);
+      close (conns[i].rfd);
+      total += conns[i].received;
+    }
+  close (lfd);
+
+  for (i = 0; i < connections; i++)
+    printf ("connection %d: %.2f MB/s\n",
+	    i, conns[i].received / elapsed / 1e6);
+  printf ("%d connections, %zu byte writes: %.2f MB/s in total\n",
+	  connections, write_size, total / elapsed / 1e6);
+
+  return 0;
+}
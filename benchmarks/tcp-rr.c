@@ -0,0 +1,212 @@
+/* Measure TCP request/response latency over the loopback interface
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* A thread answers every request it reads on a connection with a
+   response of the same size, and the main thread times each round trip.
+   Nearly all of the time goes into the TCP/IP server's handling of
+   io_write and io_read, which makes this a fair measure of the cost of
+   getting at its stack from an RPC thread.  */
+
+#include <argp.h>
+#include <error.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+static int round_trips = 100000;
+static size_t message_size = 1;
+
+static const struct argp_option options[] =
+{
+  {"count", 'n', "N", 0, "Make N round trips (default 100000)"},
+  {"size", 's', "BYTES", 0, "Send BYTES each way (default 1)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'n':
+      round_trips = atoi (arg);
+      if (round_trips < 1)
+	argp_error (state, "%s: Invalid number of round trips", arg);
+      break;
+
+    case 's':
+      message_size = strtoul (arg, 0, 0);
+      if (message_size == 0)
+	argp_error (state, "%s: Invalid message size", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+/* Read exactly LEN bytes from FD into BUF.  Return 0 at end of file.  */
+static int
+read_all (int fd, char *buf, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t n = read (fd, buf, len);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  error (1, errno, "read");
+	}
+      if (n == 0)
+	return 0;
+      buf += n;
+      len -= n;
+    }
+  return 1;
+}
+
+static void
+write_all (int fd, const char *buf, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t n = write (fd, buf, len);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  error (1, errno, "write");
+	}
+      buf += n;
+      len -= n;
+    }
+}
+
+static void *
+responder (void *arg)
+{
+  int fd = (int) (long) arg;
+  char *buf = malloc (message_size);
+
+  if (! buf)
+    error (1, ENOMEM, "responder");
+
+  while (read_all (fd, buf, message_size))
+    write_all (fd, buf, message_size);
+
+  free (buf);
+  return 0;
+}
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Measure TCP request/response latency over the"
+		       " loopback interface." };
+  struct sockaddr_in sin;
+  socklen_t len = sizeof sin;
+  pthread_t thread;
+  double *rtt, total = 0;
+  char *buf;
+  int lfd, cfd, sfd, i, one = 1;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  rtt = calloc (round_trips, sizeof *rtt);
+  buf = calloc (1, message_size);
+  if (! rtt || ! buf)
+    error (1, ENOMEM, "buffers");
+
+  lfd = socket (PF_INET, SOCK_STREAM, 0);
+  if (lfd < 0)
+    error (1, errno, "socket");
+  memset (&sin, 0, sizeof sin);
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (bind (lfd, (struct sockaddr *) &sin, sizeof sin) < 0
+      || getsockname (lfd, (struct sockaddr *) &sin, &len) < 0
+      || listen (lfd, 1) < 0)
+    error (1, errno, "listening socket");
+
+  cfd = socket (PF_INET, SOCK_STREAM, 0);
+  if (cfd < 0)
+    error (1, errno, "socket");
+  if (connect (cfd, (struct sockaddr *) &sin, sizeof sin) < 0)
+    error (1, errno, "connect");
+  sfd = accept (lfd, 0, 0);
+  if (sfd < 0)
+    error (1, errno, "accept");
+  setsockopt (cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+  setsockopt (sfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+  errno = pthread_create (&thread, 0, responder, (void *) (long) sfd);
+  if (errno)
+    error (1, errno, "pthread_create");
+
+  for (i = 0; i < round_trips; i++)
+    {
+      double start = now_ns ();
+      write_all (cfd, buf, message_size);
+      if (! read_all (cfd, buf, message_size))
+	error (1, 0, "connection closed early");
+      rtt[i] = now_ns () - start;
+      total += rtt[i];
+    }
+
+  shutdown (cfd, SHUT_WR);
+  pthread_join (thread, 0);
+  close (cfd);
+  close (sfd);
+  close (lfd);
+
+  qsort (rtt, round_trips, sizeof *rtt, compare_doubles);
+  printf ("%d round trips of %zu bytes: mean %.1f us, p50 %.1f us,"
+	  " p90 %.1f us, p99 %.1f us, max %.1f us\n",
+	  round_trips, message_size, total / round_trips / 1e3,
+	  rtt[round_trips / 2] / 1e3, rtt[round_trips * 9 / 10] / 1e3,
+	  rtt[round_trips * 99 / 100] / 1e3, rtt[round_trips - 1] / 1e3);
+
+  return 0;
+}
@@ -50,6 +50,12 @@ ds_device_open (mach_port_t master_port, mach_port_t reply_port,
   if (pi == NULL)
     return D_NO_SUCH_DEVICE;
 
+  if (pi->po->np->nn->mac_table)
+    {
+      ports_port_deref (pi);
+      return D_NO_SUCH_DEVICE;
+    }
+
   /* If the virtual device hasn't been created yet,
    * create it now. */
   if (pi->po->np->nn->ln == NULL)
@@ -113,10 +119,10 @@ ds_device_write (struct vether_device *vdev, mach_port_t reply_port,
     return D_DEVICE_DOWN;
 
   /* The packet is forwarded to all virtual interfaces and
-   * the interface which the multiplexer connects to. */
-  broadcast_pack (data, datalen, vdev);
+   * the interface which the multiplexer connects to,
+   * unless the learning switch knows where it goes. */
   *bytes_written = datalen;
-  if(ether_port != MACH_PORT_NULL)
+  if (forward_pack (data, datalen, vdev) && ether_port != MACH_PORT_NULL)
     ret = device_write (ether_port, mode , recnum ,
 			data, datalen, bytes_written);
   /* The data in device_write() is transmifered out of line,
@@ -69,7 +69,7 @@ int ethernet_demuxer (mach_msg_header_t *inp,
   if (inp->msgh_id != NET_RCV_MSG_ID)
     return 0;
 
-  broadcast_msg (msg);
+  forward_msg (msg);
   /* The data from the underlying network is inside the message,
    * so we don't need to deallocate the data. */
   return 1;
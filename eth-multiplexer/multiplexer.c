@@ -59,6 +59,8 @@ static const struct argp_option options[] =
 {
     {"interface", 'i', "DEVICE", 0,
       "Network interface to use", 2},
+    {"learn", 'l', 0, 0,
+      "Send a frame only to the interface its destination was seen on", 2},
     {0}
 };
 
@@ -109,6 +111,9 @@ parse_opt (int opt, char *arg, struct argp_state *state)
     case 'i':
       device_file = arg;
       break;
+    case 'l':
+      mac_learning = 1;
+      break;
     case ARGP_KEY_ERROR:
     case ARGP_KEY_SUCCESS:
     case ARGP_KEY_INIT:
@@ -149,14 +154,15 @@ main (int argc, char *argv[])
   if (bootstrap == MACH_PORT_NULL)
     error (1, 0, "must be started as a translator");
 
-  /* Run the multiplexer server in another thread. */
-  pthread_create (&t, NULL, multiplexer_thread, NULL);
-  pthread_detach (t);
-
+  /* The learning switch needs the time as soon as packets arrive.  */
   err = maptime_map (0, 0, &multiplexer_maptime);
   if (err)
     error (4, err, "Cannot map time");
 
+  /* Run the multiplexer server in another thread. */
+  pthread_create (&t, NULL, multiplexer_thread, NULL);
+  pthread_detach (t);
+
   /* Initialize netfs and start the translator. */
   netfs_init ();
 
@@ -203,6 +209,8 @@ netfs_append_args (char **argz, size_t *argz_len)
          err = argz_add (argz, argz_len, buf); } } while (0)
   if (device_file)
     ADD_OPT ("--interface=%s", device_file);
+  if (mac_learning)
+    ADD_OPT ("--learn");
 #undef ADD_OPT
   return err;
 }
@@ -154,7 +154,7 @@ error_t
 netfs_report_access (struct iouser *cred, struct node *node, int *types)
 {
   debug("");
-  *types = 0;
+  *types = node->nn->mac_table ? O_READ : 0;
   return 0;
 }
 
@@ -167,6 +167,12 @@ netfs_validate_stat (struct node *node, struct iouser *cred)
 
   if (node->nn->ln)
     st = node->nn->ln->st;
+  else if (node->nn->mac_table)
+    {
+      st = underlying_node_stat;
+      st.st_mode = S_IFREG | (st.st_mode & (S_IRUSR | S_IRGRP | S_IROTH));
+      st.st_size = 0;
+    }
   else
     st = underlying_node_stat;
 
@@ -260,6 +266,8 @@ netfs_get_dirents (struct iouser *cred, struct node *dir,
 	{
 	  add_dirent (".", 2, DT_DIR);
 	  add_dirent ("..", 2, DT_DIR);
+	  if (mac_learning)
+	    add_dirent (MAC_TABLE_NAME, 2, DT_REG);
 	  foreach_dev_do (add_each_dev);
 	}
 
@@ -304,6 +312,19 @@ error_t netfs_attempt_lookup (struct iouser *user, struct node *dir,
       return err;
     }
 
+  if (mac_learning && strcmp (name, MAC_TABLE_NAME) == 0)
+    {
+      err = new_node (NULL, node);
+      if (! err)
+	{
+	  (*node)->nn->name = strdup (name);
+	  (*node)->nn->mac_table = 1;
+	  pthread_mutex_lock (&(*node)->lock);
+	}
+      pthread_mutex_unlock (&dir->lock);
+      return err;
+    }
+
   *node = lookup (name);
   pthread_mutex_lock (&(*node)->lock);
   pthread_mutex_unlock (&dir->lock);
@@ -480,8 +501,28 @@ error_t netfs_attempt_readlink (struct iouser *user, struct node *node, char *bu
 error_t netfs_attempt_read (struct iouser *cred, struct node *node,
 			    off_t offset, size_t *len, void *data)
 {
+  error_t err;
+  char *table;
+  size_t table_len;
+
   debug("");
-  return EOPNOTSUPP;
+  if (! node->nn->mac_table)
+    return EOPNOTSUPP;
+
+  err = mac_table_dump (&table, &table_len);
+  if (err)
+    return err;
+
+  if (offset >= table_len)
+    *len = 0;
+  else
+    {
+      if (*len > table_len - offset)
+	*len = table_len - offset;
+      memcpy (data, table + offset, *len);
+    }
+  free (table);
+  return 0;
 }
 
 /* Write to the file NODE for user CRED starting at OFSET and continuing for up
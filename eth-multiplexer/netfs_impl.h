@@ -30,8 +30,12 @@ struct netnode
 {
   struct lnode *ln;
   char *name;
+  /* True for MAC_TABLE_NAME, which lists the learning switch's table.  */
+  int mac_table;
 };
 
+#define MAC_TABLE_NAME ".mac-table"
+
 struct lnode
 {
   struct vether_device vdev;
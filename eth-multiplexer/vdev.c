@@ -27,7 +27,9 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <error.h>
+#include <maptime.h>
 #include <hurd/ihash.h>
 
 #include <pthread.h>
@@ -37,6 +39,7 @@
 #include "queue.h"
 #include "bpf_impl.h"
 #include "util.h"
+#include "netfs_impl.h"
 
 
 static struct vether_device *dev_head;
@@ -179,6 +182,147 @@ add_vdev (char *name, size_t size)
   return vdev;
 }
 
+/* With --learn, the multiplexer works as a learning switch: it remembers
+   the interface each Ethernet address was last seen on, and passes a
+   unicast frame for a known address to that interface alone, rather than
+   to every one.  Frames for unknown addresses, broadcasts and multicasts
+   are still flooded.  The real interface is entered in the table as a
+   null device.  */
+int mac_learning;
+
+/* An address is forgotten this many seconds after it was last seen, so
+   that a host moving to another interface is found again.  */
+#define MAC_ENTRY_AGE 300
+
+/* Never remember more than this many addresses.  */
+#define MAC_TABLE_MAX 4096
+
+struct mac_entry
+{
+  hurd_ihash_locp_t locp;
+  unsigned char addr[ETH_ALEN];
+  struct vether_device *vdev;
+  time_t seen;
+};
+
+static hurd_ihash_key_t
+mac_hash (const void *key)
+{
+  return hurd_ihash_hash32 (key, ETH_ALEN, 0);
+}
+
+static int
+mac_compare (const void *a, const void *b)
+{
+  return memcmp (a, b, ETH_ALEN) == 0;
+}
+
+static struct hurd_ihash mac_table
+  = HURD_IHASH_INITIALIZER_GKI (offsetof (struct mac_entry, locp),
+				NULL, NULL, mac_hash, mac_compare);
+
+/* Protects MAC_TABLE.  destroy_vdev takes it to forget a device's
+   addresses before the device is freed, so the devices in the table can
+   be looked at while it is held.  */
+static pthread_mutex_t mac_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define is_multicast(addr) (((const unsigned char *) (addr))[0] & 1)
+
+static time_t
+mac_table_now (void)
+{
+  struct timeval tv;
+  maptime_read (multiplexer_maptime, &tv);
+  return tv.tv_sec;
+}
+
+/* Forget the addresses last seen on VDEV, or those not seen for
+   MAC_ENTRY_AGE seconds before NOW if VDEV is null.  MAC_TABLE_LOCK must
+   be held.  */
+static void
+mac_table_forget (struct vether_device *vdev, time_t now)
+{
+  HURD_IHASH_ITERATE (&mac_table, value)
+    {
+      struct mac_entry *e = value;
+      if (vdev ? e->vdev == vdev : now - e->seen > MAC_ENTRY_AGE)
+	{
+	  hurd_ihash_locp_remove (&mac_table, e->locp);
+	  free (e);
+	}
+    }
+}
+
+/* Remember that ADDR was seen on VDEV, or on the real interface if VDEV
+   is null, at NOW.  MAC_TABLE_LOCK must be held.  */
+static void
+mac_table_learn (const unsigned char *addr, struct vether_device *vdev,
+		 time_t now)
+{
+  static time_t last_expired;
+  struct mac_entry *e;
+
+  if (is_multicast (addr))
+    return;
+
+  e = hurd_ihash_find (&mac_table, (hurd_ihash_key_t) addr);
+  if (! e)
+    {
+      /* Make room by forgetting old addresses, at most once a second.  */
+      if (mac_table.nr_items >= MAC_TABLE_MAX && last_expired != now)
+	{
+	  mac_table_forget (NULL, now);
+	  last_expired = now;
+	}
+      if (mac_table.nr_items >= MAC_TABLE_MAX)
+	return;
+
+      e = malloc (sizeof *e);
+      if (! e)
+	return;
+      memcpy (e->addr, addr, ETH_ALEN);
+      if (hurd_ihash_add (&mac_table, (hurd_ihash_key_t) e->addr, e))
+	{
+	  free (e);
+	  return;
+	}
+    }
+
+  e->vdev = vdev;
+  e->seen = now;
+}
+
+/* Write the addresses in the table, one per line, with the interface each
+   was seen on and how many seconds ago, to a malloced buffer, and return
+   it in *DATA and its length in *LEN.  */
+error_t
+mac_table_dump (char **data, size_t *len)
+{
+  FILE *f = open_memstream (data, len);
+  time_t now;
+
+  if (! f)
+    return errno;
+
+  now = mac_table_now ();
+  pthread_mutex_lock (&mac_table_lock);
+  HURD_IHASH_ITERATE (&mac_table, value)
+    {
+      struct mac_entry *e = value;
+      if (now - e->seen > MAC_ENTRY_AGE)
+	continue;
+      fprintf (f, "%02x:%02x:%02x:%02x:%02x:%02x %s %ld\n",
+	       e->addr[0], e->addr[1], e->addr[2],
+	       e->addr[3], e->addr[4], e->addr[5],
+	       e->vdev ? e->vdev->name : "-", (long) (now - e->seen));
+    }
+  pthread_mutex_unlock (&mac_table_lock);
+
+  if (fclose (f))
+    return errno;
+  return 0;
+}
+
 void
 destroy_vdev (void *port)
 {
@@ -193,6 +337,10 @@ destroy_vdev (void *port)
   dev_num--;
   pthread_mutex_unlock (&dev_list_lock);
 
+  pthread_mutex_lock (&mac_table_lock);
+  mac_table_forget (vdev, 0);
+  pthread_mutex_unlock (&mac_table_lock);
+
   /* TODO Delete all filters in the interface,
    * there shouldn't be any filters left */
   destroy_filters (&vdev->port_list);
@@ -200,19 +348,93 @@ destroy_vdev (void *port)
 
 static int deliver_msg (struct net_rcv_msg *msg, struct vether_device *vdev);
 
-/* Broadcast the packet to all virtual interfaces
- * except the one the packet is from */
+/* Fill in the parts of MSG's header that are the same for every port it
+   is sent to.  */
+static void
+prepare_msg (struct net_rcv_msg *msg)
+{
+  msg->msg_hdr.msgh_bits = MACH_MSGH_BITS (MACH_MSG_TYPE_COPY_SEND, 0);
+  msg->msg_hdr.msgh_local_port = MACH_PORT_NULL;
+  msg->msg_hdr.msgh_seqno = 0;
+  msg->msg_hdr.msgh_id = NET_RCV_MSG_ID;
+}
+
+/* What switch_msg did with a frame.  */
+enum
+{
+  SWITCH_FLOOD,		/* Nothing; it goes to every interface.  */
+  SWITCH_DONE,		/* Delivered it, or dropped it.  */
+  SWITCH_IFACE,		/* Nothing; it goes to the real interface only.  */
+};
+
+/* Learn the source address of MSG, which came from FROM_VDEV, or from the
+   real interface if FROM_VDEV is null, and if its destination is known
+   to be on a virtual interface, deliver it there.  */
+static int
+switch_msg (struct net_rcv_msg *msg, struct vether_device *from_vdev)
+{
+  struct ethhdr *header = (struct ethhdr *) msg->header;
+  struct vether_device *to_vdev = NULL;
+  struct mac_entry *e;
+  int ret = SWITCH_FLOOD;
+  time_t now;
+
+  if (! mac_learning)
+    return SWITCH_FLOOD;
+
+  now = mac_table_now ();
+  pthread_mutex_lock (&mac_table_lock);
+  mac_table_learn (header->h_source, from_vdev, now);
+  if (! is_multicast (header->h_dest))
+    {
+      e = hurd_ihash_find (&mac_table, (hurd_ihash_key_t) header->h_dest);
+      if (e && now - e->seen <= MAC_ENTRY_AGE)
+	{
+	  if (! e->vdev)
+	    ret = SWITCH_IFACE;
+	  else
+	    {
+	      /* A frame for an address on the interface it came from is
+		 dropped.  The device may be going away, in which case its
+		 port is no longer found and the frame is dropped too.  */
+	      if (e->vdev != from_vdev && (e->vdev->if_flags & IFF_UP))
+		to_vdev = ports_lookup_port (port_bucket, e->vdev->dev_port,
+					     vdev_portclass);
+	      ret = SWITCH_DONE;
+	    }
+	}
+    }
+  pthread_mutex_unlock (&mac_table_lock);
+
+  if (to_vdev)
+    {
+      deliver_msg (msg, to_vdev);
+      ports_port_deref (to_vdev);
+    }
+  return ret;
+}
+
+/* Forward the packet to the virtual interfaces that should get it, which
+   is all of them except the one the packet is from, unless the switch
+   knows better.  Return true if it should go to the real interface
+   too.  */
 int
-broadcast_pack (char *data, int datalen, struct vether_device *from_vdev)
+forward_pack (char *data, int datalen, struct vether_device *from_vdev)
 {
   struct net_rcv_msg msg;
   int pack_size;
   struct ethhdr *header;
   struct packet_header *packet;
+  int ret;
 
   pack_size = datalen - sizeof (struct ethhdr);
+  if (pack_size < 0
+      || pack_size > NET_RCV_MAX - sizeof (struct packet_header))
+    return 1;
+
   /* remember message sizes must be rounded up */
-  msg.msg_hdr.msgh_size = sizeof (struct net_rcv_msg) - NET_RCV_MAX + pack_size;
+  msg.msg_hdr.msgh_size = sizeof (struct net_rcv_msg) - NET_RCV_MAX
+			  + pack_size;
   msg.msg_hdr.msgh_size = (mach_msg_size_t) ((msg.msg_hdr.msgh_size +
       MSG_ALIGNMENT - 1) & ~(MSG_ALIGNMENT - 1));
 
@@ -225,6 +447,7 @@ broadcast_pack (char *data, int datalen, struct vether_device *from_vdev)
   packet->type = header->h_proto;
   packet->length = pack_size + sizeof (struct packet_header);
   msg.packet_type.msgt_number = packet->length;
+  prepare_msg (&msg);
 
   int internal_deliver_pack (struct vether_device *vdev)
     {
@@ -237,12 +460,17 @@ broadcast_pack (char *data, int datalen, struct vether_device *from_vdev)
       return deliver_msg (&msg, vdev);
     }
 
-  return foreach_dev_do (internal_deliver_pack);
+  ret = switch_msg (&msg, from_vdev);
+  if (ret == SWITCH_FLOOD)
+    foreach_dev_do (internal_deliver_pack);
+
+  return ret != SWITCH_DONE;
 }
 
-/* Broadcast the message to all virtual interfaces. */
+/* Forward the message from the real interface to the virtual interfaces
+   that should get it. */
 int
-broadcast_msg (struct net_rcv_msg *msg)
+forward_msg (struct net_rcv_msg *msg)
 {
   int rval = 0;
   mach_msg_header_t header;
@@ -257,7 +485,9 @@ broadcast_msg (struct net_rcv_msg *msg)
 
   /* Save the message header because deliver_msg will change it. */
   header = msg->msg_hdr;
-  rval = foreach_dev_do (internal_deliver_msg);
+  prepare_msg (msg);
+  if (switch_msg (msg, NULL) == SWITCH_FLOOD)
+    rval = foreach_dev_do (internal_deliver_msg);
   msg->msg_hdr = header;
   return rval;
 }
@@ -265,6 +495,7 @@ broadcast_msg (struct net_rcv_msg *msg)
 /*
  * Deliver the message to all right pfinet servers that
  * connects to the virtual network interface.
+ * prepare_msg must have been called on it.
  */
 static int
 deliver_msg(struct net_rcv_msg *msg, struct vether_device *vdev)
@@ -273,12 +504,6 @@ deliver_msg(struct net_rcv_msg *msg, struct vether_device *vdev)
   queue_head_t *if_port_list;
   net_rcv_port_t infp, nextfp;
 
-  msg->msg_hdr.msgh_bits = MACH_MSGH_BITS (MACH_MSG_TYPE_COPY_SEND, 0);
-  /* remember message sizes must be rounded up */
-  msg->msg_hdr.msgh_local_port = MACH_PORT_NULL;
-  msg->msg_hdr.msgh_seqno = 0;
-  msg->msg_hdr.msgh_id = NET_RCV_MSG_ID;
-
   if_port_list = &vdev->port_list.if_rcv_port_list;
   FILTER_ITERATE (if_port_list, infp, nextfp, &infp->input)
     {
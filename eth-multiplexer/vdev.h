@@ -68,11 +68,15 @@ int remove_dead_port_from_dev (mach_port_t dead_port);
 struct vether_device *add_vdev (char *name, size_t size);
 void destroy_vdev (void *port);
 boolean_t all_dev_close (void);
-int broadcast_pack (char *data, int datalen, struct vether_device *from_vdev);
-int broadcast_msg (struct net_rcv_msg *msg);
+int forward_pack (char *data, int datalen, struct vether_device *from_vdev);
+int forward_msg (struct net_rcv_msg *msg);
 int get_dev_num (void);
 int foreach_dev_do (dev_act_func func);
 
+/* True if the multiplexer works as a learning switch.  */
+extern int mac_learning;
+error_t mac_table_dump (char **data, size_t *len);
+
 /* dev_stat.c */
 io_return_t dev_getstat (struct vether_device *, dev_flavor_t,
                          dev_status_t, natural_t *);
@@ -0,0 +1,232 @@
+/* GNU Hurd standard exec server, cache of checked ELF files.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd; see the file COPYING.  If not, write to
+   the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
+
+/* Shell scripts exec the same few programs, and the same ld.so, over and
+   over.  Checking each means mapping in its headers, faulting their page
+   in from the file system, and going through its program headers, and
+   for a dynamically linked program, mapping in the name of its
+   interpreter too.  So we keep what check_elf found out about the last
+   files we checked, by the identity port io_identity gives for them, the
+   way check_hashbang tells files apart.  An entry is only used if the
+   file still has the times and size it had when it was checked.
+
+   The file is still opened, io_map'd and io_stat'd for each exec: the
+   caller's port must allow that, and we have to see whether the file has
+   changed anyway.  Only the contents of the file are cached, which are
+   the same whoever execs it.  */
+
+#include "priv.h"
+#include <hurd/io.h>
+
+/* How many files to keep; set with --cache-size.  */
+int elf_cache_size = 64;
+
+static struct hurd_ihash elf_cache
+  = HURD_IHASH_INITIALIZER (offsetof (struct elf_cache_entry, locp));
+static pthread_mutex_t elf_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long elf_cache_clock;
+
+/* Free C if nothing uses it any more.  ELF_CACHE_LOCK must be held.  */
+static void
+unref (struct elf_cache_entry *c)
+{
+  if (--c->refs > 0)
+    return;
+
+  mach_port_deallocate (mach_task_self (), c->idport);
+  free (c->interp);
+  free (c);
+}
+
+/* Take C out of the cache.  ELF_CACHE_LOCK must be held.  */
+static void
+drop (struct elf_cache_entry *c)
+{
+  hurd_ihash_locp_remove (&elf_cache, c->locp);
+  unref (c);
+}
+
+/* Drop the least recently used entries until there are fewer than
+   MAX.  ELF_CACHE_LOCK must be held.  */
+static void
+make_room (size_t max)
+{
+  while (elf_cache.nr_items > 0 && elf_cache.nr_items >= max)
+    {
+      struct elf_cache_entry *lru = NULL;
+
+      HURD_IHASH_ITERATE (&elf_cache, value)
+	{
+	  struct elf_cache_entry *c = value;
+	  if (! lru || c->used < lru->used)
+	    lru = c;
+	}
+      drop (lru);
+    }
+}
+
+static int
+unchanged (const struct elf_cache_entry *c, const struct execdata *e)
+{
+  return (c->file_size == e->file_size
+	  && c->mtime.tv_sec == e->mtime.tv_sec
+	  && c->mtime.tv_nsec == e->mtime.tv_nsec
+	  && c->ctime.tv_sec == e->ctime.tv_sec
+	  && c->ctime.tv_nsec == e->ctime.tv_nsec);
+}
+
+int
+elf_cache_find (struct execdata *e, mach_port_t *idport)
+{
+  struct elf_cache_entry *c;
+  mach_port_t fsidport;
+  ino64_t fileno;
+
+  *idport = MACH_PORT_NULL;
+
+  /* Without the shared page, prepare has done an io_stat, which gives
+     the times.  */
+  if (elf_cache_size == 0 || e->cntl)
+    return 0;
+
+  if (io_identity (e->file, idport, &fsidport, &fileno))
+    {
+      *idport = MACH_PORT_NULL;
+      return 0;
+    }
+  mach_port_deallocate (mach_task_self (), fsidport);
+
+  pthread_mutex_lock (&elf_cache_lock);
+  c = hurd_ihash_find (&elf_cache, (hurd_ihash_key_t) *idport);
+  if (c && ! unchanged (c, e))
+    {
+      drop (c);
+      c = NULL;
+    }
+  if (c)
+    {
+      c->refs++;
+      c->used = ++elf_cache_clock;
+    }
+  pthread_mutex_unlock (&elf_cache_lock);
+
+  if (! c)
+    return 0;
+
+  /* The entry has a reference of its own.  */
+  mach_port_deallocate (mach_task_self (), *idport);
+  *idport = MACH_PORT_NULL;
+
+  e->cached = c;
+  e->error = 0;
+  e->entry = c->entry;
+  e->info.elf.anywhere = c->anywhere;
+  e->info.elf.loadbase = 0;
+  e->info.elf.phnum = c->phnum;
+  e->info.elf.phdr = c->phdr;
+  e->info.elf.phdr_addr = c->phdr_addr;
+  return 1;
+}
+
+void
+elf_cache_enter (struct execdata *e, mach_port_t idport)
+{
+  struct elf_cache_entry *c, *old;
+  const ElfW(Phdr) *ph;
+
+  if (! MACH_PORT_VALID (idport))
+    return;
+
+  c = e->error ? NULL : malloc (sizeof *c
+				+ e->info.elf.phnum * sizeof (ElfW(Phdr)));
+  if (! c)
+    {
+      mach_port_deallocate (mach_task_self (), idport);
+      return;
+    }
+
+  c->idport = idport;
+  c->mtime = e->mtime;
+  c->ctime = e->ctime;
+  c->file_size = e->file_size;
+  c->entry = e->entry;
+  c->anywhere = e->info.elf.anywhere;
+  c->phdr_addr = e->info.elf.phdr_addr;
+  c->phnum = e->info.elf.phnum;
+  memcpy (c->phdr, e->info.elf.phdr,
+	  c->phnum * sizeof (ElfW(Phdr))); /* XXX/fault */
+  c->interp = NULL;
+
+  /* This may reuse the mapping window, so E must use our copy of the
+     program headers from now on.  */
+  e->info.elf.phdr = c->phdr;
+
+  for (ph = c->phdr; ph < &c->phdr[c->phnum]; ++ph)
+    if (ph->p_type == PT_INTERP)
+      {
+	/* Find the name the way do_exec does.  */
+	const char *name = map (e, ph->p_offset & ~(ph->p_align - 1),
+				ph->p_filesz);
+	if (name)
+	  c->interp = strndup (name, ph->p_filesz); /* XXX/fault */
+	if (! c->interp)
+	  {
+	    /* Leave it to do_exec to find out what went wrong.  E still
+	       uses our copy of the program headers, so give it C as an
+	       entry of its own, which is not put in the cache.  */
+	    e->error = 0;
+	    c->refs = 1;
+	    e->cached = c;
+	    return;
+	  }
+	break;
+      }
+
+  /* One reference for the cache and one for E.  */
+  c->refs = 2;
+  e->cached = c;
+
+  pthread_mutex_lock (&elf_cache_lock);
+  c->used = ++elf_cache_clock;
+  old = hurd_ihash_find (&elf_cache, (hurd_ihash_key_t) idport);
+  if (old)
+    drop (old);
+  make_room (elf_cache_size);
+  if (elf_cache_size == 0
+      || hurd_ihash_add (&elf_cache, (hurd_ihash_key_t) idport, c))
+    c->refs--;
+  pthread_mutex_unlock (&elf_cache_lock);
+}
+
+void
+elf_cache_release (struct elf_cache_entry *c)
+{
+  pthread_mutex_lock (&elf_cache_lock);
+  unref (c);
+  pthread_mutex_unlock (&elf_cache_lock);
+}
+
+/* Drop what does not fit in ELF_CACHE_SIZE any more.  */
+void
+elf_cache_trim (void)
+{
+  pthread_mutex_lock (&elf_cache_lock);
+  make_room (elf_cache_size + 1);
+  pthread_mutex_unlock (&elf_cache_lock);
+}
@@ -400,6 +400,9 @@ prepare (file_t file, struct execdata *e)
   e->cntlmap = MACH_PORT_NULL;
 
   e->interp.section = NULL;
+  e->cached = NULL;
+  e->mtime.tv_sec = e->ctime.tv_sec = 0;
+  e->mtime.tv_nsec = e->ctime.tv_nsec = 0;
 
   e->start_code = 0;
   e->end_code = 0;
@@ -469,6 +472,8 @@ prepare (file_t file, struct execdata *e)
       if (e->error)
 	return;
       e->file_size = st.st_size;
+      e->mtime = st.st_mtim;
+      e->ctime = st.st_ctim;
       e->optimal_block = st.st_blksize;
     }
 }
@@ -603,7 +608,12 @@ check_elf_phdr (struct execdata *e, const ElfW(Phdr) *mapped_phdr)
 static void
 check (struct execdata *e)
 {
+  mach_port_t idport;
+
+  if (elf_cache_find (e, &idport))
+    return;
   check_elf (e);		/* XXX/fault */
+  elf_cache_enter (e, idport);
 }
 
 
@@ -655,6 +665,11 @@ finish (struct execdata *e, int dealloc_file)
 	map_buffer (e) = NULL;
       }
     }
+  if (e->cached != NULL)
+    {
+      elf_cache_release (e->cached);
+      e->cached = NULL;
+    }
   if (dealloc_file && e->file != MACH_PORT_NULL)
     {
       mach_port_deallocate (mach_task_self (), e->file);
@@ -1140,9 +1155,10 @@ do_exec (file_t file,
 	 along with this executable.  Find the name of the file and open
 	 it.  */
 
-      char *name = map (&e, (e.interp.phdr->p_offset
-			     & ~(e.interp.phdr->p_align - 1)),
-			e.interp.phdr->p_filesz);
+      char *name = (e.cached && e.cached->interp ? e.cached->interp
+		    : map (&e, (e.interp.phdr->p_offset
+				& ~(e.interp.phdr->p_align - 1)),
+			   e.interp.phdr->p_filesz));
       if (! name && ! e.error)
 	e.error = ENOEXEC;
 
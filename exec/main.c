@@ -111,12 +111,16 @@ deadboot (void *p)
 }
 
 #define OPT_DEVICE_MASTER_PORT	(-1)
+#define OPT_CACHE_SIZE		(-2)
 
 static const struct argp_option options[] =
 {
   {"device-master-port", OPT_DEVICE_MASTER_PORT, "PORT", 0,
    "If specified, a boot-time exec server can print "
    "diagnostic messages earlier.", 0},
+  {"cache-size", OPT_CACHE_SIZE, "N", 0,
+   "Keep what checking the last N executables found out, "
+   "for execing them again (default 64, 0 to keep nothing)", 0},
   {0}
 };
 
@@ -135,6 +139,20 @@ parse_opt (int opt, char *arg, struct argp_state *state)
     case OPT_DEVICE_MASTER_PORT:
       opt_device_master = atoi (arg);
       break;
+
+    case OPT_CACHE_SIZE:
+      {
+	char *end;
+	long n = strtol (arg, &end, 10);
+	if (*end || n < 0)
+	  {
+	    argp_error (state, "%s: Invalid cache size", arg);
+	    return EINVAL;
+	  }
+	elf_cache_size = n;
+	elf_cache_trim ();
+      }
+      break;
     }
   return 0;
 }
@@ -159,6 +177,17 @@ trivfs_append_args (struct trivfs_control *fsys,
 	}
     }
 
+  if (! err)
+    {
+      asprintf (&opt, "--cache-size=%d", elf_cache_size);
+
+      if (opt)
+	{
+	  err = argz_add (argz, argz_len, opt);
+	  free (opt);
+	}
+    }
+
   return err;
 }
 
@@ -27,6 +27,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include <hurd/trivfs.h>
 #include <hurd/ports.h>
 #include <hurd/lookup.h>
+#include <hurd/ihash.h>
 #include <pthread.h>
 
 #include <elf.h>
@@ -64,6 +65,28 @@ extern mach_port_t procserver;	/* Our proc port.  */
 
 typedef void asection;
 
+/* What checking an ELF file found out, kept by elfcache.c for later execs
+   of the same file.  */
+struct elf_cache_entry
+  {
+    hurd_ihash_locp_t locp;
+    mach_port_t idport;		/* Identity of the file; the key.  */
+    struct timespec mtime, ctime; /* Its times and size when checked.  */
+    off_t file_size;
+    unsigned int refs;
+    unsigned long used;		/* When it was last used.  */
+
+    vm_address_t entry;
+    int anywhere;
+    ElfW(Addr) phdr_addr;
+    char *interp;		/* Name of the PT_INTERP file, or null if
+				   there is none, or if it could not be
+				   read, in which case the entry is not
+				   in the cache.  */
+    ElfW(Word) phnum;
+    ElfW(Phdr) phdr[];
+  };
+
 /* Data shared between check, check_section,
    load, load_section, and finish.  */
 struct execdata
@@ -100,8 +123,12 @@ struct execdata
     struct shared_io *cntl;
     char *file_data;		/* File data if already copied in core.  */
     off_t file_size;
+    struct timespec mtime, ctime; /* Set by prepare, with file_size.  */
     size_t optimal_block;	/* Optimal size for io_read from file.  */
 
+    /* Set by check if the file was found in the cache, or put there.  */
+    struct elf_cache_entry *cached;
+
     /* Set by caller of load.  */
     task_t task;
 
@@ -132,6 +159,17 @@ void finish (struct execdata *, int dealloc_file_port);
 void *map (struct execdata *e, off_t posn, size_t len);
 
 
+/* The cache of checked ELF files, in elfcache.c.  ELF_CACHE_FIND looks
+   the file of E up; if it is there and has not changed since, it fills in
+   what check_elf would and returns nonzero.  Otherwise, it leaves the
+   identity of the file in *IDPORT for ELF_CACHE_ENTER, to be called after
+   check_elf, which enters it if it was found good.  */
+extern int elf_cache_size;
+int elf_cache_find (struct execdata *e, mach_port_t *idport);
+void elf_cache_enter (struct execdata *e, mach_port_t idport);
+void elf_cache_release (struct elf_cache_entry *c);
+void elf_cache_trim (void);
+
 void check_hashbang (struct execdata *e,
 		     file_t file,
 		     task_t oldtask,
@@ -29,4 +29,25 @@ typedef const recnum_t *const_recnum_array_t;
 typedef vm_size_t *vm_size_array_t;
 typedef const vm_size_t *const_vm_size_array_t;
 
+/* Indices into the array returned by default_pager_statistics.  */
+enum
+  {
+    DEFAULT_PAGER_STAT_PAGEINS,		/* pages supplied to the kernel */
+    DEFAULT_PAGER_STAT_PAGEOUTS,	/* pages received from the kernel */
+    DEFAULT_PAGER_STAT_CLUSTER_WRITES,	/* device writes for them */
+    DEFAULT_PAGER_STAT_CLUSTER_PAGES,	/* pages in those writes */
+    DEFAULT_PAGER_STAT_CLUSTER_MAX,	/* largest write, in pages */
+    DEFAULT_PAGER_STAT_READAHEAD_READS,	/* device reads with readahead */
+    DEFAULT_PAGER_STAT_READAHEAD_PAGES,	/* pages read ahead */
+    DEFAULT_PAGER_STAT_READAHEAD_HITS,	/* requests satisfied from them */
+    DEFAULT_PAGER_STAT_ZPOOL_LIMIT,	/* compressed pool size, or 0 */
+    DEFAULT_PAGER_STAT_ZPOOL_PAGES,	/* pages in the compressed pool */
+    DEFAULT_PAGER_STAT_ZPOOL_BYTES,	/* their compressed size */
+    DEFAULT_PAGER_STAT_ZPOOL_STORES,	/* pages ever stored there */
+    DEFAULT_PAGER_STAT_ZPOOL_REJECTS,	/* pages that did not compress */
+    DEFAULT_PAGER_STAT_ZPOOL_HITS,	/* pages supplied from the pool */
+    DEFAULT_PAGER_STAT_ZPOOL_WRITEBACKS, /* pages written back from it */
+    DEFAULT_PAGER_STAT_COUNT
+  };
+
 #endif
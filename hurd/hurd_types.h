@@ -316,6 +316,16 @@ struct procinfo
 typedef int *procinfo_t;
 typedef const int *const_procinfo_t;
 
+/* proc_getprocinfos returns one of these for each process, followed by
+   its procinfo unless ERROR is nonzero.  */
+struct procinfo_record
+{
+  int size;			/* of the record with the procinfo, in ints */
+  pid_t pid;
+  int flags;			/* as proc_getprocinfo returns them */
+  int error;			/* why there is no procinfo, or 0 */
+};
+
 /* Bits in struct procinfo  state: */
 #define PI_STOPPED 0x00000001	/* Proc server thinks is stopped.  */
 #define PI_EXECED  0x00000002	/* Has called proc_exec.  */
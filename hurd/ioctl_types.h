@@ -45,4 +45,22 @@ struct srtentry {
 };
 
 typedef struct srtentry srtentry_t;
+
+/* The statistics of a network interface, as pfinet_getifstats returns
+   them.  The rates are taken over at least the last second.  */
+struct ifstatsreq {
+  char ifname[16];
+  uint64_t rx_packets;
+  uint64_t rx_bytes;
+  uint64_t rx_errors;
+  uint64_t rx_dropped;
+  uint64_t tx_packets;
+  uint64_t tx_bytes;
+  uint64_t tx_errors;
+  uint64_t tx_dropped;
+  uint32_t rx_pps;
+  uint32_t tx_pps;
+};
+
+typedef struct ifstatsreq ifstatsreq_t;
 #endif	/* hurd/ioctl_types.h */
@@ -0,0 +1,249 @@
+/* Check that decoded filters give the same results as interpreted ones
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Make up random filters that bpf_validate accepts, run random packets
+   through each with both bpf_interpret and bpf_run, and complain about
+   any difference.  The filters use every instruction bpf_interpret knows
+   but BPF_MATCH_IMM, with constants chosen to reach both the header and
+   the packet, and to go past their ends.  */
+
+#include <argp.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mach.h>
+#include <device/net_status.h>
+
+#include "bpf_impl.h"
+
+static int filters = 10000;
+static int packets = 100;
+static unsigned int seed = 1;
+
+static const struct argp_option options[] =
+{
+  {"filters", 'f', "N", 0, "Make up N filters (default 10000)"},
+  {"packets", 'p', "N", 0, "Run N packets through each (default 100)"},
+  {"seed", 's', "N", 0, "Seed the random number generator with N"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'f':
+      filters = atoi (arg);
+      break;
+
+    case 'p':
+      packets = atoi (arg);
+      break;
+
+    case 's':
+      seed = strtoul (arg, 0, 0);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static const unsigned short codes[] =
+{
+  BPF_RET|BPF_K, BPF_RET|BPF_A,
+  BPF_LD|BPF_W|BPF_ABS, BPF_LD|BPF_H|BPF_ABS, BPF_LD|BPF_B|BPF_ABS,
+  BPF_LD|BPF_W|BPF_IND, BPF_LD|BPF_H|BPF_IND, BPF_LD|BPF_B|BPF_IND,
+  BPF_LD|BPF_W|BPF_LEN, BPF_LDX|BPF_W|BPF_LEN, BPF_LDX|BPF_MSH|BPF_B,
+  BPF_LD|BPF_IMM, BPF_LDX|BPF_IMM, BPF_LD|BPF_MEM, BPF_LDX|BPF_MEM,
+  BPF_ST, BPF_STX,
+  BPF_JMP|BPF_JA, BPF_JMP|BPF_JGT|BPF_K, BPF_JMP|BPF_JGE|BPF_K,
+  BPF_JMP|BPF_JEQ|BPF_K, BPF_JMP|BPF_JSET|BPF_K,
+  BPF_JMP|BPF_JGT|BPF_X, BPF_JMP|BPF_JGE|BPF_X,
+  BPF_JMP|BPF_JEQ|BPF_X, BPF_JMP|BPF_JSET|BPF_X,
+  BPF_ALU|BPF_ADD|BPF_X, BPF_ALU|BPF_SUB|BPF_X, BPF_ALU|BPF_MUL|BPF_X,
+  BPF_ALU|BPF_DIV|BPF_X, BPF_ALU|BPF_AND|BPF_X, BPF_ALU|BPF_OR|BPF_X,
+  BPF_ALU|BPF_LSH|BPF_X, BPF_ALU|BPF_RSH|BPF_X,
+  BPF_ALU|BPF_ADD|BPF_K, BPF_ALU|BPF_SUB|BPF_K, BPF_ALU|BPF_MUL|BPF_K,
+  BPF_ALU|BPF_DIV|BPF_K, BPF_ALU|BPF_AND|BPF_K, BPF_ALU|BPF_OR|BPF_K,
+  BPF_ALU|BPF_LSH|BPF_K, BPF_ALU|BPF_RSH|BPF_K,
+  BPF_ALU|BPF_NEG, BPF_MISC|BPF_TAX, BPF_MISC|BPF_TXA,
+  /* Not an instruction.  */
+  BPF_MISC|0xf8,
+};
+
+#define HLEN 14
+
+/* A constant for CODE: mostly small, to land in the header or the
+   start of the packet, or to equal what was loaded from it, sometimes
+   anywhere.  */
+static int
+random_k (unsigned short code)
+{
+  if (BPF_CLASS (code) == BPF_ST || BPF_CLASS (code) == BPF_STX
+      || ((BPF_CLASS (code) == BPF_LD || BPF_CLASS (code) == BPF_LDX)
+	  && BPF_MODE (code) == BPF_MEM))
+    return random () % BPF_MEMWORDS;
+  switch (random () % 5)
+    {
+    case 0:
+      return random () % 4;
+    case 4:
+      return random () % 32;
+    case 1:
+      return random () % 128;
+    case 2:
+      return NET_RCV_MAX - 8 + random () % 16;
+    default:
+      return random ();
+    }
+}
+
+/* Make up a filter of LEN instructions, header included, in F.  */
+static void
+random_filter (struct bpf_insn *f, int len)
+{
+  int i;
+
+  f[0].code = NETF_IN | NETF_BPF;
+  f[0].jt = f[0].jf = 0;
+  f[0].k = 0;
+
+  for (i = 1; i < len; i++)
+    {
+      unsigned short code = codes[random () % (sizeof codes
+					       / sizeof codes[0])];
+      int left = len - i - 1;
+
+      if (i == len - 1)
+	code = random () % 2 ? BPF_RET|BPF_K : BPF_RET|BPF_A;
+
+      f[i].code = code;
+      f[i].k = random_k (code);
+      f[i].jt = f[i].jf = 0;
+      if (BPF_CLASS (code) == BPF_JMP)
+	{
+	  if (BPF_OP (code) == BPF_JA)
+	    f[i].k = left ? random () % left : 0;
+	  else
+	    {
+	      f[i].jt = left ? random () % left : 0;
+	      f[i].jf = left ? random () % left : 0;
+	    }
+	}
+      if (f[i].code == (BPF_ALU|BPF_DIV|BPF_K) && f[i].k == 0)
+	f[i].k = 1;
+    }
+}
+
+/* A byte that is often small enough for comparisons with small constants
+   to come out true.  */
+#define random_byte() (random () % 2 ? random () % 4 : random ())
+
+/* Change the header and some bytes near the start of the packet, where
+   most loads land.  main fills all of the packet in once.  */
+static void
+random_packet (char *header, char *p, unsigned int *wirelen)
+{
+  int i;
+
+  for (i = 0; i < HLEN; i++)
+    header[i] = random_byte ();
+  for (i = 0; i < 32; i++)
+    p[random () % 256] = random_byte ();
+  *wirelen = random () % 1500;
+}
+
+static void
+dump_filter (struct bpf_insn *f, int len)
+{
+  int i;
+  for (i = 0; i < len; i++)
+    fprintf (stderr, "  {0x%02x, %u, %u, %d},\n",
+	     f[i].code, f[i].jt, f[i].jf, f[i].k);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Compare decoded and interpreted BPF filters." };
+  static char p[NET_RCV_MAX];
+  char header[HLEN];
+  struct net_rcv_port *infp;
+  int i, j, tried = 0, failures = 0;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+  srandom (seed);
+
+  infp = calloc (1, sizeof *infp);
+  if (! infp)
+    error (1, ENOMEM, "filter");
+
+  for (i = 0; i < NET_RCV_MAX; i++)
+    p[i] = random_byte ();
+
+  for (i = 0; i < filters; i++)
+    {
+      struct bpf_insn *f = (struct bpf_insn *) infp->filter;
+      int len = 2 + random () % (NET_MAX_FILTER / 4 - 2);
+      bpf_insn_t match = 0;
+
+      random_filter (f, len);
+      if (! bpf_validate (f, len * sizeof *f, &match))
+	continue;
+      tried++;
+
+      infp->filter_end = (filter_t *) (f + len);
+      infp->rcv_port = random () % 8 ? 1 : MACH_PORT_NULL;
+      infp->prog = bpf_compile (f, len * sizeof *f);
+      if (! infp->prog)
+	error (1, ENOMEM, "bpf_compile");
+
+      for (j = 0; j < packets; j++)
+	{
+	  net_hash_entry_t *headp1 = 0, *headp2 = 0, ent1, ent2;
+	  unsigned int wirelen;
+	  int r1, r2;
+
+	  random_packet (header, p, &wirelen);
+	  r1 = bpf_interpret (infp, p, wirelen, header, HLEN, &headp1, &ent1);
+	  r2 = bpf_run (infp->prog, infp, p, wirelen, header, HLEN,
+			&headp2, &ent2);
+	  if (r1 != r2 || ent1 != ent2)
+	    {
+	      fprintf (stderr, "filter %d, packet %d: interpreted %d,"
+		       " decoded %d\n", i, j, r1, r2);
+	      dump_filter (f, len);
+	      failures++;
+	      break;
+	    }
+	}
+
+      bpf_prog_free (infp->prog);
+      infp->prog = 0;
+    }
+
+  printf ("%d filters, %d packets each: %d failed\n",
+	  tried, packets, failures);
+  return failures != 0;
+}
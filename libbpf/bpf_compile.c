@@ -0,0 +1,454 @@
+/* Predecoded, direct-threaded execution of BPF filters
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd; see the file COPYING.  If not, write to
+   the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
+
+/* bpf_interpret decodes every instruction of a filter, through a switch,
+   for every packet it is given.  Here, a validated filter is decoded
+   once, when it is installed, into an array of operations, each of which
+   holds the address of the code that carries it out and, for jumps, the
+   operations to go on with, so that running it is a matter of jumping
+   from one operation's code to the next's.  The code for each operation
+   is the same as bpf_interpret's, so the results are too.  */
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+
+#include <mach.h>
+#include <hurd.h>
+
+#include "bpf_impl.h"
+
+struct bpf_op
+{
+  const void *code;		/* Where the code for this operation is.  */
+  int k;			/* The instruction's constant.  */
+  struct bpf_op *jt, *jf;	/* Where jumps go.  */
+  int n_keys;			/* For BPF_MATCH_IMM, the number of keys.  */
+};
+
+struct bpf_prog
+{
+  struct bpf_op ops[0];
+};
+
+/* The operations, indexing the table of code addresses in bpf_exec.  */
+enum
+{
+  OP_RET_0, OP_RET_K, OP_RET_A, OP_RET_MATCH,
+  OP_LD_W_ABS, OP_LD_H_ABS, OP_LD_B_ABS,
+  OP_LD_W_IND, OP_LD_H_IND, OP_LD_B_IND,
+  OP_LD_W_LEN, OP_LDX_W_LEN, OP_LDX_MSH_B,
+  OP_LD_IMM, OP_LDX_IMM, OP_LD_MEM, OP_LDX_MEM, OP_ST, OP_STX,
+  OP_JA, OP_JGT_K, OP_JGE_K, OP_JEQ_K, OP_JSET_K,
+  OP_JGT_X, OP_JGE_X, OP_JEQ_X, OP_JSET_X,
+  OP_ADD_X, OP_SUB_X, OP_MUL_X, OP_DIV_X, OP_AND_X, OP_OR_X,
+  OP_LSH_X, OP_RSH_X,
+  OP_ADD_K, OP_SUB_K, OP_MUL_K, OP_DIV_K, OP_AND_K, OP_OR_K,
+  OP_LSH_K, OP_RSH_K,
+  OP_NEG, OP_TAX, OP_TXA,
+  OP_MAX
+};
+
+/* Run PROG, the filter of INFP, on a packet, as bpf_interpret does.  If
+   TABLE is not null, just return in it the table of code addresses that
+   bpf_compile puts in operations.  */
+static int
+bpf_exec (const struct bpf_prog *prog, const void *const **table,
+	  net_rcv_port_t infp, char *p, unsigned int wirelen,
+	  char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+	  net_hash_entry_t *entpp)
+{
+  static const void *const code[OP_MAX] =
+    {
+      [OP_RET_0] = &&ret_0, [OP_RET_K] = &&ret_k, [OP_RET_A] = &&ret_a,
+      [OP_RET_MATCH] = &&ret_match,
+      [OP_LD_W_ABS] = &&ld_w_abs, [OP_LD_H_ABS] = &&ld_h_abs,
+      [OP_LD_B_ABS] = &&ld_b_abs,
+      [OP_LD_W_IND] = &&ld_w_ind, [OP_LD_H_IND] = &&ld_h_ind,
+      [OP_LD_B_IND] = &&ld_b_ind,
+      [OP_LD_W_LEN] = &&ld_w_len, [OP_LDX_W_LEN] = &&ldx_w_len,
+      [OP_LDX_MSH_B] = &&ldx_msh_b,
+      [OP_LD_IMM] = &&ld_imm, [OP_LDX_IMM] = &&ldx_imm,
+      [OP_LD_MEM] = &&ld_mem, [OP_LDX_MEM] = &&ldx_mem,
+      [OP_ST] = &&st, [OP_STX] = &&stx,
+      [OP_JA] = &&ja, [OP_JGT_K] = &&jgt_k, [OP_JGE_K] = &&jge_k,
+      [OP_JEQ_K] = &&jeq_k, [OP_JSET_K] = &&jset_k,
+      [OP_JGT_X] = &&jgt_x, [OP_JGE_X] = &&jge_x,
+      [OP_JEQ_X] = &&jeq_x, [OP_JSET_X] = &&jset_x,
+      [OP_ADD_X] = &&add_x, [OP_SUB_X] = &&sub_x, [OP_MUL_X] = &&mul_x,
+      [OP_DIV_X] = &&div_x, [OP_AND_X] = &&and_x, [OP_OR_X] = &&or_x,
+      [OP_LSH_X] = &&lsh_x, [OP_RSH_X] = &&rsh_x,
+      [OP_ADD_K] = &&add_k, [OP_SUB_K] = &&sub_k, [OP_MUL_K] = &&mul_k,
+      [OP_DIV_K] = &&div_k, [OP_AND_K] = &&and_k, [OP_OR_K] = &&or_k,
+      [OP_LSH_K] = &&lsh_k, [OP_RSH_K] = &&rsh_k,
+      [OP_NEG] = &&neg, [OP_TAX] = &&tax, [OP_TXA] = &&txa,
+    };
+  const struct bpf_op *op;
+  unsigned int buflen = NET_RCV_MAX;
+  unsigned int A = 0, X = 0;
+  int k;
+  unsigned int mem[BPF_MEMWORDS] = { 0 };
+  char *data;
+
+  if (table)
+    {
+      *table = code;
+      return 0;
+    }
+
+#define NEXT		goto *(++op)->code
+#define JUMP(cond)	do { op = (cond) ? op->jt : op->jf; \
+			     goto *op->code; } while (0)
+
+  *entpp = 0;
+  op = prog->ops;
+  goto *op->code;
+
+ ret_0:
+  return 0;
+
+ ret_k:
+  if (infp->rcv_port == MACH_PORT_NULL && *entpp == 0)
+    return 0;
+  return ((u_int) op->k <= wirelen) ? op->k : wirelen;
+
+ ret_a:
+  if (infp->rcv_port == MACH_PORT_NULL && *entpp == 0)
+    return 0;
+  return ((u_int) A <= wirelen) ? A : wirelen;
+
+ ret_match:
+  if (bpf_match ((net_hash_header_t) infp, op->n_keys, mem,
+		 hash_headpp, entpp))
+    return ((u_int) op->k <= wirelen) ? op->k : wirelen;
+  return 0;
+
+ ld_w_abs:
+  k = op->k;
+ load_word:
+  if ((u_int) k + sizeof (int) <= hlen)
+    data = header;
+  else if ((u_int) k + sizeof (int) <= buflen)
+    {
+      k -= hlen;
+      data = p;
+    }
+  else
+    return 0;
+#ifdef BPF_ALIGN
+  if (((int) (data + k) & 3) != 0)
+    A = EXTRACT_LONG (&data[k]);
+  else
+#endif
+    A = ntohl (*(int *) (data + k));
+  NEXT;
+
+ ld_h_abs:
+  k = op->k;
+ load_half:
+  if ((u_int) k + sizeof (short) <= hlen)
+    data = header;
+  else if ((u_int) k + sizeof (short) <= buflen)
+    {
+      k -= hlen;
+      data = p;
+    }
+  else
+    return 0;
+  A = EXTRACT_SHORT (&data[k]);
+  NEXT;
+
+ ld_b_abs:
+  k = op->k;
+ load_byte:
+  if ((u_int) k < hlen)
+    data = header;
+  else if ((u_int) k < buflen)
+    {
+      data = p;
+      k -= hlen;
+    }
+  else
+    return 0;
+  A = data[k];
+  NEXT;
+
+ ld_w_ind:
+  k = X + op->k;
+  goto load_word;
+
+ ld_h_ind:
+  k = X + op->k;
+  goto load_half;
+
+ ld_b_ind:
+  k = X + op->k;
+  goto load_byte;
+
+ ld_w_len:
+  A = wirelen;
+  NEXT;
+
+ ldx_w_len:
+  X = wirelen;
+  NEXT;
+
+ ldx_msh_b:
+  k = op->k;
+  if (k < hlen)
+    data = header;
+  else if (k < buflen)
+    {
+      data = p;
+      k -= hlen;
+    }
+  else
+    return 0;
+  X = (data[k] & 0xf) << 2;
+  NEXT;
+
+ ld_imm:
+  A = op->k;
+  NEXT;
+
+ ldx_imm:
+  X = op->k;
+  NEXT;
+
+ ld_mem:
+  A = mem[op->k];
+  NEXT;
+
+ ldx_mem:
+  X = mem[op->k];
+  NEXT;
+
+ st:
+  mem[op->k] = A;
+  NEXT;
+
+ stx:
+  mem[op->k] = X;
+  NEXT;
+
+ ja:
+  op = op->jt;
+  goto *op->code;
+
+ jgt_k:
+  JUMP (A > op->k);
+ jge_k:
+  JUMP (A >= op->k);
+ jeq_k:
+  JUMP (A == op->k);
+ jset_k:
+  JUMP (A & op->k);
+ jgt_x:
+  JUMP (A > X);
+ jge_x:
+  JUMP (A >= X);
+ jeq_x:
+  JUMP (A == X);
+ jset_x:
+  JUMP (A & X);
+
+ add_x:
+  A += X;
+  NEXT;
+ sub_x:
+  A -= X;
+  NEXT;
+ mul_x:
+  A *= X;
+  NEXT;
+ div_x:
+  if (X == 0)
+    return 0;
+  A /= X;
+  NEXT;
+ and_x:
+  A &= X;
+  NEXT;
+ or_x:
+  A |= X;
+  NEXT;
+ lsh_x:
+  A <<= X;
+  NEXT;
+ rsh_x:
+  A >>= X;
+  NEXT;
+
+ add_k:
+  A += op->k;
+  NEXT;
+ sub_k:
+  A -= op->k;
+  NEXT;
+ mul_k:
+  A *= op->k;
+  NEXT;
+ div_k:
+  A /= op->k;
+  NEXT;
+ and_k:
+  A &= op->k;
+  NEXT;
+ or_k:
+  A |= op->k;
+  NEXT;
+ lsh_k:
+  A <<= op->k;
+  NEXT;
+ rsh_k:
+  A >>= op->k;
+  NEXT;
+
+ neg:
+  A = -A;
+  NEXT;
+ tax:
+  X = A;
+  NEXT;
+ txa:
+  A = X;
+  NEXT;
+
+#undef NEXT
+#undef JUMP
+}
+
+/* Return the operation carrying out the instruction with code CODE, or
+   OP_RET_0 if there is none, as bpf_interpret rejects packets when it
+   meets such an instruction.  */
+static int
+bpf_op_of (unsigned short code)
+{
+  switch (code)
+    {
+    case BPF_RET|BPF_K:		return OP_RET_K;
+    case BPF_RET|BPF_A:		return OP_RET_A;
+    case BPF_RET|BPF_MATCH_IMM:	return OP_RET_MATCH;
+    case BPF_LD|BPF_W|BPF_ABS:	return OP_LD_W_ABS;
+    case BPF_LD|BPF_H|BPF_ABS:	return OP_LD_H_ABS;
+    case BPF_LD|BPF_B|BPF_ABS:	return OP_LD_B_ABS;
+    case BPF_LD|BPF_W|BPF_IND:	return OP_LD_W_IND;
+    case BPF_LD|BPF_H|BPF_IND:	return OP_LD_H_IND;
+    case BPF_LD|BPF_B|BPF_IND:	return OP_LD_B_IND;
+    case BPF_LD|BPF_W|BPF_LEN:	return OP_LD_W_LEN;
+    case BPF_LDX|BPF_W|BPF_LEN:	return OP_LDX_W_LEN;
+    case BPF_LDX|BPF_MSH|BPF_B:	return OP_LDX_MSH_B;
+    case BPF_LD|BPF_IMM:	return OP_LD_IMM;
+    case BPF_LDX|BPF_IMM:	return OP_LDX_IMM;
+    case BPF_LD|BPF_MEM:	return OP_LD_MEM;
+    case BPF_LDX|BPF_MEM:	return OP_LDX_MEM;
+    case BPF_ST:		return OP_ST;
+    case BPF_STX:		return OP_STX;
+    case BPF_JMP|BPF_JA:	return OP_JA;
+    case BPF_JMP|BPF_JGT|BPF_K:	return OP_JGT_K;
+    case BPF_JMP|BPF_JGE|BPF_K:	return OP_JGE_K;
+    case BPF_JMP|BPF_JEQ|BPF_K:	return OP_JEQ_K;
+    case BPF_JMP|BPF_JSET|BPF_K: return OP_JSET_K;
+    case BPF_JMP|BPF_JGT|BPF_X:	return OP_JGT_X;
+    case BPF_JMP|BPF_JGE|BPF_X:	return OP_JGE_X;
+    case BPF_JMP|BPF_JEQ|BPF_X:	return OP_JEQ_X;
+    case BPF_JMP|BPF_JSET|BPF_X: return OP_JSET_X;
+    case BPF_ALU|BPF_ADD|BPF_X:	return OP_ADD_X;
+    case BPF_ALU|BPF_SUB|BPF_X:	return OP_SUB_X;
+    case BPF_ALU|BPF_MUL|BPF_X:	return OP_MUL_X;
+    case BPF_ALU|BPF_DIV|BPF_X:	return OP_DIV_X;
+    case BPF_ALU|BPF_AND|BPF_X:	return OP_AND_X;
+    case BPF_ALU|BPF_OR|BPF_X:	return OP_OR_X;
+    case BPF_ALU|BPF_LSH|BPF_X:	return OP_LSH_X;
+    case BPF_ALU|BPF_RSH|BPF_X:	return OP_RSH_X;
+    case BPF_ALU|BPF_ADD|BPF_K:	return OP_ADD_K;
+    case BPF_ALU|BPF_SUB|BPF_K:	return OP_SUB_K;
+    case BPF_ALU|BPF_MUL|BPF_K:	return OP_MUL_K;
+    case BPF_ALU|BPF_DIV|BPF_K:	return OP_DIV_K;
+    case BPF_ALU|BPF_AND|BPF_K:	return OP_AND_K;
+    case BPF_ALU|BPF_OR|BPF_K:	return OP_OR_K;
+    case BPF_ALU|BPF_LSH|BPF_K:	return OP_LSH_K;
+    case BPF_ALU|BPF_RSH|BPF_K:	return OP_RSH_K;
+    case BPF_ALU|BPF_NEG:	return OP_NEG;
+    case BPF_MISC|BPF_TAX:	return OP_TAX;
+    case BPF_MISC|BPF_TXA:	return OP_TXA;
+    default:			return OP_RET_0;
+    }
+}
+
+/* Decode the filter F, of BYTES bytes, which bpf_validate has accepted,
+   for bpf_run.  Return null if there's no memory for it.  */
+struct bpf_prog *
+bpf_compile (bpf_insn_t f, int bytes)
+{
+  const void *const *code;
+  struct bpf_prog *prog;
+  struct bpf_op *ops;
+  int i, len;
+
+  bpf_exec (0, &code, 0, 0, 0, 0, 0, 0, 0);
+
+  /* F[0] is the filter header; the operation after the last instruction
+     rejects packets, as does running off the end of the filter.  */
+  len = BPF_BYTES2LEN (bytes) - 1;
+  prog = malloc (sizeof *prog + (len + 1) * sizeof (struct bpf_op));
+  if (! prog)
+    return 0;
+  ops = prog->ops;
+
+#define TARGET(i) (&ops[(i) >= 0 && (i) < len ? (i) : len])
+
+  for (i = 0; i < len; i++)
+    {
+      bpf_insn_t pc = &f[i + 1];
+      int op = bpf_op_of (pc->code);
+
+      ops[i].code = code[op];
+      ops[i].k = pc->k;
+      ops[i].n_keys = pc->jt;
+      if (op == OP_JA)
+	ops[i].jt = ops[i].jf = TARGET (i + 1 + pc->k);
+      else
+	{
+	  ops[i].jt = TARGET (i + 1 + pc->jt);
+	  ops[i].jf = TARGET (i + 1 + pc->jf);
+	}
+    }
+  ops[len].code = code[OP_RET_0];
+
+#undef TARGET
+
+  return prog;
+}
+
+/* Free PROG.  */
+void
+bpf_prog_free (struct bpf_prog *prog)
+{
+  free (prog);
+}
+
+/* Run PROG, the decoded filter of INFP, on a packet, as bpf_do_filter.  */
+int
+bpf_run (struct bpf_prog *prog, net_rcv_port_t infp, char *p,
+	 unsigned int wirelen, char *header, unsigned int hlen,
+	 net_hash_entry_t **hash_headpp, net_hash_entry_t *entpp)
+{
+  return bpf_exec (prog, 0, infp, p, wirelen, header, hlen,
+		   hash_headpp, entpp);
+}
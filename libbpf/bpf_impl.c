@@ -48,6 +48,26 @@
 
 static struct net_hash_header filter_hash_header[N_NET_HASH];
 
+/*
+ * Run the filter of infp on the packet p, decoded if it could be.
+ *
+ * @p: packet data.
+ * @wirelen: data_count (in bytes)
+ * @hlen: header len (in bytes)
+ */
+
+int
+bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
+		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+		net_hash_entry_t *entpp)
+{
+	if (infp->prog)
+		return bpf_run(infp->prog, infp, p, wirelen, header, hlen,
+				hash_headpp, entpp);
+	return bpf_interpret(infp, p, wirelen, header, hlen,
+			hash_headpp, entpp);
+}
+
 /*
  * Execute the filter program starting at pc on the packet p
  * wirelen is the length of the original packet
@@ -59,7 +79,7 @@ static struct net_hash_header filter_hash_header[N_NET_HASH];
  */
 
 int
-bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
+bpf_interpret(net_rcv_port_t infp, char *p,	unsigned int wirelen,
 		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
 		net_hash_entry_t *entpp)
 {
@@ -68,7 +88,7 @@ bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
 
 	unsigned int A, X;
 	int k;
-	unsigned int mem[BPF_MEMWORDS];
+	unsigned int mem[BPF_MEMWORDS] = { 0 };
 
 	/* Generic pointer to either HEADER or P according to the specified offset. */
 	char *data = NULL;
@@ -506,6 +526,10 @@ hash_ent_remove (if_filter_list_t *ifp, net_hash_header_t hp, int used,
 							(net_rcv_port_t)hp,
 							net_rcv_port_t, output);
 				hp->n_keys = 0;
+				/* The header stays, for the next
+				   filter to use; its program need not. */
+				bpf_prog_free(((net_rcv_port_t)hp)->prog);
+				((net_rcv_port_t)hp)->prog = NULL;
 				return TRUE;
 			}
 			return FALSE;
@@ -534,6 +558,7 @@ net_free_dead_infp (queue_entry_t dead_infp)
 	for (infp = (net_rcv_port_t) dead_infp; infp != 0; infp = nextfp) {
 		nextfp = (net_rcv_port_t) queue_next(&infp->input);
 		mach_port_deallocate(mach_task_self(), infp->rcv_port);
+		bpf_prog_free(infp->prog);
 		free(infp);
 		debug ("a dead infp is freed\n");
 	}
@@ -741,6 +766,11 @@ hash_loop_end:
 		my_infp->filter_end =
 			(filter_t *)((char *)my_infp->filter + filter_bytes);
 
+		/* Decode it once and for all; if that fails, it is
+		   interpreted instead. */
+		bpf_prog_free(my_infp->prog);
+		my_infp->prog = bpf_compile((bpf_insn_t)filter, filter_bytes);
+
 		/* Insert my_infp according to priority */
 		if (in) {
 			queue_iterate(&ifp->if_rcv_port_list, infp, net_rcv_port_t, input)
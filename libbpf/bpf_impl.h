@@ -92,6 +92,8 @@ typedef filter_t	*filter_array_t;
 
 #define CSPF_BYTES(n) ((n) * sizeof (filter_t))
 
+struct bpf_prog;
+
 /*
  * Receive port for net, with packet filter.
  * This data structure by itself represents a packet
@@ -106,6 +108,7 @@ struct net_rcv_port {
 	filter_t	*filter_end;	/* pointer to end of filter */
 	filter_t	filter[NET_MAX_FILTER];
 	/* filter operations */
+	struct bpf_prog	*prog;		/* decoded filter, if any */
 };
 typedef struct net_rcv_port *net_rcv_port_t;
 
@@ -141,6 +144,20 @@ typedef struct net_hash_header *net_hash_header_t;
 int bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
 		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
 		net_hash_entry_t *entpp);
+int bpf_interpret(net_rcv_port_t infp, char *p,	unsigned int wirelen,
+		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+		net_hash_entry_t *entpp);
+
+/*
+ * Filters are decoded by bpf_compile when they are installed, and
+ * bpf_do_filter runs them with bpf_run, which gives the same results
+ * as bpf_interpret.
+ */
+struct bpf_prog *bpf_compile (bpf_insn_t f, int bytes);
+void bpf_prog_free (struct bpf_prog *prog);
+int bpf_run (struct bpf_prog *prog, net_rcv_port_t infp, char *p,
+		unsigned int wirelen, char *header, unsigned int hlen,
+		net_hash_entry_t **hash_headpp, net_hash_entry_t *entpp);
 io_return_t net_set_filter(if_filter_list_t *ifp, mach_port_t rcv_port,
 		int priority, filter_t *filter, unsigned int filter_count);
 
@@ -35,10 +35,21 @@
 
 #define SLAB_PAGES 4
 
+/* The number of magazines of each kind the depot of a space keeps at
+   most.  Beyond that, full magazines are emptied into the slabs and
+   empty ones freed.  */
+#define DEPOT_MAX 16
+
 
 /* Number of pages the slab allocator has allocated.  */
 static int __hurd_slab_nr_pages;
 
+/* All slab spaces that have had objects allocated from them and are
+   not destroyed.  Nothing takes this lock with the lock of a space
+   held, so it can be held while the lock of a space is taken.  */
+static struct hurd_slab_space *spaces;
+static pthread_mutex_t spaces_lock = PTHREAD_MUTEX_INITIALIZER;
+
 
 /* Buffer control structure.  Lives at the end of an object.  If the
    buffer is allocated, SLAB points to the slab to which it belongs.
@@ -67,6 +78,30 @@ struct hurd_slab
   union hurd_bufctl *free_list;
 };
 
+/* A magazine of free objects, the first ROUNDS of OBJS.  It holds
+   MAGAZINE_SIZE of the slab space at most.  */
+struct hurd_slab_magazine
+{
+  struct hurd_slab_magazine *next;
+  int rounds;
+  void *objs[];
+};
+
+
+/* The magazines of a thread for a slab space.  Allocations come from
+   LOADED, and deallocations go into it; PREVIOUS is the other one,
+   which is either full or empty, so that a thread going back and
+   forth around the edge of a magazine does not need the depot.  */
+struct hurd_slab_cache
+{
+  struct hurd_slab_space *space;
+  struct hurd_slab_magazine *loaded;
+  struct hurd_slab_magazine *previous;
+};
+
+static void cache_flush (struct hurd_slab_space *space);
+static void depot_flush (struct hurd_slab_space *space);
+
 /* Allocate a buffer in *PTR of size SIZE which must be a power of 2
    and self aligned (i.e. aligned on a SIZE byte boundary) for slab
    space SPACE.  Return 0 on success, an error code on failure.  */
@@ -146,9 +181,9 @@ remove_slab (struct hurd_slab_space *space, struct hurd_slab *slab)
 
 
 /* Iterate through slabs in SPACE and release memory for slabs that
-   are complete (no allocated buffers).  */
+   are complete (no allocated buffers), but the first KEEP of them.  */
 static error_t
-reap (struct hurd_slab_space *space)
+reap (struct hurd_slab_space *space, size_t keep)
 {
   struct hurd_slab *s, *next, *new_first;
   error_t err = 0;
@@ -161,6 +196,12 @@ reap (struct hurd_slab_space *space)
 	 buffers, so it can be freed.  */
       if (!s->refcount)
 	{
+	  if (keep > 0)
+	    {
+	      keep--;
+	      continue;
+	    }
+
 	  remove_slab (space, s);
 	  
 	  /* If there is a destructor it must be invoked for every 
@@ -211,6 +252,10 @@ init_space (hurd_slab_space_t space)
   size_t size = space->requested_size + sizeof (union hurd_bufctl);
   size_t alignment = space->requested_align;
 
+  /* HURD_SLAB_SPACE_INITIALIZER leaves the slab size to us.  */
+  if (space->slab_size == 0)
+    space->slab_size = getpagesize () * SLAB_PAGES;
+
   /* If SIZE is so big that one object can not fit into a page
      something gotta be really wrong.  */ 
   size = (size + alignment - 1) & ~(alignment - 1);
@@ -225,9 +270,6 @@ init_space (hurd_slab_space_t space)
   space->full_refcount 
     = ((space->slab_size - sizeof (struct hurd_slab)) / size);
 
-  /* FIXME: Notify pager's reap functionality about this slab
-     space.  */
-
   space->initialized = true;
 }
 
@@ -306,6 +348,40 @@ grow (struct hurd_slab_space *space)
 }
 
 
+/* Put SPACE in the list of all slab spaces, if it is not there yet.  */
+static void
+register_space (struct hurd_slab_space *space)
+{
+  pthread_mutex_lock (&spaces_lock);
+  if (!space->registered)
+    {
+      space->next_space = spaces;
+      if (spaces)
+	spaces->prevp = &space->next_space;
+      space->prevp = &spaces;
+      spaces = space;
+      __atomic_store_n (&space->registered, true, __ATOMIC_RELEASE);
+    }
+  pthread_mutex_unlock (&spaces_lock);
+}
+
+
+/* Take SPACE out of the list of all slab spaces, if it is there.  */
+static void
+unregister_space (struct hurd_slab_space *space)
+{
+  pthread_mutex_lock (&spaces_lock);
+  if (space->registered)
+    {
+      *space->prevp = space->next_space;
+      if (space->next_space)
+	space->next_space->prevp = space->prevp;
+      __atomic_store_n (&space->registered, false, __ATOMIC_RELEASE);
+    }
+  pthread_mutex_unlock (&spaces_lock);
+}
+
+
 /* Initialize the slab space SPACE.  */
 error_t
 hurd_slab_init (hurd_slab_space_t space, size_t size, size_t alignment,
@@ -391,10 +467,19 @@ hurd_slab_destroy (hurd_slab_space_t space)
 {
   error_t err;
 
+  /* The objects in magazines are free, but the slabs count them as
+     allocated until they are given back.  Those of threads other than
+     the calling one are still allocated as far as we know.  */
+  if (space->magazine_size)
+    {
+      cache_flush (space);
+      depot_flush (space);
+    }
+
   /* The caller wants to destroy the slab.  It can not be destroyed if
      there are any outstanding memory allocations.  */
   pthread_mutex_lock (&space->lock);
-  err = reap (space);
+  err = reap (space, 0);
   if (err)
     {
       pthread_mutex_unlock (&space->lock);
@@ -409,7 +494,16 @@ hurd_slab_destroy (hurd_slab_space_t space)
       return EBUSY;
     }
 
-  /* FIXME: Remove slab space from pager's reap functionality.  */
+  pthread_mutex_unlock (&space->lock);
+  unregister_space (space);
+
+  if (space->magazine_size)
+    {
+      /* Whatever magazines other threads still have are empty, and are
+	 lost: there is no depot to give them to when they exit.  */
+      pthread_key_delete (space->cache_key);
+      pthread_mutex_destroy (&space->depot_lock);
+    }
 
   return 0;
 }
@@ -429,15 +523,14 @@ hurd_slab_free (hurd_slab_space_t space)
 }
 
 
-/* Allocate a new object from the slab space SPACE.  */
-error_t
-hurd_slab_alloc (hurd_slab_space_t space, void **buffer)
+/* Allocate a new object from the slab space SPACE, whose lock is
+   held.  */
+static error_t
+alloc_locked (hurd_slab_space_t space, void **buffer)
 {
   error_t err;
   union hurd_bufctl *bufctl;
 
-  pthread_mutex_lock (&space->lock);
-
   /* If there is no slabs with free buffer, the cache has to be
      expanded with another slab.  If the slab space has not yet been
      initialized this is always true.  */
@@ -445,10 +538,7 @@ hurd_slab_alloc (hurd_slab_space_t space, void **buffer)
     {
       err = grow (space);
       if (err)
-	{
-	  pthread_mutex_unlock (&space->lock);
-	  return err;
-	}
+	return err;
     }
 
   /* Remove buffer from the free list and update the reference
@@ -477,7 +567,6 @@ hurd_slab_alloc (hurd_slab_space_t space, void **buffer)
       space->first_free = new_first;
     }
   *buffer = ((void *) bufctl) - (space->size - sizeof *bufctl);
-  pthread_mutex_unlock (&space->lock);
   return 0;
 }
 
@@ -492,17 +581,14 @@ put_on_slab_list (struct hurd_slab *slab, union hurd_bufctl *bufctl)
 }
 
 
-/* Deallocate the object BUFFER from the slab space SPACE.  */
-void
-hurd_slab_dealloc (hurd_slab_space_t space, void *buffer)
+/* Deallocate the object BUFFER from the slab space SPACE, whose lock
+   is held.  */
+static void
+dealloc_locked (hurd_slab_space_t space, void *buffer)
 {
   struct hurd_slab *slab;
   union hurd_bufctl *bufctl;
 
-  assert_backtrace (space->initialized);
-
-  pthread_mutex_lock (&space->lock);
-
   bufctl = (buffer + (space->size - sizeof *bufctl));
   put_on_slab_list (slab = bufctl->slab, bufctl);
 
@@ -513,6 +599,479 @@ hurd_slab_dealloc (hurd_slab_space_t space, void *buffer)
   if (!space->first_free 
       || slab->refcount < space->first_free->refcount)
     space->first_free = slab;
+}
+
+
+/* The magazine layer.  */
+
+static struct hurd_slab_magazine *
+magazine_alloc (struct hurd_slab_space *space)
+{
+  struct hurd_slab_magazine *m;
+
+  m = malloc (sizeof *m + space->magazine_size * sizeof m->objs[0]);
+  if (m)
+    m->rounds = 0;
+  return m;
+}
+
+/* Give the objects in magazine M back to the slabs of SPACE.  */
+static void
+magazine_flush (struct hurd_slab_space *space, struct hurd_slab_magazine *m)
+{
+  if (m->rounds == 0)
+    return;
+
+  pthread_mutex_lock (&space->lock);
+  while (m->rounds > 0)
+    dealloc_locked (space, m->objs[--m->rounds]);
+  pthread_mutex_unlock (&space->lock);
+}
+
+/* Fill magazine M with objects from the slabs of SPACE, but only half
+   way, so that the thread can deallocate into it as well before it
+   needs the depot again.  Return an error only if none could be
+   allocated.  */
+static error_t
+magazine_fill (struct hurd_slab_space *space, struct hurd_slab_magazine *m)
+{
+  error_t err = 0;
+
+  pthread_mutex_lock (&space->lock);
+  while (m->rounds < (space->magazine_size + 1) / 2)
+    {
+      err = alloc_locked (space, &m->objs[m->rounds]);
+      if (err)
+	break;
+      m->rounds++;
+    }
+  pthread_mutex_unlock (&space->lock);
+
+  return m->rounds > 0 ? 0 : err;
+}
+
+/* Take a magazine from the depot of SPACE, a non-empty one if FULL,
+   else an empty one.  Return NULL if there is none.  */
+static struct hurd_slab_magazine *
+depot_take (struct hurd_slab_space *space, bool full)
+{
+  struct hurd_slab_magazine *m;
+
+  pthread_mutex_lock (&space->depot_lock);
+  if (full)
+    {
+      m = space->depot_full;
+      if (m)
+	{
+	  space->depot_full = m->next;
+	  space->depot_nr_full--;
+	}
+    }
+  else
+    {
+      m = space->depot_empty;
+      if (m)
+	{
+	  space->depot_empty = m->next;
+	  space->depot_nr_empty--;
+	}
+    }
+  pthread_mutex_unlock (&space->depot_lock);
+
+  return m;
+}
+
+/* Put magazine M in the depot of SPACE, or if there are enough of its
+   kind there already, give its objects back to the slabs and free
+   it.  */
+static void
+depot_give (struct hurd_slab_space *space, struct hurd_slab_magazine *m)
+{
+  pthread_mutex_lock (&space->depot_lock);
+  if (m->rounds > 0 && space->depot_nr_full < DEPOT_MAX)
+    {
+      m->next = space->depot_full;
+      space->depot_full = m;
+      space->depot_nr_full++;
+      m = NULL;
+    }
+  else if (m->rounds == 0 && space->depot_nr_empty < DEPOT_MAX)
+    {
+      m->next = space->depot_empty;
+      space->depot_empty = m;
+      space->depot_nr_empty++;
+      m = NULL;
+    }
+  pthread_mutex_unlock (&space->depot_lock);
+
+  if (m)
+    {
+      magazine_flush (space, m);
+      free (m);
+    }
+}
+
+/* Give all the magazines in the depot of SPACE back.  */
+static void
+depot_flush (struct hurd_slab_space *space)
+{
+  struct hurd_slab_magazine *full, *empty, *m;
+
+  pthread_mutex_lock (&space->depot_lock);
+  full = space->depot_full;
+  empty = space->depot_empty;
+  space->depot_full = space->depot_empty = NULL;
+  space->depot_nr_full = space->depot_nr_empty = 0;
+  pthread_mutex_unlock (&space->depot_lock);
+
+  while ((m = full))
+    {
+      full = m->next;
+      magazine_flush (space, m);
+      free (m);
+    }
+  while ((m = empty))
+    {
+      empty = m->next;
+      free (m);
+    }
+}
+
+/* Give the magazines of cache C to the depot of its space, and free
+   it.  Called on thread exit.  */
+static void
+cache_destroy (void *arg)
+{
+  struct hurd_slab_cache *c = arg;
+
+  if (c->loaded)
+    depot_give (c->space, c->loaded);
+  if (c->previous)
+    depot_give (c->space, c->previous);
+  free (c);
+}
+
+/* Return the magazines of the calling thread for SPACE, or NULL if they
+   can't be allocated.  */
+static struct hurd_slab_cache *
+cache_get (struct hurd_slab_space *space)
+{
+  struct hurd_slab_cache *c = pthread_getspecific (space->cache_key);
+
+  if (c)
+    return c;
+
+  c = calloc (1, sizeof *c);
+  if (! c)
+    return NULL;
+  c->space = space;
+  if (pthread_setspecific (space->cache_key, c))
+    {
+      free (c);
+      return NULL;
+    }
+  return c;
+}
+
+static inline void
+cache_swap (struct hurd_slab_cache *c)
+{
+  struct hurd_slab_magazine *m = c->loaded;
+  c->loaded = c->previous;
+  c->previous = m;
+}
 
+/* Allocate an object from the magazines of the calling thread for
+   SPACE.  Return false if it has none and could not get any.  */
+static bool
+cache_alloc (struct hurd_slab_space *space, void **buffer, error_t *err)
+{
+  struct hurd_slab_cache *c = cache_get (space);
+  struct hurd_slab_magazine *m;
+
+  if (! c)
+    return false;
+
+  if (c->loaded && c->loaded->rounds > 0)
+    goto pop;
+
+  if (c->previous && c->previous->rounds > 0)
+    {
+      cache_swap (c);
+      goto pop;
+    }
+
+  /* Both are empty: trade the previous one for a full one.  */
+  m = depot_take (space, true);
+  if (m)
+    {
+      if (c->previous)
+	depot_give (space, c->previous);
+      c->previous = c->loaded;
+      c->loaded = m;
+      goto pop;
+    }
+
+  /* There is none, so get objects from the slabs.  */
+  if (! c->loaded)
+    {
+      c->loaded = depot_take (space, false) ?: magazine_alloc (space);
+      if (! c->loaded)
+	return false;
+    }
+  *err = magazine_fill (space, c->loaded);
+  if (*err)
+    return true;
+
+ pop:
+  *buffer = c->loaded->objs[--c->loaded->rounds];
+  *err = 0;
+  return true;
+}
+
+/* Deallocate the object BUFFER into the magazines of the calling thread
+   for SPACE.  Return false if it could not get an empty one.  */
+static bool
+cache_dealloc (struct hurd_slab_space *space, void *buffer)
+{
+  struct hurd_slab_cache *c = cache_get (space);
+  struct hurd_slab_magazine *m;
+
+  if (! c)
+    return false;
+
+  if (c->loaded && c->loaded->rounds < space->magazine_size)
+    goto push;
+
+  if (c->previous && c->previous->rounds < space->magazine_size)
+    {
+      cache_swap (c);
+      goto push;
+    }
+
+  /* Both are full, or missing: trade the previous one for an empty
+     one.  */
+  m = depot_take (space, false) ?: magazine_alloc (space);
+  if (! m)
+    return false;
+  if (c->previous)
+    depot_give (space, c->previous);
+  c->previous = c->loaded;
+  c->loaded = m;
+
+ push:
+  c->loaded->objs[c->loaded->rounds++] = buffer;
+  return true;
+}
+
+/* Give the magazines of the calling thread for SPACE, if any, to the
+   depot.  */
+static void
+cache_flush (struct hurd_slab_space *space)
+{
+  struct hurd_slab_cache *c = pthread_getspecific (space->cache_key);
+
+  if (c)
+    {
+      pthread_setspecific (space->cache_key, NULL);
+      cache_destroy (c);
+    }
+}
+
+
+error_t
+hurd_slab_set_magazine_size (hurd_slab_space_t space, int size)
+{
+  error_t err;
+
+  if (size < 1 || size > HURD_SLAB_MAGAZINE_MAX || space->magazine_size)
+    return EINVAL;
+
+  err = pthread_mutex_init (&space->depot_lock, NULL);
+  if (err)
+    return err;
+  err = pthread_key_create (&space->cache_key, cache_destroy);
+  if (err)
+    {
+      pthread_mutex_destroy (&space->depot_lock);
+      return err;
+    }
+
+  space->magazine_size = size;
+  return 0;
+}
+
+
+error_t
+hurd_slab_reclaim (hurd_slab_space_t space)
+{
+  if (space->magazine_size)
+    {
+      cache_flush (space);
+      depot_flush (space);
+    }
+
+  return hurd_slab_reap (space, 0);
+}
+
+
+void
+hurd_slab_set_name (hurd_slab_space_t space, const char *name)
+{
+  space->name = name;
+}
+
+
+void
+hurd_slab_get_stats (hurd_slab_space_t space, struct hurd_slab_stats *stats)
+{
+  struct hurd_slab *s;
+  struct hurd_slab_magazine *m;
+
+  memset (stats, 0, sizeof *stats);
+
+  if (space->magazine_size)
+    {
+      pthread_mutex_lock (&space->depot_lock);
+      for (m = space->depot_full; m; m = m->next)
+	stats->nr_cached += m->rounds;
+      pthread_mutex_unlock (&space->depot_lock);
+    }
+
+  pthread_mutex_lock (&space->lock);
+  stats->obj_size = space->size;
+  stats->slab_size = space->slab_size;
+  stats->bufs_per_slab = space->full_refcount;
+  for (s = space->slab_first; s; s = s->next)
+    {
+      stats->nr_slabs++;
+      stats->nr_objs += s->refcount;
+      if (s->refcount == 0)
+	stats->nr_free_slabs++;
+      else if (s->refcount < space->full_refcount)
+	stats->nr_partial_slabs++;
+    }
+  pthread_mutex_unlock (&space->lock);
+
+  stats->nr_bufs = stats->nr_slabs * stats->bufs_per_slab;
+  stats->mem_usage = stats->nr_slabs * stats->slab_size;
+}
+
+
+error_t
+hurd_slab_reap (hurd_slab_space_t space, size_t keep)
+{
+  error_t err;
+
+  pthread_mutex_lock (&space->lock);
+  err = reap (space, keep);
+  pthread_mutex_unlock (&space->lock);
+  return err;
+}
+
+
+error_t
+hurd_slab_reap_all (size_t keep)
+{
+  struct hurd_slab_space *space;
+  error_t err = 0;
+
+  /* Holding SPACES_LOCK keeps the spaces from being destroyed under
+     us, and is why the callbacks reap makes must not register or
+     destroy a space.  */
+  pthread_mutex_lock (&spaces_lock);
+  for (space = spaces; space; space = space->next_space)
+    {
+      error_t e = hurd_slab_reap (space, keep);
+      if (e && !err)
+	err = e;
+    }
+  pthread_mutex_unlock (&spaces_lock);
+
+  return err;
+}
+
+
+error_t
+hurd_slab_print_stats (FILE *stream)
+{
+  const char header[] =
+    "cache                          obj slab  bufs   objs   bufs"
+    "   slabs    free partial    total reclaimable\n"
+    "name                          size size /slab  usage  count"
+    "   count   slabs   slabs   memory      memory\n";
+  struct hurd_slab_space *space;
+  struct hurd_slab_stats stats;
+  size_t mem_usage, mem_reclaimable, mem_total, mem_total_reclaimable;
+
+  fprintf (stream, "%s", header);
+
+  mem_total = 0;
+  mem_total_reclaimable = 0;
+
+  pthread_mutex_lock (&spaces_lock);
+  for (space = spaces; space; space = space->next_space)
+    {
+      hurd_slab_get_stats (space, &stats);
+      /* The objects in magazines are counted under another lock than
+	 the objects of the slabs, so there may seem to be more of
+	 them.  */
+      if (stats.nr_cached > stats.nr_objs)
+	stats.nr_cached = stats.nr_objs;
+      mem_usage = stats.mem_usage >> 10;
+      mem_total += mem_usage;
+      mem_reclaimable = (stats.nr_free_slabs * stats.slab_size) >> 10;
+      mem_total_reclaimable += mem_reclaimable;
+
+      if (space->name)
+	fprintf (stream, "%-26s", space->name);
+      else
+	fprintf (stream, "%-26p", space);
+      fprintf (stream,
+	       " %7zu %3zuk  %4zu %6zu %6zu %7zu %7zu %7zu %7zuk %10zuk\n",
+	       stats.obj_size, stats.slab_size >> 10, stats.bufs_per_slab,
+	       stats.nr_objs - stats.nr_cached, stats.nr_bufs,
+	       stats.nr_slabs, stats.nr_free_slabs, stats.nr_partial_slabs,
+	       mem_usage, mem_reclaimable);
+    }
+  pthread_mutex_unlock (&spaces_lock);
+
+  fprintf (stream, "total: %zuk, reclaimable: %zuk\n",
+	   mem_total, mem_total_reclaimable);
+
+  return ferror (stream) ? (errno ?: EIO) : 0;
+}
+
+
+/* Allocate a new object from the slab space SPACE.  */
+error_t
+hurd_slab_alloc (hurd_slab_space_t space, void **buffer)
+{
+  error_t err;
+
+  if (!__atomic_load_n (&space->registered, __ATOMIC_ACQUIRE))
+    register_space (space);
+
+  if (space->magazine_size && cache_alloc (space, buffer, &err))
+    return err;
+
+  pthread_mutex_lock (&space->lock);
+  err = alloc_locked (space, buffer);
+  pthread_mutex_unlock (&space->lock);
+  return err;
+}
+
+
+/* Deallocate the object BUFFER from the slab space SPACE.  */
+void
+hurd_slab_dealloc (hurd_slab_space_t space, void *buffer)
+{
+  assert_backtrace (space->initialized);
+
+  if (space->magazine_size && cache_dealloc (space, buffer))
+    return;
+
+  pthread_mutex_lock (&space->lock);
+  dealloc_locked (space, buffer);
   pthread_mutex_unlock (&space->lock);
 }
@@ -24,6 +24,7 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <pthread.h>
 
 
@@ -55,7 +56,8 @@ typedef void (*hurd_slab_destructor_t) (void *hook, void *object);
    initialized by a static initializer (HURD_SLAB_SPACE_INITIALIZER)
    or by the hurd_slab_create function.  The initialization of the
    space is delayed until the first allocation.  After that only the
-   second part is used.  */
+   second part is used.  A third part is only used if the space has
+   magazines (see hurd_slab_set_magazine_size).  */
 
 typedef struct hurd_slab_space *hurd_slab_space_t;
 struct hurd_slab_space
@@ -93,6 +95,9 @@ struct hurd_slab_space
   /* The user's private data.  */
   void *hook;
 
+  /* The name of the space in hurd_slab_print_stats, or NULL.  */
+  const char *name;
+
   /* Second part.  Runtime information for the slab space.  */
 
   struct hurd_slab *slab_first;
@@ -111,6 +116,30 @@ struct hurd_slab_space
   /* The size of one object.  Should include possible alignment as
      well as the size of the bufctl structure.  */
   size_t size;
+
+  /* True if the space is in the list of all slab spaces, linked
+     through NEXT_SPACE and PREVP.  A space is put there on its first
+     allocation, and taken out when it is destroyed.  */
+  bool registered;
+  struct hurd_slab_space *next_space;
+  struct hurd_slab_space **prevp;
+
+  /* Third part.  The magazine layer.  */
+
+  /* The number of objects in a magazine, or zero if the space has no
+     magazines.  */
+  int magazine_size;
+
+  /* The magazines of each thread, a struct hurd_slab_cache.  */
+  pthread_key_t cache_key;
+
+  /* Protects the depot: the magazines no thread has, with free
+     objects in them, and empty.  */
+  pthread_mutex_t depot_lock;
+  struct hurd_slab_magazine *depot_full;
+  struct hurd_slab_magazine *depot_empty;
+  int depot_nr_full;
+  int depot_nr_empty;
 };
 
 
@@ -124,15 +153,16 @@ struct hurd_slab_space
 #define HURD_SLAB_SPACE_INITIALIZER(TYPE, ALLOC, DEALLOC, CTOR,	\
 				    DTOR, HOOK)			\
   {								\
-    false,							\
-    PTHREAD_MUTEX_INITIALIZER, 					\
-    sizeof (TYPE),						\
-    __alignof__ (TYPE),						\
-    ALLOC,							\
-    DEALLOC,							\
-    CTOR,							\
-    DTOR,							\
-    HOOK							\
+    .initialized = false,					\
+    .lock = PTHREAD_MUTEX_INITIALIZER,				\
+    .requested_size = sizeof (TYPE),				\
+    .requested_align = __alignof__ (TYPE),			\
+    .allocate_buffer = ALLOC,					\
+    .deallocate_buffer = DEALLOC,				\
+    .constructor = CTOR,					\
+    .destructor = DTOR,						\
+    .hook = HOOK,						\
+    .name = NULL						\
     /* The rest of the structure will be filled with zeros,     \
        which is good for us.  */				\
   }
@@ -177,7 +207,87 @@ error_t hurd_slab_alloc (hurd_slab_space_t space, void **buffer);
 
 /* Deallocate the object BUFFER from the slab space SPACE.  */
 void hurd_slab_dealloc (hurd_slab_space_t space, void *buffer);
+
+/* The largest number of objects a magazine may hold.  */
+#define HURD_SLAB_MAGAZINE_MAX	128
+
+/* Give each thread allocating from SPACE magazines of SIZE objects,
+   SIZE being at most HURD_SLAB_MAGAZINE_MAX, from which it allocates,
+   and into which it deallocates, without taking the lock of SPACE.
+   When a thread's magazines run empty, or full, it trades them for
+   others in a depot shared by all threads, and when there are none
+   there, it gets or gives back objects to the slabs, many at a time.
+   A thread's magazines go back to the depot when it exits.  This must
+   be called before the first allocation from SPACE.  Returns EINVAL if
+   SIZE is out of range.  */
+error_t hurd_slab_set_magazine_size (hurd_slab_space_t space, int size);
+
+/* Give the free objects in the depot of SPACE, and in the magazines of
+   the calling thread, back to the slabs, and release the memory of the
+   slabs that then have no allocated objects, so that the memory can be
+   used elsewhere.  Objects in the magazines of other threads are not
+   released.  For spaces without magazines, this only releases the
+   memory of the slabs.  */
+error_t hurd_slab_reclaim (hurd_slab_space_t space);
 
+/* Name SPACE NAME in hurd_slab_print_stats.  NAME is not copied, and
+   must stay valid as long as SPACE does.  */
+void hurd_slab_set_name (hurd_slab_space_t space, const char *name);
+
+/* What a slab space holds, as returned by hurd_slab_get_stats.  */
+struct hurd_slab_stats
+{
+  /* The size of an object, bookkeeping and padding included, the size
+     of a slab, and how many objects a slab holds.  */
+  size_t obj_size;
+  size_t slab_size;
+  size_t bufs_per_slab;
+
+  /* The number of objects allocated, and of those, how many are free
+     objects in the depot of the space.  Objects in the magazines of
+     threads count as allocated.  */
+  size_t nr_objs;
+  size_t nr_cached;
+
+  /* The number of objects all the slabs hold.  */
+  size_t nr_bufs;
+
+  /* The number of slabs, of those which have no objects allocated,
+     which hurd_slab_reap can release, and of those which have some,
+     but not all, of their objects allocated.  */
+  size_t nr_slabs;
+  size_t nr_free_slabs;
+  size_t nr_partial_slabs;
+
+  /* The memory the slabs take, in bytes.  */
+  size_t mem_usage;
+};
+
+/* Fill STATS with what SPACE holds now.  */
+void hurd_slab_get_stats (hurd_slab_space_t space,
+			  struct hurd_slab_stats *stats);
+
+/* Release the memory of the slabs of SPACE that have no allocated
+   objects, but KEEP of them, so that allocations that come soon after
+   do not need to allocate them again.  Free objects in magazines are
+   allocated as far as the slabs know; use hurd_slab_reclaim to give
+   those back as well.  */
+error_t hurd_slab_reap (hurd_slab_space_t space, size_t keep);
+
+/* Call hurd_slab_reap with KEEP on every slab space that has had
+   objects allocated from it and is not destroyed.  Returns the first
+   error, after trying all of them.  The list of slab spaces stays
+   locked while the destructors and buffer deallocators of the spaces
+   run, so they must not allocate from a slab space that has not had
+   objects allocated from it yet, nor destroy a slab space.  */
+error_t hurd_slab_reap_all (size_t keep);
+
+/* Print a line for every slab space that has had objects allocated
+   from it and is not destroyed to STREAM, with what it holds, in the
+   format of the kernel's slab info, and a total.  Returns the error of
+   writing to STREAM, if any.  */
+error_t hurd_slab_print_stats (FILE *stream);
+
 /* Create a more strongly typed slab interface a la a C++ template.
 
    NAME is the name of the new slab class.  NAME is used to synthesize
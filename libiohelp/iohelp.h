@@ -128,6 +128,17 @@ error_t iohelp_return_malloced_buffer (char *buf, size_t len,
 				       char **rbuf,
 				       mach_msg_type_number_t *rlen);
 
+/* Pass up to AMOUNT bytes of FILE, starting at OFFSET, to SEND in
+   pieces read with io_read, and return in SENT how many it took.  An
+   OFFSET of -1 reads from the file pointer.  SEND is
+   called with HOOK and sets *SENT to how much of BUF it took; taking
+   less ends the transfer.  An error is returned only if nothing was
+   sent.  This is appropriate for implementing socket_send_file.  */
+error_t iohelp_send_file (mach_port_t file, loff_t offset, vm_size_t amount,
+			  error_t (*send) (const void *buf, size_t len,
+					   size_t *sent, void *hook),
+			  void *hook, vm_size_t *sent);
+
 
 
 #endif
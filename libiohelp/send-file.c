@@ -0,0 +1,82 @@
+/* Feed the contents of a file to a sending function
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include <mach.h>
+#include <hurd/io.h>
+
+#include "iohelp.h"
+
+/* How much of the file is read at a time.  */
+#define WINDOW	(256 * 1024)
+
+/* Send AMOUNT bytes of FILE from OFFSET, a window at a time, adding
+   what was sent to *SENT.  */
+static error_t
+send_read (mach_port_t file, loff_t offset, vm_size_t amount,
+	   error_t (*send) (const void *, size_t, size_t *, void *),
+	   void *hook, vm_size_t *sent)
+{
+  error_t err = 0;
+
+  while (amount > 0)
+    {
+      char *data = 0;
+      mach_msg_type_number_t datalen = 0;
+      size_t n;
+
+      err = io_read (file, &data, &datalen, offset,
+		     amount < WINDOW ? amount : WINDOW);
+      if (err || datalen == 0)
+	break;
+
+      err = (*send) (data, datalen, &n, hook);
+      vm_deallocate (mach_task_self (), (vm_address_t) data, datalen);
+      if (err)
+	break;
+
+      *sent += n;
+      if (offset != -1)
+	offset += n;
+      amount -= n;
+      if (n < datalen)
+	break;
+    }
+
+  return err;
+}
+
+error_t
+iohelp_send_file (mach_port_t file, loff_t offset, vm_size_t amount,
+		  error_t (*send) (const void *buf, size_t len,
+				   size_t *sent, void *hook),
+		  void *hook, vm_size_t *sent)
+{
+  error_t err;
+
+  *sent = 0;
+
+  /* The file is read rather than mapped: a mapping would have to be
+     copied out under a fault guard anyway, since the client's pager may
+     never supply the pages, so it would save nothing over io_read.  */
+  err = send_read (file, offset, amount, send, hook, sent);
+
+  /* Like a write, report the error only if nothing was sent.  */
+  return *sent ? 0 : err;
+}
@@ -0,0 +1,621 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/*
+ * Asynchronous device_read and device_write.
+ *
+ * Rather than keeping the thread that received it busy until it is done,
+ * a read or write with a reply port is put on a queue belonging to its
+ * device and MIG_NO_REPLY is returned.  A pool of worker threads takes
+ * requests off the queues of the devices in turn, at most
+ * MACHDEV_QUEUE_DEPTH of one device's at a time, and sends each reply
+ * when its request is done.  So a slow request on one device does not
+ * hold up others, and a driver gets several requests for a device at
+ * once.
+ *
+ * The queue of a device with records, that is a disk, is kept sorted by
+ * record number, and worked through in one direction like an elevator:
+ * the next request taken is the first at or past where the last one
+ * ended, going back to the lowest once there is none.  A request that
+ * has waited longer than QUEUE_EXPIRE goes next regardless, so one
+ * client reading sequentially cannot hold off another forever.  Reads,
+ * or writes, following on from the one taken are merged with it into a
+ * single call to the driver, up to MERGE_MAX bytes, and the result is
+ * split among their replies.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/param.h>
+
+#include <hurd.h>
+#include <mach.h>
+#include <device/device.h>
+
+#include "device_reply_U.h"
+#include "machdev-dev_hdr.h"
+#include "machdev.h"
+#include "mach_device.h"
+
+/* The number of worker threads.  */
+#define MACHDEV_WORKERS 16
+
+/* The most bytes that requests are merged into.  */
+#define MERGE_MAX (1024 * 1024)
+
+/* How long a request may wait while others are taken before it, in
+   nanoseconds.  */
+#define QUEUE_EXPIRE (100 * 1000000ULL)
+
+enum machdev_op
+{
+  MACHDEV_READ,
+  MACHDEV_WRITE,
+};
+
+struct machdev_request
+{
+  enum machdev_op op;
+  struct mach_device *device;
+  mach_port_t reply_port;
+  mach_msg_type_name_t reply_port_type;
+  dev_mode_t mode;
+  recnum_t recnum;
+  io_buf_ptr_t data;		/* For writes.  */
+  unsigned count;
+  unsigned long long queued_at;	/* When it was queued, in ns.  */
+  struct machdev_request *next;
+};
+
+struct machdev_queue
+{
+  struct machdev_request *head, *tail;
+  unsigned queued;		/* Requests waiting on the queue.  */
+  unsigned in_flight;		/* Requests taken off it and not done.  */
+  unsigned calls;		/* Calls to the driver being made for them.  */
+  int ready;			/* On the ready list.  */
+  struct machdev_queue *next_ready;
+
+  /* The size of the device's records, or 0 if it has none, in which
+     case its requests are taken in the order they came.  */
+  unsigned record_size;
+  recnum_t position;		/* Where the last request taken ended.  */
+
+  /* Statistics.  */
+  unsigned long long requests_done;
+  unsigned long long calls_done;
+  unsigned long long wait_total;	/* ns */
+  unsigned long long wait_max;		/* ns */
+};
+
+/* Protects all queues and the ready list.  */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+/* The queues that have a request a worker can start, in the order they
+   got it.  */
+static struct machdev_queue *ready_head, *ready_tail;
+
+static pthread_once_t workers_once = PTHREAD_ONCE_INIT;
+static int workers_started;
+
+static unsigned long long
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Put Q on the ready list, if it has a request that can be started.
+   QUEUE_LOCK must be held.  */
+static void
+queue_make_ready (struct machdev_queue *q)
+{
+  if (q->ready || ! q->head || q->calls >= MACHDEV_QUEUE_DEPTH)
+    return;
+
+  q->ready = 1;
+  q->next_ready = NULL;
+  if (ready_tail)
+    ready_tail->next_ready = q;
+  else
+    ready_head = q;
+  ready_tail = q;
+  pthread_cond_signal (&queue_cond);
+}
+
+/* Whether NEXT can be merged after the requests from FIRST to LAST, which
+   make up TOTAL bytes, on Q.  */
+static int
+request_can_merge (struct machdev_queue *q, struct machdev_request *first,
+		   struct machdev_request *last, unsigned total,
+		   struct machdev_request *next)
+{
+  if (next->op != first->op || next->mode != first->mode
+      || last->count % q->record_size != 0
+      || next->recnum != last->recnum + last->count / q->record_size
+      || total + next->count > MERGE_MAX)
+    return 0;
+
+  /* The data of a read is handed back to each request in place, so each
+     must start on a page of its own.  */
+  if (first->op == MACHDEV_READ && total % vm_page_size != 0)
+    return 0;
+
+  return 1;
+}
+
+/* Take the next requests to do off Q, as a list of requests to be merged
+   into one call, and account for them.  QUEUE_LOCK must be held.  */
+static struct machdev_request *
+queue_take (struct machdev_queue *q)
+{
+  struct machdev_request *req, *prev, *last, **pp;
+  unsigned long long now = now_ns ();
+  unsigned total;
+  int n;
+
+  if (! q->record_size)
+    {
+      req = q->head;
+      q->head = req->next;
+      if (! q->head)
+	q->tail = NULL;
+      req->next = NULL;
+      n = 1;
+      goto account;
+    }
+
+  /* Take the request that has waited longest if it has waited too long,
+     otherwise the first at or past the last position.  */
+  req = q->head;
+  for (last = q->head; last; last = last->next)
+    if (last->queued_at < req->queued_at)
+      req = last;
+  if (now - req->queued_at < QUEUE_EXPIRE)
+    {
+      for (req = q->head; req; req = req->next)
+	if (req->recnum >= q->position)
+	  break;
+      if (! req)
+	req = q->head;
+    }
+
+  for (pp = &q->head, prev = NULL; *pp != req; prev = *pp, pp = &(*pp)->next)
+    ;
+
+  /* The queue is sorted, so anything that follows on from REQ is next to
+     it.  */
+  total = req->count;
+  n = 1;
+  for (last = req; last->next; last = last->next)
+    {
+      if (! request_can_merge (q, req, last, total, last->next))
+	break;
+      total += last->next->count;
+      n++;
+    }
+
+  *pp = last->next;
+  if (q->tail == last)
+    q->tail = prev;
+  last->next = NULL;
+  q->position = last->recnum + last->count / q->record_size;
+
+ account:
+  q->queued -= n;
+  q->in_flight += n;
+  q->calls++;
+  q->calls_done++;
+  q->requests_done += n;
+  for (last = req; last; last = last->next)
+    {
+      unsigned long long wait = now - last->queued_at;
+      q->wait_total += wait;
+      if (wait > q->wait_max)
+	q->wait_max = wait;
+    }
+
+  return req;
+}
+
+/* Send the reply to the read REQ, of COUNT bytes of DATA.  */
+static void
+read_reply (struct machdev_request *req, io_return_t err,
+	    io_buf_ptr_t data, unsigned count)
+{
+  err = ds_device_read_reply (req->reply_port, req->reply_port_type,
+			      err, data, count);
+  if (err)
+    {
+      /* The reply was not sent, so DATA and the reply right are still
+	 ours.  */
+      if (data)
+	vm_deallocate (mach_task_self (), (vm_address_t) data, count);
+      mach_port_deallocate (mach_task_self (), req->reply_port);
+    }
+}
+
+/* Do the reads in the list REQS with one call of DEV's read, and send
+   their replies.  */
+static void
+reads_run (struct machdev_emul_device *dev, struct machdev_request *reqs)
+{
+  struct machdev_request *req;
+  io_buf_ptr_t data = 0;
+  unsigned bytes_read = 0;
+  unsigned total = 0, offset = 0;
+  io_return_t err;
+
+  for (req = reqs; req; req = req->next)
+    total += req->count;
+
+  err = (*dev->emul_ops->read) (dev->emul_data, reqs->reply_port,
+				reqs->reply_port_type, reqs->mode,
+				reqs->recnum, total, &data, &bytes_read);
+  if (err)
+    {
+      data = 0;
+      bytes_read = 0;
+    }
+
+  if (! reqs->next)
+    {
+      read_reply (reqs, err, data, bytes_read);
+      return;
+    }
+
+  /* Each request starts on a page boundary of its own, so the pages of
+     DATA can be given to them in turn.  */
+  if ((vm_address_t) data % vm_page_size != 0)
+    {
+      /* Not the way a driver returns data, but let's not assume.  */
+      io_buf_ptr_t copy;
+
+      if (vm_allocate (mach_task_self (), (vm_address_t *) &copy,
+		       bytes_read, TRUE))
+	{
+	  err = D_NO_MEMORY;
+	  copy = 0;
+	}
+      else
+	memcpy (copy, data, bytes_read);
+      vm_deallocate (mach_task_self (), (vm_address_t) data, bytes_read);
+      data = copy;
+      if (! data)
+	bytes_read = 0;
+    }
+
+  for (req = reqs; req; req = req->next)
+    {
+      unsigned count = 0;
+
+      if (offset < bytes_read)
+	count = MIN (req->count, bytes_read - offset);
+      read_reply (req, err, count ? data + offset : 0, count);
+      offset += req->count;
+    }
+}
+
+/* Do the writes in the list REQS with one call of DEV's write, and send
+   their replies.  */
+static void
+writes_run (struct machdev_emul_device *dev, struct machdev_request *reqs)
+{
+  struct machdev_request *req;
+  io_buf_ptr_t data;
+  unsigned total = 0, offset = 0;
+  int bytes_written = 0;
+  io_return_t err;
+
+  for (req = reqs; req; req = req->next)
+    total += req->count;
+
+  data = reqs->data;
+  if (reqs->next)
+    {
+      /* Copy the requests' data together.  */
+      if (vm_allocate (mach_task_self (), (vm_address_t *) &data,
+		       total, TRUE))
+	{
+	  /* Do them one by one instead.  */
+	  for (req = reqs; req; req = reqs)
+	    {
+	      reqs = req->next;
+	      req->next = NULL;
+	      writes_run (dev, req);
+	      req->next = reqs;
+	    }
+	  return;
+	}
+      for (req = reqs; req; req = req->next)
+	{
+	  memcpy (data + offset, req->data, req->count);
+	  vm_deallocate (mach_task_self (), (vm_address_t) req->data,
+			 req->count);
+	  offset += req->count;
+	}
+    }
+
+  err = (*dev->emul_ops->write) (dev->emul_data, reqs->reply_port,
+				 reqs->reply_port_type, reqs->mode,
+				 reqs->recnum, data, total, &bytes_written);
+  /* On success the driver has deallocated the data.  Otherwise it is left
+     for the server loop to destroy along with the request message, which
+     it did not get to do as the request was not answered straight
+     away.  */
+  if (err)
+    vm_deallocate (mach_task_self (), (vm_address_t) data, total);
+
+  for (req = reqs, offset = 0; req; req = req->next)
+    {
+      unsigned count = 0;
+
+      if (offset < bytes_written)
+	count = MIN (req->count, bytes_written - offset);
+      if (ds_device_write_reply (req->reply_port, req->reply_port_type,
+				 err, count))
+	mach_port_deallocate (mach_task_self (), req->reply_port);
+      offset += req->count;
+    }
+}
+
+static void *
+worker (void *arg)
+{
+  pthread_mutex_lock (&queue_lock);
+  while (1)
+    {
+      struct machdev_queue *q;
+      struct machdev_request *reqs, *req;
+      int n;
+
+      while (! ready_head)
+	pthread_cond_wait (&queue_cond, &queue_lock);
+
+      q = ready_head;
+      ready_head = q->next_ready;
+      if (! ready_head)
+	ready_tail = NULL;
+      q->ready = 0;
+
+      reqs = queue_take (q);
+
+      /* Let the next worker have a go at the other devices before this
+	 one again.  */
+      queue_make_ready (q);
+
+      pthread_mutex_unlock (&queue_lock);
+      if (reqs->op == MACHDEV_READ)
+	reads_run (&reqs->device->dev, reqs);
+      else
+	writes_run (&reqs->device->dev, reqs);
+
+      for (n = 0, req = reqs; req; req = req->next)
+	n++;
+
+      pthread_mutex_lock (&queue_lock);
+      q->in_flight -= n;
+      q->calls--;
+      queue_make_ready (q);
+      pthread_mutex_unlock (&queue_lock);
+
+      /* Dropping the last reference to the device frees Q, so only do it
+	 once we are done with Q.  */
+      for (; reqs; reqs = req)
+	{
+	  req = reqs->next;
+	  ports_port_deref (reqs->device);
+	  free (reqs);
+	}
+
+      pthread_mutex_lock (&queue_lock);
+    }
+
+  return NULL;
+}
+
+static void
+workers_start (void)
+{
+  pthread_t t;
+  int i;
+
+  for (i = 0; i < MACHDEV_WORKERS; i++)
+    {
+      if (pthread_create (&t, NULL, worker, NULL))
+	break;
+      pthread_detach (t);
+    }
+  workers_started = i;
+}
+
+/* Return a new queue for DEV.  */
+static struct machdev_queue *
+queue_create (struct machdev_emul_device *dev)
+{
+  struct machdev_queue *q;
+  int status[DEV_GET_RECORDS_COUNT];
+  mach_msg_type_number_t count = DEV_GET_RECORDS_COUNT;
+
+  q = calloc (1, sizeof *q);
+  if (! q)
+    return NULL;
+
+  if (dev->emul_ops->get_status
+      && (*dev->emul_ops->get_status) (dev->emul_data, DEV_GET_RECORDS,
+				       status, &count) == D_SUCCESS
+      && count >= DEV_GET_RECORDS_COUNT
+      && status[DEV_GET_RECORDS_RECORD_SIZE] > 0)
+    q->record_size = status[DEV_GET_RECORDS_RECORD_SIZE];
+
+  return q;
+}
+
+/* Put REQ on its device's queue.  Return MIG_NO_REPLY, or an error if it
+   could not be queued, in which case it should be done straight away.  */
+static io_return_t
+request_queue (struct machdev_request *req)
+{
+  struct machdev_emul_device *dev = &req->device->dev;
+  struct machdev_queue *q, *new = NULL;
+  struct machdev_request **pp;
+
+  pthread_once (&workers_once, workers_start);
+  if (! workers_started)
+    return EAGAIN;
+
+  /* Ask the driver about the device without holding the lock.  */
+  if (! dev->queue)
+    {
+      new = queue_create (dev);
+      if (! new)
+	return ENOMEM;
+    }
+
+  req->queued_at = now_ns ();
+
+  pthread_mutex_lock (&queue_lock);
+
+  q = dev->queue;
+  if (! q)
+    {
+      q = dev->queue = new;
+      new = NULL;
+    }
+
+  /* The request keeps the device until it is done.  */
+  ports_port_ref (req->device);
+
+  if (q->record_size)
+    {
+      /* After any requests for the same record, so that those are still
+	 done in the order they came.  */
+      for (pp = &q->head; *pp; pp = &(*pp)->next)
+	if ((*pp)->recnum > req->recnum)
+	  break;
+      req->next = *pp;
+      *pp = req;
+      if (! req->next)
+	q->tail = req;
+    }
+  else
+    {
+      req->next = NULL;
+      if (q->tail)
+	q->tail->next = req;
+      else
+	q->head = req;
+      q->tail = req;
+    }
+  q->queued++;
+  queue_make_ready (q);
+
+  pthread_mutex_unlock (&queue_lock);
+  free (new);
+  return MIG_NO_REPLY;
+}
+
+io_return_t
+machdev_queue_read (struct mach_device *device, mach_port_t reply_port,
+		    mach_msg_type_name_t reply_port_type, dev_mode_t mode,
+		    recnum_t recnum, int count)
+{
+  struct machdev_request *req;
+  io_return_t err;
+
+  req = malloc (sizeof *req);
+  if (! req)
+    return ENOMEM;
+
+  req->op = MACHDEV_READ;
+  req->device = device;
+  req->reply_port = reply_port;
+  req->reply_port_type = reply_port_type;
+  req->mode = mode;
+  req->recnum = recnum;
+  req->data = 0;
+  req->count = count;
+
+  err = request_queue (req);
+  if (err != MIG_NO_REPLY)
+    free (req);
+  return err;
+}
+
+io_return_t
+machdev_queue_write (struct mach_device *device, mach_port_t reply_port,
+		     mach_msg_type_name_t reply_port_type, dev_mode_t mode,
+		     recnum_t recnum, io_buf_ptr_t data, unsigned count)
+{
+  struct machdev_request *req;
+  io_return_t err;
+
+  req = malloc (sizeof *req);
+  if (! req)
+    return ENOMEM;
+
+  req->op = MACHDEV_WRITE;
+  req->device = device;
+  req->reply_port = reply_port;
+  req->reply_port_type = reply_port_type;
+  req->mode = mode;
+  req->recnum = recnum;
+  req->data = data;
+  req->count = count;
+
+  err = request_queue (req);
+  if (err != MIG_NO_REPLY)
+    free (req);
+  return err;
+}
+
+void
+machdev_queue_status (struct mach_device *device, dev_status_t status)
+{
+  struct machdev_queue *q;
+
+  memset (status, 0, MACHDEV_QUEUE_STATUS_COUNT * sizeof status[0]);
+  status[MACHDEV_QUEUE_STATUS_DEPTH] = MACHDEV_QUEUE_DEPTH;
+
+  pthread_mutex_lock (&queue_lock);
+  q = device->dev.queue;
+  if (q)
+    {
+      status[MACHDEV_QUEUE_STATUS_QUEUED] = q->queued;
+      status[MACHDEV_QUEUE_STATUS_IN_FLIGHT] = q->in_flight;
+      status[MACHDEV_QUEUE_STATUS_REQUESTS] = q->requests_done;
+      status[MACHDEV_QUEUE_STATUS_CALLS] = q->calls_done;
+      if (q->requests_done)
+	status[MACHDEV_QUEUE_STATUS_WAIT_AVG] =
+	  q->wait_total / q->requests_done / 1000;
+      status[MACHDEV_QUEUE_STATUS_WAIT_MAX] = q->wait_max / 1000;
+    }
+  pthread_mutex_unlock (&queue_lock);
+}
+
+void
+machdev_queue_free (struct mach_device *device)
+{
+  free (device->dev.queue);
+  device->dev.queue = NULL;
+}
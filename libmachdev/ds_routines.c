@@ -164,6 +164,15 @@ ds_device_write (struct mach_device *device, mach_port_t reply_port,
   if (! device->dev.emul_ops->write)
     return D_INVALID_OPERATION;
 
+  if (MACH_PORT_VALID (reply_port))
+    {
+      io_return_t err = machdev_queue_write (device, reply_port,
+					     reply_port_type, mode, recnum,
+					     data, count);
+      if (err == MIG_NO_REPLY)
+	return err;
+    }
+
   return (*device->dev.emul_ops->write) (device->dev.emul_data, reply_port,
 					 reply_port_type, mode, recnum,
 					 data, count, bytes_written);
@@ -206,6 +215,15 @@ ds_device_read (struct mach_device *device, mach_port_t reply_port,
   if (! device->dev.emul_ops->read)
     return D_INVALID_OPERATION;
 
+  if (MACH_PORT_VALID (reply_port))
+    {
+      io_return_t err = machdev_queue_read (device, reply_port,
+					    reply_port_type, mode, recnum,
+					    count);
+      if (err == MIG_NO_REPLY)
+	return err;
+    }
+
   return (*device->dev.emul_ops->read) (device->dev.emul_data, reply_port,
 				        reply_port_type, mode, recnum,
 				        count, data, bytes_read);
@@ -255,6 +273,15 @@ ds_device_get_status (struct mach_device *device, dev_flavor_t flavor,
   if (device == MACH_DEVICE_NULL)
     return D_NO_SUCH_DEVICE;
 
+  if (flavor == MACHDEV_GET_QUEUE_STATUS)
+    {
+      if (*status_count < MACHDEV_QUEUE_STATUS_COUNT)
+	return D_INVALID_OPERATION;
+      machdev_queue_status (device, status);
+      *status_count = MACHDEV_QUEUE_STATUS_COUNT;
+      return D_SUCCESS;
+    }
+
   if (! device->dev.emul_ops->get_status)
     return D_INVALID_OPERATION;
 
@@ -310,8 +337,19 @@ ds_device_intr_ack (mach_device_t dev, mach_port_t receive_port)
 error_t
 machdev_create_device_port (size_t size, void *result)
 {
-  return ports_create_port (machdev_device_class, machdev_device_bucket,
-			    size, result);
+  error_t err;
+
+  err = ports_create_port (machdev_device_class, machdev_device_bucket,
+			   size, result);
+  if (! err)
+    (*(struct mach_device **) result)->dev.queue = NULL;
+  return err;
+}
+
+static void
+machdev_device_clean (void *arg)
+{
+  machdev_queue_free (arg);
 }
 
 void
@@ -320,7 +358,7 @@ machdev_device_init(void)
   int i;
 
   machdev_device_bucket = ports_create_bucket ();
-  machdev_device_class = ports_create_class (0, 0);
+  machdev_device_class = ports_create_class (machdev_device_clean, 0);
 
   for (i = 0; i < num_emul; i++)
     {
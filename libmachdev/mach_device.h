@@ -32,4 +32,14 @@ struct mach_device {
 typedef	struct mach_device *mach_device_t;
 #define	MACH_DEVICE_NULL ((mach_device_t)0)
 
+/* ds_queue.c */
+io_return_t machdev_queue_read (struct mach_device *, mach_port_t,
+				mach_msg_type_name_t, dev_mode_t,
+				recnum_t, int);
+io_return_t machdev_queue_write (struct mach_device *, mach_port_t,
+				 mach_msg_type_name_t, dev_mode_t,
+				 recnum_t, io_buf_ptr_t, unsigned);
+void machdev_queue_status (struct mach_device *, dev_status_t);
+void machdev_queue_free (struct mach_device *);
+
 #endif	/* _MACHDEV_MACH_DEVICE_H */
@@ -68,6 +68,7 @@ struct machdev_emul_device
 {
     struct machdev_device_emulation_ops *emul_ops;
     void *emul_data;
+    struct machdev_queue *queue;	/* reads and writes waiting, or 0 */
 };
 
 typedef struct machdev_emul_device *machdev_emul_device_t;
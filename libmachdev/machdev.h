@@ -29,6 +29,28 @@
 
 extern struct port_bucket *machdev_device_bucket;
 
+/* device_read and device_write requests with a reply port are queued and
+   answered by a pool of worker threads.  At most this many requests of
+   a device are handed to its driver at once.  */
+#define MACHDEV_QUEUE_DEPTH 8
+
+/* device_get_status flavor, answered by libmachdev for any of its
+   devices, giving the number of requests waiting on the device's queue,
+   the number being done, and MACHDEV_QUEUE_DEPTH.  Then the number of
+   requests taken off the queue so far and of the calls to the driver
+   they were merged into, which is fewer when requests for adjacent
+   records were merged, and the mean and longest time, in microseconds,
+   that they waited on the queue.  */
+#define MACHDEV_GET_QUEUE_STATUS	(('q' << 16) + 1)
+#define MACHDEV_QUEUE_STATUS_QUEUED	0
+#define MACHDEV_QUEUE_STATUS_IN_FLIGHT	1
+#define MACHDEV_QUEUE_STATUS_DEPTH	2
+#define MACHDEV_QUEUE_STATUS_REQUESTS	3
+#define MACHDEV_QUEUE_STATUS_CALLS	4
+#define MACHDEV_QUEUE_STATUS_WAIT_AVG	5
+#define MACHDEV_QUEUE_STATUS_WAIT_MAX	6
+#define MACHDEV_QUEUE_STATUS_COUNT	7
+
 void machdev_register (struct machdev_device_emulation_ops *ops);
 
 void machdev_device_init(void);
@@ -70,6 +70,11 @@ pipe_create (struct pipe_class *class, struct pipe **pipe)
 
   pq_create (&new->queue);
 
+  memset (&new->ring, 0, sizeof new->ring);
+  if (class->flags & PIPE_CLASS_RING)
+    /* If this fails, the pipe just keeps everything in packets.  */
+    _pipe_ring_create (new);
+
   if (! pipe_is_connless (new))
     new->flags |= PIPE_BROKEN;
 
@@ -82,6 +87,7 @@ void
 pipe_free (struct pipe *pipe)
 {
   pq_free (pipe->queue);
+  _pipe_ring_free (pipe);
   free (pipe);
 }
 
@@ -373,6 +379,7 @@ pipe_send (struct pipe *pipe, int noblock, void *source,
 	err = ENOBUFS;
       else
 	{
+	  control_packet->ring_pos = pipe->ring.written;
 	  err = packet_write (control_packet, control, control_len, NULL);
 	  if (!err)
 	    err = packet_set_ports (control_packet, ports, num_ports);
@@ -394,10 +401,22 @@ pipe_send (struct pipe *pipe, int noblock, void *source,
       size_t partial_amount;
 
       if (todo > left)
-	todo = left;
+	{
+	  todo = left;
+	  if (todo >= PACKET_SIZE_VIRTUAL
+	      && trunc_page ((vm_address_t) (data + done))
+		 == (vm_address_t) (data + done))
+	    /* Keep the rest of a page-aligned buffer page-aligned, so
+	       that it can still be copied virtually by the next write.  */
+	    todo = trunc_page (todo);
+	}
 
-      err = (*pipe->class->write)(pipe->queue, source, data + done, todo,
-				  &partial_amount);
+      if (pipe->ring.buf)
+	/* Ring pipes are streams, which have no sources.  */
+	err = _pipe_ring_write (pipe, data + done, todo, &partial_amount);
+      else
+	err = (*pipe->class->write)(pipe->queue, source, data + done, todo,
+				    &partial_amount);
 
       if (!err)
 	{
@@ -469,6 +488,19 @@ pipe_recv (struct pipe *pipe, int noblock, unsigned *flags, void **source,
   if (err)
     return err;
 
+  if (pipe->ring.buf)
+    {
+      err = _pipe_ring_recv (pipe, data_only, flags, source,
+			     data, data_len, amount,
+			     control, control_len, ports, num_ports);
+      if (!err)
+	{
+	  timestamp (&pipe->read_time);
+	  _pipe_wake_writers (pipe);
+	}
+      return err;
+    }
+
   packet = pq_head (pq, PACKET_TYPE_ANY, 0);
 
   if (data_only)
@@ -56,6 +56,7 @@ struct pipe_class
 
 /* pipe_class flags  */
 #define PIPE_CLASS_CONNECTIONLESS	0x1 /* A non-stream protocol.  */
+#define PIPE_CLASS_RING			0x2 /* Keep data in a ring buffer.  */
 
 /* Some pre-defined pipe_classes.  */
 extern struct pipe_class *stream_pipe_class;
@@ -69,6 +70,17 @@ struct pipe_select_cond
   pthread_cond_t cond;
 };
 
+/* Stream data for pipes of a class with PIPE_CLASS_RING.  BUF is a ring
+   of MASK + 1 bytes, a power of two; READ and WRITTEN count the bytes ever
+   read from and written to it, so the data in it runs from READ & MASK to
+   WRITTEN & MASK, wrapping around at the end.  */
+struct pipe_ring
+{
+  char *buf;
+  size_t mask;
+  size_t read, written;
+};
+
 /* A unidirectional data pipe; it transfers data from READER to WRITER.  */
 struct pipe
 {
@@ -114,6 +126,13 @@ struct pipe
      packet (if any).  Reads interested only in data just skip control
      packets until they find a data packet.  */
   struct pq *queue;
+
+  /* If the class has PIPE_CLASS_RING and the ring could be allocated, the
+     data written, which then goes into QUEUE only if it doesn't fit or is
+     better passed on as whole pages.  Packets in QUEUE are marked with
+     the ring's WRITTEN count when they were queued, and come before any
+     data written to the ring from that point on.  */
+  struct pipe_ring ring;
 };
 
 /* Pipe flags.  */
@@ -140,7 +159,7 @@ extern error_t pipe_select_writable (struct pipe *pipe, struct timespec *tsp);
 PIPE_EI size_t
 pipe_readable (struct pipe *pipe, int data_only)
 {
-  size_t readable = 0;
+  size_t readable = pipe->ring.written - pipe->ring.read;
   struct pq *pq = pipe->queue;
   struct packet *packet = pq_head (pq, PACKET_TYPE_ANY, NULL);
   while (packet)
@@ -161,6 +180,8 @@ pipe_is_readable (struct pipe *pipe, int data_only)
 {
   struct pq *pq = pipe->queue;
   struct packet *packet = pq_head (pq, PACKET_TYPE_ANY, NULL);
+  if (pipe->ring.written != pipe->ring.read)
+    return 1;
   if (data_only)
     while (packet && packet->type == PACKET_TYPE_CONTROL)
       packet = packet->next;
@@ -249,6 +270,26 @@ error_t pipe_create (struct pipe_class *class, struct pipe **pipe);
 /* Free PIPE and any resources it holds.  */
 void pipe_free (struct pipe *pipe);
 
+/* Allocate PIPE's ring buffer, big enough for its write limit.  */
+error_t _pipe_ring_create (struct pipe *pipe);
+
+/* Free PIPE's ring buffer, if it has one.  */
+void _pipe_ring_free (struct pipe *pipe);
+
+/* Write DATA, of length DATA_LEN, to PIPE, which has a ring buffer and
+   should be locked, and return the amount written in AMOUNT.  */
+error_t _pipe_ring_write (struct pipe *pipe,
+			  const char *data, size_t data_len, size_t *amount);
+
+/* Like pipe_recv, for PIPE, which has a ring buffer, after waiting for it
+   to be readable.  DATA_ONLY is true if CONTROL and PORTS are both
+   NULL.  */
+error_t _pipe_ring_recv (struct pipe *pipe, int data_only, unsigned *flags,
+			 void **source,
+			 char **data, size_t *data_len, size_t amount,
+			 char **control, size_t *control_len,
+			 mach_port_t **ports, size_t *num_ports);
+
 /* Take any actions necessary when PIPE acquires its first reader.  */ 
 void _pipe_first_reader (struct pipe *pipe);
 
@@ -366,6 +407,7 @@ PIPE_EI void
 pipe_drain (struct pipe *pipe)
 {
   pq_drain (pipe->queue);
+  pipe->ring.read = pipe->ring.written;
 }
 
 #endif /* Use extern inlines.  */
@@ -25,6 +25,9 @@
 #include <sys/mman.h>
 
 #include "pq.h"
+
+#define page_aligned(addr) \
+  (trunc_page ((vm_address_t) (addr)) == (vm_address_t) (addr))
 
 /* ---------------------------------------------------------------- */
 
@@ -215,18 +218,15 @@ packet_extend (struct packet *packet, size_t new_len)
   return 1;
 }
 
-/* Reallocate PACKET to have NEW_LEN bytes of buffer space, which should be
-   greater than the current packet size.  This should be a valid length --
-   i.e., if it's greater than PACKET_SIZE_LARGE, it should be a multiple of
-   VM_PAGE_SIZE.  If an error occurs, PACKET is not modified and the error is
-   returned.  */
-error_t
-packet_realloc (struct packet *packet, size_t new_len)
+/* Reallocate PACKET to have NEW_LEN bytes of buffer space, vm_allocated if
+   VM_ALLOC is true (in which case NEW_LEN should be a multiple of
+   VM_PAGE_SIZE), else malloc'd.  */
+static error_t
+packet_realloc_1 (struct packet *packet, size_t new_len, int vm_alloc)
 {
   error_t err;
   char *new_buf;
   char *old_buf = packet->buf;
-  int vm_alloc = (new_len >= PACKET_SIZE_LARGE);
 
   /* Make a new buffer.  */
   if (vm_alloc)
@@ -273,6 +273,17 @@ packet_realloc (struct packet *packet, size_t new_len)
 
   return err;
 }
+
+/* Reallocate PACKET to have NEW_LEN bytes of buffer space, which should be
+   greater than the current packet size.  This should be a valid length --
+   i.e., if it's greater than PACKET_SIZE_LARGE, it should be a multiple of
+   VM_PAGE_SIZE.  If an error occurs, PACKET is not modified and the error is
+   returned.  */
+error_t
+packet_realloc (struct packet *packet, size_t new_len)
+{
+  return packet_realloc_1 (packet, new_len, new_len >= PACKET_SIZE_LARGE);
+}
 
 /* ---------------------------------------------------------------- */
 
@@ -336,13 +347,44 @@ error_t
 packet_write (struct packet *packet,
 	      const char *data, size_t data_len, size_t *amount)
 {
-  error_t err = packet_ensure (packet, data_len);
+  error_t err;
+  size_t pages = 0;
+
+  if (data_len >= PACKET_SIZE_VIRTUAL && page_aligned (data)
+      && packet->buf_start == packet->buf_end)
+    /* DATA starts with whole pages, as out-of-line data from io_write
+       does, and PACKET is empty: make sure it has a page-aligned buffer
+       that they can be copied into below.  */
+    {
+      size_t need = round_page (data_len);
+      if (! packet->buf_vm_alloced || packet->buf_len < need)
+	{
+	  err = packet_realloc_1 (packet, need, 1);
+	  if (err)
+	    return err;
+	}
+      packet->buf_start = packet->buf_end = packet->buf;
+    }
 
+  err = packet_ensure (packet, data_len);
   if (err)
     return err;
 
-  /* Add the new data.  */
-  memcpy (packet->buf_end, data, data_len);
+  if (data_len >= PACKET_SIZE_VIRTUAL && packet->buf_vm_alloced
+      && page_aligned (data) && page_aligned (packet->buf_end))
+    /* Copy the whole pages virtually, so that they're shared
+       copy-on-write with the writer's buffer (which MiG usually throws
+       away as soon as we return), and can be handed to the reader
+       by packet_fetch without being touched in between.  */
+    {
+      pages = trunc_page (data_len);
+      if (vm_copy (mach_task_self (), (vm_address_t) data, pages,
+		   (vm_address_t) packet->buf_end))
+	pages = 0;
+    }
+
+  /* Add the rest of the new data.  */
+  memcpy (packet->buf_end + pages, data + pages, data_len - pages);
   packet->buf_end += data_len;
   if (amount != NULL)
     *amount = data_len;
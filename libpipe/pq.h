@@ -55,6 +55,10 @@ struct packet
   mach_port_t *ports;
   size_t num_ports, ports_alloced;
 
+  /* For a pipe with a ring buffer, the count of bytes written to the ring
+     when this packet was queued; see struct pipe_ring in "pipe.h".  */
+  size_t ring_pos;
+
   /* Next and previous packets within the packet queue we're part of.  If
      PREV is null, we're at the head of the queue, and if NEXT is null, we're
      at the tail.  */
@@ -129,6 +133,11 @@ packet_read_source (struct packet *packet, void **source)
    copying around data.  */
 #define PACKET_SIZE_LARGE	8192
 
+/* Page-aligned writes of at least this many bytes get a packet of their
+   own, whose pages are copied virtually.  For smaller ones, allocating
+   the packet costs more than copying the data.  */
+#define PACKET_SIZE_VIRTUAL	(8 * vm_page_size)
+
 /* Returns a legal size to which PACKET can be set allowing enough room for
    EXTRA bytes more than what's already in it, and perhaps more.  */
 size_t packet_new_size (struct packet *packet, size_t extra);
@@ -0,0 +1,216 @@
+/* Ring buffers for stream pipes
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>		/* For MSG_PEEK */
+
+#include "pipe.h"
+
+/* A stream pipe spends its life doing small reads and writes, so rather
+   than giving every write a packet of its own, it copies them into one
+   ring, allocated up front, and readers copy them out again.  Only
+   control packets, and data that is better passed on as whole pages or
+   that doesn't fit in the ring, go in the pipe's packet queue.  */
+
+#define page_aligned(addr) \
+  (trunc_page ((vm_address_t) (addr)) == (vm_address_t) (addr))
+
+/* Allocate PIPE's ring buffer, big enough for its write limit.  */
+error_t
+_pipe_ring_create (struct pipe *pipe)
+{
+  size_t size = vm_page_size;
+  char *buf;
+
+  while (size < pipe->write_limit)
+    size <<= 1;
+
+  /* Pages the pipe never gets as far as using are never touched.  */
+  buf = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (buf == (char *) -1)
+    return errno;
+
+  pipe->ring.buf = buf;
+  pipe->ring.mask = size - 1;
+  pipe->ring.read = pipe->ring.written = 0;
+  return 0;
+}
+
+/* Free PIPE's ring buffer, if it has one.  */
+void
+_pipe_ring_free (struct pipe *pipe)
+{
+  if (pipe->ring.buf)
+    munmap (pipe->ring.buf, pipe->ring.mask + 1);
+}
+
+/* Write DATA, of length DATA_LEN, to PIPE, which has a ring buffer and
+   should be locked, and return the amount written in AMOUNT.  */
+error_t
+_pipe_ring_write (struct pipe *pipe,
+		  const char *data, size_t data_len, size_t *amount)
+{
+  struct pipe_ring *ring = &pipe->ring;
+  int pages = data_len >= PACKET_SIZE_VIRTUAL && page_aligned (data);
+  size_t done = 0;
+
+  if (! pages)
+    /* Copy as much as fits into the ring.  */
+    {
+      size_t size = ring->mask + 1;
+      size_t space = size - (ring->written - ring->read);
+      size_t start = ring->written & ring->mask;
+      size_t first;
+
+      done = data_len < space ? data_len : space;
+      first = size - start < done ? size - start : done;
+      memcpy (ring->buf + start, data, first);
+      memcpy (ring->buf, data + first, done - first);
+      ring->written += done;
+    }
+
+  if (done < data_len)
+    /* Queue whole pages so that packet_write can copy them virtually, and
+       anything that doesn't fit in the ring because the write limit has
+       been raised since it was allocated.  */
+    {
+      struct pq *pq = pipe->queue;
+      struct packet *packet = pq->tail;
+      size_t partial;
+      error_t err;
+
+      if (pages || ! packet || packet->type != PACKET_TYPE_DATA
+	  || packet->ring_pos != ring->written)
+	{
+	  packet = pq_queue (pq, PACKET_TYPE_DATA, NULL);
+	  if (! packet)
+	    err = ENOBUFS;
+	  else
+	    packet->ring_pos = ring->written;
+	}
+
+      if (packet)
+	err = packet_write (packet, data + done, data_len - done, &partial);
+      if (err && ! done)
+	return err;
+      if (! err)
+	done += partial;
+    }
+
+  *amount = done;
+  return 0;
+}
+
+/* Copy up to AMOUNT bytes out of RING, without going past END, into DATA
+   and return the amount copied in DATA_LEN, as packet_read does.  Unless
+   PEEK is true, remove them from RING.  */
+static error_t
+ring_fetch (struct pipe_ring *ring, size_t end,
+	    char **data, size_t *data_len, size_t amount, int peek)
+{
+  size_t size = ring->mask + 1;
+  size_t start = ring->read & ring->mask;
+  size_t first;
+
+  if (amount > end - ring->read)
+    amount = end - ring->read;
+
+  if (*data_len < amount)
+    {
+      *data = mmap (0, amount, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (*data == (char *) -1)
+	return errno;
+    }
+
+  first = size - start < amount ? size - start : amount;
+  memcpy (*data, ring->buf + start, first);
+  memcpy (*data + first, ring->buf, amount - first);
+  if (! peek)
+    ring->read += amount;
+
+  *data_len = amount;
+  return 0;
+}
+
+/* Like pipe_recv, for PIPE, which has a ring buffer, after waiting for it
+   to be readable.  DATA_ONLY is true if CONTROL and PORTS are both
+   NULL.  */
+error_t
+_pipe_ring_recv (struct pipe *pipe, int data_only, unsigned *flags,
+		 void **source,
+		 char **data, size_t *data_len, size_t amount,
+		 char **control, size_t *control_len,
+		 mach_port_t **ports, size_t *num_ports)
+{
+  struct pipe_ring *ring = &pipe->ring;
+  struct pq *pq = pipe->queue;
+  struct packet *packet = pq_head (pq, PACKET_TYPE_ANY, 0);
+  error_t err = 0;
+
+  /* A packet is only due once the data written before it has been read.  */
+#define due(packet) ((packet) && (packet)->ring_pos == ring->read)
+
+  if (data_only)
+    /* The user doesn't want to know about control info, so skip any...  */
+    while (due (packet) && packet->type == PACKET_TYPE_CONTROL)
+      packet = pq_next (pq, PACKET_TYPE_ANY, 0);
+  else if (due (packet) && packet->type == PACKET_TYPE_CONTROL)
+    /* Read this control packet first, and then the data following it.  */
+    {
+      if (control != NULL)
+	packet_read (packet, control, control_len, packet_readable (packet));
+      if (ports != NULL)
+	packet_read_ports (packet, ports, num_ports);
+      packet = pq_next (pq, PACKET_TYPE_ANY, 0);
+    }
+  else
+    {
+      if (control_len)
+	*control_len = 0;
+      if (num_ports)
+	*num_ports = 0;
+    }
+
+  if (source)
+    *source = NULL;
+
+  if (due (packet))
+    {
+      if (packet->type == PACKET_TYPE_DATA)
+	{
+	  int dq = 1;
+	  err = (*pipe->class->read)(packet, &dq, flags,
+				     data, data_len, amount);
+	  if (dq)
+	    pq_dequeue (pq);
+	}
+      else
+	/* Another control packet, so there's no data to go with this one.  */
+	*data_len = 0;
+    }
+  else
+    /* Read from the ring, up to the next packet, if any.  At EOF, there
+       is nothing in it and this returns nothing.  */
+    err = ring_fetch (ring, packet ? packet->ring_pos : ring->written,
+		      data, data_len, amount, flags && *flags & MSG_PEEK);
+
+#undef due
+
+  return err;
+}
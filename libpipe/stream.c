@@ -43,7 +43,8 @@ stream_write (struct pq *pq, void *source,
 	  || ! packet_ensure_efficiently (packet, data_len)))
     /* Put a large page-aligned transfer in its own packet, if it's
        page-aligned `differently' than the end of the current packet, or if
-       the current packet can't be extended in place.  */
+       the current packet can't be extended in place; packet_write can
+       then copy its pages virtually.  */
     packet = pq_queue (pq, PACKET_TYPE_DATA, source);
 
   if (!packet)
@@ -72,6 +73,6 @@ stream_read (struct packet *packet, int *dequeue, unsigned *flags,
 
 struct pipe_class _stream_pipe_class =
 {
-  SOCK_STREAM, 0, stream_read, stream_write
+  SOCK_STREAM, PIPE_CLASS_RING, stream_read, stream_write
 };
 struct pipe_class *stream_pipe_class = &_stream_pipe_class;
@@ -367,6 +367,58 @@ proc_stat_list_add_pgrp (struct proc_stat_list *pp, pid_t pgrp,
 
 /* ---------------------------------------------------------------- */
 
+/* Have the proc_stats in PP that lack some of FLAGS take the procinfo
+   they need from one call to proc_getprocinfos, returning the records in
+   PROCINFOS and PROCINFOS_LEN, if that can be done.  Otherwise each
+   proc_stat asks for its own later.  */
+static void
+prefetch_procinfo (struct proc_stat_list *pp, ps_flags_t flags,
+		   procinfo_t *procinfos, mach_msg_type_number_t *procinfos_len)
+{
+  struct proc_stat **procs = pp->proc_stats;
+  struct proc_stat **need;
+  pid_t *pids;
+  unsigned i, num = 0;
+  size_t off;
+  int pi_flags;
+  error_t err;
+
+  *procinfos = 0;
+  *procinfos_len = 0;
+
+  need = NEWVEC (struct proc_stat *, pp->num_procs);
+  pids = NEWVEC (pid_t, pp->num_procs);
+  if (need && pids)
+    for (i = 0; i < pp->num_procs; i++)
+      if (! proc_stat_is_thread (procs[i]) && ! proc_stat_has (procs[i], flags))
+	{
+	  need[num] = procs[i];
+	  pids[num++] = procs[i]->pid;
+	}
+
+  if (num > 1)
+    {
+      err = ps_context_get_procinfos (pp->context, pids, num, flags,
+				      &pi_flags, procinfos, procinfos_len);
+      if (err)
+	/* Perhaps the proc server is too old; never mind.  */
+	*procinfos_len = 0;
+
+      /* There is a record for each process, in order.  */
+      for (i = 0, off = 0; i < num && off < *procinfos_len; i++)
+	{
+	  struct procinfo_record *rec =
+	    (struct procinfo_record *) (*procinfos + off);
+	  if (rec->pid == need[i]->pid)
+	    proc_stat_set_procinfo (need[i], rec, pi_flags);
+	  off += rec->size;
+	}
+    }
+
+  FREE (need);
+  FREE (pids);
+}
+
 /* Try to set FLAGS in each proc_stat in PP (but they may still not be set
    -- you have to check).  If a fatal error occurs, the error code is
    returned, otherwise 0.  */
@@ -375,22 +427,31 @@ proc_stat_list_set_flags (struct proc_stat_list *pp, ps_flags_t flags)
 {
   unsigned nprocs = pp->num_procs;
   struct proc_stat **procs = pp->proc_stats;
+  procinfo_t procinfos;
+  mach_msg_type_number_t procinfos_len;
+  error_t err = 0;
 
-  while (nprocs-- > 0)
+  prefetch_procinfo (pp, flags, &procinfos, &procinfos_len);
+
+  while (nprocs-- > 0 && !err)
     {
       struct proc_stat *ps = *procs++;
 
       if (!proc_stat_has (ps, flags))
-	{
-	  error_t err = proc_stat_set_flags (ps, flags);
-	  if (err)
-	    return err;
-	}
+	err = proc_stat_set_flags (ps, flags);
     }
 
-  return 0;
+  if (procinfos_len > 0)
+    {
+      /* Make sure no proc_stat is left pointing into PROCINFOS.  */
+      for (nprocs = 0; nprocs < pp->num_procs; nprocs++)
+	proc_stat_set_procinfo (pp->proc_stats[nprocs], 0, 0);
+      VMFREE (procinfos, procinfos_len * sizeof (int));
+    }
+
+  return err;
 }
-
+
 /* ---------------------------------------------------------------- */
 
 /* Destructively modify PP to only include proc_stats for which the
@@ -27,6 +27,7 @@
 #include "common.h"
 
 #include "ps_msg.h"
+#include "ps_process.h"
 
 /* ---------------------------------------------------------------- */
 
@@ -100,57 +101,103 @@ thread_state (thread_basic_info_t bi)
 #define PSTAT_PROCINFO_MERGE    (PSTAT_TASK_BASIC | PSTAT_TASK_EVENTS)
 #define PSTAT_PROCINFO_REFETCH  (PSTAT_PROCINFO - PSTAT_PROCINFO_MERGE)
 
-/* Fetches process information from the set in PSTAT_PROCINFO, returning it
-   in PI & PI_SIZE.  NEED is the information, and HAVE is the what we already
-   have.  */
+/* Which PI_FETCH_ flags proc_getprocinfo needs for each PSTAT_ flag.  */
+static const struct { ps_flags_t ps_flag; int pi_flags; } procinfo_map[] =
+{
+  { PSTAT_TASK_BASIC,     PI_FETCH_TASKINFO				},
+  { PSTAT_TASK_EVENTS,    PI_FETCH_TASKEVENTS				},
+  { PSTAT_NUM_THREADS,    PI_FETCH_THREADS				},
+  { PSTAT_THREAD_BASIC,   PI_FETCH_THREAD_BASIC | PI_FETCH_THREADS	},
+  { PSTAT_THREAD_SCHED,   PI_FETCH_THREAD_SCHED | PI_FETCH_THREADS	},
+  { PSTAT_THREAD_WAITS,   PI_FETCH_THREAD_WAITS | PI_FETCH_THREADS	},
+  { 0, }
+};
+
+/* Returns the PI_FETCH_ flags to get what is in NEED and not in HAVE.  */
+static int
+procinfo_fetch_flags (ps_flags_t need, ps_flags_t have)
+{
+  int pi_flags = 0;
+  int i;
+
+  for (i = 0; procinfo_map[i].ps_flag; i++)
+    if ((need & procinfo_map[i].ps_flag) && !(have & procinfo_map[i].ps_flag))
+      pi_flags |= procinfo_map[i].pi_flags;
+  return pi_flags;
+}
+
+/* The size of the header of a record from proc_getprocinfos, in ints.  */
+#define PROCINFO_RECORD_HDR (sizeof (struct procinfo_record) / sizeof (int))
+
+/* Gets the procinfo in REC into PI & PI_SIZE, as proc_getprocinfo would,
+   returning the PI_FETCH_ flags it holds in PI_FLAGS.  */
+static error_t
+copy_procinfo (const struct procinfo_record *rec, int *pi_flags,
+	       struct procinfo **pi, mach_msg_type_number_t *pi_size)
+{
+  size_t size = (rec->size - PROCINFO_RECORD_HDR) * sizeof (int);
+
+  if (rec->error)
+    return rec->error;
+
+  if (size > *pi_size)
+    {
+      void *new = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (new == MAP_FAILED)
+	return ENOMEM;
+      *pi = new;
+    }
+  memcpy (*pi, (const int *) rec + PROCINFO_RECORD_HDR, size);
+  *pi_size = size;
+  *pi_flags = rec->flags;
+  return 0;
+}
+
+/* Fetches process information from the set in PSTAT_PROCINFO for PS,
+   returning it in PI & PI_SIZE.  NEED is the information, and HAVE is the
+   what we already have.  */
 static error_t
-fetch_procinfo (process_t server, pid_t pid,
+fetch_procinfo (struct proc_stat *ps,
 		ps_flags_t need, ps_flags_t *have,
 		struct procinfo **pi,
 		mach_msg_type_number_t *pi_size,
 		char **waits,
 		mach_msg_type_number_t *waits_len)
 {
-  static const struct { ps_flags_t ps_flag; int pi_flags; } map[] =
-  {
-    { PSTAT_TASK_BASIC,     PI_FETCH_TASKINFO				},
-    { PSTAT_TASK_EVENTS,    PI_FETCH_TASKEVENTS				},
-    { PSTAT_NUM_THREADS,    PI_FETCH_THREADS				},
-    { PSTAT_THREAD_BASIC,   PI_FETCH_THREAD_BASIC | PI_FETCH_THREADS	},
-    { PSTAT_THREAD_SCHED,   PI_FETCH_THREAD_SCHED | PI_FETCH_THREADS	},
-    { PSTAT_THREAD_WAITS,   PI_FETCH_THREAD_WAITS | PI_FETCH_THREADS	},
-    { 0, }
-  };
-  int pi_flags = 0;
+  int pi_flags = procinfo_fetch_flags (need, *have);
   int i;
 
-  for (i = 0; map[i].ps_flag; i++)
-    if ((need & map[i].ps_flag) && !(*have & map[i].ps_flag))
-      pi_flags |= map[i].pi_flags;
-
   if (pi_flags || ((need & PSTAT_PROC_INFO) && !(*have & PSTAT_PROC_INFO)))
     {
       error_t err;
 
-      *pi_size /= sizeof (int);	/* getprocinfo takes an array of ints.  */
-      err = proc_getprocinfo (server, pid, &pi_flags,
-			      (procinfo_t *)pi, pi_size, waits, waits_len);
-      *pi_size *= sizeof (int);
+      if (ps->procinfo_prefetch
+	  && (pi_flags & ~ps->procinfo_prefetch_flags) == 0)
+	/* proc_getprocinfos got this for us already.  */
+	err = copy_procinfo (ps->procinfo_prefetch, &pi_flags, pi, pi_size);
+      else
+	{
+	  *pi_size /= sizeof (int); /* getprocinfo takes an array of ints.  */
+	  err = proc_getprocinfo (ps->context->server, ps->pid, &pi_flags,
+				  (procinfo_t *)pi, pi_size, waits, waits_len);
+	  *pi_size *= sizeof (int);
+	}
 
       if (! err)
 	/* Update *HAVE to reflect what we've successfully fetched.  */
 	{
 	  *have |= PSTAT_PROC_INFO;
-	  for (i = 0; map[i].ps_flag; i++)
-	    if ((pi_flags & map[i].pi_flags) == map[i].pi_flags)
-	      *have |= map[i].ps_flag;
+	  for (i = 0; procinfo_map[i].ps_flag; i++)
+	    if ((pi_flags & procinfo_map[i].pi_flags)
+		== procinfo_map[i].pi_flags)
+	      *have |= procinfo_map[i].ps_flag;
 	}
       return err;
     }
   else
     return 0;
 }
-
+
 /* The size of the initial buffer malloced to try and avoid getting
    vm_alloced memory for the procinfo structure returned by getprocinfo.
    Here we just give enough for four threads.  */
@@ -209,7 +256,7 @@ merge_procinfo (struct proc_stat *ps, ps_flags_t need, ps_flags_t have)
       new_waits_len = ps->thread_waits_len;
     }
 
-  err = fetch_procinfo (ps->context->server, ps->pid, really_need, &really_have,
+  err = fetch_procinfo (ps, really_need, &really_have,
 			&new_pi, &new_pi_size,
 			&new_waits, &new_waits_len);
   if (err)
@@ -1055,8 +1102,49 @@ proc_stat_set_flags (struct proc_stat *ps, ps_flags_t flags)
       ps->flags = have;
     }
 
+  /* The record from proc_getprocinfos is only good for this call.  */
+  ps->procinfo_prefetch = 0;
+
   return 0;
 }
+
+/* Have the next call to proc_stat_set_flags on PS take the procinfo it
+   needs from REC, a record that proc_getprocinfos returned for PS's process
+   when asked for PI_FLAGS, if REC holds all it needs, instead of asking the
+   proc server.  */
+void
+proc_stat_set_procinfo (struct proc_stat *ps,
+			const struct procinfo_record *rec, int pi_flags)
+{
+  ps->procinfo_prefetch = rec;
+  ps->procinfo_prefetch_flags = pi_flags;
+}
+
+/* Return in PROCINFOS and PROCINFOS_LEN (in ints) vm_alloced procinfo
+   records for the NPIDS processes in PIDS, or for every process if NPIDS is
+   0, with what setting FLAGS in their proc_stats needs, asking PC's proc
+   server only once.  PI_FLAGS returns what proc_stat_set_procinfo must be
+   given with each record.  If FLAGS needs no procinfo, there are none.  */
+error_t
+ps_context_get_procinfos (struct ps_context *pc,
+			  const pid_t *pids, size_t npids,
+			  ps_flags_t flags, int *pi_flags,
+			  procinfo_t *procinfos,
+			  mach_msg_type_number_t *procinfos_len)
+{
+  flags = add_preconditions (flags, pc);
+
+  /* proc_getprocinfos doesn't get thread waits; proc_stat_set_flags asks
+     for them separately.  */
+  *pi_flags = procinfo_fetch_flags (flags, 0) & ~PI_FETCH_THREAD_WAITS;
+  *procinfos = 0;
+  *procinfos_len = 0;
+
+  if (! (flags & PSTAT_PROCINFO))
+    return 0;
+  return ps_proc_getprocinfos (pc->server, (pidarray_t) pids, npids,
+			       *pi_flags, procinfos, procinfos_len);
+}
 
 /* ---------------------------------------------------------------- */
 /* Discard PS and any resources it holds.  */
@@ -1120,6 +1208,7 @@ _proc_stat_create (pid_t pid, struct ps_context *context, struct proc_stat **ps)
   (*ps)->failed = 0;
   (*ps)->inapp = PSTAT_THREAD;
   (*ps)->context = context;
+  (*ps)->procinfo_prefetch = 0;
   (*ps)->hook = 0;
 
   return 0;
@@ -1160,6 +1249,7 @@ proc_stat_thread_create (struct proc_stat *ps, unsigned index, struct proc_stat
       tps->thread_index = index;
 
       tps->context = ps->context;
+      tps->procinfo_prefetch = 0;
 
       *thread_ps = tps;
 
@@ -214,6 +214,13 @@ struct proc_stat
   /* The size of the info structure for deallocation purposes.  */
   unsigned proc_info_size;
 
+  /* If not NULL, a record returned by proc_getprocinfos when asked for
+     PROCINFO_PREFETCH_FLAGS, which proc_stat_set_flags uses instead of
+     calling proc_getprocinfo if it holds what is needed.  Not ours; see
+     proc_stat_set_procinfo.  */
+  const struct procinfo_record *procinfo_prefetch;
+  int procinfo_prefetch_flags;
+
   /* If present, these are just pointers into the proc_info structure.  */
   unsigned num_threads;
   task_basic_info_t task_basic_info;
@@ -481,6 +488,26 @@ void _proc_stat_free (struct proc_stat *ps);
    a system error code if a fatal error occurred, and 0 otherwise.  */
 error_t proc_stat_set_flags (struct proc_stat *ps, ps_flags_t flags);
 
+/* Have the next call to proc_stat_set_flags on PS take the procinfo it
+   needs from REC, a record that proc_getprocinfos returned for PS's process
+   when asked for PI_FLAGS, if REC holds all it needs, instead of asking the
+   proc server.  REC must stay valid until that call returns; PS forgets it
+   then.  */
+void proc_stat_set_procinfo (struct proc_stat *ps,
+			     const struct procinfo_record *rec, int pi_flags);
+
+/* Return in PROCINFOS and PROCINFOS_LEN (in ints) vm_alloced procinfo
+   records (see <hurd/hurd_types.h>) for the NPIDS processes in PIDS, or for
+   every process if NPIDS is 0, with what setting FLAGS in their proc_stats
+   needs, asking PC's proc server only once.  PI_FLAGS returns what
+   proc_stat_set_procinfo must be given with each record.  If FLAGS needs
+   no procinfo, there are none.  */
+error_t ps_context_get_procinfos (struct ps_context *pc,
+				  const pid_t *pids, size_t npids,
+				  ps_flags_t flags, int *pi_flags,
+				  procinfo_t *procinfos,
+				  mach_msg_type_number_t *procinfos_len);
+
 /* Returns in THREAD_PS a proc_stat for the Nth thread in the proc_stat
    PS (N should be between 0 and the number of threads in the process).  The
    resulting proc_stat isn't fully functional -- most flags can't be set in
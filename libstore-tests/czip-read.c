@@ -0,0 +1,244 @@
+/* Check that the czip store gives back what was compressed
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Make up data, some of which compresses and some of which doesn't,
+   write it as a czip image the way storezip does, into a buffer store,
+   open that with store_czip_create, and check that reads at random
+   offsets and of random lengths, into the caller's buffer and into
+   ones the store allocates, give back the data.  */
+
+#include <argp.h>
+#include <error.h>
+#include <endian.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#include "store.h"
+
+static size_t size = 1000 * 1000 + 123;
+static size_t chunk_size = 16384;
+static size_t cache_chunks = 4;
+static int reads = 10000;
+static unsigned int seed = 1;
+
+static const struct argp_option options[] =
+{
+  {"size", 'S', "BYTES", 0, "Make up BYTES of data (default 1000123)"},
+  {"chunk-size", 'c', "BYTES", 0, "Compress chunks of BYTES"
+   " (default 16384)"},
+  {"cache", 'C', "N", 0, "Cache N chunks (default 4)"},
+  {"reads", 'r', "N", 0, "Do N reads (default 10000)"},
+  {"seed", 's', "N", 0, "Seed the random number generator with N"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'S':
+      size = strtoul (arg, 0, 0);
+      if (size == 0)
+	argp_error (state, "%s: Invalid size", arg);
+      break;
+
+    case 'c':
+      chunk_size = strtoul (arg, 0, 0);
+      if (chunk_size < STORE_CZIP_MIN_CHUNK
+	  || chunk_size > STORE_CZIP_MAX_CHUNK
+	  || (chunk_size & (chunk_size - 1)))
+	argp_error (state, "%s: Invalid chunk size", arg);
+      break;
+
+    case 'C':
+      cache_chunks = strtoul (arg, 0, 0);
+      break;
+
+    case 'r':
+      reads = atoi (arg);
+      break;
+
+    case 's':
+      seed = strtoul (arg, 0, 0);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+/* Make up SIZE bytes in DATA: runs of one byte, which compress, and
+   random bytes, which don't, chunk sized or smaller.  */
+static void
+make_data (unsigned char *data)
+{
+  size_t i = 0;
+
+  while (i < size)
+    {
+      size_t n = 1 + random () % chunk_size;
+      int c = random ();
+
+      if (n > size - i)
+	n = size - i;
+      if (random () % 2)
+	memset (data + i, c, n);
+      else
+	{
+	  size_t j;
+	  for (j = 0; j < n; j++)
+	    data[i + j] = random ();
+	}
+      i += n;
+    }
+}
+
+/* Return the size of the czip image of the SIZE bytes of DATA, written
+   into IMAGE, which must be large enough.  */
+static size_t
+make_image (const unsigned char *data, unsigned char *image)
+{
+  struct store_czip_header *hdr = (void *) image;
+  size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+  uint64_t *index = (void *) (hdr + 1);
+  size_t offs = sizeof *hdr + (num_chunks + 1) * sizeof *index;
+  size_t i;
+
+  memcpy (hdr->magic, STORE_CZIP_MAGIC, sizeof hdr->magic);
+  hdr->chunk_size = htole32 (chunk_size);
+  hdr->num_chunks = htole32 (num_chunks);
+  hdr->size = htole64 (size);
+
+  for (i = 0; i < num_chunks; i++)
+    {
+      size_t len = chunk_size;
+      uLongf clen = compressBound (chunk_size);
+
+      if (len > size - i * chunk_size)
+	len = size - i * chunk_size;
+
+      index[i] = htole64 (offs);
+      if (compress2 (image + offs, &clen, data + i * chunk_size, len,
+		     Z_BEST_SPEED) != Z_OK || clen >= len)
+	{
+	  /* Chunks that don't shrink are stored as is.  */
+	  memcpy (image + offs, data + i * chunk_size, len);
+	  clen = len;
+	}
+      offs += clen;
+    }
+  index[num_chunks] = htole64 (offs);
+
+  return offs;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct argp argp = { options, parse_opt, 0,
+		       "Check that the czip store gives back what was"
+		       " compressed." };
+  unsigned char *data, *image, *mine;
+  size_t image_len, num_chunks;
+  struct store *from, *store;
+  int i, failures = 0;
+  error_t err;
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+  srandom (seed);
+
+  num_chunks = (size + chunk_size - 1) / chunk_size;
+  image_len = (sizeof (struct store_czip_header)
+	       + (num_chunks + 1) * sizeof (uint64_t)
+	       + num_chunks * compressBound (chunk_size));
+
+  data = malloc (size);
+  mine = malloc (size);
+  /* The buffer store munmaps its buffer when freed.  */
+  image = mmap (0, image_len, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (! data || ! mine || image == MAP_FAILED)
+    error (1, ENOMEM, "data");
+
+  make_data (data);
+  image_len = make_image (data, image);
+
+  err = store_buffer_create (image, image_len, 0, &from);
+  if (err)
+    error (1, err, "store_buffer_create");
+  err = store_czip_create (from, cache_chunks, 0, &store);
+  if (err)
+    error (1, err, "store_czip_create");
+  if (store->size != size)
+    error (1, 0, "store size %lld, should be %zu",
+	   (long long) store->size, size);
+
+  for (i = 0; i < reads; i++)
+    {
+      store_offset_t addr = random () % size;
+      size_t amount = 1 + random () % (3 * chunk_size);
+      void *buf;
+      size_t len;
+
+      /* Read into our buffer half of the time, and let the store
+	 allocate one the other half.  */
+      if (random () % 2)
+	{
+	  buf = mine;
+	  len = size;
+	}
+      else
+	{
+	  buf = 0;
+	  len = 0;
+	}
+
+      if (amount > size - addr)
+	amount = size - addr;
+
+      err = store_read (store, addr, amount, &buf, &len);
+      if (err)
+	{
+	  fprintf (stderr, "read %zu at %lld: %s\n", amount,
+		   (long long) addr, strerror (err));
+	  failures++;
+	  continue;
+	}
+
+      if (len != amount || memcmp (buf, data + addr, len) != 0)
+	{
+	  fprintf (stderr, "read %zu at %lld: got %zu bytes, %s\n", amount,
+		   (long long) addr, len,
+		   len == amount ? "different" : "wrong length");
+	  failures++;
+	}
+
+      if (buf != mine)
+	munmap (buf, len);
+    }
+
+  store_free (store);
+
+  printf ("%d reads of %zu bytes in %zu chunks: %d failed\n",
+	  reads, size, num_chunks, failures);
+  return failures != 0;
+}
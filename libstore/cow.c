@@ -0,0 +1,837 @@
+/* Copy-on-write overlay store backend
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111, USA. */
+
+/* A cow store has two children: a read-only BASE store, and a writable
+   DELTA store that receives all writes.  The address space of the cow
+   store is that of BASE, divided into chunks of CHUNK_SIZE bytes.  The
+   first time a chunk is written, it is copied into a newly allocated slot
+   in DELTA, and from then on that chunk is read from and written to its
+   slot.
+
+   DELTA is laid out as follows, so that it can be reopened later:
+
+     [0, CHUNK_SIZE)		struct cow_header
+     [MAP_OFFSET, DATA_OFFSET)	NUM_CHUNKS uint32_t slot numbers, one per
+				chunk of BASE; 0 means the chunk is unwritten
+     [DATA_OFFSET, ...)		slot N lives at DATA_OFFSET
+				+ (N - 1) * CHUNK_SIZE
+
+   All numbers are little-endian.  The slot data is always written before
+   the map entry pointing at it, so a crash can at worst lose a slot.
+
+   Reads take no lock: a chunk is read from BASE until its map entry is
+   set, and by then its slot holds the data.  Writes lock the chunk they
+   change, with one of COW_CHUNK_LOCKS locks shared by every
+   COW_CHUNK_LOCKS-th chunk, and the map only to take a slot or set an
+   entry.  */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "store.h"
+
+#define COW_MAGIC "HURDCOW1"
+
+#define COW_CHUNK_LOCKS 64
+
+struct cow_header
+{
+  char magic[8];		/* COW_MAGIC.  */
+  uint32_t chunk_size;
+  uint32_t reserved;
+  uint64_t base_size;		/* Size of BASE in bytes.  */
+  uint64_t num_chunks;
+  uint64_t map_offset;		/* Byte offsets in DELTA.  */
+  uint64_t data_offset;
+};
+
+/* Per-store state, kept in STORE->hook.  */
+struct cow
+{
+  /* Protects SLOTS, and the map as it is written to DELTA.  */
+  pthread_mutex_t lock;
+
+  /* Chunk N is written holding CHUNK_LOCKS[N % COW_CHUNK_LOCKS].  */
+  pthread_mutex_t chunk_locks[COW_CHUNK_LOCKS];
+
+  /* Held shared to read or write DELTA, and exclusive to grow it, which
+     may change its runs.  */
+  pthread_rwlock_t delta_lock;
+
+  size_t chunk_size;
+  size_t num_chunks;
+  store_offset_t map_offset, data_offset;
+
+  uint32_t *map;		/* On-disk image of the map, MAP_LEN bytes.  */
+  size_t map_len;
+  uint32_t slots;		/* Number of allocated slots.  */
+
+  void *chunk;			/* Scratch buffer for cow_setup_delta.  */
+};
+
+#define cow_base(store)  ((store)->children[0])
+#define cow_delta(store) ((store)->children[1])
+
+/* Read LEN bytes at byte offset OFFS in STORE into DST.  */
+static error_t
+cow_pread (struct store *store, store_offset_t offs, void *dst, size_t len)
+{
+  error_t err;
+  size_t mask = store->block_size - 1;
+  size_t skip = offs & mask;
+  size_t amount = (skip + len + mask) & ~mask;
+  void *buf = dst;
+  size_t buf_len = len;
+
+  if (skip != 0 || amount != len)
+    /* Not aligned to STORE's blocks; let it allocate a buffer.  */
+    buf_len = 0;
+
+  err = store_read (store, offs >> store->log2_block_size, amount,
+		    &buf, &buf_len);
+  if (err)
+    return err;
+
+  if (buf != dst)
+    {
+      if (buf_len >= skip + len)
+	memcpy (dst, buf + skip, len);
+      else
+	err = EIO;
+      munmap (buf, buf_len);
+    }
+  else if (buf_len < len)
+    err = EIO;
+
+  return err;
+}
+
+/* Write LEN bytes from SRC to byte offset OFFS in STORE.  Both OFFS and LEN
+   must be multiples of STORE's block size.  */
+static error_t
+cow_pwrite (struct store *store, store_offset_t offs,
+	    const void *src, size_t len)
+{
+  while (len > 0)
+    {
+      size_t amount;
+      error_t err = store_write (store, offs >> store->log2_block_size,
+				 src, len, &amount);
+      if (err)
+	return err;
+      if (amount == 0)
+	return EIO;
+      offs += amount;
+      src += amount;
+      len -= amount;
+    }
+  return 0;
+}
+
+/* Read LEN bytes at byte offset OFFS in the DELTA of STORE into DST.  */
+static error_t
+cow_delta_pread (struct store *store, store_offset_t offs, void *dst,
+		 size_t len)
+{
+  struct cow *cow = store->hook;
+  error_t err;
+
+  pthread_rwlock_rdlock (&cow->delta_lock);
+  err = cow_pread (cow_delta (store), offs, dst, len);
+  pthread_rwlock_unlock (&cow->delta_lock);
+  return err;
+}
+
+/* Write LEN bytes from SRC to byte offset OFFS in the DELTA of STORE, as
+   cow_pwrite.  */
+static error_t
+cow_delta_pwrite (struct store *store, store_offset_t offs,
+		  const void *src, size_t len)
+{
+  struct cow *cow = store->hook;
+  error_t err;
+
+  pthread_rwlock_rdlock (&cow->delta_lock);
+  err = cow_pwrite (cow_delta (store), offs, src, len);
+  pthread_rwlock_unlock (&cow->delta_lock);
+  return err;
+}
+
+/* Write out the part of the map of STORE holding the entry of CHUNK.  */
+static error_t
+cow_sync_map_entry (struct store *store, size_t chunk)
+{
+  struct cow *cow = store->hook;
+  size_t mask = cow_delta (store)->block_size - 1;
+  size_t start = (chunk * sizeof (uint32_t)) & ~mask;
+  size_t end = ((chunk + 1) * sizeof (uint32_t) + mask) & ~mask;
+
+  return cow_delta_pwrite (store, cow->map_offset + start,
+			   (void *) cow->map + start, end - start);
+}
+
+/* Make sure that DELTA has room for slot number SLOT, growing it if we
+   can.  COW->lock must be held.  */
+static error_t
+cow_reserve_slot (struct store *store, uint32_t slot)
+{
+  struct cow *cow = store->hook;
+  struct store *delta = cow_delta (store);
+  store_offset_t need =
+    cow->data_offset + (store_offset_t) slot * cow->chunk_size;
+  error_t err = 0;
+
+  if (need <= delta->size)
+    return 0;
+
+  /* Grow in steps of 64 chunks, to keep the number of resizes down.  */
+  need += 63 * (store_offset_t) cow->chunk_size;
+  pthread_rwlock_wrlock (&cow->delta_lock);
+  if (store_set_size (delta, need) != 0 || delta->size < need)
+    err = ENOSPC;
+  pthread_rwlock_unlock (&cow->delta_lock);
+
+  return err;
+}
+
+/* Return the number of bytes of BASE covered by CHUNK.  */
+static inline size_t
+cow_chunk_len (struct store *store, size_t chunk)
+{
+  struct cow *cow = store->hook;
+  store_offset_t start = (store_offset_t) chunk * cow->chunk_size;
+  store_offset_t left = cow_base (store)->size - start;
+  return left < cow->chunk_size ? left : cow->chunk_size;
+}
+
+static inline uint32_t
+cow_slot (struct cow *cow, size_t chunk)
+{
+  return le32toh (__atomic_load_n (&cow->map[chunk], __ATOMIC_ACQUIRE));
+}
+
+static inline store_offset_t
+cow_slot_offset (struct cow *cow, uint32_t slot)
+{
+  return cow->data_offset + (store_offset_t) (slot - 1) * cow->chunk_size;
+}
+
+static error_t
+cow_read (struct store *store,
+	  store_offset_t addr, size_t index, size_t amount, void **buf,
+	  size_t *len)
+{
+  struct cow *cow = store->hook;
+  store_offset_t pos = addr << store->log2_block_size;
+  size_t done = 0;
+  void *out = *buf;
+  error_t err = 0;
+
+  if (*len < amount)
+    /* Have to allocate memory for the return value.  */
+    {
+      out = mmap (0, amount, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (out == MAP_FAILED)
+	return errno;
+    }
+
+  while (done < amount)
+    {
+      size_t chunk = pos / cow->chunk_size;
+      size_t offs = pos % cow->chunk_size;
+      uint32_t first = cow_slot (cow, chunk);
+      uint32_t slot = first;
+      size_t n = cow->chunk_size - offs;
+
+      /* Coalesce following chunks that come from the same place: unwritten
+	 chunks all come from BASE, and written chunks whose slots are
+	 consecutive are contiguous in DELTA.  */
+      while (n < amount - done && chunk + 1 < cow->num_chunks)
+	{
+	  uint32_t next = cow_slot (cow, chunk + 1);
+	  if (slot ? next != slot + 1 : next != 0)
+	    break;
+	  chunk++;
+	  slot = next ?: slot;
+	  n += cow->chunk_size;
+	}
+      if (n > amount - done)
+	n = amount - done;
+
+      if (first)
+	err = cow_delta_pread (store, cow_slot_offset (cow, first) + offs,
+			       out + done, n);
+      else
+	err = cow_pread (cow_base (store), pos, out + done, n);
+      if (err)
+	break;
+
+      done += n;
+      pos += n;
+    }
+
+  if (err && done == 0)
+    {
+      if (out != *buf)
+	munmap (out, amount);
+      return err;
+    }
+
+  if (out != *buf && round_page (done) < round_page (amount))
+    munmap (out + round_page (done),
+	    round_page (amount) - round_page (done));
+
+  *buf = out;
+  *len = done;
+  return 0;
+}
+
+/* Return true if the LEN bytes at P are all zero.  */
+static bool
+cow_zero (const void *p, size_t len)
+{
+  const char *c = p;
+  while (len-- > 0)
+    if (*c++)
+      return false;
+  return true;
+}
+
+/* Write N bytes from BUF at byte OFFS of chunk CHUNK of STORE, whose lock
+   is held.  If it has to assemble the chunk, it does so in *SCRATCH, a
+   buffer of CHUNK_SIZE bytes, allocating it if it is null.  */
+static error_t
+cow_write_chunk (struct store *store, size_t chunk, size_t offs,
+		 const void *buf, size_t n, void **scratchp)
+{
+  struct cow *cow = store->hook;
+  size_t dmask = cow_delta (store)->block_size - 1;
+  size_t clen = cow_chunk_len (store, chunk);
+  uint32_t slot = cow_slot (cow, chunk);
+  void *scratch = *scratchp;
+  bool zero;
+  error_t err;
+
+  if (slot && ((offs | n) & dmask) == 0)
+    /* Already copied, and aligned for DELTA: write in place.  */
+    return cow_delta_pwrite (store, cow_slot_offset (cow, slot) + offs,
+			     buf, n);
+
+  /* Assemble the whole chunk and write it to its slot, allocating a new
+     slot the first time the chunk is written.  Zeros written over zeros
+     of BASE, as when a file system is made on the store, change nothing,
+     and are not worth a slot.  */
+  if (! scratch)
+    {
+      scratch = mmap (0, cow->chunk_size, PROT_READ|PROT_WRITE,
+		      MAP_ANON, 0, 0);
+      if (scratch == MAP_FAILED)
+	return ENOMEM;
+      *scratchp = scratch;
+    }
+
+  zero = ! slot && cow_zero (buf, n);
+  if (n < clen || zero)
+    {
+      if (slot)
+	err = cow_delta_pread (store, cow_slot_offset (cow, slot),
+			       scratch, clen);
+      else
+	err = cow_pread (cow_base (store),
+			 (store_offset_t) chunk * cow->chunk_size,
+			 scratch, clen);
+      if (err)
+	return err;
+      if (zero && cow_zero (scratch + offs, n))
+	return 0;
+    }
+  memcpy (scratch + offs, buf, n);
+  if (clen < cow->chunk_size)
+    memset (scratch + clen, 0, cow->chunk_size - clen);
+
+  if (slot)
+    return cow_delta_pwrite (store, cow_slot_offset (cow, slot),
+			     scratch, cow->chunk_size);
+
+  /* A slot taken by a write that then fails is lost, as after a
+     crash.  */
+  pthread_mutex_lock (&cow->lock);
+  err = cow_reserve_slot (store, cow->slots + 1);
+  if (! err)
+    slot = ++cow->slots;
+  pthread_mutex_unlock (&cow->lock);
+  if (err)
+    return err;
+
+  err = cow_delta_pwrite (store, cow_slot_offset (cow, slot),
+			  scratch, cow->chunk_size);
+  if (err)
+    return err;
+
+  pthread_mutex_lock (&cow->lock);
+  __atomic_store_n (&cow->map[chunk], htole32 (slot), __ATOMIC_RELEASE);
+  err = cow_sync_map_entry (store, chunk);
+  if (err)
+    __atomic_store_n (&cow->map[chunk], 0, __ATOMIC_RELEASE);
+  pthread_mutex_unlock (&cow->lock);
+
+  return err;
+}
+
+static error_t
+cow_write (struct store *store,
+	   store_offset_t addr, size_t index, const void *buf, size_t len,
+	   size_t *amount)
+{
+  struct cow *cow = store->hook;
+  store_offset_t pos = addr << store->log2_block_size;
+  void *scratch = 0;
+  size_t done = 0;
+  error_t err = 0;
+
+  while (done < len)
+    {
+      size_t chunk = pos / cow->chunk_size;
+      size_t offs = pos % cow->chunk_size;
+      size_t n = cow_chunk_len (store, chunk) - offs;
+      pthread_mutex_t *lock = &cow->chunk_locks[chunk % COW_CHUNK_LOCKS];
+
+      if (n > len - done)
+	n = len - done;
+
+      pthread_mutex_lock (lock);
+      err = cow_write_chunk (store, chunk, offs, buf + done, n, &scratch);
+      pthread_mutex_unlock (lock);
+      if (err)
+	break;
+
+      done += n;
+      pos += n;
+    }
+
+  if (scratch)
+    munmap (scratch, cow->chunk_size);
+
+  if (err && done == 0)
+    return err;
+
+  *amount = done;
+  return 0;
+}
+
+static error_t
+cow_set_size (struct store *store, size_t newsize)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+cow_allocate_encoding (const struct store *store, struct store_enc *enc)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+cow_encode (const struct store *store, struct store_enc *enc)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+cow_decode (struct store_enc *enc, const struct store_class *const *classes,
+	    struct store **store)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+cow_open (const char *name, int flags,
+	  const struct store_class *const *classes,
+	  struct store **store)
+{
+  return store_cow_open (name, flags, classes, store);
+}
+
+/* Check that NAME names two stores, in the syntax of
+   store_open_children.  */
+static error_t
+cow_validate_name (const char *name,
+		   const struct store_class *const *classes)
+{
+  const char *p;
+  size_t count = 0;
+  char sep;
+
+  if (!name)
+    return EINVAL;
+
+  sep = *name;
+  if (sep && isalnum (sep))
+    /* A TYPE: prefix shared by both stores.  */
+    {
+      while (isalnum (*name))
+	name++;
+      if (*name++ != ':')
+	return EINVAL;
+      sep = *name;
+    }
+  if (!sep)
+    return EINVAL;
+
+  for (p = name; p && p[1]; p = strchr (p + 1, sep))
+    count++;
+
+  return count == 2 ? 0 : EINVAL;
+}
+
+static error_t
+cow_set_flags (struct store *store, int flags)
+{
+  if ((flags & ~(STORE_INACTIVE | STORE_ENFORCED)) != 0)
+    /* Trying to set flags we don't support.  */
+    return EINVAL;
+
+  store->flags |= flags;
+  return 0;
+}
+
+static error_t
+cow_clear_flags (struct store *store, int flags)
+{
+  if ((flags & ~(STORE_INACTIVE | STORE_ENFORCED)) != 0)
+    return EINVAL;
+
+  store->flags &= ~flags;
+  return 0;
+}
+
+/* Free the per-store state COW.  */
+static void
+cow_free (struct cow *cow)
+{
+  int i;
+
+  if (cow->map)
+    munmap (cow->map, cow->map_len);
+  if (cow->chunk)
+    munmap (cow->chunk, cow->chunk_size);
+  pthread_mutex_destroy (&cow->lock);
+  for (i = 0; i < COW_CHUNK_LOCKS; i++)
+    pthread_mutex_destroy (&cow->chunk_locks[i]);
+  pthread_rwlock_destroy (&cow->delta_lock);
+  free (cow);
+}
+
+/* Called just before deallocating STORE.  */
+static void
+cow_cleanup (struct store *store)
+{
+  if (store->hook)
+    cow_free (store->hook);
+}
+
+const struct store_class
+store_cow_class =
+{
+  STORAGE_OTHER, "cow", cow_read, cow_write, cow_set_size,
+  cow_allocate_encoding, cow_encode, cow_decode,
+  cow_set_flags, cow_clear_flags, cow_cleanup, 0, 0, cow_open,
+  cow_validate_name
+};
+STORE_STD_CLASS (cow);
+
+/* Read the layout of DELTA, or initialize it if it doesn't contain one yet,
+   for an overlay of BASE with chunks of CHUNK_SIZE bytes.  Return the new
+   per-store state in COWP.  */
+static error_t
+cow_setup_delta (struct store *base, struct store *delta, size_t chunk_size,
+		 struct cow **cowp)
+{
+  error_t err;
+  struct cow *cow;
+  struct cow_header *hdr;
+  size_t i;
+  int fresh;
+
+  if (chunk_size < base->block_size || chunk_size < delta->block_size
+      || (chunk_size & (chunk_size - 1)))
+    return EINVAL;
+
+  cow = calloc (1, sizeof *cow);
+  if (! cow)
+    return ENOMEM;
+  pthread_mutex_init (&cow->lock, NULL);
+  for (i = 0; i < COW_CHUNK_LOCKS; i++)
+    pthread_mutex_init (&cow->chunk_locks[i], NULL);
+  pthread_rwlock_init (&cow->delta_lock, NULL);
+
+  cow->chunk = mmap (0, chunk_size, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (cow->chunk == MAP_FAILED)
+    {
+      cow->chunk = 0;
+      err = ENOMEM;
+      goto lose;
+    }
+  hdr = cow->chunk;
+
+  /* See if DELTA already holds an overlay.  A DELTA that is empty or
+     starts with a zero-filled chunk is initialized below; anything else is
+     refused, rather than overwriting data that may be precious.  */
+  if (delta->size >= chunk_size)
+    {
+      err = cow_pread (delta, 0, hdr, chunk_size);
+      if (err)
+	goto lose;
+      fresh = memcmp (hdr->magic, COW_MAGIC, sizeof hdr->magic) != 0;
+      if (fresh)
+	for (i = 0; i < chunk_size; i++)
+	  if (((char *) hdr)[i] != 0)
+	    {
+	      err = EFTYPE;
+	      goto lose;
+	    }
+    }
+  else
+    fresh = 1;
+
+  if (fresh)
+    {
+      cow->chunk_size = chunk_size;
+      cow->num_chunks = (base->size + chunk_size - 1) / chunk_size;
+    }
+  else
+    {
+      cow->chunk_size = le32toh (hdr->chunk_size);
+      cow->num_chunks = le64toh (hdr->num_chunks);
+      if (le64toh (hdr->base_size) != base->size
+	  || cow->chunk_size < base->block_size
+	  || cow->chunk_size < delta->block_size
+	  || (cow->chunk_size & (cow->chunk_size - 1))
+	  || cow->num_chunks
+	     != (base->size + cow->chunk_size - 1) / cow->chunk_size
+	  || le64toh (hdr->map_offset) != cow->chunk_size)
+	{
+	  err = EFTYPE;
+	  goto lose;
+	}
+      if (cow->chunk_size != chunk_size)
+	/* Use the chunk size the overlay was created with.  */
+	{
+	  munmap (cow->chunk, chunk_size);
+	  cow->chunk = mmap (0, cow->chunk_size, PROT_READ|PROT_WRITE,
+			     MAP_ANON, 0, 0);
+	  if (cow->chunk == MAP_FAILED)
+	    {
+	      cow->chunk = 0;
+	      err = ENOMEM;
+	      goto lose;
+	    }
+	}
+    }
+
+  cow->map_offset = cow->chunk_size;
+  cow->map_len = round_page (cow->num_chunks * sizeof (uint32_t));
+  cow->data_offset = cow->map_offset
+    + (((store_offset_t) cow->num_chunks * sizeof (uint32_t)
+	+ cow->chunk_size - 1) & ~((store_offset_t) cow->chunk_size - 1));
+  if (cow->map_len == 0)
+    cow->map_len = vm_page_size;
+
+  cow->map = mmap (0, cow->map_len, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (cow->map == MAP_FAILED)
+    {
+      cow->map = 0;
+      err = ENOMEM;
+      goto lose;
+    }
+
+  if (fresh)
+    /* Write an empty map followed by the header.  */
+    {
+      store_offset_t offs;
+      size_t dmask = delta->block_size - 1;
+      size_t hdr_len = (sizeof *hdr + dmask) & ~dmask;
+
+      if (delta->flags & STORE_READONLY)
+	{
+	  err = EROFS;
+	  goto lose;
+	}
+
+      if (delta->size < cow->data_offset)
+	{
+	  err = store_set_size (delta, cow->data_offset);
+	  if (err || delta->size < cow->data_offset)
+	    {
+	      err = ENOSPC;
+	      goto lose;
+	    }
+	}
+
+      memset (cow->chunk, 0, cow->chunk_size);
+      for (offs = cow->map_offset; offs < cow->data_offset && !err;
+	   offs += cow->chunk_size)
+	err = cow_pwrite (delta, offs, cow->chunk, cow->chunk_size);
+      if (err)
+	goto lose;
+
+      memcpy (hdr->magic, COW_MAGIC, sizeof hdr->magic);
+      hdr->chunk_size = htole32 (cow->chunk_size);
+      hdr->base_size = htole64 (base->size);
+      hdr->num_chunks = htole64 (cow->num_chunks);
+      hdr->map_offset = htole64 (cow->map_offset);
+      hdr->data_offset = htole64 (cow->data_offset);
+      err = cow_pwrite (delta, 0, hdr, hdr_len);
+      if (err)
+	goto lose;
+    }
+  else
+    {
+      err = cow_pread (delta, cow->map_offset, cow->map,
+		       cow->num_chunks * sizeof (uint32_t));
+      if (err)
+	goto lose;
+
+      /* The next free slot follows the highest one in use.  */
+      for (i = 0; i < cow->num_chunks; i++)
+	if (le32toh (cow->map[i]) > cow->slots)
+	  cow->slots = le32toh (cow->map[i]);
+      if (cow->data_offset + (store_offset_t) cow->slots * cow->chunk_size
+	  > delta->size)
+	{
+	  err = EFTYPE;
+	  goto lose;
+	}
+    }
+
+  /* Writes get scratch buffers of their own.  */
+  munmap (cow->chunk, cow->chunk_size);
+  cow->chunk = 0;
+
+  *cowp = cow;
+  return 0;
+
+ lose:
+  cow_free (cow);
+  return err;
+}
+
+/* Return a new store in STORE that overlays the read-only store BASE with
+   the writable store DELTA: reads come from BASE until a block has been
+   written, and writes only ever go to DELTA.  Copying is done in units of
+   CHUNK_SIZE bytes (0 selects the default); if DELTA already contains an
+   overlay for BASE, it is reused with its original chunk size.  BASE and
+   DELTA are consumed.  */
+error_t
+store_cow_create (struct store *base, struct store *delta, size_t chunk_size,
+		  int flags, struct store **store)
+{
+  error_t err;
+  struct cow *cow;
+  struct store_run run;
+  struct store *kids[2] = { base, delta };
+
+  if (chunk_size == 0)
+    chunk_size = STORE_COW_CHUNK_SIZE;
+  while (chunk_size < base->block_size || chunk_size < delta->block_size)
+    chunk_size <<= 1;
+
+  err = cow_setup_delta (base, delta, chunk_size, &cow);
+  if (err)
+    return err;
+
+  run.start = 0;
+  run.length = base->blocks;
+
+  err = _store_create (&store_cow_class, MACH_PORT_NULL,
+		       flags | (base->flags & delta->flags & STORE_ENFORCED),
+		       base->block_size, &run, 1, 0, store);
+  if (err)
+    {
+      cow_free (cow);
+      return err;
+    }
+
+  (*store)->hook = cow;
+  err = store_set_children (*store, kids, 2);
+  if (! err)
+    {
+      char *name;
+      err = store_children_name (*store, &name);
+      if (err == EINVAL)
+	/* Some child doesn't have a name; leave ours unset.  */
+	err = 0;
+      else if (! err)
+	(*store)->name = name;
+    }
+
+  if (err)
+    {
+      (*store)->num_children = 0;
+      store_free (*store);
+    }
+
+  return err;
+}
+
+/* Open the cow store NAME -- which consists of two store names in the
+   syntax of store_open_children, the read-only base store followed by the
+   writable delta store -- and return the corresponding store in STORE.  */
+error_t
+store_cow_open (const char *name, int flags,
+		const struct store_class *const *classes,
+		struct store **store)
+{
+  struct store **stores;
+  size_t num_stores;
+  error_t err =
+    store_open_children (name, flags & ~STORE_READONLY, classes,
+			 &stores, &num_stores);
+
+  if (err)
+    return err;
+
+  if (num_stores != 2)
+    err = EINVAL;
+  else
+    {
+      /* Never write to the base store.  */
+      err = store_set_flags (stores[0], STORE_READONLY);
+      if (! err)
+	err = store_cow_create (stores[0], stores[1], 0, flags, store);
+    }
+
+  if (err)
+    {
+      size_t k;
+      for (k = 0; k < num_stores; k++)
+	if (stores[k])
+	  store_free (stores[k]);
+    }
+  free (stores);
+
+  return err;
+}
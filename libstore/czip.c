@@ -0,0 +1,587 @@
+/* Random-access store backend for chunked compressed images
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111, USA. */
+
+/* Unlike the gunzip and bunzip2 stores, which decompress their whole
+   source into memory when opened, this store reads images made of
+   independently compressed chunks (see struct store_czip_header in
+   store.h, and the storezip utility), and only decompresses the chunks
+   touched by each read.  Decompressed chunks are kept in a small LRU
+   cache so that sequential reads of less than a chunk are cheap.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#include "store.h"
+
+/* A decompressed chunk in the cache.  */
+struct czip_chunk
+{
+  size_t number;		/* Chunk index, or -1 if unused.  */
+  void *data;			/* Mmapped, CHUNK_SIZE bytes.  */
+  size_t len;			/* Valid bytes in DATA.  */
+  struct czip_chunk *next, *prev; /* LRU list, most recent first.  */
+};
+
+/* Per-store state, kept in STORE->hook.  */
+struct czip
+{
+  pthread_mutex_t lock;
+
+  size_t chunk_size;
+  size_t num_chunks;
+  store_offset_t size;		/* Uncompressed size.  */
+  uint64_t *index;		/* NUM_CHUNKS + 1 image byte offsets.  */
+
+  struct czip_chunk *chunks;	/* The cache, CACHE_CHUNKS entries.  */
+  size_t cache_chunks;
+  struct czip_chunk *lru_head, *lru_tail;
+
+  void *cbuf;			/* Scratch buffer for compressed data.  */
+  size_t cbuf_len;
+
+  unsigned long hits, misses;
+};
+
+/* Move CHUNK to the front of CZ's LRU list.  */
+static void
+czip_touch (struct czip *cz, struct czip_chunk *chunk)
+{
+  if (cz->lru_head == chunk)
+    return;
+
+  /* Unlink.  */
+  if (chunk->prev)
+    chunk->prev->next = chunk->next;
+  if (chunk->next)
+    chunk->next->prev = chunk->prev;
+  if (cz->lru_tail == chunk)
+    cz->lru_tail = chunk->prev;
+
+  /* Push at the head.  */
+  chunk->prev = 0;
+  chunk->next = cz->lru_head;
+  if (cz->lru_head)
+    cz->lru_head->prev = chunk;
+  cz->lru_head = chunk;
+  if (! cz->lru_tail)
+    cz->lru_tail = chunk;
+}
+
+/* Read LEN bytes at byte offset OFFS of SOURCE into CZ's scratch buffer,
+   returning a pointer to them in DATA.  */
+static error_t
+czip_read_source (struct czip *cz, struct store *source,
+		  uint64_t offs, size_t len, const void **data)
+{
+  error_t err;
+  size_t mask = source->block_size - 1;
+  size_t skip = offs & mask;
+  size_t amount = (skip + len + mask) & ~mask;
+  void *buf = cz->cbuf;
+  size_t buf_len = cz->cbuf_len;
+
+  if (amount > cz->cbuf_len)
+    return EINVAL;
+
+  err = store_read (source, offs >> source->log2_block_size, amount,
+		    &buf, &buf_len);
+  if (err)
+    return err;
+
+  if (buf != cz->cbuf)
+    /* The source returned a buffer of its own; copy the data we want
+       into the scratch buffer and give the source's buffer back.  */
+    {
+      if (buf_len < skip + len)
+	{
+	  munmap (buf, buf_len);
+	  return EIO;
+	}
+      memcpy (cz->cbuf, buf + skip, len);
+      munmap (buf, buf_len);
+      skip = 0;
+    }
+  else if (buf_len < skip + len)
+    return EIO;
+
+  *data = cz->cbuf + skip;
+  return 0;
+}
+
+/* Return in CHUNK the cache entry for chunk NUMBER of STORE, reading and
+   decompressing it if necessary.  CZ->lock must be held.  */
+static error_t
+czip_get_chunk (struct store *store, size_t number, struct czip_chunk **chunk)
+{
+  struct czip *cz = store->hook;
+  struct czip_chunk *c;
+  const void *cdata;
+  size_t clen, ulen;
+  error_t err;
+  int i;
+
+  for (i = 0; i < cz->cache_chunks; i++)
+    if (cz->chunks[i].number == number)
+      {
+	cz->hits++;
+	czip_touch (cz, &cz->chunks[i]);
+	*chunk = &cz->chunks[i];
+	return 0;
+      }
+
+  cz->misses++;
+
+  /* Recycle the least recently used entry.  */
+  c = cz->lru_tail;
+  c->number = -1;
+
+  ulen = cz->chunk_size;
+  if ((store_offset_t) (number + 1) * cz->chunk_size > cz->size)
+    ulen = cz->size - (store_offset_t) number * cz->chunk_size;
+
+  clen = cz->index[number + 1] - cz->index[number];
+  err = czip_read_source (cz, store->children[0], cz->index[number], clen,
+			  &cdata);
+  if (err)
+    return err;
+
+  if (clen == ulen)
+    /* Chunks that didn't shrink are stored as is.  */
+    memcpy (c->data, cdata, ulen);
+  else
+    {
+      uLongf dlen = ulen;
+      if (uncompress (c->data, &dlen, cdata, clen) != Z_OK || dlen != ulen)
+	return EIO;
+    }
+
+  c->number = number;
+  c->len = ulen;
+  czip_touch (cz, c);
+  *chunk = c;
+  return 0;
+}
+
+static error_t
+czip_read (struct store *store,
+	   store_offset_t addr, size_t index, size_t amount, void **buf,
+	   size_t *len)
+{
+  struct czip *cz = store->hook;
+  error_t err = 0;
+  size_t done = 0;
+  void *out = *buf;
+
+  if (addr + amount > cz->size)
+    amount = cz->size - addr;
+
+  if (*len < amount)
+    /* Have to allocate memory for the return value.  */
+    {
+      out = mmap (0, amount, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (out == MAP_FAILED)
+	return errno;
+    }
+
+  pthread_mutex_lock (&cz->lock);
+  while (done < amount)
+    {
+      struct czip_chunk *chunk;
+      store_offset_t pos = addr + done;
+      size_t offs = pos & (cz->chunk_size - 1);
+      size_t n;
+
+      err = czip_get_chunk (store, pos / cz->chunk_size, &chunk);
+      if (err)
+	break;
+
+      n = chunk->len - offs;
+      if (n > amount - done)
+	n = amount - done;
+      memcpy (out + done, chunk->data + offs, n);
+      done += n;
+    }
+  pthread_mutex_unlock (&cz->lock);
+
+  if (err && done == 0)
+    {
+      if (out != *buf)
+	munmap (out, amount);
+      return err;
+    }
+
+  if (out != *buf && round_page (done) < round_page (amount))
+    /* Give back the pages a short read didn't get to.  */
+    munmap (out + round_page (done),
+	    round_page (amount) - round_page (done));
+
+  *buf = out;
+  *len = done;
+  return 0;
+}
+
+static error_t
+czip_write (struct store *store,
+	    store_offset_t addr, size_t index, const void *buf, size_t len,
+	    size_t *amount)
+{
+  return EROFS;
+}
+
+static error_t
+czip_set_size (struct store *store, size_t newsize)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+czip_allocate_encoding (const struct store *store, struct store_enc *enc)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+czip_encode (const struct store *store, struct store_enc *enc)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+czip_decode (struct store_enc *enc, const struct store_class *const *classes,
+	     struct store **store)
+{
+  return EOPNOTSUPP;
+}
+
+/* Open the czip store NAME -- which consists of an optional number of
+   chunks to cache followed by a ':', then another store-class name, a
+   ':', and a name for that store class to open -- and return the
+   corresponding store in STORE.  */
+static error_t
+czip_open (const char *name, int flags,
+	   const struct store_class *const *classes,
+	   struct store **store)
+{
+  return store_czip_open (name, flags, classes, store);
+}
+
+static error_t
+czip_validate_name (const char *name,
+		    const struct store_class *const *classes)
+{
+  if (!name)
+    return EINVAL;
+  if (isdigit (*name))
+    {
+      do
+	++name;
+      while (isdigit (*name));
+      if (*name != ':')
+	return EINVAL;
+    }
+  return 0;
+}
+
+static error_t
+czip_set_flags (struct store *store, int flags)
+{
+  if ((flags & ~(STORE_INACTIVE | STORE_ENFORCED)) != 0)
+    /* Trying to set flags we don't support.  */
+    return EINVAL;
+
+  store->flags |= flags;
+  return 0;
+}
+
+static error_t
+czip_clear_flags (struct store *store, int flags)
+{
+  if ((flags & ~(STORE_INACTIVE | STORE_ENFORCED)) != 0)
+    return EINVAL;
+
+  store->flags &= ~flags;
+  return 0;
+}
+
+/* Free the per-store state CZ.  */
+static void
+czip_free (struct czip *cz)
+{
+  int i;
+
+  if (cz->chunks)
+    {
+      for (i = 0; i < cz->cache_chunks; i++)
+	if (cz->chunks[i].data)
+	  munmap (cz->chunks[i].data, cz->chunk_size);
+      free (cz->chunks);
+    }
+  if (cz->cbuf)
+    munmap (cz->cbuf, cz->cbuf_len);
+  free (cz->index);
+  pthread_mutex_destroy (&cz->lock);
+  free (cz);
+}
+
+/* Called just before deallocating STORE.  */
+static void
+czip_cleanup (struct store *store)
+{
+  if (store->hook)
+    czip_free (store->hook);
+}
+
+const struct store_class
+store_czip_class =
+{
+  STORAGE_OTHER, "czip", czip_read, czip_write, czip_set_size,
+  czip_allocate_encoding, czip_encode, czip_decode,
+  czip_set_flags, czip_clear_flags, czip_cleanup, 0, 0,
+  czip_open, czip_validate_name
+};
+STORE_STD_CLASS (czip);
+
+/* Read and validate the header and chunk index of FROM, returning a new
+   per-store state in CZ.  */
+static error_t
+czip_load_index (struct store *from, size_t cache_chunks, struct czip **czp)
+{
+  error_t err;
+  struct store_czip_header hdr;
+  struct czip *cz;
+  void *buf = &hdr;
+  size_t buf_len = sizeof hdr;
+  size_t hdr_read, index_len, cbuf_len;
+  size_t bmask = from->block_size - 1;
+  size_t i;
+
+  /* The header occupies the first bytes of the image; read whole source
+     blocks to satisfy stores with a large block size.  */
+  hdr_read = (sizeof hdr + bmask) & ~bmask;
+  if (hdr_read > sizeof hdr)
+    buf_len = 0;
+  err = store_read (from, 0, hdr_read, &buf, &buf_len);
+  if (err)
+    return err;
+  if (buf != &hdr)
+    {
+      if (buf_len >= sizeof hdr)
+	memcpy (&hdr, buf, sizeof hdr);
+      munmap (buf, buf_len);
+    }
+  if (buf_len < sizeof hdr
+      || memcmp (hdr.magic, STORE_CZIP_MAGIC, sizeof hdr.magic) != 0)
+    return EFTYPE;
+
+  cz = calloc (1, sizeof *cz);
+  if (! cz)
+    return ENOMEM;
+  pthread_mutex_init (&cz->lock, NULL);
+
+  cz->chunk_size = le32toh (hdr.chunk_size);
+  cz->num_chunks = le32toh (hdr.num_chunks);
+  cz->size = le64toh (hdr.size);
+
+  if (cz->chunk_size < STORE_CZIP_MIN_CHUNK
+      || cz->chunk_size > STORE_CZIP_MAX_CHUNK
+      || (cz->chunk_size & (cz->chunk_size - 1))
+      || cz->num_chunks
+	 != (cz->size + cz->chunk_size - 1) / cz->chunk_size)
+    {
+      err = EFTYPE;
+      goto lose;
+    }
+
+  /* Read the index, which immediately follows the header.  */
+  index_len = (cz->num_chunks + 1) * sizeof (uint64_t);
+  cz->index = malloc (index_len);
+  if (! cz->index)
+    {
+      err = ENOMEM;
+      goto lose;
+    }
+  buf_len = (sizeof hdr + index_len + bmask) & ~bmask;
+  buf = 0;
+  {
+    size_t len = 0;
+    err = store_read (from, 0, buf_len, &buf, &len);
+    if (! err && len < sizeof hdr + index_len)
+      err = EFTYPE;
+    if (! err)
+      memcpy (cz->index, buf + sizeof hdr, index_len);
+    if (len > 0)
+      munmap (buf, len);
+    if (err)
+      goto lose;
+  }
+
+  for (i = 0; i <= cz->num_chunks; i++)
+    {
+      cz->index[i] = le64toh (cz->index[i]);
+      if (i > 0
+	  && (cz->index[i] < cz->index[i - 1]
+	      || cz->index[i] - cz->index[i - 1] > cz->chunk_size))
+	break;
+    }
+  if (i <= cz->num_chunks || cz->index[cz->num_chunks] > from->size)
+    {
+      err = EFTYPE;
+      goto lose;
+    }
+
+  /* Allocate the cache and a scratch buffer large enough for any
+     compressed chunk, rounded out to source block boundaries.  */
+  if (cache_chunks == 0)
+    cache_chunks = 1;
+  if (cache_chunks > cz->num_chunks && cz->num_chunks > 0)
+    cache_chunks = cz->num_chunks;
+  cz->cache_chunks = cache_chunks;
+  cz->chunks = calloc (cache_chunks, sizeof *cz->chunks);
+  if (! cz->chunks)
+    {
+      err = ENOMEM;
+      goto lose;
+    }
+  for (i = 0; i < cache_chunks; i++)
+    {
+      struct czip_chunk *c = &cz->chunks[i];
+      c->number = -1;
+      c->data = mmap (0, cz->chunk_size, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (c->data == MAP_FAILED)
+	{
+	  c->data = 0;
+	  err = ENOMEM;
+	  goto lose;
+	}
+      c->prev = i > 0 ? &cz->chunks[i - 1] : 0;
+      c->next = i + 1 < cache_chunks ? &cz->chunks[i + 1] : 0;
+    }
+  cz->lru_head = &cz->chunks[0];
+  cz->lru_tail = &cz->chunks[cache_chunks - 1];
+
+  cbuf_len = round_page (cz->chunk_size + 2 * from->block_size);
+  cz->cbuf = mmap (0, cbuf_len, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (cz->cbuf == MAP_FAILED)
+    {
+      cz->cbuf = 0;
+      err = ENOMEM;
+      goto lose;
+    }
+  cz->cbuf_len = cbuf_len;
+
+  *czp = cz;
+  return 0;
+
+ lose:
+  czip_free (cz);
+  return err;
+}
+
+/* Return a new store in STORE which provides random access to the
+   uncompressed contents of the chunked compressed image in FROM, keeping
+   at most CACHE_CHUNKS decompressed chunks in memory (0 means the
+   default); FROM is consumed.  */
+error_t
+store_czip_create (struct store *from, size_t cache_chunks, int flags,
+		   struct store **store)
+{
+  error_t err;
+  struct czip *cz;
+  struct store_run run;
+
+  err = czip_load_index (from, cache_chunks ?: STORE_CZIP_CACHE_CHUNKS, &cz);
+  if (err)
+    return err;
+
+  run.start = 0;
+  run.length = cz->size;
+
+  flags |= STORE_HARD_READONLY | STORE_READONLY;
+  err = _store_create (&store_czip_class, MACH_PORT_NULL,
+		       flags | (from->flags & STORE_ENFORCED), 1, &run, 1, 0,
+		       store);
+  if (err)
+    {
+      czip_free (cz);
+      return err;
+    }
+
+  (*store)->hook = cz;
+  err = store_set_children (*store, &from, 1);
+  if (! err && from->name)
+    {
+      size_t len = strlen (from->class->name) + 1 + strlen (from->name) + 1;
+      (*store)->name = malloc (len);
+      if ((*store)->name)
+	snprintf ((*store)->name, len, "%s:%s", from->class->name, from->name);
+      else
+	err = ENOMEM;
+    }
+
+  if (err)
+    {
+      /* Don't free FROM along with the new store; the caller still owns it
+	 on failure.  */
+      (*store)->num_children = 0;
+      store_free (*store);
+    }
+
+  return err;
+}
+
+/* Open the czip store NAME -- which consists of an optional cache size in
+   chunks and a ':', another store-class name, a ':', and a name for that
+   store class to open -- and return the corresponding store in STORE.
+   CLASSES is used to select classes specified by the type name; if it is
+   0, STORE_STD_CLASSES is used.  */
+error_t
+store_czip_open (const char *name, int flags,
+		 const struct store_class *const *classes,
+		 struct store **store)
+{
+  struct store *from;
+  size_t cache_chunks = 0;
+  error_t err;
+
+  if (isdigit (*name))
+    {
+      char *end;
+      cache_chunks = strtoul (name, &end, 0);
+      if (*end != ':')
+	return EINVAL;
+      name = end + 1;
+    }
+
+  err = store_typed_open (name, flags | STORE_HARD_READONLY, classes, &from);
+  if (! err)
+    {
+      err = store_czip_create (from, cache_chunks, flags, store);
+      if (err)
+	store_free (from);
+    }
+
+  return err;
+}
@@ -28,6 +28,7 @@
 #define __STORE_H__
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <fcntl.h>
 
 #include <mach.h>
@@ -454,6 +455,26 @@ error_t store_remap_create (struct store *source,
 			    const struct store_run *runs, size_t num_runs,
 			    int flags, struct store **store);
 
+/* Default granularity of copying in cow stores.  */
+#define STORE_COW_CHUNK_SIZE	4096
+
+/* Return a new store in STORE that overlays the read-only store BASE with
+   the writable store DELTA: reads come from BASE until a block has been
+   written, and writes only ever go to DELTA.  Copying is done in units of
+   CHUNK_SIZE bytes (0 selects the default); if DELTA already contains an
+   overlay for BASE, it is reused with its original chunk size.  BASE and
+   DELTA are consumed.  */
+error_t store_cow_create (struct store *base, struct store *delta,
+			  size_t chunk_size, int flags, struct store **store);
+
+/* Open the cow store NAME -- which consists of two store names in the
+   syntax of store_open_children, the read-only base store followed by the
+   writable delta store -- and return the corresponding store in STORE.
+   CLASSES is as if passed to store_find_class, which see.  */
+error_t store_cow_open (const char *name, int flags,
+			const struct store_class *const *classes,
+			struct store **store);
+
 /* Return a new store in STORE which contains a snapshot of the contents of
    the store FROM; FROM is consumed.  */
 error_t store_copy_create (struct store *from, int flags, struct store **store);
@@ -498,6 +519,41 @@ error_t store_bunzip2_open (const char *name, int flags,
 			    const struct store_class *const *classes,
 			    struct store **store);
 
+/* Chunked compressed images, as read by the czip store class and written
+   by the storezip utility.  An image starts with this header (all fields
+   little-endian), immediately followed by NUM_CHUNKS + 1 uint64_t byte
+   offsets into the image; chunk I occupies the bytes between offsets I and
+   I + 1, and uncompresses to CHUNK_SIZE bytes (the last chunk may be
+   shorter).  A chunk whose stored length equals its uncompressed length
+   is stored uncompressed; otherwise it is a zlib stream.  */
+#define STORE_CZIP_MAGIC	"HURDCZ\0\1"
+#define STORE_CZIP_MIN_CHUNK	4096
+#define STORE_CZIP_MAX_CHUNK	(16 * 1024 * 1024)
+#define STORE_CZIP_CACHE_CHUNKS	16	/* Default number of cached chunks. */
+
+struct store_czip_header
+{
+  char magic[8];		/* STORE_CZIP_MAGIC.  */
+  uint32_t chunk_size;		/* Uncompressed bytes per chunk.  */
+  uint32_t num_chunks;
+  uint64_t size;		/* Total uncompressed size.  */
+};
+
+/* Return a new store in STORE which provides random access to the
+   uncompressed contents of the chunked compressed image in FROM, keeping
+   at most CACHE_CHUNKS decompressed chunks in memory (0 means the
+   default); FROM is consumed.  */
+error_t store_czip_create (struct store *from, size_t cache_chunks, int flags,
+			   struct store **store);
+
+/* Open the czip store NAME -- which consists of an optional cache size in
+   chunks and a ':', another store-class name, a ':', and a name for that
+   store class to open -- and return the corresponding store in STORE.
+   CLASSES is as if passed to store_find_class, which see.  */
+error_t store_czip_open (const char *name, int flags,
+			 const struct store_class *const *classes,
+			 struct store **store);
+
 /* Return a new store in STORE that multiplexes multiple physical volumes
    from PHYS as one larger virtual volume.  SWAP_VOLS is a function that will
    be called whenever the volume currently active isn't correct.  PHYS is
@@ -622,8 +678,10 @@ extern const struct store_class store_concat_class;
 extern const struct store_class store_remap_class;
 extern const struct store_class store_query_class;
 extern const struct store_class store_copy_class;
+extern const struct store_class store_cow_class;
 extern const struct store_class store_gunzip_class;
 extern const struct store_class store_bunzip2_class;
+extern const struct store_class store_czip_class;
 extern const struct store_class store_typed_open_class;
 extern const struct store_class store_url_open_class;
 extern const struct store_class store_module_open_class;
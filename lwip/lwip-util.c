@@ -281,6 +281,26 @@ update_if (void *arg)
   return;
 }
 
+/*
+ * Call FUNCTION (ARG) where the stack may be touched, and wait for it
+ * to return.
+ *
+ * With core locking, that is right here under the core lock, as the
+ * socket calls of the RPC threads do; else it is in the tcpip_thread.
+ */
+error_t
+run_in_tcpip_core (tcpip_callback_fn function, void *arg)
+{
+#if LWIP_TCPIP_CORE_LOCKING
+  LOCK_TCPIP_CORE ();
+  function (arg);
+  UNLOCK_TCPIP_CORE ();
+  return 0;
+#else
+  return err_to_errno (tcpip_callback_wait (function, arg));
+#endif
+}
+
 /* Get the IP configuration of an interface */
 void
 inquire_device (struct netif *netif, uint32_t * addr, uint32_t * netmask,
@@ -346,7 +366,7 @@ configure_device (struct netif *netif, uint32_t addr, uint32_t netmask,
     err = EINVAL;
   else
     {
-      /* Call update_if() inside the tcpip_thread */
+      /* Call update_if() where it may touch the stack */
       struct update_if_args *arg = calloc (1, sizeof (struct update_if_args));
       arg->netif = netif;
       arg->addr = addr;
@@ -356,7 +376,7 @@ configure_device (struct netif *netif, uint32_t addr, uint32_t netmask,
       arg->gateway = gateway;
       arg->addr6 = addr6;
       arg->addr6_prefix_len = addr6_prefix_len;
-      err = err_to_errno(tcpip_callback (update_if, arg));
+      err = run_in_tcpip_core (update_if, arg);
     }
 
   return err;
@@ -28,9 +28,12 @@
 #include <errno.h>
 
 #include <lwip/netif.h>
+#include <lwip/tcpip.h>
 
 void init_ifs (void *arg);
 
+error_t run_in_tcpip_core (tcpip_callback_fn function, void *arg);
+
 void inquire_device (struct netif *netif, uint32_t * addr, uint32_t * netmask,
 		     uint32_t * peer, uint32_t * broadcast,
 		     uint32_t * gateway, uint32_t * addr6,
@@ -123,3 +123,12 @@ lwip_S_pfinet_getroutes (io_t port,
 {
   return EOPNOTSUPP;
 }
+
+error_t
+lwip_S_pfinet_getifstats (io_t port,
+			  data_t *stats,
+			  mach_msg_type_number_t *len,
+			  boolean_t *dealloc_data)
+{
+  return EOPNOTSUPP;
+}
@@ -24,12 +24,46 @@
 #define LWIP_HURDETHIF_H
 
 #include <hurd/ports.h>
+#include <device/net_status.h>
 
 #include <lwip/netif.h>
+#include <lwip/pbuf.h>
 #include <netif/ifcommon.h>
 
 typedef struct ifcommon hurdethif;
 
+/*
+ * A buffer a frame is received into.  In zero-copy mode the pbuf given
+ * to lwIP refers to the frame where it is, and freeing the pbuf gives
+ * the buffer back for the next frame.
+ */
+struct hurdethif_rxbuf
+{
+#if LWIP_SUPPORT_CUSTOM_PBUF
+  struct pbuf_custom pc;	/* must come first */
+#endif
+  struct hurdethif_rxbuf *next;	/* in the free list */
+  struct net_rcv_msg msg;
+};
+
+/* Whether received frames are handed to lwIP in place, not copied */
+extern int hurdethif_zero_copy;
+
+/* Get a receive buffer, or NULL if out of memory */
+struct hurdethif_rxbuf *hurdethif_rxbuf_get (void);
+
+/* Give back a receive buffer that no pbuf refers to */
+void hurdethif_rxbuf_put (struct hurdethif_rxbuf *buf);
+
+/*
+ * Queue the frame in BUF, received on NETIF, for the TCP/IP thread.
+ * BUF belongs to lwIP afterwards.  Frames are handed over in batches;
+ * call hurdethif_input_flush when no more are coming for now.  Only one
+ * thread may call these.
+ */
+void hurdethif_input (struct netif *netif, struct hurdethif_rxbuf *buf);
+void hurdethif_input_flush (void);
+
 /* Device initialization */
 err_t hurdethif_device_init (struct netif *netif);
 
@@ -29,6 +29,8 @@
 #include <fcntl.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <error.h>
 #include <device/device.h>
 #include <device/net_status.h>
@@ -45,6 +47,8 @@
 #include <lwip/etharp.h>
 #include <lwip/sockets.h>
 #include <lwip/inet.h>
+#include <lwip/tcpip.h>
+#include <netif/ethernet.h>
 
 /* Get the MAC address from an array of int */
 #define GET_HWADDR_BYTE(x,n)  (((char*)x)[n])
@@ -84,6 +88,37 @@ struct port_class *etherread_class;
 /* Thread for the incoming data */
 static pthread_t input_thread;
 
+/* The port a device sends us frames on */
+struct hurdethif_port
+{
+  struct port_info pi;
+  struct netif *netif;
+};
+
+/* Most frames handed to the TCP/IP thread at once */
+#define HURDETHIF_BATCH 32
+
+/* Most receive buffers kept for reuse */
+#define HURDETHIF_RXBUF_MAX 256
+
+/* Frames waiting to be handed to the TCP/IP thread */
+struct hurdethif_batch
+{
+  int count;
+  struct pbuf *p[HURDETHIF_BATCH];
+  struct netif *netif[HURDETHIF_BATCH];
+};
+
+int hurdethif_zero_copy = LWIP_SUPPORT_CUSTOM_PBUF;
+
+/* Free receive buffers */
+static pthread_mutex_t rxbuf_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct hurdethif_rxbuf *rxbuf_free;
+static int rxbuf_nfree;
+
+/* The batch being filled by the input thread */
+static struct hurdethif_batch *input_batch;
+
 /* Get the device flags */
 static error_t
 hurdethif_device_get_flags (struct netif *netif, uint16_t * flags)
@@ -166,13 +201,14 @@ hurdethif_device_open (struct netif *netif)
     }
 
   err = ports_create_port (etherread_class, etherport_bucket,
-			   sizeof (struct port_info), &ethif->readpt);
+			   sizeof (struct hurdethif_port), &ethif->readpt);
   if (err)
     {
       error (0, err, "ports_create_port on %s", ethif->devname);
     }
   else
     {
+      ((struct hurdethif_port *) ethif->readpt)->netif = netif;
       ethif->readptname = ports_get_right (ethif->readpt);
       mach_port_insert_right (mach_task_self (), ethif->readptname,
 			      ethif->readptname, MACH_MSG_TYPE_MAKE_SEND);
@@ -306,21 +342,78 @@ hurdethif_output (struct netif *netif, struct pbuf *p)
   return ERR_OK;
 }
 
+struct hurdethif_rxbuf *
+hurdethif_rxbuf_get (void)
+{
+  struct hurdethif_rxbuf *buf;
+
+  pthread_mutex_lock (&rxbuf_lock);
+  buf = rxbuf_free;
+  if (buf)
+    {
+      rxbuf_free = buf->next;
+      rxbuf_nfree--;
+    }
+  pthread_mutex_unlock (&rxbuf_lock);
+
+  if (!buf)
+    buf = malloc (sizeof (struct hurdethif_rxbuf));
+
+  return buf;
+}
+
+void
+hurdethif_rxbuf_put (struct hurdethif_rxbuf *buf)
+{
+  pthread_mutex_lock (&rxbuf_lock);
+  if (rxbuf_nfree < HURDETHIF_RXBUF_MAX)
+    {
+      buf->next = rxbuf_free;
+      rxbuf_free = buf;
+      rxbuf_nfree++;
+      buf = NULL;
+    }
+  pthread_mutex_unlock (&rxbuf_lock);
+
+  free (buf);
+}
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+/* Called by lwIP when the last reference to a received frame is gone */
+static void
+hurdethif_rxbuf_free (struct pbuf *p)
+{
+  hurdethif_rxbuf_put ((struct hurdethif_rxbuf *) p);
+}
+
 /*
- * Called from the demuxer when incoming data is ready
+ * Make a pbuf that refers to the frame in BUF.  The Ethernet header is
+ * moved up against the payload, which stays where it is.
  */
-void
-hurdethif_input (struct netif *netif, struct net_rcv_msg *msg)
+static struct pbuf *
+hurdethif_wrap_frame (struct hurdethif_rxbuf *buf, uint16_t len)
+{
+  struct net_rcv_msg *msg = &buf->msg;
+  char *frame;
+
+  frame = msg->packet + sizeof (struct packet_header) - PBUF_LINK_HLEN;
+  memmove (frame, msg->header, PBUF_LINK_HLEN);
+
+  buf->pc.custom_free_function = hurdethif_rxbuf_free;
+  return pbuf_alloced_custom (PBUF_RAW, len, PBUF_REF, &buf->pc, frame, len);
+}
+#endif
+
+/*
+ * Copy the frame in MSG into a new pbuf chain
+ */
+static struct pbuf *
+hurdethif_copy_frame (struct net_rcv_msg *msg, uint16_t len)
 {
   struct pbuf *p, *q;
-  uint16_t len;
   uint16_t off;
   uint16_t next_read;
 
-  /* Get the size of the whole packet */
-  len = PBUF_LINK_HLEN
-    + msg->packet_type.msgt_number - sizeof (struct packet_header);
-
   /* Allocate an empty pbuf chain for the data */
   p = pbuf_alloc (PBUF_RAW, len, PBUF_POOL);
 
@@ -363,59 +456,123 @@ hurdethif_input (struct netif *netif, struct net_rcv_msg *msg)
 	    q = q->next;
 	}
       while (1);
-
-      /* Pass the pbuf chain to he input function */
-      if (netif->input (p, netif) != ERR_OK)
-	{
-	  LWIP_DEBUGF (NETIF_DEBUG, ("hurdethif_input: IP input error\n"));
-	  pbuf_free (p);
-	  p = NULL;
-	}
     }
+
+  return p;
 }
 
-/* Demux incoming RPCs from the device */
-int
-hurdethif_demuxer (mach_msg_header_t * inp, mach_msg_header_t * outp)
+/*
+ * Called in the TCP/IP core with a batch of received frames
+ */
+static void
+hurdethif_input_batch (void *arg)
 {
-  struct net_rcv_msg *msg = (struct net_rcv_msg *) inp;
-  struct netif *netif;
-  mach_port_t local_port;
+  struct hurdethif_batch *batch = arg;
+  int i;
+
+  for (i = 0; i < batch->count; i++)
+    /* What tcpip_input would have done for each */
+    if (ethernet_input (batch->p[i], batch->netif[i]) != ERR_OK)
+      {
+	LWIP_DEBUGF (NETIF_DEBUG, ("hurdethif_input: IP input error\n"));
+	pbuf_free (batch->p[i]);
+      }
+
+  free (batch);
+}
 
-  if (inp->msgh_id != NET_RCV_MSG_ID)
-    return 0;
+void
+hurdethif_input_flush (void)
+{
+  struct hurdethif_batch *batch = input_batch;
+
+  if (!batch)
+    return;
+
+  input_batch = NULL;
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+  /* Like tcpip_input, run the stack right here */
+  LOCK_TCPIP_CORE ();
+  hurdethif_input_batch (batch);
+  UNLOCK_TCPIP_CORE ();
+#else
+  if (tcpip_callback (hurdethif_input_batch, batch) != ERR_OK)
+    {
+      int i;
 
-  if (MACH_MSGH_BITS_LOCAL (inp->msgh_bits) ==
-      MACH_MSG_TYPE_PROTECTED_PAYLOAD)
+      for (i = 0; i < batch->count; i++)
+	pbuf_free (batch->p[i]);
+      free (batch);
+    }
+#endif
+}
+
+void
+hurdethif_input (struct netif *netif, struct hurdethif_rxbuf *buf)
+{
+  struct net_rcv_msg *msg = &buf->msg;
+  struct pbuf *p;
+  uint16_t len;
+
+  if (!input_batch)
     {
-      struct port_info *pi = ports_lookup_payload (NULL,
-						   inp->msgh_protected_payload,
-						   NULL);
-      if (pi)
+      input_batch = malloc (sizeof (struct hurdethif_batch));
+      if (!input_batch)
 	{
-	  local_port = pi->port_right;
-	  ports_port_deref (pi);
+	  hurdethif_rxbuf_put (buf);
+	  return;
 	}
-      else
-	local_port = MACH_PORT_NULL;
+      input_batch->count = 0;
     }
-  else
-    local_port = inp->msgh_local_port;
 
-  for (netif = netif_list; netif; netif = netif->next)
-    if (local_port == netif_get_state (netif)->readptname)
-      break;
+  /* Get the size of the whole packet */
+  len = PBUF_LINK_HLEN
+    + msg->packet_type.msgt_number - sizeof (struct packet_header);
 
-  if (!netif)
+#if LWIP_SUPPORT_CUSTOM_PBUF
+  if (hurdethif_zero_copy)
+    {
+      p = hurdethif_wrap_frame (buf, len);
+      if (!p)
+	hurdethif_rxbuf_put (buf);
+    }
+  else
+#endif
     {
-      if (inp->msgh_remote_port != MACH_PORT_NULL)
-	mach_port_deallocate (mach_task_self (), inp->msgh_remote_port);
-      return 1;
+      p = hurdethif_copy_frame (msg, len);
+      hurdethif_rxbuf_put (buf);
     }
 
-  hurdethif_input (netif, msg);
+  if (!p)
+    return;
 
-  return 1;
+  input_batch->p[input_batch->count] = p;
+  input_batch->netif[input_batch->count] = netif;
+  if (++input_batch->count == HURDETHIF_BATCH)
+    hurdethif_input_flush ();
+}
+
+/* Get the interface a message from a device came for, or NULL */
+static struct netif *
+hurdethif_netif_of (mach_msg_header_t * inp)
+{
+  struct hurdethif_port *port;
+  struct netif *netif;
+
+  if (MACH_MSGH_BITS_LOCAL (inp->msgh_bits) ==
+      MACH_MSG_TYPE_PROTECTED_PAYLOAD)
+    port = ports_lookup_payload (etherport_bucket,
+				 inp->msgh_protected_payload,
+				 etherread_class);
+  else
+    port = ports_lookup_port (etherport_bucket, inp->msgh_local_port,
+			      etherread_class);
+  if (!port)
+    return NULL;
+
+  netif = port->netif;
+  ports_port_deref (port);
+  return netif;
 }
 
 /*
@@ -541,11 +698,56 @@ hurdethif_device_init (struct netif *netif)
   return ERR_OK;
 }
 
+/*
+ * Receive frames from all devices.  Frames are received right into the
+ * buffers handed to lwIP.  After a frame has arrived, those queued
+ * behind it are taken without waiting, and the batch is handed over
+ * when there are none left.
+ */
 static void *
 hurdethif_input_thread (void *arg)
 {
-  ports_manage_port_operations_one_thread (etherport_bucket,
-					   hurdethif_demuxer, 0);
+  struct hurdethif_rxbuf *buf = NULL;
+  mach_msg_option_t option = MACH_RCV_MSG;
+  mach_msg_return_t mr;
+  struct netif *netif;
+
+  while (1)
+    {
+      if (!buf)
+	{
+	  buf = hurdethif_rxbuf_get ();
+	  if (!buf)
+	    {
+	      hurdethif_input_flush ();
+	      sleep (1);
+	      continue;
+	    }
+	}
+
+      mr = mach_msg (&buf->msg.msg_hdr, option, 0, sizeof (buf->msg),
+		     etherport_bucket->portset, 0, MACH_PORT_NULL);
+      if (mr == MACH_RCV_TIMED_OUT)
+	{
+	  /* Nothing more queued for now */
+	  hurdethif_input_flush ();
+	  option = MACH_RCV_MSG;
+	  continue;
+	}
+      if (mr != MACH_MSG_SUCCESS)
+	continue;
+
+      if (buf->msg.msg_hdr.msgh_id != NET_RCV_MSG_ID
+	  || !(netif = hurdethif_netif_of (&buf->msg.msg_hdr)))
+	{
+	  mach_msg_destroy (&buf->msg.msg_hdr);
+	  continue;
+	}
+
+      hurdethif_input (netif, buf);
+      buf = NULL;
+      option = MACH_RCV_MSG | MACH_RCV_TIMEOUT;
+    }
 
   return 0;
 }
@@ -27,6 +27,8 @@
 
 #include <lwip/tcpip.h>
 
+#include <lwip-util.h>
+
 /* Open the device and set the interface up */
 static error_t
 if_open (struct netif *netif)
@@ -152,13 +154,14 @@ if_change_flags (struct netif * netif, uint16_t flags)
   error_t err;
 
   /*
-   * Call _if_change_flags() inside the tcpip_thread and wait for it to finish.
+   * Call _if_change_flags() where it may touch the stack and wait for it
+   * to finish.
    */
   struct if_change_flags_args *args =
     calloc (1, sizeof (struct if_change_flags_args));
   args->netif = netif;
   args->flags = flags;
-  err = tcpip_callback_wait(_if_change_flags, args);
+  err = run_in_tcpip_core (_if_change_flags, args);
 
   if(!err)
     /* Get the return value */
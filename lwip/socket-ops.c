@@ -24,6 +24,7 @@
 
 #include <sys/mman.h>
 #include <hurd/fshelp.h>
+#include <hurd/iohelp.h>
 
 #include <lwip/sockets.h>
 #include <lwip-hurd.h>
@@ -380,6 +381,40 @@ lwip_S_socket_send (struct sock_user * user,
   return errno;
 }
 
+/* Called by iohelp_send_file with each piece of the file.  */
+static error_t
+send_file_chunk (const void *buf, size_t len, size_t *amount, void *hook)
+{
+  struct sock_user *user = hook;
+  int sent;
+  int flags = 0;
+
+  if (lwip_fcntl (user->sock->sockno, F_GETFL, 0) & O_NONBLOCK)
+    flags |= MSG_DONTWAIT;
+
+  sent = lwip_send (user->sock->sockno, buf, len, flags);
+  if (sent < 0)
+    return errno;
+  *amount = sent;
+  return 0;
+}
+
+error_t
+lwip_S_socket_send_file (struct sock_user * user,
+			 mach_port_t file,
+			 loff_t offset, vm_size_t amount, vm_size_t * sent)
+{
+  error_t err;
+
+  if (!user)
+    return EOPNOTSUPP;
+
+  err = iohelp_send_file (file, offset, amount, send_file_chunk, user, sent);
+  if (!err)
+    mach_port_deallocate (mach_task_self (), file);
+  return err;
+}
+
 error_t
 lwip_S_socket_recv (struct sock_user * user,
 		    mach_port_t * addrport,
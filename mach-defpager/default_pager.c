@@ -57,6 +57,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdarg.h>
 
 #include <file_io.h>
@@ -67,6 +68,7 @@
 #include "exc_S.h"
 
 #include "priv.h"
+#include "zpool.h"
 
 #define debug 0
 
@@ -157,6 +159,135 @@ partition_init(void)
 	all_partitions.n_partitions = 0;
 }
 
+/*
+ * Bitmap summaries.
+ */
+
+static void
+bm_tree_free(struct bm_tree *t)
+{
+	while (t->levels > 0)
+	    free(t->level[--t->levels]);
+}
+
+/*
+ * Set up an empty summary for a bitmap of NWORDS words.
+ */
+static int
+bm_tree_init(struct bm_tree *t,
+	vm_size_t	nwords)
+{
+	vm_size_t	n = nwords ? nwords : 1;
+
+	t->levels = 0;
+	do {
+	    if (t->levels == BM_LEVELS)
+		panic("%sbm_tree_init",my_name);
+	    n = howmany(n, NB_BM);
+	    t->words[t->levels] = n;
+	    t->level[t->levels] = calloc(n, sizeof(bm_entry_t));
+	    if (t->level[t->levels] == 0) {
+		bm_tree_free(t);
+		return (ENOMEM);
+	    }
+	    t->levels++;
+	} while (n > 1);
+	return (0);
+}
+
+/*
+ * Set or clear the bit for word BIT of the bitmap.
+ */
+static void
+bm_tree_set(struct bm_tree *t,
+	vm_offset_t	bit,
+	boolean_t	on)
+{
+	bm_entry_t	*w, old;
+	int		l;
+
+	for (l = 0; l < t->levels; l++) {
+	    w = &t->level[l][bit / NB_BM];
+	    old = *w;
+	    if (on)
+		*w |= 1U << (bit % NB_BM);
+	    else
+		*w &= ~(1U << (bit % NB_BM));
+	    /* the level above only cares whether the word is zero */
+	    if ((old == 0) == (*w == 0))
+		break;
+	    bit /= NB_BM;
+	}
+}
+
+/*
+ * Return the first word of the bitmap at or after FROM whose bit
+ * is set, or NO_BLOCK.
+ */
+static vm_offset_t
+bm_tree_next(struct bm_tree *t,
+	vm_offset_t	from)
+{
+	vm_offset_t	i = from;
+	bm_entry_t	w = 0;
+	int		l;
+
+	/* climb until a word has a set bit at or after I */
+	for (l = 0; l < t->levels; l++) {
+	    if (i / NB_BM >= t->words[l])
+		return (NO_BLOCK);
+	    w = t->level[l][i / NB_BM] & (BM_MASK << (i % NB_BM));
+	    if (w)
+		break;
+	    i = i / NB_BM + 1;
+	}
+	if (l == t->levels)
+	    return (NO_BLOCK);
+
+	/* then go down to the first set bit below it */
+	i = i / NB_BM * NB_BM + ffs(w) - 1;
+	while (--l >= 0)
+	    i = i * NB_BM + ffs(t->level[l][i]) - 1;
+	return (i);
+}
+
+/*
+ * Bring the summaries of a partition's bitmap up to date
+ * after word BM_E of it changed.
+ */
+static void
+part_bitmap_changed(partition_t	part,
+	vm_offset_t	bm_e)
+{
+	bm_tree_set(&part->some_free, bm_e, part->bitmap[bm_e] != BM_MASK);
+	bm_tree_set(&part->all_free, bm_e, part->bitmap[bm_e] == 0);
+}
+
+/*
+ * Mark the bits past the end of a partition's bitmap as used,
+ * and build its summaries.
+ */
+static int
+part_bitmap_init(partition_t	part)
+{
+	vm_size_t	nwords = howmany(part->total_size, NB_BM);
+	vm_offset_t	i;
+
+	if (part->total_size % NB_BM)
+	    part->bitmap[nwords - 1] |= BM_MASK << (part->total_size % NB_BM);
+
+	if (bm_tree_init(&part->some_free, nwords))
+	    return (ENOMEM);
+	if (bm_tree_init(&part->all_free, nwords)) {
+	    bm_tree_free(&part->some_free);
+	    return (ENOMEM);
+	}
+
+	for (i = 0; i < nwords; i++)
+	    part_bitmap_changed(part, i);
+	return (0);
+}
+
 static partition_t
 new_partition (const char *name, struct file_direct *fdp,
 	       int check_linux_signature)
@@ -421,6 +552,15 @@ create_paging_partition(const char *name,
 	if (!part)
 	  return;
 
+	if (part_bitmap_init(part)) {
+		printf("(default pager): "
+		       "No memory to index %s, SKIPPING it!\n", name);
+		free(part->bitmap);
+		free(part->name);
+		free(part);
+		return;
+	}
+
 	pthread_mutex_lock(&all_partitions.lock);
 	{
 		int i;
@@ -504,23 +644,77 @@ ddprintf ("choose_partition(%x,%d,%d)\n",size,cur_part,i);
 }
 
 /*
- * Allocate a page in a paging partition
+ * Clustered paging.  Pages of an object that are paged out
+ * together are given contiguous blocks when possible, so that
+ * they can be written, and later read back, with a single
+ * device operation.
+ */
+vm_size_t	default_pager_cluster_pages = 16;	/* max pages per write */
+vm_size_t	default_pager_readahead_pages = 8;	/* max pages per read */
+vm_size_t	default_pager_readahead_limit = 256;	/* max pages held */
+
+/*
+ * Statistics.  The cluster counts are protected by
+ * cluster_stats_lock, the readahead ones by readahead_lock.
+ */
+int		default_pager_cluster_writes = 0;
+int		default_pager_cluster_written = 0;
+int		default_pager_cluster_max = 0;
+int		default_pager_readahead_reads = 0;
+int		default_pager_readahead_count = 0;
+int		default_pager_readahead_hits = 0;
+static pthread_mutex_t	cluster_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Find a free page in a partition, preferably the first one
+ * of a run of at least RUN free pages.  Runs are only looked
+ * for in whole free words of the bitmap.
+ * The partition must be locked and must not be full.
+ */
+static vm_offset_t
+pager_find_free_page(partition_t	part,
+	vm_size_t	run)
+{
+	vm_offset_t	start, w;
+	vm_size_t	nwords, n;
+
+	if (run > 1) {
+	    nwords = howmany(run, NB_BM);
+	    for (start = bm_tree_next(&part->all_free, 0);
+		 start != NO_BLOCK;
+		 start = bm_tree_next(&part->all_free, w)) {
+		for (n = 1, w = start + 1; n < nwords; n++, w++)
+		    if (bm_tree_next(&part->all_free, w) != w)
+			break;
+		if (n == nwords)
+		    return (start * NB_BM);
+	    }
+	}
+
+	w = bm_tree_next(&part->some_free, 0);
+	if (w == NO_BLOCK)
+	    panic("%spager_alloc_page",my_name);
+	return (w * NB_BM + ffs(~part->bitmap[w]) - 1);
+}
+
+/*
+ * Allocate a page in a paging partition, preferably HINT,
+ * or else the first page of a free run of RUN pages, so that
+ * the pages that follow can be allocated next to it.
  * The partition is returned unlocked.
  */
 vm_offset_t
-pager_alloc_page(p_index_t	pindex,
+pager_alloc_page_near(p_index_t	pindex,
+	vm_offset_t	hint,
+	vm_size_t	run,
 	boolean_t	lock_it)
 {
-	int	bm_e;
-	int	bit;
-	int	limit;
-	bm_entry_t	*bm;
+	vm_offset_t	page;
 	partition_t	part;
-	static char	here[] = "%spager_alloc_page";
 
 	if (no_partition(pindex))
 	    return (NO_BLOCK);
-ddprintf ("pager_alloc_page(%d,%d)\n",pindex,lock_it);
+ddprintf ("pager_alloc_page_near(%d,%lx,%d)\n",pindex,hint,lock_it);
 	part = partition_of(pindex);
 
 	/* unlikely, but possible deadlock against destroy_partition */
@@ -536,35 +730,30 @@ ddprintf ("pager_alloc_page(%d,%d)\n",pindex,lock_it);
 	    return (NO_BLOCK);
 	}
 
-	limit = howmany(part->total_size, NB_BM);
-	bm = part->bitmap;
-	for (bm_e = 0; bm_e < limit; bm_e++, bm++)
-	    if (*bm != BM_MASK)
-		break;
-
-	if (bm_e == limit)
-	    panic(here,my_name);
-
-	/*
-	 * Find and set the proper bit
-	 */
-	{
-	    bm_entry_t	b = *bm;
-
-	    for (bit = 0; bit < NB_BM; bit++)
-		if ((b & (1U<<bit)) == 0)
-		    break;
-	    if (bit == NB_BM)
-		panic(here,my_name);
-
-	    *bm = b | (1U<<bit);
-	    part->free--;
+	if (hint < part->total_size
+	    && (part->bitmap[hint / NB_BM] & (1U << (hint % NB_BM))) == 0)
+	    page = hint;
+	else
+	    page = pager_find_free_page(part, run);
 
-	}
+	part->bitmap[page / NB_BM] |= 1U << (page % NB_BM);
+	part_bitmap_changed(part, page / NB_BM);
+	part->free--;
 
 	pthread_mutex_unlock(&part->p_lock);
 
-	return (bm_e*NB_BM+bit);
+	return (page);
+}
+
+/*
+ * Allocate a page in a paging partition
+ * The partition is returned unlocked.
+ */
+vm_offset_t
+pager_alloc_page(p_index_t	pindex,
+	boolean_t	lock_it)
+{
+	return (pager_alloc_page_near(pindex, NO_BLOCK, 1, lock_it));
 }
 
 /*
@@ -594,6 +783,7 @@ ddprintf ("pager_dealloc_page(%d,%lx,%d)\n",pindex,page,lock_it);
 	    pthread_mutex_lock(&part->p_lock);
 
 	part->bitmap[bm_e] &= ~(1U<<bit);
+	part_bitmap_changed(part, bm_e);
 	part->free++;
 
 	if (lock_it)
@@ -661,6 +851,10 @@ pager_alloc(dpager_t	pager,
 	pager->writer = FALSE;
 #endif
 	pager->cur_partition = part;
+	pager->ra_buffer = 0;
+	pager->ra_count = 0;
+	pager->ra_gen = 0;
+	pager->z_entries = 0;
 
 	/*
 	 * Convert byte size to number of pages, then increase to the nearest
@@ -957,6 +1151,248 @@ pager_extend(dpager_t	pager,
 	pthread_mutex_unlock(&pager->lock);
 }
 
+/*
+ * Return the block map entry for page F_PAGE of a paging
+ * object, or an invalid block if there is none.
+ * The pager must be locked.
+ */
+static union dp_map
+pager_map_entry(dpager_t	pager,
+	vm_offset_t		f_page)
+{
+	union dp_map	entry;
+
+	invalidate_block(entry);
+	if (f_page >= pager->size || pager->map == 0)
+	    return (entry);
+
+	if (INDIRECT_PAGEMAP(pager->size)) {
+	    dp_map_t	mapptr;
+
+	    mapptr = pager->map[f_page/PAGEMAP_ENTRIES].indirect;
+	    if (mapptr)
+		entry = mapptr[f_page%PAGEMAP_ENTRIES];
+	}
+	else
+	    entry = pager->map[f_page];
+	return (entry);
+}
+
+/*
+ * Count the pages, starting with the one at OFFSET which is
+ * stored in BLOCK and up to MAX of them, that are stored in
+ * consecutive blocks of the same partition.
+ */
+static vm_size_t
+pager_contiguous(dpager_t	pager,
+	vm_offset_t		offset,
+	union dp_map		block,
+	vm_size_t		max)
+{
+	vm_offset_t	f_page;
+	vm_size_t	n;
+	union dp_map	next;
+
+	f_page = atop(offset);
+
+	pthread_mutex_lock(&pager->lock);	/* XXX lock_read */
+	for (n = 1; n < max; n++) {
+	    next = pager_map_entry(pager, f_page + n);
+	    if (no_block(next)
+		|| next.block.p_index != block.block.p_index
+		|| next.block.p_offset != block.block.p_offset + n)
+		break;
+	}
+	pthread_mutex_unlock(&pager->lock);
+	return (n);
+}
+
+/*
+ * Readahead.  When the kernel asks for a page that is followed
+ * by others in consecutive blocks, we read them all at once and
+ * keep the ones it did not ask for, to satisfy the requests
+ * that usually follow.  We cannot supply them right away: the
+ * kernel might still have a newer copy of any of them.
+ */
+static pthread_mutex_t	readahead_lock = PTHREAD_MUTEX_INITIALIZER;
+static vm_size_t	readahead_held;		/* pages in all buffers */
+
+/*
+ * The objects holding readahead buffers, least recently used
+ * first, so that the buffers of objects that have gone idle
+ * can be taken back for others.  Protected by readahead_lock,
+ * which is taken after an object's lock.
+ */
+static queue_head_t	readahead_queue = { &readahead_queue,
+					    &readahead_queue };
+
+/*
+ * Release the readahead buffer of a paging object.
+ * The pager and readahead_lock must be locked.
+ */
+static void
+pager_ra_free(dpager_t	pager)
+{
+	(void) vm_deallocate(mach_task_self(), pager->ra_buffer,
+			     ptoa(pager->ra_count));
+	readahead_held -= pager->ra_count;
+	queue_remove(&readahead_queue, pager, dpager_t, ra_link);
+	pager->ra_buffer = 0;
+	pager->ra_count = 0;
+}
+
+/*
+ * Forget the pages read ahead for a paging object.
+ * The pager must be locked.
+ */
+static void
+pager_ra_drop(dpager_t	pager)
+{
+	pager->ra_gen++;
+	if (pager->ra_buffer == 0)
+	    return;
+
+	pthread_mutex_lock(&readahead_lock);
+	pager_ra_free(pager);
+	pthread_mutex_unlock(&readahead_lock);
+}
+
+/*
+ * Forget the pages read ahead for a paging object if any of
+ * them is in the SIZE bytes at OFFSET, which are being or have
+ * just been written.  Either way, a readahead that is still
+ * reading may have read the old blocks, so it must not keep them.
+ */
+void
+pager_ra_invalidate(dpager_t	pager,
+	vm_offset_t		offset,
+	vm_size_t		size)
+{
+	pthread_mutex_lock(&pager->lock);
+	if (pager->ra_buffer == 0
+	    || (offset < pager->ra_offset + ptoa(pager->ra_count)
+		&& pager->ra_offset < offset + size))
+	    pager_ra_drop(pager);
+	else
+	    pager->ra_gen++;
+	pthread_mutex_unlock(&pager->lock);
+}
+
+/*
+ * Copy the page at OFFSET, stored in BLOCK, to ADDR if it was
+ * read ahead.  The buffer is released when its last page has
+ * been used.
+ */
+static boolean_t
+pager_ra_lookup(dpager_t	pager,
+	vm_offset_t		offset,
+	union dp_map		block,
+	vm_offset_t		addr)
+{
+	vm_size_t	i;
+	boolean_t	found = FALSE;
+
+	pthread_mutex_lock(&pager->lock);
+	if (pager->ra_buffer
+	    && offset >= pager->ra_offset
+	    && offset < pager->ra_offset + ptoa(pager->ra_count)) {
+	    i = atop(offset - pager->ra_offset);
+	    if (block.block.p_index == pager->ra_block.block.p_index
+		&& block.block.p_offset == pager->ra_block.block.p_offset + i) {
+		memcpy((void *) addr, (void *) (pager->ra_buffer + ptoa(i)),
+		       vm_page_size);
+		found = TRUE;
+	    }
+	    if (i == pager->ra_count - 1)
+		pager_ra_drop(pager);
+	    else if (found) {
+		pthread_mutex_lock(&readahead_lock);
+		queue_remove(&readahead_queue, pager, dpager_t, ra_link);
+		queue_enter(&readahead_queue, pager, dpager_t, ra_link);
+		pthread_mutex_unlock(&readahead_lock);
+	    }
+	}
+	pthread_mutex_unlock(&pager->lock);
+
+	if (found) {
+	    pthread_mutex_lock(&readahead_lock);
+	    default_pager_readahead_hits++;
+	    pthread_mutex_unlock(&readahead_lock);
+	}
+	return (found);
+}
+
+/*
+ * Keep the COUNT pages at BUFFER, read from BLOCK for OFFSET,
+ * unless the object was written since GEN was sampled.
+ * Consumes BUFFER.
+ */
+static void
+pager_ra_install(dpager_t	pager,
+	unsigned int		gen,
+	vm_offset_t		offset,
+	union dp_map		block,
+	vm_offset_t		buffer,
+	vm_size_t		count)
+{
+	pthread_mutex_lock(&pager->lock);
+	if (pager->ra_gen == gen) {
+	    pager_ra_drop(pager);
+	    pager->ra_buffer = buffer;
+	    pager->ra_offset = offset;
+	    pager->ra_count = count;
+	    pager->ra_block = block;
+	    buffer = 0;
+	    pthread_mutex_lock(&readahead_lock);
+	    queue_enter(&readahead_queue, pager, dpager_t, ra_link);
+	    default_pager_readahead_reads++;
+	    default_pager_readahead_count += count - 1;
+	    pthread_mutex_unlock(&readahead_lock);
+	}
+	pthread_mutex_unlock(&pager->lock);
+
+	if (buffer) {
+	    (void) vm_deallocate(mach_task_self(), buffer, ptoa(count));
+	    pthread_mutex_lock(&readahead_lock);
+	    readahead_held -= count;
+	    pthread_mutex_unlock(&readahead_lock);
+	}
+}
+
+/*
+ * Reserve room for COUNT more pages of readahead, taking back
+ * the least recently used buffers if need be.  Their objects
+ * are only tried, as readahead_lock is taken after them.
+ */
+static boolean_t
+readahead_reserve(vm_size_t	count)
+{
+	boolean_t	ok;
+	queue_entry_t	qe, next;
+	dpager_t	pager;
+
+	if (count > default_pager_readahead_limit)
+	    return (FALSE);
+
+	pthread_mutex_lock(&readahead_lock);
+	for (qe = queue_first(&readahead_queue);
+	     readahead_held + count > default_pager_readahead_limit
+	     && !queue_end(&readahead_queue, qe);
+	     qe = next) {
+	    pager = (dpager_t) qe;
+	    next = pager->ra_link.next;
+	    if (pthread_mutex_trylock(&pager->lock) == 0) {
+		pager_ra_free(pager);
+		pthread_mutex_unlock(&pager->lock);
+	    }
+	}
+	ok = readahead_held + count <= default_pager_readahead_limit;
+	if (ok)
+	    readahead_held += count;
+	pthread_mutex_unlock(&readahead_lock);
+	return (ok);
+}
+
 /* This deallocates the pages necessary to truncate a direct map
    previously of size NEW_SIZE to the smaller size OLD_SIZE.  */
 static void
@@ -994,6 +1430,9 @@ pager_truncate(dpager_t pager, vm_size_t new_size)	/* in pages */
 
   pthread_mutex_lock(&pager->lock);	/* XXX lock_write */
 
+  pager_ra_drop(pager);
+  zpool_discard(pager, ptoa(new_size), (vm_size_t) -1);
+
   if (!pager->map)
     goto done;
 
@@ -1090,20 +1529,7 @@ pager_read_offset(dpager_t	pager,
 #endif
 	  }
 
-	invalidate_block(pager_offset);
-	if (INDIRECT_PAGEMAP(pager->size)) {
-	    dp_map_t	mapptr;
-
-	    if (pager->map) {
-		mapptr = pager->map[f_page/PAGEMAP_ENTRIES].indirect;
-		if (mapptr)
-		    pager_offset = mapptr[f_page%PAGEMAP_ENTRIES];
-	    }
-	}
-	else {
-	    if (pager->map)
-		pager_offset = pager->map[f_page];
-	}
+	pager_offset = pager_map_entry(pager, f_page);
 
 #if	DEBUG_READER_CONFLICTS
 	pager->readers--;
@@ -1310,7 +1736,7 @@ pager_write_offset(dpager_t	pager,
 {
 	vm_offset_t	f_page;
 	dp_map_t	mapptr;
-	union dp_map	block;
+	union dp_map	block, prev;
 
 	invalidate_block(block);
 
@@ -1415,10 +1841,23 @@ pager_write_offset(dpager_t	pager,
 	block = mapptr[f_page];
 	ddprintf ("pager_write_offset: block starts as %p[%lx] %p\n", mapptr, f_page, block.indirect);
 	if (no_block(block)) {
-	    vm_offset_t	off;
+	    vm_offset_t	off, hint;
+
+	    /*
+	     * Try to put it right after the previous page of
+	     * the object, so that they can be clustered.
+	     */
+	    hint = NO_BLOCK;
+	    if (atop(offset) > 0) {
+		prev = pager_map_entry(pager, atop(offset) - 1);
+		if (!no_block(prev)
+		    && prev.block.p_index == pager->cur_partition)
+		    hint = prev.block.p_offset + 1;
+	    }
 
 	    /* get room now */
-	    off = pager_alloc_page(pager->cur_partition, TRUE);
+	    off = pager_alloc_page_near(pager->cur_partition, hint,
+					default_pager_cluster_pages, TRUE);
 	    if (off == NO_BLOCK) {
 		/*
 		 * Before giving up, try all other partitions.
@@ -1440,7 +1879,9 @@ dprintf("extending object %x (size %x) to %x.\n",
 		    pager->cur_partition = new_part;
 
 		    /* this unlocks the partition too */
-		    off = pager_alloc_page(pager->cur_partition, FALSE);
+		    off = pager_alloc_page_near(pager->cur_partition, NO_BLOCK,
+						default_pager_cluster_pages,
+						FALSE);
 
 		}
 
@@ -1478,6 +1919,12 @@ pager_dealloc(dpager_t	pager)
 	dp_map_t	mapptr;
 	union dp_map	block;
 
+	/* Readahead_reserve may still find the buffer.  */
+	pthread_mutex_lock(&pager->lock);
+	pager_ra_drop(pager);
+	pthread_mutex_unlock(&pager->lock);
+	zpool_discard(pager, 0, (vm_size_t) -1);
+
 	if (!pager->map)
 	    return;
 
@@ -1610,6 +2057,8 @@ default_read(dpager_t	ds,
 	int	rc;
 	boolean_t	first_time;
 	partition_t	part;
+	vm_size_t	count;
+	unsigned int	gen;
 #ifdef	CHECKSUM
 	vm_size_t	original_size = size;
 #endif	 /* CHECKSUM */
@@ -1632,15 +2081,56 @@ default_read(dpager_t	ds,
 	    return (PAGER_ABSENT);
 	}
 
-	/*
-	 * Read it, trying for the entire page.
-	 */
 	offset = ptoa(block.block.p_offset);
 ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	part   = partition_of(block.block.p_index);
 	first_time = TRUE;
 	*out_addr = addr;
 
+	/*
+	 * Maybe it is in memory, compressed or read ahead.
+	 */
+	if (size == vm_page_size
+	    && zpool_load(ds, original_offset, addr, deallocate))
+	    goto done;
+	if (size == vm_page_size
+	    && pager_ra_lookup(ds, original_offset, block, addr))
+	    goto done;
+
+	/*
+	 * If the pages that follow are next to it on disk,
+	 * read them along with it.
+	 */
+	count = 1;
+	if (size == vm_page_size && default_pager_readahead_pages > 1)
+	    count = pager_contiguous(ds, original_offset, block,
+				     default_pager_readahead_pages);
+	if (count > 1 && readahead_reserve(count)) {
+	    pthread_mutex_lock(&ds->lock);
+	    gen = ds->ra_gen;
+	    pthread_mutex_unlock(&ds->lock);
+
+	    rc = page_read_file_direct(part->file,
+				       offset,
+				       ptoa(count),
+				       &raddr,
+				       &rsize);
+	    if (rc == 0 && rsize == ptoa(count)) {
+		memcpy((char *)addr, (char *)raddr, vm_page_size);
+		pager_ra_install(ds, gen, original_offset, block,
+				 raddr, count);
+		goto done;
+	    }
+	    if (rc == 0)
+		(void) vm_deallocate(mach_task_self(), raddr, rsize);
+	    pthread_mutex_lock(&readahead_lock);
+	    readahead_held -= count;
+	    pthread_mutex_unlock(&readahead_lock);
+	}
+
+	/*
+	 * Read it, trying for the entire page.
+	 */
 	do {
 	    rc = page_read_file_direct(part->file,
 				       offset,
@@ -1669,6 +2159,7 @@ ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	    size -= rsize;
 	} while (size != 0);
 
+    done:
 #if	USE_PRECIOUS
 	if (deallocate)
 		pager_release_offset(ds, original_offset);
@@ -1691,45 +2182,82 @@ ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	return (PAGER_SUCCESS);
 }
 
-int
-default_write(dpager_t	ds,
+/*
+ * Write the pages at OFFSET, up to SIZE bytes of them, that
+ * get consecutive blocks of the same partition, with a single
+ * device write.  Returns the number of bytes consumed in
+ * CLUSTER, even on error.
+ */
+static int
+default_write_cluster(dpager_t	ds,
 	vm_offset_t	addr,
 	vm_size_t	size,
-	vm_offset_t	offset)
+	vm_offset_t	offset,
+	vm_size_t	*cluster)
 {
-	union dp_map	block;
+	union dp_map	block, next;
 	partition_t		part;
 	mach_msg_type_number_t	wsize;
+	vm_size_t	n, max;
+	vm_offset_t	original_offset;
 	int		rc;
 
 	ddprintf ("default_write: pager offset %lx\n", offset);
 
+	*cluster = vm_page_size;
+
 	/*
-	 * Find block in paging partition
+	 * Find blocks in paging partition
 	 */
 	block = pager_write_offset(ds, offset);
 	if ( no_block(block) )
 	    return (PAGER_ERROR);
 
+	max = atop(size);
+	if (max > default_pager_cluster_pages)
+	    max = default_pager_cluster_pages;
+	for (n = 1; n < max; n++) {
+	    next = pager_write_offset(ds, offset + ptoa(n));
+	    if (no_block(next)
+		|| next.block.p_index != block.block.p_index
+		|| next.block.p_offset != block.block.p_offset + n)
+		break;
+	}
+	size = *cluster = ptoa(n);
+	original_offset = offset;
+
+	pager_ra_invalidate(ds, offset, size);
+	zpool_discard(ds, offset, size);
+
 #ifdef	CHECKSUM
 	/*
-	 * Save checksum
+	 * Save checksums
 	 */
 	{
 	    int	checksum;
+	    vm_size_t i;
 
-	    checksum = compute_checksum(addr, size);
-	    pager_put_checksum(ds, offset, checksum);
+	    for (i = 0; i < size; i += vm_page_size) {
+		checksum = compute_checksum(addr + i, vm_page_size);
+		pager_put_checksum(ds, offset + i, checksum);
+	    }
 	}
 #endif	 /* CHECKSUM */
 	offset = ptoa(block.block.p_offset);
 ddprintf ("default_write(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	part   = partition_of(block.block.p_index);
 
+	pthread_mutex_lock(&cluster_stats_lock);
+	default_pager_cluster_writes++;
+	default_pager_cluster_written += n;
+	if (n > default_pager_cluster_max)
+	    default_pager_cluster_max = n;
+	pthread_mutex_unlock(&cluster_stats_lock);
+
 	/*
-	 * There are various assumptions made here,we
-	 * will not get into the next disk 'block' by
-	 * accident. It might well be non-contiguous.
+	 * The blocks are contiguous in the partition, though
+	 * not necessarily on the device; page_write_file_direct
+	 * takes care of that.
 	 */
 	do {
 	    rc = page_write_file_direct(part->file,
@@ -1741,13 +2269,64 @@ ddprintf ("default_write(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index)
 		dprintf("*** PAGER ERROR: default_write: ");
 		dprintf("ds=0x%p addr=0x%lx size=0x%x offset=0x%lx resid=0x%x\n",
 			ds, addr, size, offset, wsize);
-		return (PAGER_ERROR);
+		break;
 	    }
 	    addr += wsize;
 	    offset += wsize;
 	    size -= wsize;
 	} while (size != 0);
-	return (PAGER_SUCCESS);
+
+	/*
+	 * A readahead that started before the write may have read
+	 * the blocks while they were being written.
+	 */
+	pager_ra_invalidate(ds, original_offset, *cluster);
+
+	return (rc == 0 ? PAGER_SUCCESS : PAGER_ERROR);
+}
+
+/*
+ * Keep a page in the compressed pool instead of writing it
+ * out.  Its block is allocated all the same, for when it is
+ * written back.  Returns FALSE if the page must be written.
+ */
+static boolean_t
+default_write_compressed(dpager_t	ds,
+	vm_offset_t	addr,
+	vm_offset_t	offset)
+{
+	union dp_map	block;
+
+	block = pager_write_offset(ds, offset);
+	if ( no_block(block) )
+	    return (FALSE);
+
+	pager_ra_invalidate(ds, offset, vm_page_size);
+#ifdef	CHECKSUM
+	pager_put_checksum(ds, offset, compute_checksum(addr, vm_page_size));
+#endif	 /* CHECKSUM */
+	return (zpool_store(ds, offset, block, addr));
+}
+
+/*
+ * Write SIZE bytes of data, a whole number of pages, at OFFSET
+ * in a paging object.  Fails if any page could not be written.
+ */
+int
+default_write(dpager_t	ds,
+	vm_offset_t	addr,
+	vm_size_t	size,
+	vm_offset_t	offset)
+{
+	vm_size_t	done, cluster;
+	int		rc = PAGER_SUCCESS;
+
+	for (done = 0; done < size; done += cluster)
+	    if (default_write_cluster(ds, addr + done, size - done,
+				      offset + done, &cluster)
+		!= PAGER_SUCCESS)
+		rc = PAGER_ERROR;
+	return (rc);
 }
 
 boolean_t
@@ -1835,6 +2414,14 @@ destroy_paging_partition(const char	*name,
 	part->going_away = TRUE;
 	pthread_mutex_unlock(&all_partitions.lock);
 
+	/*
+	 * Compressed pages must be on disk to be moved.
+	 */
+	if (!zpool_flush_partition(pindex)) {
+		part->going_away = FALSE;
+		return KERN_FAILURE;
+	}
+
 	/*
 	 * This might take a while..
 	 */
@@ -1884,6 +2471,8 @@ dprintf("Partition x%p (id x%x) for %s, all_ok %d\n", part, id, name, all_ok);
 
 		set_partition_of(pindex, 0);
 		*pp_private = part->file;
+		bm_tree_free(&part->some_free);
+		bm_tree_free(&part->all_free);
 		free(part->bitmap);
 		free(part->name);
 		free(part);
@@ -2571,7 +3160,7 @@ ddprintf ("seqnos_memory_object_data_initialize <%p>: pager_port_unlock: <%p>[s:
 /*
  * memory_object_data_return: split up the stuff coming in from
  * a memory_object_data_write call
- * into individual pages and pass them off to default_write.
+ * into clusters of pages and pass them off to default_write_cluster.
  */
 kern_return_t
 seqnos_memory_object_data_return(default_pager_t	ds,
@@ -2585,6 +3174,9 @@ seqnos_memory_object_data_return(default_pager_t	ds,
 {
 	register
 	vm_size_t	amount_sent;
+	vm_size_t	cluster;
+	vm_size_t	tried;		/* pages before this were offered to the pool */
+	vm_size_t	stored;		/* the last one it took, or data_cnt */
 	static char	here[] = "%sdata_return";
 	int err;
 
@@ -2625,22 +3217,49 @@ seqnos_memory_object_data_return(default_pager_t	ds,
 	    return(KERN_SUCCESS);
 	  }
 
+	/*
+	 * Write the pages in as few device operations as we can,
+	 * or better yet, none at all.  Pages the compressed pool
+	 * takes are skipped; the runs of those it does not are
+	 * still written out together.
+	 */
+	tried = 0;
+	stored = data_cnt;
 	for (amount_sent = 0;
 	     amount_sent < data_cnt;
-	     amount_sent += vm_page_size) {
+	     amount_sent += cluster) {
 
 	    int result;
+	    vm_size_t	size = data_cnt - amount_sent;
+
+	    if (zpool_limit) {
+		while (tried < data_cnt
+		       && (stored < amount_sent || stored == data_cnt)) {
+		    if (default_write_compressed(&ds->dpager,
+						 addr + tried,
+						 offset + tried))
+			stored = tried;
+		    tried += vm_page_size;
+		}
+		if (stored == amount_sent) {
+		    cluster = vm_page_size;
+		    default_pager_pageout_count++;
+		    continue;
+		}
+		size = (stored > amount_sent ? stored : tried) - amount_sent;
+	    }
 
-	    result = default_write(&ds->dpager,
+	    result = default_write_cluster(&ds->dpager,
 			      addr + amount_sent,
-			      vm_page_size,
-			      offset + amount_sent);
+			      size,
+			      offset + amount_sent,
+			      &cluster);
 	    if (result != KERN_SUCCESS) {
 		dstruct_lock(ds);
 		ds->errors++;
 		dstruct_unlock(ds);
 	    }
-	    default_pager_pageout_count++;
+	    default_pager_pageout_count += atop(cluster);
 	}
 
 	pager_port_finish_write(ds);
@@ -3243,6 +3862,59 @@ nomemory:
 	return KERN_RESOURCE_SHORTAGE;
 }
 
+kern_return_t
+S_default_pager_statistics (mach_port_t pager,
+			    vm_size_array_t *stats,
+			    mach_msg_type_number_t *statsCnt)
+{
+	kern_return_t	kr;
+	vm_offset_t	addr;
+	struct zpool_stats zs;
+
+	if (pager != default_pager_default_port)
+		return KERN_INVALID_ARGUMENT;
+
+	if (*statsCnt < DEFAULT_PAGER_STAT_COUNT)
+	{
+		kr = vm_allocate(default_pager_self, &addr,
+				 round_page(DEFAULT_PAGER_STAT_COUNT
+					    * sizeof(**stats)), TRUE);
+		if (kr != KERN_SUCCESS)
+			return KERN_RESOURCE_SHORTAGE;
+		*stats = (vm_size_array_t) addr;
+	}
+	*statsCnt = DEFAULT_PAGER_STAT_COUNT;
+
+	(*stats)[DEFAULT_PAGER_STAT_PAGEINS] = default_pager_pagein_count;
+	(*stats)[DEFAULT_PAGER_STAT_PAGEOUTS] = default_pager_pageout_count;
+	pthread_mutex_lock(&cluster_stats_lock);
+	(*stats)[DEFAULT_PAGER_STAT_CLUSTER_WRITES] =
+		default_pager_cluster_writes;
+	(*stats)[DEFAULT_PAGER_STAT_CLUSTER_PAGES] =
+		default_pager_cluster_written;
+	(*stats)[DEFAULT_PAGER_STAT_CLUSTER_MAX] = default_pager_cluster_max;
+	pthread_mutex_unlock(&cluster_stats_lock);
+	pthread_mutex_lock(&readahead_lock);
+	(*stats)[DEFAULT_PAGER_STAT_READAHEAD_READS] =
+		default_pager_readahead_reads;
+	(*stats)[DEFAULT_PAGER_STAT_READAHEAD_PAGES] =
+		default_pager_readahead_count;
+	(*stats)[DEFAULT_PAGER_STAT_READAHEAD_HITS] =
+		default_pager_readahead_hits;
+	pthread_mutex_unlock(&readahead_lock);
+
+	zpool_get_stats(&zs);
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_LIMIT] = zpool_limit;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_PAGES] = zs.pages;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_BYTES] = zs.bytes;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_STORES] = zs.stores;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_REJECTS] = zs.rejects;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_HITS] = zs.hits;
+	(*stats)[DEFAULT_PAGER_STAT_ZPOOL_WRITEBACKS] = zs.writebacks;
+
+	return KERN_SUCCESS;
+}
+
 kern_return_t
 S_default_pager_objects (mach_port_t pager,
 			 default_pager_object_array_t *objectsp,
@@ -50,9 +50,10 @@ struct file_direct
   struct storage_run runs[0];
 };
 
-/* These are in fact only called to read or write a single page, from
-   default_pager.c::default_read/default_write.  The SIZE argument is
-   always vm_page_size and OFFSET is always page-aligned.  */
+/* These are called from default_pager.c to read or write a single
+   page, or a cluster of pages that are contiguous in the paging area.
+   The SIZE argument is always a multiple of vm_page_size and OFFSET is
+   always page-aligned.  */
 
 int page_read_file_direct (struct file_direct *fdp,
 			   vm_offset_t offset,
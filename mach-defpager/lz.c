@@ -0,0 +1,224 @@
+/* Simple LZ77 page compressor for the default pager.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* The compressed data is a series of sequences, each made of a token
+   byte, literal bytes and a back reference, much like LZ4 blocks.  The
+   high nibble of the token is the number of literals and the low one
+   the match length minus LZ_MIN_MATCH; a nibble of 15 is followed by
+   bytes to add to it, until one is not 255.  The literals come next,
+   then the match offset as two little-endian bytes.  The last sequence
+   has no match.  Matches are found through a hash of the next four
+   bytes; speed matters more than ratio here.  */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "zpool.h"
+
+#define LZ_HASH_BITS	12
+#define LZ_MIN_MATCH	4
+#define LZ_MAX_OFFSET	0xffff
+
+static inline uint32_t
+lz_read32 (const unsigned char *p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof v);
+  return v;
+}
+
+static inline unsigned int
+lz_hash (uint32_t v)
+{
+  return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/* Store the extra bytes of length LEN at OP, not past END.  */
+static unsigned char *
+lz_put_length (unsigned char *op, unsigned char *end, size_t len)
+{
+  for (; len >= 255; len -= 255)
+    {
+      if (op >= end)
+	return 0;
+      *op++ = 255;
+    }
+  if (op >= end)
+    return 0;
+  *op++ = len;
+  return op;
+}
+
+/* Store a sequence of LITLEN literals from LIT followed by a match of
+   MLEN bytes at OFFSET back, or by none if MLEN is zero, at OP, not
+   past END.  Return the end of the sequence, or 0 if it does not
+   fit.  */
+static unsigned char *
+lz_put_sequence (unsigned char *op, unsigned char *end,
+		 const unsigned char *lit, size_t litlen,
+		 size_t offset, size_t mlen)
+{
+  size_t ml = mlen ? mlen - LZ_MIN_MATCH : 0;
+  unsigned char *token;
+
+  if (op >= end)
+    return 0;
+  token = op++;
+  *token = ((litlen < 15 ? litlen : 15) << 4) | (ml < 15 ? ml : 15);
+
+  if (litlen >= 15 && ! (op = lz_put_length (op, end, litlen - 15)))
+    return 0;
+  if (litlen > end - op)
+    return 0;
+  memcpy (op, lit, litlen);
+  op += litlen;
+
+  if (mlen)
+    {
+      if (end - op < 2)
+	return 0;
+      *op++ = offset & 0xff;
+      *op++ = offset >> 8;
+      if (ml >= 15 && ! (op = lz_put_length (op, end, ml - 15)))
+	return 0;
+    }
+
+  return op;
+}
+
+static size_t
+lz_compress (const void *src, size_t size, void *dst, size_t avail)
+{
+  const unsigned char *const base = src;
+  const unsigned char *const iend = base + size;
+  const unsigned char *ip = base, *anchor = base;
+  unsigned char *op = dst;
+  unsigned char *const oend = op + avail;
+  /* Positions plus one of the last occurrences of each hash, or 0.  */
+  uint32_t table[1 << LZ_HASH_BITS];
+
+  memset (table, 0, sizeof table);
+
+  while (iend - ip >= LZ_MIN_MATCH)
+    {
+      uint32_t seq = lz_read32 (ip);
+      unsigned int h = lz_hash (seq);
+      const unsigned char *ref = table[h] ? base + table[h] - 1 : 0;
+      const unsigned char *mp, *rp;
+
+      table[h] = ip - base + 1;
+      if (! ref || ip - ref > LZ_MAX_OFFSET || lz_read32 (ref) != seq)
+	{
+	  ip++;
+	  continue;
+	}
+
+      for (mp = ip + LZ_MIN_MATCH, rp = ref + LZ_MIN_MATCH;
+	   mp < iend && *mp == *rp;
+	   mp++, rp++)
+	;
+
+      op = lz_put_sequence (op, oend, anchor, ip - anchor, ip - ref, mp - ip);
+      if (! op)
+	return 0;
+      ip = anchor = mp;
+    }
+
+  if (anchor < iend)
+    {
+      op = lz_put_sequence (op, oend, anchor, iend - anchor, 0, 0);
+      if (! op)
+	return 0;
+    }
+
+  return op - (unsigned char *) dst;
+}
+
+/* Add the extra bytes of a length at *IP, not past END, to *LEN.  */
+static int
+lz_get_length (const unsigned char **ip, const unsigned char *end,
+	       size_t *len)
+{
+  unsigned char b;
+
+  do
+    {
+      if (*ip >= end)
+	return -1;
+      b = *(*ip)++;
+      *len += b;
+    }
+  while (b == 255);
+
+  return 0;
+}
+
+static int
+lz_decompress (const void *src, size_t size, void *dst, size_t avail)
+{
+  const unsigned char *ip = src;
+  const unsigned char *const iend = ip + size;
+  unsigned char *const base = dst;
+  unsigned char *const oend = base + avail;
+  unsigned char *op = base;
+
+  while (ip < iend)
+    {
+      unsigned int token = *ip++;
+      const unsigned char *ref;
+      size_t len, offset;
+
+      len = token >> 4;
+      if (len == 15 && lz_get_length (&ip, iend, &len))
+	return -1;
+      if (len > iend - ip || len > oend - op)
+	return -1;
+      memcpy (op, ip, len);
+      op += len;
+      ip += len;
+
+      if (ip == iend)
+	break;
+
+      if (iend - ip < 2)
+	return -1;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > op - base)
+	return -1;
+
+      len = token & 15;
+      if (len == 15 && lz_get_length (&ip, iend, &len))
+	return -1;
+      len += LZ_MIN_MATCH;
+      if (len > oend - op)
+	return -1;
+
+      /* The match may overlap what it produces.  */
+      for (ref = op - offset; len > 0; len--)
+	*op++ = *ref++;
+    }
+
+  return op == oend ? 0 : -1;
+}
+
+const struct zpool_compressor zpool_lz_compressor =
+{
+  "lz", lz_compress, lz_decompress
+};
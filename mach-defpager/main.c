@@ -30,6 +30,7 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <error.h>
+#include <argp.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -48,6 +49,7 @@
 /* XXX */
 
 #include "default_pager.h"
+#include "zpool.h"
 
 const char *defpager_server_name = "mach-defpager";
 
@@ -75,6 +77,67 @@ printf_init (device_t master)
 
 int debug;
 
+/* Set by -d: stay in the foreground.  */
+static int foreground;
+
+static vm_size_t zpool_size;
+static const struct zpool_compressor *zpool_compressor;
+
+static const struct argp_option options[] =
+{
+  {0, 'd', 0, 0, "Do not detach from the terminal"},
+  {"compressed-pool", 'z', "SIZE", 0,
+   "Keep up to SIZE bytes of compressed pages in memory before writing"
+   " them to paging space (a suffix of k, m or g multiplies it)"},
+  {"compressor", 'c', "NAME", 0,
+   "Compress pages with NAME (default lz)"},
+  {0}
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  char *end;
+
+  switch (key)
+    {
+    case 'd':
+      foreground = 1;
+      break;
+
+    case 'z':
+      zpool_size = strtoul (arg, &end, 0);
+      switch (*end)
+	{
+	case 'g': case 'G':
+	  zpool_size <<= 10;
+	  /* Fall through.  */
+	case 'm': case 'M':
+	  zpool_size <<= 10;
+	  /* Fall through.  */
+	case 'k': case 'K':
+	  zpool_size <<= 10;
+	  end++;
+	}
+      if (end == arg || *end)
+	argp_error (state, "%s: Invalid size", arg);
+      break;
+
+    case 'c':
+      zpool_compressor = zpool_find_compressor (arg);
+      if (! zpool_compressor)
+	argp_error (state, "%s: Unknown compressor", arg);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static const struct argp argp = { options, parse_opt, 0,
+				  "Default memory manager for the Hurd." };
+
 static void
 nohandler (int sig)
 { }
@@ -86,6 +149,8 @@ main (int argc, char **argv)
   error_t err;
   memory_object_t defpager;
 
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
   err = get_privileged_ports (&bootstrap_master_host_port,
 			      &bootstrap_master_device_port);
   if (err)
@@ -98,7 +163,7 @@ main (int argc, char **argv)
   if (MACH_PORT_VALID (defpager))
     error (2, 0, "Another default memory manager is already running");
 
-  if (!(argc == 2 && !strcmp (argv[1], "-d")))
+  if (!foreground)
     {
       /* We don't use the `daemon' function because we might exit back to the
 	 parent before the daemon has completed vm_set_default_memory_manager.
@@ -160,6 +225,8 @@ main (int argc, char **argv)
    * Set up the default pager.
    */
   partition_init();
+  if (zpool_size)
+    zpool_init (zpool_size, zpool_compressor);
 
   /*
    * task_set_exception_port and task_set_bootstrap_port
@@ -177,7 +244,7 @@ main (int argc, char **argv)
 
   default_pager_initialize (bootstrap_master_host_port);
 
-  if (!(argc == 2 && !strcmp (argv[1], "-d")))
+  if (!foreground)
     kill (getppid (), SIGUSR1);
 
   /*
@@ -62,6 +62,21 @@ typedef unsigned int	bm_entry_t;
 
 #define	howmany(a,b)	(((a) + (b) - 1)/(b))
 
+/*
+ * Summary of a bitmap, so that set bits can be found without
+ * scanning it: a tree of bit vectors in which a bit of level 0
+ * stands for a word of the bitmap, and a bit of level N+1 is set
+ * when the corresponding word of level N is not zero.  The top
+ * level is a single word.
+ */
+#define	BM_LEVELS	6	/* enough for any 32-bit block count */
+
+struct bm_tree {
+	int		levels;
+	vm_size_t	words[BM_LEVELS];	/* size of each level */
+	bm_entry_t	*level[BM_LEVELS];
+};
+
 /*
  * Value to indicate no block assigned
  */
@@ -78,6 +93,8 @@ struct part {
 	vm_size_t	free;		/* number of blocks free */
 	unsigned int	id;		/* named lookup */
 	bm_entry_t	*bitmap;	/* allocation map */
+	struct bm_tree	some_free;	/* bitmap words not full */
+	struct bm_tree	all_free;	/* bitmap words all free */
 	boolean_t	going_away;	/* destroy attempt in progress */
 	struct file_direct *file;	/* file paged to */
 };
@@ -90,6 +107,8 @@ struct partitions {
 };
 extern struct partitions all_partitions; /* list of all such */
 
+partition_t partition_of(int x);
+
 typedef unsigned char	p_index_t;
 
 #define	P_INDEX_INVALID	((p_index_t)-1)
@@ -146,6 +165,17 @@ struct dpager {
 	vm_size_t	byte_limit; /* limit, which wasn't
 				       rounded to page boundary */
 	p_index_t	cur_partition;
+	/*
+	 * Pages read ahead of the kernel's requests, also
+	 * protected by the lock above.
+	 */
+	vm_offset_t	ra_buffer;	/* the data, or 0 */
+	vm_offset_t	ra_offset;	/* object offset of first page */
+	vm_size_t	ra_count;	/* number of pages */
+	union dp_map	ra_block;	/* block of first page */
+	unsigned int	ra_gen;		/* bumped on each invalidation */
+	queue_chain_t	ra_link;	/* in readahead_queue, if ra_buffer */
+	struct zpool_entry *z_entries;	/* compressed pages, see zpool.c */
 #ifdef	CHECKSUM
 	vm_offset_t	*checksum;	/* checksum - parallel to block map */
 #define	NO_CHECKSUM	((vm_offset_t)-1)
@@ -153,6 +183,10 @@ struct dpager {
 };
 typedef struct dpager	*dpager_t;
 
+/* Forget the pages read ahead for PAGER if any is in the SIZE bytes
+   at OFFSET.  */
+void pager_ra_invalidate(dpager_t pager, vm_offset_t offset, vm_size_t size);
+
 /*
  * A paging object uses either a one- or a two-level map of offsets
  * into a paging partition.
@@ -113,7 +113,7 @@ S_default_pager_paging_storage (mach_port_t pager,
 }
 #endif
 
-/* Called to read a page from backing store.  */
+/* Called to read one or more pages from backing store.  */
 int
 page_read_file_direct (struct file_direct *fdp,
 		       vm_offset_t offset,
@@ -125,61 +125,65 @@ page_read_file_direct (struct file_direct *fdp,
   error_t err;
   char *readloc;
   char *page;
+  vm_size_t left;
   mach_msg_type_number_t nread;
 
   assert_backtrace (page_aligned (offset));
-  assert_backtrace (size == vm_page_size);
+  assert_backtrace (size > 0 && page_aligned (size));
 
   offset >>= fdp->bshift;
 
   assert_backtrace (offset + (size >> fdp->bshift) <= fdp->fd_size);
 
-  /* Find the run containing the beginning of the page.  */
-  for (r = fdp->runs; offset > r->length; ++r)
+  /* Find the run containing the beginning of the data.  */
+  for (r = fdp->runs; offset >= r->length; ++r)
     offset -= r->length;
 
   if (offset + (size >> fdp->bshift) <= r->length)
-    /* The first run contains the whole page.  */
+    /* The first run contains all of it.  */
     return device_read (fdp->device, 0, r->start + offset,
 			size, (char **) addr, size_read);
 
-  /* Read the first part of the run.  */
-  err = device_read (fdp->device, 0, r->start + offset,
-		     (r->length - offset) << fdp->bshift,
-		     (char **) addr, &nread);
+  /* The data spans several runs; gather the pieces in a buffer of our
+     own.  */
+  err = vm_allocate (mach_task_self (), addr, size, TRUE);
   if (err)
     return err;
 
-  size -= nread;
   readloc = (char *) *addr;
+  left = size;
   do
     {
-      readloc += nread;
-      offset += nread >> fdp->bshift;
-      if (offset > r->length)
-	offset -= r++->length;
+      vm_size_t segsize = (r->length - offset) << fdp->bshift;
+      if (segsize > left)
+	segsize = left;
 
-      /* We always get another out-of-line page, so we have to copy
-	 out of that page and deallocate it.  */
+      /* We always get another out-of-line buffer, so we have to copy
+	 out of it and deallocate it.  */
       err = device_read (fdp->device, 0, r->start + offset,
-			 (r->length - offset) << fdp->bshift,
-			 &page, &nread);
+			 segsize, &page, &nread);
+      if (! err && nread == 0)
+	err = EIO;
       if (err)
 	{
-	  vm_deallocate (mach_task_self (),
-			 (vm_address_t) *addr, vm_page_size);
+	  vm_deallocate (mach_task_self (), *addr, size);
 	  return err;
 	}
       memcpy (readloc, page, nread);
-      vm_deallocate (mach_task_self (), (vm_address_t) page, vm_page_size);
-      size -= nread;
-    } while (size > 0);
+      vm_deallocate (mach_task_self (), (vm_address_t) page, nread);
+
+      readloc += nread;
+      left -= nread;
+      offset += nread >> fdp->bshift;
+      if (offset >= r->length)
+	offset -= r++->length;
+    } while (left > 0);
 
-  *size_read = vm_page_size;
+  *size_read = size;
   return 0;
 }
 
-/* Called to write a page to backing store.  */
+/* Called to write one or more pages to backing store.  */
 int
 page_write_file_direct(struct file_direct *fdp,
 		       vm_offset_t offset,
@@ -192,59 +196,48 @@ page_write_file_direct(struct file_direct *fdp,
   int wrote;
 
   assert_backtrace (page_aligned (offset));
-  assert_backtrace (size == vm_page_size);
+  assert_backtrace (size > 0 && page_aligned (size));
 
   offset >>= fdp->bshift;
 
   assert_backtrace (offset + (size >> fdp->bshift) <= fdp->fd_size);
 
-  /* Find the run containing the beginning of the page.  */
-  for (r = fdp->runs; offset > r->length; ++r)
+  /* Find the run containing the beginning of the data.  */
+  for (r = fdp->runs; offset >= r->length; ++r)
     offset -= r->length;
 
   if (offset + (size >> fdp->bshift) <= r->length)
     {
-      /* The first run contains the whole page.  */
+      /* The first run contains all of it.  */
       err = device_write (fdp->device, 0, r->start + offset,
 			  (char *) addr, size, &wrote);
       *size_written = wrote;
       return err;
     }
 
-  /* Write the first part of the run.  */
-  err = device_write (fdp->device, 0,
-		      r->start + offset, (char *) addr,
-		      (r->length - offset) << fdp->bshift,
-		      &wrote);
-  if (err)
-    return err;
-
-  size -= wrote;
+  /* Write it a run at a time.  */
+  *size_written = 0;
   do
     {
-      mach_msg_type_number_t segsize;
-
-      addr += wrote;
-      offset += wrote >> fdp->bshift;
-      if (offset > r->length)
-	offset -= r++->length;
-
-      segsize = (r->length - offset) << fdp->bshift;
+      vm_size_t segsize = (r->length - offset) << fdp->bshift;
       if (segsize > size)
 	segsize = size;
+
       err = device_write (fdp->device, 0, r->start + offset,
 			  (char *) addr, segsize, &wrote);
+      if (! err && wrote <= 0)
+	err = EIO;
       if (err)
-	{
-	  vm_deallocate (mach_task_self (),
-			 (vm_address_t) addr, vm_page_size);
-	  return err;
-	}
+	return err;
 
+      *size_written += wrote;
+      addr += wrote;
       size -= wrote;
+      offset += wrote >> fdp->bshift;
+      if (offset >= r->length)
+	offset -= r++->length;
     } while (size > 0);
 
-  *size_written = vm_page_size;
   return 0;
 }
 
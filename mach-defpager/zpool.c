@@ -0,0 +1,409 @@
+/* Compressed in-memory page pool for the default pager.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include <errno.h>
+#include <error.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "default_pager.h"
+#include "zpool.h"
+
+/* Pages that do not shrink below this are written out directly.  */
+#define ZPOOL_MAX_SIZE		(vm_page_size * 3 / 4)
+
+/* The most pages written back with a single device write.  */
+#define ZPOOL_CLUSTER		16
+
+struct zpool_key
+{
+  dpager_t pager;
+  vm_offset_t page;		/* in pages */
+};
+
+struct zpool_entry
+{
+  hurd_ihash_locp_t locp;
+  struct zpool_key key;
+  union dp_map block;		/* where it goes on write back */
+
+  /* All the entries of a paging object, through its z_entries.  */
+  struct zpool_entry *next, **prevp;
+
+  /* All entries, most recently stored first.  */
+  struct zpool_entry *lru_next, *lru_prev;
+
+  int busy;			/* being written back */
+  size_t size;			/* of DATA */
+  char data[0];
+};
+
+static const struct zpool_compressor *const compressors[] =
+{
+  &zpool_lz_compressor,
+  0
+};
+
+vm_size_t zpool_limit;
+
+static const struct zpool_compressor *compressor;
+
+/* Protects everything below, and the z_entries of all paging objects.
+   It is taken after any pager lock.  */
+static pthread_mutex_t zpool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled when entries are no longer busy.  */
+static pthread_cond_t zpool_idle = PTHREAD_COND_INITIALIZER;
+
+static struct hurd_ihash zpool_table =
+  HURD_IHASH_INITIALIZER (offsetof (struct zpool_entry, locp));
+
+static struct zpool_entry *lru_head, *lru_tail;
+
+static struct zpool_stats stats;
+
+static hurd_ihash_key_t
+zpool_hash (const void *key)
+{
+  const struct zpool_key *k = key;
+  return (hurd_ihash_key_t) k->pager ^ (k->page * 2654435761U);
+}
+
+static int
+zpool_compare (const void *key1, const void *key2)
+{
+  const struct zpool_key *k1 = key1, *k2 = key2;
+  return k1->pager == k2->pager && k1->page == k2->page;
+}
+
+const struct zpool_compressor *
+zpool_find_compressor (const char *name)
+{
+  const struct zpool_compressor *const *c;
+
+  for (c = compressors; *c; c++)
+    if (! strcmp ((*c)->name, name))
+      return *c;
+  return 0;
+}
+
+void
+zpool_init (vm_size_t limit, const struct zpool_compressor *c)
+{
+  hurd_ihash_set_gki (&zpool_table, zpool_hash, zpool_compare);
+  compressor = c ?: &zpool_lz_compressor;
+  zpool_limit = limit;
+}
+
+/* Return the entry for page PAGE of PAGER, or 0.  */
+static struct zpool_entry *
+zpool_lookup (dpager_t pager, vm_offset_t page)
+{
+  struct zpool_key key = { pager, page };
+  return hurd_ihash_find (&zpool_table, (hurd_ihash_key_t) &key);
+}
+
+/* Take E out of the pool and free it.  */
+static void
+zpool_remove (struct zpool_entry *e)
+{
+  hurd_ihash_locp_remove (&zpool_table, e->locp);
+
+  *e->prevp = e->next;
+  if (e->next)
+    e->next->prevp = e->prevp;
+
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    lru_head = e->lru_next;
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    lru_tail = e->lru_prev;
+
+  stats.pages--;
+  stats.bytes -= e->size;
+  free (e);
+}
+
+/* Write E back to its block, along with the entries for the pages
+   that follow it in consecutive blocks.  The pool must be locked; it
+   is unlocked during the write.  */
+static error_t
+zpool_write_back (struct zpool_entry *e)
+{
+  struct zpool_entry *cluster[ZPOOL_CLUSTER];
+  partition_t part;
+  vm_offset_t buf, addr, offset;
+  vm_size_t n, i, size;
+  mach_msg_type_number_t wsize;
+  error_t err;
+
+  cluster[0] = e;
+  for (n = 1; n < ZPOOL_CLUSTER; n++)
+    {
+      struct zpool_entry *f = zpool_lookup (e->key.pager, e->key.page + n);
+      if (! f || f->busy
+	  || f->block.block.p_index != e->block.block.p_index
+	  || f->block.block.p_offset != e->block.block.p_offset + n)
+	break;
+      cluster[n] = f;
+    }
+  for (i = 0; i < n; i++)
+    cluster[i]->busy = 1;
+
+  part = partition_of (e->block.block.p_index);
+  err = vm_allocate (mach_task_self (), &buf, ptoa (n), TRUE);
+  if (err)
+    goto out;
+
+  /* The entries cannot go away while they are busy.  */
+  pthread_mutex_unlock (&zpool_lock);
+
+  for (i = 0; i < n; i++)
+    if (compressor->decompress (cluster[i]->data, cluster[i]->size,
+				(void *) (buf + ptoa (i)), vm_page_size))
+      panic ("compressed pool: corrupt page");
+
+  offset = ptoa (e->block.block.p_offset);
+  addr = buf;
+  size = ptoa (n);
+  do
+    {
+      err = page_write_file_direct (part->file, offset, addr, size, &wsize);
+      if (err)
+	break;
+      addr += wsize;
+      offset += wsize;
+      size -= wsize;
+    }
+  while (size != 0);
+
+  vm_deallocate (mach_task_self (), buf, ptoa (n));
+
+  /* Readahead may have read the blocks before they were written, while
+     the pages were still here.  Pager locks come before the pool's.  */
+  if (! err)
+    pager_ra_invalidate (e->key.pager, ptoa (e->key.page), ptoa (n));
+
+  pthread_mutex_lock (&zpool_lock);
+
+ out:
+  for (i = 0; i < n; i++)
+    {
+      cluster[i]->busy = 0;
+      if (! err)
+	zpool_remove (cluster[i]);
+    }
+  pthread_cond_broadcast (&zpool_idle);
+
+  if (err)
+    error (0, err, "compressed pool: cannot write back to %s", part->name);
+  else
+    stats.writebacks += n;
+  return err;
+}
+
+boolean_t
+zpool_store (dpager_t pager, vm_offset_t offset,
+	     union dp_map block, vm_offset_t addr)
+{
+  static __thread char *scratch;
+  struct zpool_entry *e, *old;
+  partition_t part;
+  size_t size;
+
+  if (! zpool_limit)
+    return FALSE;
+
+  if (! scratch)
+    {
+      scratch = malloc (vm_page_size);
+      if (! scratch)
+	return FALSE;
+    }
+
+  size = compressor->compress ((void *) addr, vm_page_size,
+			       scratch, ZPOOL_MAX_SIZE);
+  if (size == 0)
+    {
+      pthread_mutex_lock (&zpool_lock);
+      stats.rejects++;
+      pthread_mutex_unlock (&zpool_lock);
+      return FALSE;
+    }
+
+  e = malloc (sizeof *e + size);
+  if (! e)
+    return FALSE;
+  e->key.pager = pager;
+  e->key.page = atop (offset);
+  e->block = block;
+  e->busy = 0;
+  e->size = size;
+  memcpy (e->data, scratch, size);
+
+  pthread_mutex_lock (&zpool_lock);
+
+  /* Make room, oldest pages first.  */
+  while (stats.bytes + size > zpool_limit)
+    {
+      struct zpool_entry *victim;
+
+      for (victim = lru_tail; victim && victim->busy;
+	   victim = victim->lru_prev)
+	;
+      if (! victim || zpool_write_back (victim))
+	break;
+    }
+
+  /* An older copy might be being written back; let it finish, as the
+     write would otherwise land after whatever the caller does next.  */
+  while ((old = zpool_lookup (pager, e->key.page)) && old->busy)
+    pthread_cond_wait (&zpool_idle, &zpool_lock);
+  if (old)
+    zpool_remove (old);
+
+  part = partition_of (block.block.p_index);
+  if (stats.bytes + size > zpool_limit || ! part || part->going_away
+      || hurd_ihash_add (&zpool_table, (hurd_ihash_key_t) &e->key, e))
+    {
+      pthread_mutex_unlock (&zpool_lock);
+      free (e);
+      return FALSE;
+    }
+
+  e->next = pager->z_entries;
+  if (e->next)
+    e->next->prevp = &e->next;
+  e->prevp = &pager->z_entries;
+  pager->z_entries = e;
+
+  e->lru_prev = 0;
+  e->lru_next = lru_head;
+  if (lru_head)
+    lru_head->lru_prev = e;
+  else
+    lru_tail = e;
+  lru_head = e;
+
+  stats.pages++;
+  stats.bytes += size;
+  stats.stores++;
+
+  pthread_mutex_unlock (&zpool_lock);
+  return TRUE;
+}
+
+boolean_t
+zpool_load (dpager_t pager, vm_offset_t offset,
+	    vm_offset_t addr, boolean_t remove)
+{
+  struct zpool_entry *e;
+
+  if (! pager->z_entries)
+    return FALSE;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  e = zpool_lookup (pager, atop (offset));
+  if (! e)
+    {
+      pthread_mutex_unlock (&zpool_lock);
+      return FALSE;
+    }
+
+  if (compressor->decompress (e->data, e->size, (void *) addr, vm_page_size))
+    panic ("compressed pool: corrupt page");
+  stats.hits++;
+
+  if (remove)
+    {
+      while ((e = zpool_lookup (pager, atop (offset))) && e->busy)
+	pthread_cond_wait (&zpool_idle, &zpool_lock);
+      if (e)
+	zpool_remove (e);
+    }
+
+  pthread_mutex_unlock (&zpool_lock);
+  return TRUE;
+}
+
+void
+zpool_discard (dpager_t pager, vm_offset_t offset, vm_size_t size)
+{
+  struct zpool_entry *e, *next;
+  vm_offset_t first = atop (offset);
+  vm_offset_t end = offset + size < offset
+		    ? (vm_offset_t) -1 : atop (round_page (offset + size));
+
+  if (! pager->z_entries)
+    return;
+
+  pthread_mutex_lock (&zpool_lock);
+ again:
+  for (e = pager->z_entries; e; e = next)
+    {
+      next = e->next;
+      if (e->key.page < first || e->key.page >= end)
+	continue;
+      if (e->busy)
+	{
+	  pthread_cond_wait (&zpool_idle, &zpool_lock);
+	  goto again;
+	}
+      zpool_remove (e);
+    }
+  pthread_mutex_unlock (&zpool_lock);
+}
+
+boolean_t
+zpool_flush_partition (p_index_t pindex)
+{
+  struct zpool_entry *e;
+  boolean_t ok = TRUE;
+
+  pthread_mutex_lock (&zpool_lock);
+ again:
+  for (e = lru_tail; e; e = e->lru_prev)
+    if (e->block.block.p_index == pindex)
+      {
+	if (e->busy)
+	  pthread_cond_wait (&zpool_idle, &zpool_lock);
+	else if (zpool_write_back (e))
+	  {
+	    ok = FALSE;
+	    break;
+	  }
+	goto again;
+      }
+  pthread_mutex_unlock (&zpool_lock);
+
+  return ok;
+}
+
+void
+zpool_get_stats (struct zpool_stats *s)
+{
+  pthread_mutex_lock (&zpool_lock);
+  *s = stats;
+  pthread_mutex_unlock (&zpool_lock);
+}
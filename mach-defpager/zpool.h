@@ -0,0 +1,89 @@
+/* Compressed in-memory page pool for the default pager.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Pages returned by the kernel can be compressed and kept in memory
+   instead of being written to a paging partition right away.  Each of
+   them still gets a block in a partition, to which it is written back
+   when the pool fills up; the pool saves device operations, not paging
+   space.  */
+
+#ifndef _ZPOOL_H_
+#define _ZPOOL_H_
+
+#include "priv.h"
+
+/* A page compressor.  COMPRESS compresses the SIZE bytes at SRC into at
+   most AVAIL bytes at DST, and returns the compressed size, or zero if
+   it would not fit.  DECOMPRESS expands the SIZE bytes at SRC into
+   exactly AVAIL bytes at DST, and returns zero, or nonzero if the data
+   is corrupt.  */
+struct zpool_compressor
+{
+  const char *name;
+  size_t (*compress) (const void *src, size_t size, void *dst, size_t avail);
+  int (*decompress) (const void *src, size_t size, void *dst, size_t avail);
+};
+
+/* The built-in LZ compressor, in lz.c.  */
+extern const struct zpool_compressor zpool_lz_compressor;
+
+/* Return the compressor called NAME, or 0 if there is none.  */
+const struct zpool_compressor *zpool_find_compressor (const char *name);
+
+/* The most compressed data the pool may hold, in bytes.  The pool is
+   disabled while this is zero.  */
+extern vm_size_t zpool_limit;
+
+/* Enable the pool, holding up to LIMIT bytes of data compressed with
+   COMPRESSOR.  */
+void zpool_init (vm_size_t limit, const struct zpool_compressor *compressor);
+
+/* Compress the page at ADDR, for OFFSET in PAGER, whose block in the
+   paging partitions is BLOCK, and keep it in the pool.  Return FALSE if
+   the page does not compress well or the pool is full; the caller must
+   then write it out itself.  */
+boolean_t zpool_store (dpager_t pager, vm_offset_t offset,
+		       union dp_map block, vm_offset_t addr);
+
+/* If the page at OFFSET in PAGER is in the pool, decompress it to ADDR
+   and return TRUE.  If REMOVE, drop it from the pool.  */
+boolean_t zpool_load (dpager_t pager, vm_offset_t offset,
+		      vm_offset_t addr, boolean_t remove);
+
+/* Drop the pages of PAGER in the SIZE bytes at OFFSET from the pool,
+   without writing them back.  */
+void zpool_discard (dpager_t pager, vm_offset_t offset, vm_size_t size);
+
+/* Write back all pages whose blocks are in partition PINDEX.  Return
+   FALSE if some could not be written.  */
+boolean_t zpool_flush_partition (p_index_t pindex);
+
+struct zpool_stats
+{
+  vm_size_t pages;		/* pages in the pool */
+  vm_size_t bytes;		/* their compressed size */
+  vm_size_t stores;		/* pages ever stored */
+  vm_size_t rejects;		/* pages that did not compress well */
+  vm_size_t hits;		/* pages supplied from the pool */
+  vm_size_t writebacks;		/* pages written back */
+};
+
+void zpool_get_stats (struct zpool_stats *stats);
+
+#endif /* _ZPOOL_H_ */
@@ -129,6 +129,8 @@ setup_dummy_device (char *name, struct device **device)
   /* This call adds the device to the `dev_base' chain,
      initializes its `ifindex' member (which matters!),
      and tells the protocol stacks about the device.  */
+  begin_config_change ();
   err = - register_netdevice (dev);
+  end_config_change ();
   assert_perror_backtrace (err);
 }
@@ -39,6 +39,12 @@
 
 struct port_class *etherreadclass;
 
+/* The most frames taken off the device ports per wakeup.  */
+#define ETHER_BATCH	32
+
+/* The most receive buffers each device keeps for reuse.  */
+#define ETHER_POOL_MAX	256
+
 struct ether_device
 {
   struct ether_device *next;
@@ -46,19 +52,34 @@ struct ether_device
   struct port_info *readpt;
   mach_port_t readptname;
   struct device dev;
+  struct net_device_stats stats;
+  struct skb_pool pool;		/* receive buffers */
+};
+
+/* The port a device sends us its frames on.  Its protected payload is
+   the port itself, so the device comes straight out of the message.  */
+struct ether_port
+{
+  struct port_info pi;
+  struct ether_device *edev;
 };
 
 /* Linked list of all ethernet devices.  */
 struct ether_device *ether_dev;
 
-struct enet_statistics retbuf;
+/* Frames are received right into the buffers that become their skbs;
+   each holds a whole net_rcv_msg.  A buffer a frame arrived in is
+   replaced with one from the pool of that frame's device; this pool
+   only provides the first ones.  */
+static struct skb_pool ether_spare_pool;
 
 
-/* Mach doesn't provide this.  DAMN. */
-struct enet_statistics *
+/* Mach doesn't provide this, so we count for ourselves.  */
+struct net_device_stats *
 ethernet_get_stats (struct device *dev)
 {
-  return &retbuf;
+  struct ether_device *edev = (struct ether_device *) dev->priv;
+  return &edev->stats;
 }
 
 int
@@ -99,80 +120,143 @@ static int bpf_ether_filter_len = sizeof (bpf_ether_filter) / (sizeof (short));
 static struct port_bucket *etherport_bucket;
 
 
-static void *
-ethernet_thread (void *arg)
+/* Return the device the frame in MSG came from, or null.  */
+static struct ether_device *
+ether_device_of (mach_msg_header_t *msg)
 {
-  ports_manage_port_operations_one_thread (etherport_bucket,
-					   ethernet_demuxer,
-					   0);
-  return NULL;
+  struct ether_port *port;
+  struct ether_device *edev;
+
+  if (MACH_MSGH_BITS_LOCAL (msg->msgh_bits) ==
+      MACH_MSG_TYPE_PROTECTED_PAYLOAD)
+    port = ports_lookup_payload (etherport_bucket,
+				 msg->msgh_protected_payload,
+				 etherreadclass);
+  else
+    port = ports_lookup_port (etherport_bucket, msg->msgh_local_port,
+			      etherreadclass);
+  if (! port)
+    return NULL;
+
+  edev = port->edev;
+  ports_port_deref (port);
+  return edev;
 }
 
-int
-ethernet_demuxer (mach_msg_header_t *inp,
-		  mach_msg_header_t *outp)
+/* Turn MSG, a frame from EDEV, into an skb whose buffer goes back to
+   EDEV's pool when it is freed.  The Ethernet header is moved up
+   against the payload, which stays where it is.  */
+static struct sk_buff *
+ether_make_skb (struct ether_device *edev, struct net_rcv_msg *msg)
 {
-  struct net_rcv_msg *msg = (struct net_rcv_msg *) inp;
   struct sk_buff *skb;
+  unsigned char *payload;
   int datalen;
-  struct ether_device *edev;
-  struct device *dev = 0;
-  mach_port_t local_port;
 
-  if (inp->msgh_id != NET_RCV_MSG_ID)
-    return 0;
+  datalen = ETH_HLEN
+    + msg->packet_type.msgt_number - sizeof (struct packet_header);
+  payload = (unsigned char *) msg->packet + sizeof (struct packet_header);
 
-  if (MACH_MSGH_BITS_LOCAL (inp->msgh_bits) ==
-      MACH_MSG_TYPE_PROTECTED_PAYLOAD)
-    {
-      struct port_info *pi = ports_lookup_payload (NULL,
-						   inp->msgh_protected_payload,
-						   NULL);
-      if (pi)
-	{
-	  local_port = pi->port_right;
-	  ports_port_deref (pi);
-	}
-      else
-	local_port = MACH_PORT_NULL;
-    }
-  else
-    local_port = inp->msgh_local_port;
+  skb = alloc_skb_pool (&edev->pool, msg, GFP_ATOMIC);
+  if (! skb)
+    return NULL;
 
-  for (edev = ether_dev; edev; edev = edev->next)
-    if (local_port == edev->readptname)
-      dev = &edev->dev;
+  memmove (payload - ETH_HLEN, msg->header, ETH_HLEN);
+  skb_reserve (skb, payload - ETH_HLEN - skb->head);
+  skb_put (skb, datalen);
+  skb->dev = &edev->dev;
 
-  if (! dev)
-    {
-      if (inp->msgh_remote_port != MACH_PORT_NULL)
-	mach_port_deallocate (mach_task_self (), inp->msgh_remote_port);
-      return 1;
-    }
+  /* Account for the frame as alloc_skb would, so that socket buffer
+     limits mean what they did; the rest of the buffer is the message it
+     came in.  */
+  skb->truesize = (NET_IP_ALIGN + datalen + 15) & ~15;
 
-  datalen = ETH_HLEN
-    + msg->packet_type.msgt_number - sizeof (struct packet_header);
+  skb->protocol = eth_type_trans (skb, &edev->dev);
+  return skb;
+}
 
-  pthread_mutex_lock (&net_bh_lock);
-  skb = alloc_skb (NET_IP_ALIGN + datalen, GFP_ATOMIC);
-  skb_reserve(skb, NET_IP_ALIGN);
-  skb_put (skb, datalen);
-  skb->dev = dev;
+/* Receive frames from all devices.  Each time a frame arrives, those
+   queued behind it are taken as well, up to ETHER_BATCH, and handed
+   to the stack taking net_bh_lock once.  */
+static void *
+ethernet_thread (void *arg)
+{
+  struct net_rcv_msg *msgs[ETHER_BATCH] = { 0 };
+  struct sk_buff *skbs[ETHER_BATCH];
+  struct ether_device *edevs[ETHER_BATCH];
+  mach_msg_return_t mr;
+  int dropped, i, n, nskbs;
 
-  /* Copy the two parts of the frame into the buffer. */
-  memcpy (skb->data, msg->header, ETH_HLEN);
-  memcpy (skb->data + ETH_HLEN,
-	  msg->packet + sizeof (struct packet_header),
-	  datalen - ETH_HLEN);
+  for (;;)
+    {
+      for (n = 0; n < ETHER_BATCH; n++)
+	{
+	  if (! msgs[n])
+	    {
+	      msgs[n] = skb_pool_get (&ether_spare_pool);
+	      if (! msgs[n])
+		break;
+	    }
+
+	  /* Only wait for the first one.  */
+	  mr = mach_msg (&msgs[n]->msg_hdr,
+			 MACH_RCV_MSG | (n ? MACH_RCV_TIMEOUT : 0),
+			 0, sizeof (struct net_rcv_msg),
+			 etherport_bucket->portset, 0, MACH_PORT_NULL);
+	  if (mr == MACH_RCV_TOO_LARGE)
+	    /* Not a frame; the kernel has destroyed it.  */
+	    n--;
+	  else if (mr != MACH_MSG_SUCCESS)
+	    break;
+	}
+
+      nskbs = 0;
+      for (i = 0; i < n; i++)
+	{
+	  struct ether_device *edev;
+
+	  if (msgs[i]->msg_hdr.msgh_id != NET_RCV_MSG_ID
+	      || ! (edev = ether_device_of (&msgs[i]->msg_hdr)))
+	    {
+	      mach_msg_destroy (&msgs[i]->msg_hdr);
+	      continue;
+	    }
+
+	  /* The buffer is the skb's now, or back in the pool if it could
+	     not be made.  */
+	  skbs[nskbs] = ether_make_skb (edev, msgs[i]);
+	  edevs[nskbs++] = edev;
+	  msgs[i] = skb_pool_get (&edev->pool);
+	}
 
-  /* Drop it on the queue. */
-  skb->protocol = eth_type_trans (skb, dev);
-  netif_rx (skb);
-  pthread_mutex_unlock (&net_bh_lock);
+      if (nskbs == 0)
+	continue;
 
-  return 1;
-}
+      pthread_mutex_lock (&net_bh_lock);
+      for (i = 0; i < nskbs; i++)
+	{
+	  struct net_device_stats *stats = &edevs[i]->stats;
+
+	  if (! skbs[i])
+	    {
+	      stats->rx_dropped++;
+	      continue;
+	    }
+
+	  stats->rx_packets++;
+	  stats->rx_bytes += skbs[i]->len + ETH_HLEN;
+
+	  /* netif_rx drops frames when the backlog is full.  */
+	  dropped = atomic_read (&netdev_rx_dropped);
+	  netif_rx (skbs[i]);
+	  if (atomic_read (&netdev_rx_dropped) != dropped)
+	    stats->rx_dropped++;
+	}
+      pthread_mutex_unlock (&net_bh_lock);
+    }
 
+  return NULL;
+}
 
 void
 ethernet_initialize (void)
@@ -181,6 +265,7 @@ ethernet_initialize (void)
   error_t err;
   etherport_bucket = ports_create_bucket ();
   etherreadclass = ports_create_class (0, 0);
+  skb_pool_init (&ether_spare_pool, sizeof (struct net_rcv_msg), 0);
 
   err = pthread_create (&thread, NULL, ethernet_thread, NULL);
   if (!err)
@@ -202,8 +287,9 @@ ethernet_open (struct device *dev)
   assert_backtrace (edev->ether_port == MACH_PORT_NULL);
 
   err = ports_create_port (etherreadclass, etherport_bucket,
-			   sizeof (struct port_info), &edev->readpt);
+			   sizeof (struct ether_port), &edev->readpt);
   assert_perror_backtrace (err);
+  ((struct ether_port *) edev->readpt)->edev = edev;
   edev->readptname = ports_get_right (edev->readpt);
   mach_port_insert_right (mach_task_self (), edev->readptname, edev->readptname,
 			  MACH_MSG_TYPE_MAKE_SEND);
@@ -287,8 +373,11 @@ ethernet_xmit (struct sk_buff *skb, struct device *dev)
 	  /* Device probably just died, wait a bit (to let driver restart) and try to reopen it.  */
 
 	  if (tried == 2)
-	    /* Too many tries, abort */
-	    break;
+	    {
+	      /* Too many tries, abort */
+	      edev->stats.tx_errors++;
+	      break;
+	    }
 
 	  sleep (1);
 	  ethernet_close (dev);
@@ -298,6 +387,8 @@ ethernet_xmit (struct sk_buff *skb, struct device *dev)
 	{
 	  assert_perror_backtrace (err);
 	  assert_backtrace (count == skb->len);
+	  edev->stats.tx_packets++;
+	  edev->stats.tx_bytes += count;
 	}
     }
   while (err);
@@ -372,6 +463,8 @@ setup_ethernet_device (char *name, struct device **device)
 
   dev->change_flags = ethernet_change_flags;
 
+  skb_pool_init (&edev->pool, sizeof (struct net_rcv_msg), ETHER_POOL_MAX);
+
   dev_init_buffers (dev);
 
   ethernet_open (dev);
@@ -401,6 +494,8 @@ setup_ethernet_device (char *name, struct device **device)
   /* This call adds the device to the `dev_base' chain,
      initializes its `ifindex' member (which matters!),
      and tells the protocol stacks about the device.  */
+  begin_config_change ();
   err = - register_netdevice (dev);
+  end_config_change ();
   assert_perror_backtrace (err);
 }
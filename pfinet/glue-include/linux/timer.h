@@ -26,10 +26,12 @@ void mod_timer (struct timer_list *, unsigned long);
 void init_timer (struct timer_list *);
 
 
-#define time_after(a,b)		((long)(b) - (long)(a) < 0)
+/* The difference is taken unsigned, which wraps, and only then made
+   signed; subtracting the signed values overflows when jiffies wrap.  */
+#define time_after(a,b)		((long)((b) - (a)) < 0)
 #define time_before(a,b)	time_after(b,a)
 
-#define time_after_eq(a,b)	((long)(a) - (long)(b) >= 0)
+#define time_after_eq(a,b)	((long)((a) - (b)) >= 0)
 #define time_before_eq(a,b)	time_after_eq(b,a)
 
 
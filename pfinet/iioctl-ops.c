@@ -56,7 +56,8 @@ extern void inquire_device (struct device *dev, uint32_t *addr,
                             uint32_t *netmask, uint32_t *peer,
 			    uint32_t *broadcast);
 
-/* Truncate name, take the global lock and find device with this name.  */
+/* Truncate name and find device with this name.  The caller must hold
+   config_lock.  */
 struct device *get_dev (const char *name)
 {
   char ifname[IFNAMSIZ];
@@ -65,8 +66,6 @@ struct device *get_dev (const char *name)
   memcpy (ifname, name, IFNAMSIZ-1);
   ifname[IFNAMSIZ-1] = 0;
 
-  pthread_mutex_lock (&global_lock);
-
   for (dev = dev_base; dev; dev = dev->next)
     if (strcmp (dev->name, ifname) == 0)
       break;
@@ -299,6 +298,7 @@ siocgifXaddr (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (ifnam);
   if (!dev)
     err = ENODEV;
@@ -312,7 +312,7 @@ siocgifXaddr (struct sock_user *user,
       sin->sin_addr.s_addr = addrs[type];
     }
 
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -340,6 +340,7 @@ siocsifXaddr (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  begin_config_change ();
   dev = get_dev (ifnam);
 
   if (!user->isroot)
@@ -357,7 +358,7 @@ siocsifXaddr (struct sock_user *user,
       err = configure_device (dev, addrs[0], addrs[1], addrs[2], addrs[3]);
     }
 
-  pthread_mutex_unlock (&global_lock);
+  end_config_change ();
   return err;
 }
 
@@ -373,6 +374,7 @@ S_rioctl_siocaddrt (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  begin_config_change ();
   dev = get_dev (ifnam);
 
   if (!dev)
@@ -382,7 +384,7 @@ S_rioctl_siocaddrt (struct sock_user *user,
   else
     err = add_route (dev, &route);
 
-  pthread_mutex_unlock (&global_lock);
+  end_config_change ();
   return err;
 }
 
@@ -398,6 +400,7 @@ S_rioctl_siocdelrt (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  begin_config_change ();
   dev = get_dev (ifnam);
 
   if (!dev)
@@ -407,7 +410,7 @@ S_rioctl_siocdelrt (struct sock_user *user,
   else
     err = delete_route (dev, &route);
 
-  pthread_mutex_unlock (&global_lock);
+  end_config_change ();
   return err;
 }
 
@@ -429,6 +432,7 @@ S_iioctl_siocsifflags (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  begin_config_change ();
   dev = get_dev (ifnam);
 
   if (!user->isroot)
@@ -438,7 +442,7 @@ S_iioctl_siocsifflags (struct sock_user *user,
   else
     err = dev_change_flags (dev, flags);
 
-  pthread_mutex_unlock (&global_lock);
+  end_config_change ();
   return err;
 }
 
@@ -451,6 +455,7 @@ S_iioctl_siocgifflags (struct sock_user *user,
   error_t err = 0;
   struct device *dev;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (name);
   if (!dev)
     err = ENODEV;
@@ -458,7 +463,7 @@ S_iioctl_siocgifflags (struct sock_user *user,
     {
       *flags = dev->flags;
     }
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -477,6 +482,7 @@ S_iioctl_siocgifmetric (struct sock_user *user,
   error_t err = 0;
   struct device *dev;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (ifnam);
   if (!dev)
     err = ENODEV;
@@ -484,7 +490,7 @@ S_iioctl_siocgifmetric (struct sock_user *user,
     {
       *metric = 0; /* Not supported.  */
     }
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -530,6 +536,7 @@ S_iioctl_siocgifhwaddr (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (ifname);
   if (!dev)
     err = ENODEV;
@@ -539,7 +546,7 @@ S_iioctl_siocgifhwaddr (struct sock_user *user,
       addr->sa_family = dev->type;
     }
   
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -552,6 +559,7 @@ S_iioctl_siocgifmtu (struct sock_user *user,
   error_t err = 0;
   struct device *dev;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (ifnam);
   if (!dev)
     err = ENODEV;
@@ -559,7 +567,7 @@ S_iioctl_siocgifmtu (struct sock_user *user,
     {
       *mtu = dev->mtu;
     }
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -575,6 +583,7 @@ S_iioctl_siocsifmtu (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
+  begin_config_change ();
   dev = get_dev (ifnam);
 
   if (!user->isroot)
@@ -593,7 +602,7 @@ S_iioctl_siocsifmtu (struct sock_user *user,
       notifier_call_chain (&netdev_chain, NETDEV_CHANGEMTU, dev);
     }
 
-  pthread_mutex_unlock (&global_lock);
+  end_config_change ();
   return err;
 }
 
@@ -606,6 +615,7 @@ S_iioctl_siocgifindex (struct sock_user *user,
   error_t err = 0;
   struct device *dev;
 
+  pthread_rwlock_rdlock (&config_lock);
   dev = get_dev (ifnam);
   if (!dev)
     err = ENODEV;
@@ -613,7 +623,7 @@ S_iioctl_siocgifindex (struct sock_user *user,
     {
       *index = dev->ifindex;
     }
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -626,7 +636,7 @@ S_iioctl_siocgifname (struct sock_user *user,
   error_t err = 0;
   struct device *dev;
 
-  pthread_mutex_lock (&global_lock);
+  pthread_rwlock_rdlock (&config_lock);
   dev = dev_get_by_index (*index);
   if (!dev)
     err = ENODEV;
@@ -635,7 +645,7 @@ S_iioctl_siocgifname (struct sock_user *user,
       strncpy (ifnam, dev->name, IFNAMSIZ);
       ifnam[IFNAMSIZ-1] = '\0';
     }
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
 
   return err;
 }
@@ -375,7 +375,6 @@ S_io_reauthenticate (struct sock_user *user,
   aux_uids = aubuf;
   aux_gids = agbuf;
 
-  pthread_mutex_lock (&global_lock);
   do
     newuser = make_sock_user (user->sock, 0, 1, 0);
     /* Should check whether errno is indeed EINTR --
@@ -386,8 +385,6 @@ S_io_reauthenticate (struct sock_user *user,
   auth = getauth ();
   newright = ports_get_send_right (newuser);
   assert_backtrace (newright != MACH_PORT_NULL);
-  /* Release the global lock while blocking on the auth server and client.  */
-  pthread_mutex_unlock (&global_lock);
   do
     err = auth_server_authenticate (auth,
 				    rend,
@@ -399,7 +396,6 @@ S_io_reauthenticate (struct sock_user *user,
 				    &gen_gids, &gengidlen,
 				    &aux_gids, &auxgidlen);
   while (err == EINTR);
-  pthread_mutex_lock (&global_lock);
   mach_port_deallocate (mach_task_self (), rend);
   mach_port_deallocate (mach_task_self (), newright);
   mach_port_deallocate (mach_task_self (), auth);
@@ -421,8 +417,6 @@ S_io_reauthenticate (struct sock_user *user,
   mach_port_move_member (mach_task_self (), newuser->pi.port_right,
 			 pfinet_bucket->portset);
 
-  pthread_mutex_unlock (&global_lock);
-
   ports_port_deref (newuser);
 
   if (gubuf != gen_uids)
@@ -451,8 +445,6 @@ S_io_restrict_auth (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
-  pthread_mutex_lock (&global_lock);
-
   isroot = 0;
   if (user->isroot)
     /* Check permission as fshelp_isowner would do.  */
@@ -470,7 +462,6 @@ S_io_restrict_auth (struct sock_user *user,
   *newobject = ports_get_right (newuser);
   *newobject_type = MACH_MSG_TYPE_MAKE_SEND;
   ports_port_deref (newuser);
-  pthread_mutex_unlock (&global_lock);
   return 0;
 }
 
@@ -483,12 +474,10 @@ S_io_duplicate (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
-  pthread_mutex_lock (&global_lock);
   newuser = make_sock_user (user->sock, user->isroot, 0, 0);
   *newobject = ports_get_right (newuser);
   *newobject_type = MACH_MSG_TYPE_MAKE_SEND;
   ports_port_deref (newuser);
-  pthread_mutex_unlock (&global_lock);
   return 0;
 }
 
@@ -505,14 +494,14 @@ S_io_identity (struct sock_user *user,
   if (!user)
     return EOPNOTSUPP;
 
-  pthread_mutex_lock (&global_lock);
+  pthread_mutex_lock (&user->sock->lock);
   if (user->sock->identity == MACH_PORT_NULL)
     {
       err = mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_RECEIVE,
 				&user->sock->identity);
       if (err)
 	{
-	  pthread_mutex_unlock (&global_lock);
+	  pthread_mutex_unlock (&user->sock->lock);
 	  return err;
 	}
     }
@@ -523,7 +512,7 @@ S_io_identity (struct sock_user *user,
   *fsystype = MACH_MSG_TYPE_MAKE_SEND;
   *fileno = user->sock->st_ino;
 
-  pthread_mutex_unlock (&global_lock);
+  pthread_mutex_unlock (&user->sock->lock);
   return 0;
 }
 
@@ -19,6 +19,9 @@
 #define _LINUX_NET_H
 
 #include <linux/socket.h>
+#ifdef _HURD_
+#include <pthread.h>
+#endif
 
 struct poll_table_struct;
 
@@ -67,6 +70,7 @@ struct socket
 	struct proto_ops	*ops;
 	struct inode		*inode;
 #ifdef _HURD_
+	pthread_mutex_t		lock;	/* protects refcnt and identity */
  	uint_fast32_t		refcnt;	/* # of sock_user's pointing to this */
 	mach_port_t 		identity; /* for io_identity */
   	ino_t			st_ino;
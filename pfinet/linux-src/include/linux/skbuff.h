@@ -112,6 +112,9 @@ struct sk_buff {
 		__u32	ifield;
 	} private;
 #endif
+#ifdef _HURD_
+	struct skb_pool	*pool;			/* Pool the data came from, or NULL	*/
+#endif
 };
 
 /* These are just the default values. This is run time configurable.
@@ -140,6 +143,27 @@ extern void			kfree_skbmem(struct sk_buff *skb);
 extern struct sk_buff *		skb_clone(struct sk_buff *skb, int priority);
 extern struct sk_buff *		skb_copy(struct sk_buff *skb, int priority);
 extern struct sk_buff *		skb_realloc_headroom(struct sk_buff *skb, int newheadroom);
+#ifdef _HURD_
+#include <pthread.h>
+
+/*
+ *	A pool of data buffers of one size.  A driver receives frames into
+ *	buffers from it and wraps them with alloc_skb_pool; freeing the skb
+ *	gives the buffer back to the pool rather than to kfree.
+ */
+struct skb_pool {
+	pthread_mutex_t	lock;
+	void		*free;		/* Buffers, linked through their first word */
+	unsigned int	size;		/* Of a buffer, not counting its dataref	*/
+	unsigned int	nfree;		/* Buffers on FREE				*/
+	unsigned int	max;		/* Most buffers kept on FREE			*/
+};
+
+extern void			skb_pool_init(struct skb_pool *pool, unsigned int size, unsigned int max);
+extern void *			skb_pool_get(struct skb_pool *pool);
+extern void			skb_pool_put(struct skb_pool *pool, void *data);
+extern struct sk_buff *		alloc_skb_pool(struct skb_pool *pool, void *data, int priority);
+#endif
 #define dev_kfree_skb(a)	kfree_skb(a)
 extern void	skb_over_panic(struct sk_buff *skb, int len, void *here);
 extern void	skb_under_panic(struct sk_buff *skb, int len, void *here);
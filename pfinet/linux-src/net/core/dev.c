@@ -648,6 +648,11 @@ int dev_queue_xmit(struct sk_buff *skb)
 
 int netdev_dropping = 0;
 int netdev_max_backlog = 300;
+#ifdef _HURD_
+/* The most packets net_bh handles before returning to net_bh_worker,
+   which then lets go of global_lock for a moment.  */
+int netdev_bh_budget = 64;
+#endif
 atomic_t netdev_rx_dropped;
 #ifdef CONFIG_CPU_IS_SLOW
 int net_cpu_congestion;
@@ -718,7 +723,9 @@ static void netdev_wakeup(void)
 static void dev_clear_backlog(struct device *dev)
 {
 	struct sk_buff *curr;
+#ifndef _HURD_
 	unsigned long flags;
+#endif
 
 	/*
 	 *
@@ -732,23 +739,36 @@ static void dev_clear_backlog(struct device *dev)
 
 	if (backlog.qlen) {
 	repeat:
+#ifdef _HURD_
+		pthread_mutex_lock(&net_bh_lock);
+#else
 		spin_lock_irqsave(&skb_queue_lock, flags);
+#endif
 		for (curr = backlog.next;
 		     curr != (struct sk_buff *)(&backlog);
 		     curr = curr->next)
 			if (curr->dev == dev)
 			{
 				__skb_unlink(curr, &backlog);
+#ifdef _HURD_
+				pthread_mutex_unlock(&net_bh_lock);
+#else
 				spin_unlock_irqrestore(&skb_queue_lock, flags);
+#endif
 				kfree_skb(curr);
 				goto repeat;
 			}
+#ifdef _HURD_
+		netdev_dropping = 0;
+		pthread_mutex_unlock(&net_bh_lock);
+#else
 		spin_unlock_irqrestore(&skb_queue_lock, flags);
 #ifdef CONFIG_NET_HW_FLOWCONTROL
 		if (netdev_dropping)
 			netdev_wakeup();
 #else
 		netdev_dropping = 0;
+#endif
 #endif
 	}
 }
@@ -841,7 +861,9 @@ void net_bh(void)
 	struct packet_type *ptype;
 	struct packet_type *pt_prev;
 	unsigned short type;
-#ifndef _HURD_
+#ifdef _HURD_
+	int budget = netdev_bh_budget;
+#else
 	unsigned long start_time = jiffies;
 #ifdef CONFIG_CPU_IS_SLOW
 	static unsigned long start_busy = 0;
@@ -882,7 +904,11 @@ void net_bh(void)
 	{
 		struct sk_buff * skb;
 
-#ifndef _HURD_
+#ifdef _HURD_
+		/* Give RPC threads waiting for global_lock a chance.  */
+		if (budget-- == 0)
+			goto net_bh_break;
+#else
 		/* Give chance to other bottom halves to run */
 		if (jiffies - start_time > 1)
 			goto net_bh_break;
@@ -891,7 +917,14 @@ void net_bh(void)
 		/*
 		 *	We have a packet. Therefore the queue has shrunk
 		 */
+#ifdef _HURD_
+		/* Packets are queued holding only net_bh_lock.  */
+		pthread_mutex_lock(&net_bh_lock);
+		skb = __skb_dequeue(&backlog);
+		pthread_mutex_unlock(&net_bh_lock);
+#else
 		skb = skb_dequeue(&backlog);
+#endif
 
 #ifndef _HURD_
 #ifdef CONFIG_CPU_IS_SLOW
@@ -1031,18 +1064,26 @@ void net_bh(void)
 #ifdef CONFIG_NET_HW_FLOWCONTROL
 	if (netdev_dropping)
 		netdev_wakeup();
+#elif defined (_HURD_)
+	pthread_mutex_lock(&net_bh_lock);
+	netdev_dropping = 0;
+	pthread_mutex_unlock(&net_bh_lock);
 #else
 	netdev_dropping = 0;
 #endif
 	NET_PROFILE_LEAVE(net_bh);
 	return;
 
-#ifndef _HURD_
 net_bh_break:
+#ifdef _HURD_
+	pthread_mutex_lock(&net_bh_lock);
 	mark_bh(NET_BH);
+	pthread_mutex_unlock(&net_bh_lock);
+#else
+	mark_bh(NET_BH);
+#endif
 	NET_PROFILE_LEAVE(net_bh);
 	return;
-#endif
 }
 
 /* Protocol dependent address dumping routines */
@@ -164,6 +164,9 @@ struct sk_buff *alloc_skb(unsigned int size,int gfp_mask)
 
 	atomic_set(&skb->users, 1); 
 	atomic_set(skb_datarefp(skb), 1);
+#ifdef _HURD_
+	skb->pool = NULL;
+#endif
 	return skb;
 
 nodata:
@@ -174,6 +177,86 @@ nohead:
 }
 
 
+#ifdef _HURD_
+void skb_pool_init(struct skb_pool *pool, unsigned int size, unsigned int max)
+{
+	pthread_mutex_init(&pool->lock, NULL);
+	pool->free = NULL;
+	pool->size = (size + 15) & ~15;
+	pool->nfree = 0;
+	pool->max = max;
+}
+
+/*
+ *	Take a buffer from POOL, or allocate a new one if it is empty.
+ */
+void *skb_pool_get(struct skb_pool *pool)
+{
+	void *data;
+
+	pthread_mutex_lock(&pool->lock);
+	data = pool->free;
+	if (data) {
+		pool->free = *(void **) data;
+		pool->nfree--;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (data == NULL)
+		data = kmalloc(pool->size + sizeof(atomic_t), GFP_ATOMIC);
+	return data;
+}
+
+void skb_pool_put(struct skb_pool *pool, void *data)
+{
+	pthread_mutex_lock(&pool->lock);
+	if (pool->nfree < pool->max) {
+		*(void **) data = pool->free;
+		pool->free = data;
+		pool->nfree++;
+		data = NULL;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (data)
+		kfree(data);
+}
+
+/*
+ *	Make an skb of DATA, a buffer taken from POOL.  Its data pointers
+ *	are set to the start of the buffer; the caller moves them to the
+ *	frame.  On failure DATA is given back to the pool.
+ */
+struct sk_buff *alloc_skb_pool(struct skb_pool *pool, void *data, int gfp_mask)
+{
+	struct sk_buff *skb;
+
+	skb = kmem_cache_alloc(skbuff_head_cache, gfp_mask);
+	if (skb == NULL) {
+		skb_pool_put(pool, data);
+		atomic_inc(&net_fails);
+		return NULL;
+	}
+
+	atomic_inc(&net_allocs);
+	atomic_inc(&net_skbcount);
+
+	skb->truesize = pool->size;
+	skb->head = data;
+	skb->data = data;
+	skb->tail = data;
+	skb->end = (u8 *) data + pool->size;
+	skb->len = 0;
+	skb->is_clone = 0;
+	skb->cloned = 0;
+	skb->pool = pool;
+
+	atomic_set(&skb->users, 1); 
+	atomic_set(skb_datarefp(skb), 1);
+	return skb;
+}
+#endif
+
 /*
  *	Slab constructor for a skb head. 
  */ 
@@ -204,8 +287,14 @@ static inline void skb_headerinit(void *p, kmem_cache_t *cache,
  */
 void kfree_skbmem(struct sk_buff *skb)
 {
-	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb)))  
+	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb))) {
+#ifdef _HURD_
+		if (skb->pool)
+			skb_pool_put(skb->pool, skb->head);
+		else
+#endif
 		kfree(skb->head);
+	}
 
 	kmem_cache_free(skbuff_head_cache, skb);
 	atomic_dec(&net_skbcount);
@@ -72,19 +72,22 @@ static int loopback_xmit(struct sk_buff *skb, struct device *dev)
 	skb->ip_summed = CHECKSUM_UNNECESSARY;
 #endif
 
-	/*
-	 *	Calling netif_rx() requires locking net_bh_lock, which
-	 *	has already been done since this function is called by
-	 *	the net_bh worker thread.
-	 */
-
-	netif_rx(skb);
-
 	stats->rx_bytes+=skb->len;
 	stats->tx_bytes+=skb->len;
 	stats->rx_packets++;
 	stats->tx_packets++;
 
+	/*
+	 *	Calling netif_rx() requires locking net_bh_lock.  We are
+	 *	called holding global_lock, by RPC threads, the timer
+	 *	thread or the net_bh worker thread, but never holding
+	 *	net_bh_lock.
+	 */
+
+	pthread_mutex_lock(&net_bh_lock);
+	netif_rx(skb);
+	pthread_mutex_unlock(&net_bh_lock);
+
 	return(0);
 }
 
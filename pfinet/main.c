@@ -201,18 +201,23 @@ arrange_shutdown_notification (void)
 }
 
 
-/* Return an open device called NAME.  If NAME is 0, and there is a single
-   active device, it is returned, otherwise an error.  */
-error_t
-find_device (char *name, struct device **device)
+/* Serializes the creation of devices by find_device.  */
+static pthread_mutex_t device_setup_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Look for a device called NAME, or if NAME is 0, the single active
+   device, and return it in *DEVICE, 0 if there is no device called NAME,
+   or an error.  The caller must hold config_lock.  */
+static error_t
+lookup_device (char *name, struct device **device)
 {
   struct device *dev = dev_base;
-  char *base_name;
 
   /* Skip loopback interface. */
   assert_backtrace (dev);
   dev = dev->next;
 
+  *device = 0;
+
   if (!name)
     {
       if (dev)
@@ -233,9 +238,33 @@ find_device (char *name, struct device **device)
     if (strcmp (dev->name, name) == 0)
       {
 	*device = dev;
-	return 0;
+	break;
       }
 
+  return 0;
+}
+
+/* Return an open device called NAME.  If NAME is 0, and there is a single
+   active device, it is returned, otherwise an error.  A new device is
+   opened without holding global_lock, as that means RPCs to the device
+   and file servers; only adding it to the stack takes the lock.  */
+error_t
+find_device (char *name, struct device **device)
+{
+  char *base_name;
+  error_t err;
+
+  pthread_mutex_lock (&device_setup_lock);
+
+  pthread_rwlock_rdlock (&config_lock);
+  err = lookup_device (name, device);
+  pthread_rwlock_unlock (&config_lock);
+  if (err || *device)
+    {
+      pthread_mutex_unlock (&device_setup_lock);
+      return err;
+    }
+
   base_name = strrchr(name, '/');
   if (base_name)
     base_name++;
@@ -250,8 +279,11 @@ find_device (char *name, struct device **device)
     setup_ethernet_device (name, device);
 
   /* Turn on device. */
+  begin_config_change ();
   dev_open (*device);
+  end_config_change ();
 
+  pthread_mutex_unlock (&device_setup_lock);
   return 0;
 }
 
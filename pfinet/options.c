@@ -451,7 +451,7 @@ parse_opt (int opt, char *arg, struct argp_state *state)
 	}
       /* Successfully finished parsing, return a result.  */
 
-      pthread_mutex_lock (&global_lock);
+      begin_config_change ();
 
       for (in = h->interfaces; in < h->interfaces + h->num_interfaces; in++)
 	{
@@ -474,7 +474,7 @@ parse_opt (int opt, char *arg, struct argp_state *state)
 
 	  if (err)
 	    {
-	      pthread_mutex_unlock (&global_lock);
+	      end_config_change ();
 	      FAIL (err, 16, 0, "cannot configure interface");
 	    }
 
@@ -524,7 +524,7 @@ parse_opt (int opt, char *arg, struct argp_state *state)
 	    err = add_route (gw4_in->device, &route);
 	    if (err)
 	      {
-		pthread_mutex_unlock (&global_lock);
+		end_config_change ();
 	        FAIL (err, 17, 0, "cannot set default gateway");
 	      }
 	  }
@@ -563,12 +563,12 @@ parse_opt (int opt, char *arg, struct argp_state *state)
 	  err = add_route (in->device, &route);
 	  if (err)
 	    {
-	      pthread_mutex_unlock (&global_lock);
+	      end_config_change ();
 	      FAIL (err, 17, 0, "cannot add route");
 	    }
 	}
 
-      pthread_mutex_unlock (&global_lock);
+      end_config_change ();
 
       /* Fall through to free hook.  */
 
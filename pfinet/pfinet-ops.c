@@ -39,6 +39,7 @@
 #include <sys/mman.h>
 
 #include <sys/ioctl.h>
+#include <hurd/ioctl_types.h>
 
 #define MAX_ROUTES	255
 
@@ -56,7 +57,7 @@ S_pfinet_siocgifconf (io_t port,
   error_t err = 0;
   struct ifconf ifc;
 
-  pthread_mutex_lock (&global_lock);
+  pthread_rwlock_rdlock (&config_lock);
   if (amount == (vm_size_t) -1)
     {
       /* Get the needed buffer length.  */
@@ -65,7 +66,7 @@ S_pfinet_siocgifconf (io_t port,
       err = dev_ifconf ((char *) &ifc);
       if (err)
 	{
-	  pthread_mutex_unlock (&global_lock);
+	  pthread_rwlock_unlock (&config_lock);
 	  return -err;
 	}
       amount = ifc.ifc_len;
@@ -96,7 +97,7 @@ S_pfinet_siocgifconf (io_t port,
       *ifr = ifc.ifc_buf;
     }
 
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
 
@@ -130,7 +131,7 @@ S_pfinet_getroutes (io_t port,
   int n;
   ifrtreq_t *rtable = NULL;
 
-  pthread_mutex_lock (&global_lock);
+  pthread_rwlock_rdlock (&config_lock);
 
   if (dealloc_data)
     *dealloc_data = FALSE;
@@ -174,6 +175,128 @@ S_pfinet_getroutes (io_t port,
       *routes = (char *)rtable;
     }
 
-  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
   return err;
 }
+
+/* The packet counts of an interface when its rates were last taken.  */
+struct ifrate
+{
+  int valid;
+  unsigned long stamp;		/* in jiffies */
+  unsigned long rx_packets, tx_packets;
+  unsigned int rx_pps, tx_pps;
+};
+
+/* Indexed by ifindex.  */
+static struct ifrate *ifrates;
+static int nifrates;
+static pthread_mutex_t ifrate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Fill in the rates of R from STATS, the statistics of interface
+   IFINDEX, taking them anew if they are at least a second old.  */
+static void
+get_ifrates (int ifindex, struct net_device_stats *stats, ifstatsreq_t *r)
+{
+  unsigned long now = jiffies;
+  struct ifrate *rate;
+
+  pthread_mutex_lock (&ifrate_lock);
+
+  if (ifindex >= nifrates)
+    {
+      struct ifrate *new = realloc (ifrates, (ifindex + 1) * sizeof *new);
+      if (! new)
+	{
+	  pthread_mutex_unlock (&ifrate_lock);
+	  return;
+	}
+      memset (&new[nifrates], 0, (ifindex + 1 - nifrates) * sizeof *new);
+      ifrates = new;
+      nifrates = ifindex + 1;
+    }
+  rate = &ifrates[ifindex];
+
+  if (! rate->valid || now - rate->stamp >= HZ)
+    {
+      if (rate->valid)
+	{
+	  unsigned long elapsed = now - rate->stamp;
+	  rate->rx_pps = (stats->rx_packets - rate->rx_packets) * HZ / elapsed;
+	  rate->tx_pps = (stats->tx_packets - rate->tx_packets) * HZ / elapsed;
+	}
+      rate->valid = 1;
+      rate->stamp = now;
+      rate->rx_packets = stats->rx_packets;
+      rate->tx_packets = stats->tx_packets;
+    }
+
+  r->rx_pps = rate->rx_pps;
+  r->tx_pps = rate->tx_pps;
+
+  pthread_mutex_unlock (&ifrate_lock);
+}
+
+/* Return the statistics of all interfaces as a series of ifstatsreq_t
+   structs in STATS.  The counters are read without stopping the
+   devices, as Linux does.  */
+kern_return_t
+S_pfinet_getifstats (io_t port,
+		     data_t *stats,
+		     mach_msg_type_number_t *len,
+		     boolean_t *dealloc_data)
+{
+  struct device *dev;
+  ifstatsreq_t *r;
+  size_t n = 0;
+
+  pthread_rwlock_rdlock (&config_lock);
+
+  for (dev = dev_base; dev; dev = dev->next)
+    n++;
+
+  if (dealloc_data)
+    *dealloc_data = FALSE;
+
+  if (*len < n * sizeof (ifstatsreq_t))
+    {
+      r = (ifstatsreq_t *) mmap (0, n * sizeof (ifstatsreq_t),
+				 PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (r == MAP_FAILED)
+	{
+	  pthread_rwlock_unlock (&config_lock);
+	  *len = 0;
+	  return ENOMEM;
+	}
+      if (dealloc_data)
+	*dealloc_data = TRUE;
+    }
+  else
+    r = (ifstatsreq_t *) *stats;
+
+  *stats = (char *) r;
+  *len = n * sizeof (ifstatsreq_t);
+
+  for (dev = dev_base; dev; dev = dev->next, r++)
+    {
+      struct net_device_stats *s = dev->get_stats ? dev->get_stats (dev) : 0;
+
+      memset (r, 0, sizeof *r);
+      strncpy (r->ifname, dev->name, sizeof r->ifname - 1);
+      if (! s)
+	continue;
+
+      r->rx_packets = s->rx_packets;
+      r->rx_bytes = s->rx_bytes;
+      r->rx_errors = s->rx_errors;
+      r->rx_dropped = s->rx_dropped;
+      r->tx_packets = s->tx_packets;
+      r->tx_bytes = s->tx_bytes;
+      r->tx_errors = s->tx_errors;
+      r->tx_dropped = s->tx_dropped;
+      get_ifrates (dev->ifindex, s, r);
+    }
+
+  pthread_rwlock_unlock (&config_lock);
+  return 0;
+}
@@ -36,9 +36,33 @@
 #include <net/route.h>
 #undef _ROUTE_H
 
+/* Serializes all of the Linux protocol code, including every socket's
+   sendmsg and recvmsg, the bottom half and the timers; the stack has a
+   single lock, not one per socket.  The lock of a struct socket only
+   covers its reference count and identity port.  */
 extern pthread_mutex_t global_lock;
 extern pthread_mutex_t net_bh_lock;
 
+/* Protects the list of interfaces, their addresses and the routing
+   tables against configuration changes.  Code that only looks at them
+   needs nothing more; changes are also seen by the packet paths, which
+   run under global_lock, so they are made holding both.  */
+extern pthread_rwlock_t config_lock;
+
+static inline void
+begin_config_change (void)
+{
+  pthread_rwlock_wrlock (&config_lock);
+  pthread_mutex_lock (&global_lock);
+}
+
+static inline void
+end_config_change (void)
+{
+  pthread_mutex_unlock (&global_lock);
+  pthread_rwlock_unlock (&config_lock);
+}
+
 extern struct port_bucket *pfinet_bucket;
 extern struct port_class *addrport_class;
 extern struct port_class *socketport_class;
@@ -73,7 +97,6 @@ extern uid_t pfinet_owner;
 extern uid_t pfinet_group;
 
 void ethernet_initialize (void);
-int ethernet_demuxer (mach_msg_header_t *, mach_msg_header_t *);
 void setup_ethernet_device (char *, struct device **);
 void setup_dummy_device (char *, struct device **);
 void setup_tunnel_device (char *, struct device **);
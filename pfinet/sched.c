@@ -25,6 +25,7 @@
 
 pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t net_bh_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_rwlock_t config_lock = PTHREAD_RWLOCK_INITIALIZER;
 pthread_cond_t net_bh_wakeup = PTHREAD_COND_INITIALIZER;
 int net_bh_raised = 0;
 
@@ -47,25 +48,26 @@ sock_wake_async (struct socket *sock, int how)
    The packet receiver thread calls net/core/dev.c::netif_rx with a packet;
    netif_rx either drops the packet, or enqueues it and wakes us up
    via mark_bh which is really condition_broadcast on net_bh_wakeup.
-   The packet receiver thread holds net_bh_lock while calling netif_rx.
-   We wake up and take global_lock, which locks out RPC service threads.
-   We then also take net_bh_lock running net_bh.
-   Thus, only this thread running net_bh locks out the packet receiver
-   thread (which takes only net_bh_lock while calling netif_rx), so packets
-   are quickly moved from the Mach port's message queue to the `backlog'
-   queue, or dropped, without synchronizing with RPC service threads.
-   (The RPC service threads lock out the running of net_bh, but not
-   the queuing/dropping of packets in netif_rx.)  */
+   Whoever calls netif_rx holds net_bh_lock, which protects only the
+   `backlog' queue and net_bh_raised.  We take it just to wait for work,
+   then run net_bh holding only global_lock; net_bh takes net_bh_lock
+   again for each packet it dequeues.
+   Thus packets are quickly moved from the Mach port's message queue to
+   the `backlog' queue, or dropped, without ever waiting for the protocol
+   code, be it run by us or by RPC service threads.  net_bh gives up
+   after netdev_bh_budget packets and raises itself again, so that we
+   let go of global_lock now and then and a flood of incoming packets
+   does not lock out the RPC service threads.  */
 void *
 net_bh_worker (void *arg)
 {
-  pthread_mutex_lock (&net_bh_lock);
   while (1)
     {
+      pthread_mutex_lock (&net_bh_lock);
       while (!net_bh_raised)
         pthread_cond_wait (&net_bh_wakeup, &net_bh_lock);
-
       net_bh_raised = 0;
+      pthread_mutex_unlock (&net_bh_lock);
 
       pthread_mutex_lock (&global_lock);
       net_bh ();
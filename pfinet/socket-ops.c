@@ -24,6 +24,7 @@
 #include <stddef.h>
 #include <fcntl.h>
 #include <hurd/fshelp.h>
+#include <hurd/iohelp.h>
 
 #include "pfinet.h"
 #include "socket_S.h"
@@ -472,6 +473,49 @@ S_socket_send (struct sock_user *user,
     return (error_t)-sent;
 }
 
+/* Called by iohelp_send_file with each piece of the file.  */
+static error_t
+send_file_chunk (const void *buf, size_t len, size_t *amount, void *hook)
+{
+  struct sock_user *user = hook;
+  int sent;
+  struct iovec iov = { (void *) buf, len };
+  struct msghdr m = { msg_name: 0, msg_namelen: 0, msg_flags: 0,
+		      msg_controllen: 0, msg_iov: &iov, msg_iovlen: 1 };
+
+  pthread_mutex_lock (&global_lock);
+  become_task (user);
+  if (user->sock->flags & O_NONBLOCK)
+    m.msg_flags |= MSG_DONTWAIT;
+  sent = (*user->sock->ops->sendmsg) (user->sock, &m, len, 0);
+  pthread_mutex_unlock (&global_lock);
+
+  if (sent < 0)
+    return (error_t)-sent;
+  *amount = sent;
+  return 0;
+}
+
+kern_return_t
+S_socket_send_file (struct sock_user *user,
+		    mach_port_t file,
+		    loff_t offset,
+		    vm_size_t amount,
+		    vm_size_t *sent)
+{
+  error_t err;
+
+  if (!user)
+    return EOPNOTSUPP;
+
+  /* The data goes from the file's server into the socket buffers,
+     instead of through the client and an io_write per piece.  */
+  err = iohelp_send_file (file, offset, amount, send_file_chunk, user, sent);
+  if (!err)
+    mach_port_deallocate (mach_task_self (), file);
+  return err;
+}
+
 kern_return_t
 S_socket_recv (struct sock_user *user,
 	       mach_port_t *addrport,
@@ -52,6 +52,7 @@ sock_alloc (void)
   c = (void *) &sock[1];
   pthread_cond_init (c, NULL);
   memset (sock, 0, sizeof *sock);
+  pthread_mutex_init (&sock->lock, NULL);
   sock->state = SS_UNCONNECTED;
   sock->identity = MACH_PORT_NULL;
   sock->refcnt = 1;
@@ -66,7 +67,8 @@ sock_alloc (void)
 
 /* Create a sock_user structure, initialized from SOCK and ISROOT.
    If NOINSTALL is set, don't put it in the portset.
-   We increment SOCK->refcnt iff CONSUME is zero.  */
+   We increment SOCK->refcnt iff CONSUME is zero.  Unlike most of what
+   deals with sockets, this does not need global_lock.  */
 struct sock_user *
 make_sock_user (struct socket *sock, int isroot, int noinstall, int consume)
 {
@@ -92,18 +94,28 @@ make_sock_user (struct socket *sock, int isroot, int noinstall, int consume)
      ports (struct sock_user, aka protids) pointing to the same socket.
      The socket lives until all the ports die.  */
   if (! consume)
-    ++sock->refcnt;
+    {
+      pthread_mutex_lock (&sock->lock);
+      ++sock->refcnt;
+      pthread_mutex_unlock (&sock->lock);
+    }
   user->isroot = isroot;
   user->sock = sock;
   return user;
 }
 
 /* This is called from the port cleanup function below, and on
-   a newly allocated socket when something went wrong in its creation.  */
+   a newly allocated socket when something went wrong in its creation.
+   The caller must hold global_lock, which the last release needs.  */
 void
 sock_release (struct socket *sock)
 {
-  if (--sock->refcnt != 0)
+  int last;
+
+  pthread_mutex_lock (&sock->lock);
+  last = --sock->refcnt == 0;
+  pthread_mutex_unlock (&sock->lock);
+  if (! last)
     return;
 
   if (sock->state != SS_UNCONNECTED)
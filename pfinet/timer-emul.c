@@ -25,125 +25,101 @@
 #include <asm/system.h>
 #include <linux/sched.h>
 #include <error.h>
+#include <limits.h>
 #include <string.h>
 #include "pfinet.h"
+#include "timer-wheel.h"
 
 long long root_jiffies;
 volatile struct mapped_time_value *mapped_time;
 
-static struct timer_list *timers;
-static thread_t timer_thread = 0;
+/* The timer thread waits for messages on this port; sending one makes
+   it look at the timers again.  */
+static mach_port_t timer_port;
+
+/* Whether the timer thread is waiting: 1 until timer_wakeup, -1 until
+   it gets a message, 0 not at all.  Both locked by global_lock.  */
+static int timer_waiting;
+static unsigned long timer_wakeup;
 
 static void *
 timer_function (void *this_is_a_pointless_variable_with_a_rather_long_name)
 {
-  mach_port_t recv;
-  int wait = 0;
-
-  recv = mach_reply_port ();
-
-  timer_thread = mach_thread_self ();
+  mach_msg_header_t msg;
+  int wait;
 
   pthread_mutex_lock (&global_lock);
   while (1)
     {
-      int jiff = jiffies;
+      unsigned long jiff = jiffies;
+
+      timer_wheel_run (jiff);
 
-      if (!timers)
+      if (!timer_wheel_next (&timer_wakeup))
 	wait = -1;
-      else if (timers->expires <= jiff)
+      else if (time_before_eq (timer_wakeup, jiff))
 	wait = 0;
       else
-	wait = ((timers->expires - jiff) * 1000) / HZ;
+	{
+	  unsigned long long ms
+	    = ((unsigned long long) (timer_wakeup - jiff) * 1000) / HZ;
+	  wait = ms > INT_MAX ? INT_MAX : ms;
+	}
+      timer_waiting = wait == -1 ? -1 : wait != 0;
 
       pthread_mutex_unlock (&global_lock);
 
-      mach_msg (NULL, (MACH_RCV_MSG | MACH_RCV_INTERRUPT
+      mach_msg (&msg, (MACH_RCV_MSG | MACH_RCV_INTERRUPT
 		       | (wait == -1 ? 0 : MACH_RCV_TIMEOUT)),
-		0, 0, recv, wait, MACH_PORT_NULL);
+		0, sizeof msg, timer_port, wait, MACH_PORT_NULL);
 
       pthread_mutex_lock (&global_lock);
-
-      while (timers->expires <= jiffies)
-	{
-	  struct timer_list *tp;
-
-	  tp = timers;
-
-	  timers = timers->next;
-	  if (timers)
-	    timers->prev = &timers;
-
-	  tp->next = 0;
-	  tp->prev = 0;
-
-	  (*tp->function) (tp->data);
-	}
+      timer_waiting = 0;
     }
 
   return NULL;
 }
 
+/* Make sure the timer thread runs TIMER in time.  */
+static void
+timer_kick (struct timer_list *timer)
+{
+  mach_msg_header_t msg;
+
+  if (timer_waiting == 0
+      || (timer_waiting == 1 && time_before_eq (timer_wakeup, timer->expires)))
+    return;
+
+  /* A message stays queued if the thread is not waiting yet, and if
+     the queue is full, it already has one to wake up to.  */
+  msg.msgh_bits = MACH_MSGH_BITS (MACH_MSG_TYPE_MAKE_SEND_ONCE, 0);
+  msg.msgh_size = sizeof msg;
+  msg.msgh_remote_port = timer_port;
+  msg.msgh_local_port = MACH_PORT_NULL;
+  msg.msgh_id = 0;
+  mach_msg (&msg, MACH_SEND_MSG | MACH_SEND_TIMEOUT, sizeof msg, 0,
+	    MACH_PORT_NULL, 0, MACH_PORT_NULL);
+  timer_waiting = 1;
+  timer_wakeup = timer->expires;
+}
 
 void
 add_timer (struct timer_list *timer)
 {
-  struct timer_list **tp;
-
-  for (tp = &timers; *tp; tp = &(*tp)->next)
-    if ((*tp)->expires > timer->expires)
-      {
-	timer->next = *tp;
-	timer->next->prev = &timer->next;
-	timer->prev = tp;
-	*tp = timer;
-	break;
-      }
-  if (!*tp)
-    {
-      timer->next = 0;
-      timer->prev = tp;
-      *tp = timer;
-    }
-
-  if (timers == timer)
-    {
-      /* We have change the first one, so tweak the timer thread
-	 to push things up. */
-      while (timer_thread == 0)
-	swtch_pri (0);
-
-      if (timer_thread != mach_thread_self ())
-	{
-	  thread_suspend (timer_thread);
-	  thread_abort (timer_thread);
-	  thread_resume (timer_thread);
-	}
-    }
+  timer_wheel_add (timer);
+  timer_kick (timer);
 }
 
 int
 del_timer (struct timer_list *timer)
 {
-  if (timer->prev)
-    {
-      *timer->prev = timer->next;
-      if (timer->next)
-	timer->next->prev = timer->prev;
-
-      timer->next = 0;
-      timer->prev = 0;
-      return 1;
-    }
-  else
-    return 0;
+  return timer_wheel_del (timer);
 }
 
 void
 mod_timer (struct timer_list *timer, unsigned long expires)
 {
-  /* Should optimize this.  */
-  del_timer (timer);
+  timer_wheel_del (timer);
   timer->expires = expires;
   add_timer (timer);
 }
@@ -170,6 +146,12 @@ init_time (void)
 
   root_jiffies = (long long) tp.tv_sec * HZ
     + ((long long) tp.tv_usec * HZ) / 1000000;
+  timer_wheel_init (jiffies);
+
+  err = mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_RECEIVE,
+			    &timer_port);
+  if (err)
+    error (2, err, "cannot allocate timer port");
 
   err = pthread_create (&thread, NULL, timer_function, NULL);
   if (!err)
@@ -0,0 +1,203 @@
+/* Hierarchical timing wheel for the Linux timer emulation
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+#include "timer-wheel.h"
+
+#define TVR_BITS	8
+#define TVN_BITS	6
+#define TVR_SIZE	(1 << TVR_BITS)
+#define TVN_SIZE	(1 << TVN_BITS)
+#define TVR_MASK	(TVR_SIZE - 1)
+#define TVN_MASK	(TVN_SIZE - 1)
+#define TVN_LEVELS	4
+
+/* The shift that gives the slot number in coarse wheel N.  */
+#define TVN_SHIFT(n)	(TVR_BITS + (n) * TVN_BITS)
+
+/* Timers further away than this are treated as expiring then.  */
+#define MAX_TVAL	0xffffffffUL
+
+static struct timer_list *tv1[TVR_SIZE];
+static struct timer_list *tvn[TVN_LEVELS][TVN_SIZE];
+
+/* The next jiffy whose slot is to be run.  */
+static unsigned long timer_jiffies;
+
+/* The number of pending timers.  */
+static unsigned long pending;
+
+/* Return the slot TIMER belongs in now.  */
+static struct timer_list **
+timer_slot (struct timer_list *timer)
+{
+  unsigned long expires = timer->expires;
+  unsigned long idx = expires - timer_jiffies;
+  int n;
+
+  if ((long) idx < 0)
+    /* Already expired; run it with the next slot.  */
+    return &tv1[timer_jiffies & TVR_MASK];
+  if (idx < TVR_SIZE)
+    return &tv1[expires & TVR_MASK];
+
+  for (n = 0; n < TVN_LEVELS - 1; n++)
+    if (idx < 1UL << TVN_SHIFT (n + 1))
+      return &tvn[n][(expires >> TVN_SHIFT (n)) & TVN_MASK];
+
+  if (idx > MAX_TVAL)
+    expires = timer_jiffies + MAX_TVAL;
+  return &tvn[n][(expires >> TVN_SHIFT (n)) & TVN_MASK];
+}
+
+static void
+timer_link (struct timer_list *timer, struct timer_list **slot)
+{
+  timer->next = *slot;
+  if (timer->next)
+    timer->next->prev = &timer->next;
+  timer->prev = slot;
+  *slot = timer;
+}
+
+static void
+timer_unlink (struct timer_list *timer)
+{
+  *timer->prev = timer->next;
+  if (timer->next)
+    timer->next->prev = timer->prev;
+  timer->next = 0;
+  timer->prev = 0;
+}
+
+/* Spread the timers of the current slot of coarse wheel N over the
+   finer ones, and return the number of that slot.  */
+static int
+cascade (int n)
+{
+  int index = (timer_jiffies >> TVN_SHIFT (n)) & TVN_MASK;
+  struct timer_list *t;
+
+  while ((t = tvn[n][index]))
+    {
+      timer_unlink (t);
+      timer_link (t, timer_slot (t));
+    }
+
+  return index;
+}
+
+void
+timer_wheel_init (unsigned long now)
+{
+  timer_jiffies = now;
+}
+
+void
+timer_wheel_add (struct timer_list *timer)
+{
+  timer_link (timer, timer_slot (timer));
+  pending++;
+}
+
+int
+timer_wheel_del (struct timer_list *timer)
+{
+  if (! timer->prev)
+    return 0;
+
+  timer_unlink (timer);
+  pending--;
+  return 1;
+}
+
+void
+timer_wheel_run (unsigned long now)
+{
+  while (time_after_eq (now, timer_jiffies))
+    {
+      int index = timer_jiffies & TVR_MASK;
+      struct timer_list *work, *t;
+      int n;
+
+      if (! pending)
+	{
+	  /* Nothing to do until something is added.  */
+	  timer_jiffies = now + 1;
+	  break;
+	}
+
+      if (index == 0)
+	for (n = 0; n < TVN_LEVELS && cascade (n) == 0; n++)
+	  ;
+
+      /* Take the whole slot first, so that timers added by the
+	 functions we call land in later slots, and advance before
+	 calling them for the same reason.  */
+      work = tv1[index];
+      tv1[index] = 0;
+      if (work)
+	work->prev = &work;
+      timer_jiffies++;
+
+      while ((t = work))
+	{
+	  timer_unlink (t);
+	  pending--;
+	  (*t->function) (t->data);
+	}
+    }
+}
+
+int
+timer_wheel_next (unsigned long *when)
+{
+  unsigned long delta = MAX_TVAL;
+  int i, n;
+
+  if (! pending)
+    return 0;
+
+  for (i = 0; i < TVR_SIZE; i++)
+    if (tv1[(timer_jiffies + i) & TVR_MASK])
+      {
+	delta = i;
+	break;
+      }
+
+  /* Slot I of a coarse wheel comes up when the wheels before it have
+     all come round to it.  Its current slot is still to come only if
+     they are at zero right now.  */
+  for (n = 0; n < TVN_LEVELS; n++)
+    {
+      unsigned long base = timer_jiffies >> TVN_SHIFT (n);
+
+      i = (timer_jiffies & ((1UL << TVN_SHIFT (n)) - 1)) ? 1 : 0;
+      for (; i <= TVN_SIZE; i++)
+	if (tvn[n][(base + i) & TVN_MASK])
+	  {
+	    unsigned long d = ((base + i) << TVN_SHIFT (n)) - timer_jiffies;
+	    if (d < delta)
+	      delta = d;
+	    break;
+	  }
+    }
+
+  *when = timer_jiffies + delta;
+  return 1;
+}
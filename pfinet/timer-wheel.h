@@ -0,0 +1,52 @@
+/* Hierarchical timing wheel for the Linux timer emulation
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <linux/timer.h>
+
+/* Pending timers are kept in a wheel of 256 one-jiffy slots, followed
+   by four coarser wheels of 64 slots, each slot of which spans a whole
+   turn of the wheel before it, as in Linux 2.4.  Adding and removing
+   a timer take constant time; when the first wheel comes round, the
+   next slot of the second one is spread over it, and so on.
+
+   None of this is thread-safe; pfinet calls it holding global_lock.  */
+
+/* Start the wheel at jiffy NOW.  */
+void timer_wheel_init (unsigned long now);
+
+/* Add TIMER, which must not be pending, to the wheel.  */
+void timer_wheel_add (struct timer_list *timer);
+
+/* Remove TIMER from the wheel.  Return 1 if it was pending, else 0.  */
+int timer_wheel_del (struct timer_list *timer);
+
+/* Call the functions of all timers that expire up to jiffy NOW.  They
+   may add and remove timers.  */
+void timer_wheel_run (unsigned long now);
+
+/* If there are pending timers, set *WHEN to the jiffy at which
+   timer_wheel_run must next be called and return 1; else return 0.
+   This is when the first non-empty slot comes up, which for the
+   coarser wheels is earlier than when their timers expire.  */
+int timer_wheel_next (unsigned long *when);
+
+#endif
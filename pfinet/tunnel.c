@@ -231,7 +231,9 @@ setup_tunnel_device (char *name, struct device **device)
   /* This call adds the device to the `dev_base' chain,
      initializes its `ifindex' member (which matters!),
      and tells the protocol stacks about the device.  */
+  begin_config_change ();
   err = - register_netdevice (dev);
+  end_config_change ();
   assert_perror_backtrace (err);
 }
 
@@ -373,6 +373,14 @@ S_socket_send (struct sock_user *user, struct addr *dest_addr, int flags,
   return err;
 }
 
+/* Send part of a file over a socket.  */
+kern_return_t
+S_socket_send_file (struct sock_user *user, mach_port_t file,
+		    loff_t offset, vm_size_t amount, vm_size_t *sent)
+{
+  return EOPNOTSUPP;
+}
+
 /* Receive data from a socket, possibly including Mach ports.  */
 kern_return_t
 S_socket_recv (struct sock_user *user,
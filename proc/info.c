@@ -138,11 +138,11 @@ S_proc_task2proc (struct proc *callerp,
       error_t err;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2proc (p->p_task_namespace, t, outproc);
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
 
       if (! err)
 	{
@@ -202,11 +202,11 @@ S_proc_pid2proc (struct proc *callerp,
       error_t err;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2proc (p->p_task_namespace, p->p_task, outproc);
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
 
       if (! err)
 	{
@@ -418,13 +418,13 @@ S_proc_getprocargs (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
 	err = proc_getprocargs (p->p_task_namespace, pid_sub, buf, buflen);
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -456,13 +456,13 @@ S_proc_getprocenv (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
 	err = proc_getprocenv (p->p_task_namespace, pid_sub, buf, buflen);
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -514,7 +514,7 @@ S_proc_getprocinfo (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -539,8 +539,9 @@ S_proc_getprocinfo (struct proc *callerp,
 	  proc_pid2task (p->p_task_namespace, pi->logincollection,
 			 &t_logincollection);
 
-	  /* Reacquire the global lock for the hash table lookups.  */
-	  pthread_mutex_lock (&global_lock);
+	  /* Reacquire the global lock for the hash table lookups,
+	     exclusively as task_find may add the tasks.  */
+	  global_lock_acquire (0);
 
 	  if (MACH_PORT_VALID (t_ppid))
 	    {
@@ -578,15 +579,16 @@ S_proc_getprocinfo (struct proc *callerp,
 	  return 0;
 	}
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
       err = 0;
       /* Fallback.  */
     }
 
   task = p->p_task;
 
-  check_msgport_death (p);
-  msgport = p->p_msgport;
+  /* We may hold GLOBAL_LOCK only shared, so leave throwing away a dead
+     message port to others.  */
+  msgport = msgport_is_dead (p) ? MACH_PORT_NULL : p->p_msgport;
 
   if (*flags & PI_FETCH_THREAD_DETAILS)
     *flags |= PI_FETCH_THREADS;
@@ -632,7 +634,7 @@ S_proc_getprocinfo (struct proc *callerp,
      | (p->p_exec ? PI_EXECED : 0)
      | (p->p_waiting ? PI_WAITING : 0)
      | (!p->p_pgrp->pg_orphcnt ? PI_ORPHAN : 0)
-     | (p->p_msgport == MACH_PORT_NULL ? PI_NOMSG : 0)
+     | (msgport == MACH_PORT_NULL ? PI_NOMSG : 0)
      | (p->p_pgrp->pg_session->s_sid == p->p_pid ? PI_SESSLD : 0)
      | (owned ? 0 : PI_NOTOWNED)
      | (!p->p_parentset ? PI_NOPARENT : 0)
@@ -658,7 +660,7 @@ S_proc_getprocinfo (struct proc *callerp,
 
   /* Release GLOBAL_LOCK around time consuming bits, and more importatantly,
      potential calls to P's msgport, which can block.  */
-  pthread_mutex_unlock (&global_lock);
+  global_lock_release ();
 
   if (*flags & PI_FETCH_TASKINFO)
     {
@@ -819,11 +821,153 @@ S_proc_getprocinfo (struct proc *callerp,
     *waits_len = waits_used;
 
   /* Reacquire GLOBAL_LOCK to make the central locking code happy.  */
-  pthread_mutex_lock (&global_lock);
+  global_lock_reacquire ();
 
   return err;
 }
 
+/* This function is used as callback in S_proc_getprocinfos.  */
+static void
+add_pid (struct proc *p, void *arg)
+{
+  pid_t **pids = arg;
+  *(*pids)++ = p->p_pid;
+}
+
+/* This function is used as callback in S_proc_getprocinfos.  */
+static void
+count_pid (struct proc *p, void *arg)
+{
+  ++*(size_t *) arg;
+}
+
+/* Implement proc_getprocinfos as described in <hurd/process.defs>. */
+kern_return_t
+S_proc_getprocinfos (struct proc *callerp,
+		     const_pidarray_t pids,
+		     mach_msg_type_number_t npids,
+		     int flags,
+		     procinfo_t *procinfos,
+		     mach_msg_type_number_t *procinfoslen)
+{
+  const size_t hdr = sizeof (struct procinfo_record) / sizeof (int);
+  pid_t *all = NULL;
+  int *buf = NULL;		/* The records so far, mmapped.  */
+  size_t buf_len = 0, used = 0;	/* In ints.  */
+  int *pi;			/* One process's procinfo.  */
+  mach_msg_type_number_t pi_max, pi_len;
+  error_t err = 0;
+  size_t i;
+
+  /* No need to check CALLERP here; we don't use it. */
+
+  /* Asking for the waits of threads may block.  */
+  flags &= ~PI_FETCH_THREAD_WAITS;
+
+  if (npids == 0)
+    {
+      size_t n = 0;
+      pid_t *end;
+
+      prociterate (count_pid, &n);
+      all = end = malloc (n * sizeof *all);
+      if (n > 0 && ! all)
+	return ENOMEM;
+      prociterate (add_pid, &end);
+      pids = all;
+      npids = n;
+    }
+
+  /* Enough for most processes.  */
+  pi_max = (sizeof (struct procinfo)
+	    + 8 * sizeof (((struct procinfo *) 0)->threadinfos[0]))
+	   / sizeof (int);
+  pi = malloc (pi_max * sizeof (int));
+  if (! pi)
+    {
+      free (all);
+      return ENOMEM;
+    }
+
+  for (i = 0; i < npids && ! err; i++)
+    {
+      struct procinfo_record *rec;
+      int *p = pi, pi_flags = flags;
+      data_t waits = NULL;
+      mach_msg_type_number_t waits_len = 0;
+      size_t p_size = 0;	/* In bytes, if P was allocated.  */
+      error_t pi_err;
+
+      pi_len = pi_max;
+      /* This may release GLOBAL_LOCK for a while, so PIDS[I] may be gone
+	 by now, or go meanwhile.  */
+      pi_err = S_proc_getprocinfo (callerp, pids[i], &pi_flags,
+				   &p, &pi_len, &waits, &waits_len);
+      if (pi_err)
+	pi_len = 0;
+      else if (p != pi)
+	/* S_proc_getprocinfo had to allocate more room.  */
+	p_size = pi_len * sizeof (int);
+      if (! pi_err && waits_len > 0)
+	munmap (waits, waits_len);
+
+      if (used + hdr + pi_len > buf_len)
+	{
+	  size_t new_len = round_page ((used + hdr + pi_len) * 2
+				       * sizeof (int)) / sizeof (int);
+	  int *new = mmap (0, new_len * sizeof (int), PROT_READ|PROT_WRITE,
+			   MAP_ANON, 0, 0);
+	  if (new == MAP_FAILED)
+	    err = ENOMEM;
+	  else
+	    {
+	      if (buf)
+		{
+		  memcpy (new, buf, used * sizeof (int));
+		  munmap (buf, buf_len * sizeof (int));
+		}
+	      buf = new;
+	      buf_len = new_len;
+	    }
+	}
+
+      if (! err)
+	{
+	  rec = (struct procinfo_record *) (buf + used);
+	  rec->size = hdr + pi_len;
+	  rec->pid = pids[i];
+	  rec->flags = pi_flags;
+	  rec->error = pi_err;
+	  memcpy (buf + used + hdr, p, pi_len * sizeof (int));
+	  used += hdr + pi_len;
+	}
+
+      if (p_size)
+	munmap (p, p_size);
+    }
+
+  free (pi);
+  free (all);
+
+  if (err)
+    {
+      if (buf)
+	munmap (buf, buf_len * sizeof (int));
+      return err;
+    }
+
+  if (used <= *procinfoslen)
+    {
+      memcpy (*procinfos, buf, used * sizeof (int));
+      if (buf)
+	munmap (buf, buf_len * sizeof (int));
+    }
+  else
+    *procinfos = buf;
+  *procinfoslen = used;
+  return 0;
+}
+
 /* Implement proc_make_login_coll as described in <hurd/process.defs>. */
 kern_return_t
 S_proc_make_login_coll (struct proc *p)
@@ -855,7 +999,7 @@ S_proc_getloginid (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -864,7 +1008,7 @@ S_proc_getloginid (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (p->p_task_namespace, leader, 1);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -905,7 +1049,7 @@ S_proc_getloginpids (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (l->p_task_namespace, l->p_task, &pid_sub);
       if (! err)
@@ -914,7 +1058,7 @@ S_proc_getloginpids (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (l->p_task_namespace, *pids, *npids);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
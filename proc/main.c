@@ -57,6 +57,42 @@ struct proc *kernel_proc;
 
 pthread_mutex_t global_lock;
 
+/* The process RPCs that only look at our state, by message ID less
+   24000, as numbered in process.defs.  */
+static const char shared_rpcs[] =
+  {
+    [5] = 1,			/* proc_getallpids */
+    [16] = 1,			/* proc_getpids */
+    [18] = 1,			/* proc_get_arg_locations */
+    [29] = 1,			/* proc_pid2task */
+    [32] = 1,			/* proc_proc2task */
+    [33] = 1,			/* proc_pid2proc */
+    [34] = 1,			/* proc_getprocinfo */
+    [35] = 1,			/* proc_getprocargs */
+    [36] = 1,			/* proc_getprocenv */
+    [38] = 1,			/* proc_getloginid */
+    [39] = 1,			/* proc_getloginpids */
+    [41] = 1,			/* proc_getlogin */
+    [43] = 1,			/* proc_getsid */
+    [44] = 1,			/* proc_getsessionpgids */
+    [45] = 1,			/* proc_getsessionpids */
+    [48] = 1,			/* proc_getpgrp */
+    [49] = 1,			/* proc_getpgrppids */
+    [51] = 1,			/* proc_getnports */
+    [54] = 1,			/* proc_is_important */
+    [56] = 1,			/* proc_get_code */
+    [59] = 1,			/* proc_get_exe */
+    [61] = 1,			/* proc_get_entry */
+    [66] = 1,			/* proc_getprocinfos */
+  };
+
+static int
+rpc_is_shared (mach_msg_id_t id)
+{
+  id -= 24000;
+  return id >= 0 && id < sizeof shared_rpcs && shared_rpcs[id];
+}
+
 int
 message_demuxer (mach_msg_header_t *inp,
 		 mach_msg_header_t *outp)
@@ -68,9 +104,9 @@ message_demuxer (mach_msg_header_t *inp,
       (routine = proc_exc_server_routine (inp)) ||
       (routine = task_notify_server_routine (inp)))
     {
-      pthread_mutex_lock (&global_lock);
+      global_lock_acquire (rpc_is_shared (inp->msgh_id));
       (*routine) (inp, outp);
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
       return TRUE;
     }
   else
@@ -80,6 +116,90 @@ message_demuxer (mach_msg_header_t *inp,
 pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
 int startup_fallback;
 
+/* GLOBAL_LOCK is held exclusively by holding the mutex while no thread
+   holds it shared.  Those that do are counted in GLOBAL_READERS, and do
+   not keep the mutex.  Threads that have the mutex and wait for them to
+   be done are counted in GLOBAL_WRITERS, and keep more from coming in
+   meanwhile.  Both are protected by the mutex.  */
+static int global_readers;
+static int global_writers;
+static pthread_cond_t global_readers_done = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t global_writers_done = PTHREAD_COND_INITIALIZER;
+
+/* Whether this thread holds GLOBAL_LOCK shared, or did last.  */
+static __thread int holding_shared;
+
+/* Wait for the threads holding GLOBAL_LOCK shared to be done.  The
+   mutex must be held.  */
+static void
+wait_for_readers (void)
+{
+  global_writers++;
+  while (global_readers > 0)
+    pthread_cond_wait (&global_readers_done, &global_lock);
+  if (--global_writers == 0)
+    pthread_cond_broadcast (&global_writers_done);
+}
+
+/* Acquire GLOBAL_LOCK, shared if SHARED.  */
+void
+global_lock_acquire (int shared)
+{
+  pthread_mutex_lock (&global_lock);
+  holding_shared = shared;
+  if (shared)
+    {
+      while (global_writers > 0)
+	pthread_cond_wait (&global_writers_done, &global_lock);
+      global_readers++;
+      pthread_mutex_unlock (&global_lock);
+    }
+  else
+    wait_for_readers ();
+}
+
+/* Release GLOBAL_LOCK, however this thread holds it.  */
+void
+global_lock_release (void)
+{
+  if (holding_shared)
+    {
+      pthread_mutex_lock (&global_lock);
+      if (--global_readers == 0 && global_writers > 0)
+	pthread_cond_broadcast (&global_readers_done);
+    }
+  pthread_mutex_unlock (&global_lock);
+}
+
+/* Acquire GLOBAL_LOCK again the way this thread held it before calling
+   global_lock_release.  */
+void
+global_lock_reacquire (void)
+{
+  global_lock_acquire (holding_shared);
+}
+
+/* Return whether this thread holds GLOBAL_LOCK shared.  */
+int
+global_lock_shared (void)
+{
+  return holding_shared;
+}
+
+/* Wait on COND, releasing GLOBAL_LOCK, which this thread must hold
+   exclusively, meanwhile.  Return whether the wait was cancelled, as
+   pthread_hurd_cond_wait_np.  */
+int
+global_lock_cond_wait (pthread_cond_t *cond)
+{
+  int cancel;
+
+  assert_backtrace (! holding_shared);
+  cancel = pthread_hurd_cond_wait_np (cond, &global_lock);
+  wait_for_readers ();
+  return cancel;
+}
+
 error_t
 increase_priority (void)
 {
@@ -130,7 +130,7 @@ S_proc_reauthenticate (struct proc *p, mach_port_t rendport)
   assert_backtrace (prev == MACH_PORT_NULL);
 
   /* Release the global lock while blocking on the auth server and client.  */
-  pthread_mutex_unlock (&global_lock);
+  global_lock_release ();
 
   do
     err = auth_server_authenticate (authserver,
@@ -151,7 +151,7 @@ S_proc_reauthenticate (struct proc *p, mach_port_t rendport)
       err = mach_msg_receive (&msg);
     }
 
-  pthread_mutex_lock (&global_lock);
+  global_lock_reacquire ();
 
   if (err)
     goto out;
@@ -393,7 +393,7 @@ S_proc_reauthenticate_reassign (struct proc *p,
      *any changes* to these two processes.  */
 
   /* Release the lock while talking to the auth server.  */
-  pthread_mutex_unlock (&global_lock);
+  global_lock_release ();
 
   do
     err = auth_server_authenticate (authserver,
@@ -416,7 +416,7 @@ S_proc_reauthenticate_reassign (struct proc *p,
       err = mach_msg_receive (&msg);
     }
 
-  pthread_mutex_lock (&global_lock);
+  global_lock_reacquire ();
 
   if (err)
     goto out;
@@ -774,7 +774,15 @@ S_proc_getallpids (struct proc *p,
 
   /* No need to check P here; we don't use it. */
 
-  add_tasks (0);
+  /* Taking on tasks we don't know about needs GLOBAL_LOCK exclusively,
+     but it is seldom there are any.  */
+  if (global_lock_shared () && tasks_unknown ())
+    {
+      global_lock_release ();
+      global_lock_acquire (0);
+    }
+  if (! global_lock_shared ())
+    add_tasks (0);
 
   nprocs = 0;
   prociterate (count_up, &nprocs);
@@ -966,7 +974,7 @@ namespace_is_subprocess (struct proc *p)
    process space.
 
    Conditions: global_lock is unlocked before calling, and is locked
-   afterwards.  */
+   afterwards, the way it was before.  */
 error_t
 namespace_translate_pids (mach_port_t namespace, pid_t *pids, size_t pids_len)
 {
@@ -976,7 +984,7 @@ namespace_translate_pids (mach_port_t namespace, pid_t *pids, size_t pids_len)
   tasks = calloc (pids_len, sizeof *tasks);
   if (tasks == NULL)
     {
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
       return ENOMEM;
     }
 
@@ -984,7 +992,7 @@ namespace_translate_pids (mach_port_t namespace, pid_t *pids, size_t pids_len)
     /* We handle errors by checking each returned task.  */
     proc_pid2task (namespace, pids[i], &tasks[i]);
 
-  pthread_mutex_lock (&global_lock);
+  global_lock_reacquire ();
 
   for (i = 0; i < pids_len; i++)
     if (MACH_PORT_VALID (tasks[i]))
@@ -1162,14 +1170,17 @@ complete_exit (struct proc *p)
 
 /* Get the list of all tasks from the kernel and start adding them.
    If we encounter TASK, then don't do any more and return its proc.
-   If TASK is null or we never find it, then return 0. */
-struct proc *
-add_tasks (task_t task)
+   If TASK is null or we never find it, then return 0.  If UNKNOWN is
+   not null, add nothing, but stop at the first task we don't know
+   and set *UNKNOWN.  */
+static struct proc *
+scan_tasks (task_t task, int *unknown)
 {
   mach_port_t *psets;
   mach_msg_type_number_t npsets;
   int i;
   struct proc *foundp = 0;
+  int done = 0;
 
   host_processor_sets (mach_host_self (), &psets, &npsets);
   for (i = 0; i < npsets; i++)
@@ -1179,7 +1190,7 @@ add_tasks (task_t task)
       mach_msg_type_number_t ntasks;
       int j;
 
-      if (!foundp)
+      if (!done)
 	{
 	  host_processor_set_priv (_hurd_host_priv, psets[i], &psetpriv);
 	  processor_set_tasks (psetpriv, &tasks, &ntasks);
@@ -1192,17 +1203,22 @@ add_tasks (task_t task)
 	      if (! MACH_PORT_VALID (tasks[j]))
 		continue;
 
-	      if (!foundp)
+	      if (!done)
 		{
 		  struct proc *p = task_find_nocreate (tasks[j]);
-		  if (!p)
+		  if (!p && unknown)
+		    *unknown = done = 1;
+		  else if (!p)
 		    {
 		      p = new_proc (tasks[j]);
 		      if (p)
 			set = 1;
 		    }
-		  if (!foundp && tasks[j] == task)
-		    foundp = p;
+		  if (!done && tasks[j] == task)
+		    {
+		      foundp = p;
+		      done = foundp != 0;
+		    }
 		}
 	      if (!set)
 		mach_port_deallocate (mach_task_self (), tasks[j]);
@@ -1216,6 +1232,22 @@ add_tasks (task_t task)
   return foundp;
 }
 
+struct proc *
+add_tasks (task_t task)
+{
+  return scan_tasks (task, 0);
+}
+
+/* Return nonzero if the kernel has tasks we don't know about, which
+   add_tasks would add.  Only needs GLOBAL_LOCK shared.  */
+int
+tasks_unknown (void)
+{
+  int unknown = 0;
+  scan_tasks (MACH_PORT_NULL, &unknown);
+  return unknown;
+}
+
 /* Allocate a new unused PID.
    (Unused means it is neither the pid nor pgrp of any relevant data.) */
 int
@@ -96,10 +96,9 @@ check_message_dying (struct proc *p, struct proc *dyingp)
     }
 }
 
-/* Check if the message port of process P has died.  Return nonzero if
-   this has indeed happened.  */
+/* Return nonzero if process P has a message port, and it has died.  */
 int
-check_msgport_death (struct proc *p)
+msgport_is_dead (struct proc *p)
 {
   /* Only check if the message port passed away, if we know that it
      was ever alive.  */
@@ -110,13 +109,24 @@ check_msgport_death (struct proc *p)
 
       err = mach_port_type (mach_task_self (), p->p_msgport, &type);
       if (err || (type & MACH_PORT_TYPE_DEAD_NAME))
-	{
-	  /* The port appears to be dead; throw it away. */
-	  mach_port_deallocate (mach_task_self (), p->p_msgport);
-	  p->p_msgport = MACH_PORT_NULL;
-	  p->p_deadmsg = 1;
-	  return 1;
-	}
+	return 1;
+    }
+
+  return 0;
+}
+
+/* Check if the message port of process P has died.  Return nonzero if
+   this has indeed happened.  */
+int
+check_msgport_death (struct proc *p)
+{
+  if (msgport_is_dead (p))
+    {
+      /* The port appears to be dead; throw it away. */
+      mach_port_deallocate (mach_task_self (), p->p_msgport);
+      p->p_msgport = MACH_PORT_NULL;
+      p->p_deadmsg = 1;
+      return 1;
     }
 
   return 0;
@@ -145,13 +155,13 @@ S_proc_getmsgport (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
         err = proc_getmsgport (p->p_task_namespace, pid_sub, msgport);
 
-      pthread_mutex_lock (&global_lock);
+      global_lock_reacquire ();
 
       if (! err)
 	{
@@ -167,7 +177,7 @@ S_proc_getmsgport (struct proc *callerp,
     {
       callerp->p_msgportwait = 1;
       p->p_checkmsghangs = 1;
-      cancel = pthread_hurd_cond_wait_np (&callerp->p_wakeup, &global_lock);
+      cancel = global_lock_cond_wait (&callerp->p_wakeup);
       if (callerp->p_dead)
 	return EOPNOTSUPP;
       if (cancel)
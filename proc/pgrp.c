@@ -154,7 +154,7 @@ S_proc_getsid (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -163,7 +163,7 @@ S_proc_getsid (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (p->p_task_namespace, sid, 1);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -199,7 +199,7 @@ S_proc_getsessionpids (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -208,7 +208,7 @@ S_proc_getsessionpids (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (p->p_task_namespace, *pids, *npidsp);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -270,7 +270,7 @@ S_proc_getsessionpgids (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -279,7 +279,7 @@ S_proc_getsessionpgids (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (p->p_task_namespace, *pgids, *npgidsp);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -335,7 +335,7 @@ S_proc_getpgrppids (struct proc *callerp,
       pid_t pid_sub;
 
       /* Release global lock while talking to the other proc server.  */
-      pthread_mutex_unlock (&global_lock);
+      global_lock_release ();
 
       err = proc_task2pid (p->p_task_namespace, p->p_task, &pid_sub);
       if (! err)
@@ -344,7 +344,7 @@ S_proc_getpgrppids (struct proc *callerp,
 	/* Acquires global_lock.  */
 	err = namespace_translate_pids (p->p_task_namespace, *pids, *npidsp);
       else
-	pthread_mutex_lock (&global_lock);
+	global_lock_reacquire ();
 
       if (! err)
 	return 0;
@@ -153,7 +153,16 @@ extern struct port_class *exc_class;
 extern mach_port_t generic_port;	/* messages not related to a specific proc */
 extern struct proc *kernel_proc;
 
+/* GLOBAL_LOCK protects all of our state.  The RPCs that only look at
+   it hold it shared, and run at the same time as each other; the rest
+   hold it exclusively.  A thread holding it shared must change nothing,
+   and to do so must release it and acquire it exclusively.  */
 extern pthread_mutex_t global_lock;
+void global_lock_acquire (int shared);
+void global_lock_release (void);
+void global_lock_reacquire (void);
+int global_lock_shared (void);
+int global_lock_cond_wait (pthread_cond_t *);
 
 extern int startup_fallback;	/* (ab)use /hurd/startup's message port */
 
@@ -171,6 +180,7 @@ void abort_getmsgport (struct proc *);
 int zombie_check_pid (pid_t);
 void check_message_dying (struct proc *, struct proc *);
 int check_msgport_death (struct proc *);
+int msgport_is_dead (struct proc *);
 void check_dead_execdata_notify (mach_port_t);
 
 void add_proc_to_hash (struct proc *);
@@ -193,6 +203,7 @@ struct session *session_find (pid_t);
 void exc_clean (void *);
 
 struct proc *add_tasks (task_t);
+int tasks_unknown (void);
 int pidfree (pid_t);
 
 struct proc *create_init_proc (void);
@@ -250,7 +250,7 @@ S_proc_waitid (struct proc *p,
     return EWOULDBLOCK;
 
   p->p_waiting = 1;
-  cancel = pthread_hurd_cond_wait_np (&p->p_wakeup, &global_lock);
+  cancel = global_lock_cond_wait (&p->p_wakeup);
   if (p->p_dead)
     return EOPNOTSUPP;
   if (cancel)
@@ -37,16 +37,19 @@ int opt_clk_tck;
 mode_t opt_stat_mode;
 pid_t opt_kernel_pid;
 uid_t opt_anon_owner;
+int opt_cache_ttl;
 
 /* Default values */
 #define OPT_CLK_TCK    sysconf(_SC_CLK_TCK)
 #define OPT_STAT_MODE  0400
 #define OPT_KERNEL_PID HURD_PID_KERNEL
 #define OPT_ANON_OWNER 0
+#define OPT_CACHE_TTL  0
 
 #define NODEV_KEY  -1 /* <= 0, so no short option. */
 #define NOEXEC_KEY -2 /* Likewise. */
 #define NOSUID_KEY -3 /* Likewise. */
+#define CACHE_TTL_KEY -4 /* Likewise. */
 
 static void set_compatibility_options (void)
 {
@@ -107,6 +110,15 @@ argp_parser (int key, char *arg, struct argp_state *state)
 	opt_anon_owner = v;
       break;
 
+    case CACHE_TTL_KEY:
+      v = strtol (arg, &endp, 0);
+      if (*endp || ! *arg || v < 0)
+	argp_error (state, "--cache-ttl: MSEC should be a non-negative "
+		    "integer");
+      else
+	opt_cache_ttl = v;
+      break;
+
     case NODEV_KEY:
       /* Ignored for compatibility with Linux' procfs. */
       break;
@@ -156,6 +168,11 @@ struct argp_option common_options[] = {
       "Be aware that USER will be granted access to the environment and "
       "other sensitive information about the processes in question.  "
       "(default: use uid " STR (OPT_ANON_OWNER) ")" },
+  { "cache-ttl", CACHE_TTL_KEY, "MSEC", 0,
+      "Keep the contents of files for MSEC milliseconds, so that reading "
+      "them again meanwhile, even through a new open, is cheap.  "
+      "Those about a process are dropped as soon as it exits.  "
+      "(default: " STR (OPT_CACHE_TTL) ", do not keep them)" },
   { "nodev", NODEV_KEY, NULL, 0,
       "Ignored for compatibility with Linux' procfs." },
   { "noexec", NOEXEC_KEY, NULL, 0,
@@ -245,6 +262,9 @@ netfs_append_args (char **argz, size_t *argz_len)
   FOPT (opt_kernel_pid, OPT_KERNEL_PID,
         "--kernel-process=%d", opt_kernel_pid);
 
+  FOPT (opt_cache_ttl, OPT_CACHE_TTL,
+        "--cache-ttl=%d", opt_cache_ttl);
+
 #undef FOPT
 
   if (! err)
@@ -294,6 +314,7 @@ int main (int argc, char **argv)
   opt_stat_mode = OPT_STAT_MODE;
   opt_kernel_pid = OPT_KERNEL_PID;
   opt_anon_owner = OPT_ANON_OWNER;
+  opt_cache_ttl = OPT_CACHE_TTL;
   err = argp_parse (&argp, argc, argv, 0, 0, 0);
   if (err)
     error (1, err, "Could not parse command line");
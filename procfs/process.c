@@ -19,7 +19,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <hurd/process.h>
 #include <hurd/resource.h>
 #include <mach/vm_param.h>
@@ -94,8 +98,12 @@ static int args_filename_length (const char *name)
 
 /* Actual content generators */
 
+/* Enough for the ones using procfs_printf to fill in the buffer procfs
+   offers them.  */
+#define PROCESS_GC_LENGTH 512
+
 static ssize_t
-process_file_gc_exe (struct proc_stat *ps, char **contents)
+process_file_gc_exe (struct proc_stat *ps, char **contents, ssize_t size)
 {
   if (proc_stat_exe_len (ps) == 0)
     {
@@ -108,21 +116,21 @@ process_file_gc_exe (struct proc_stat *ps, char **contents)
 }
 
 static ssize_t
-process_file_gc_cmdline (struct proc_stat *ps, char **contents)
+process_file_gc_cmdline (struct proc_stat *ps, char **contents, ssize_t size)
 {
   *contents = proc_stat_args(ps);
   return proc_stat_args_len(ps);
 }
 
 static ssize_t
-process_file_gc_environ (struct proc_stat *ps, char **contents)
+process_file_gc_environ (struct proc_stat *ps, char **contents, ssize_t size)
 {
   *contents = proc_stat_env(ps);
   return proc_stat_env_len(ps);
 }
 
 static ssize_t
-process_file_gc_maps (struct proc_stat *ps, char **contents)
+process_file_gc_maps (struct proc_stat *ps, char **contents, ssize_t buf_size)
 {
   error_t err;
   FILE *s;
@@ -216,7 +224,7 @@ process_file_gc_maps (struct proc_stat *ps, char **contents)
 }
 
 static ssize_t
-process_file_gc_stat (struct proc_stat *ps, char **contents)
+process_file_gc_stat (struct proc_stat *ps, char **contents, ssize_t size)
 {
   struct procinfo *pi = proc_stat_proc_info (ps);
   task_basic_info_t tbi = proc_stat_task_basic_info (ps);
@@ -255,7 +263,7 @@ process_file_gc_stat (struct proc_stat *ps, char **contents)
 
   /* See proc(5) for more information about the contents of each field for the
      Linux procfs.  */
-  return asprintf (contents,
+  return procfs_printf (contents, size,
       "%d (%.*s) %c "		/* pid, command, state */
       "%d %d %d "		/* ppid, pgid, session */
       "%d %d "			/* controlling tty stuff */
@@ -302,23 +310,23 @@ process_file_gc_stat (struct proc_stat *ps, char **contents)
 }
 
 static ssize_t
-process_file_gc_statm (struct proc_stat *ps, char **contents)
+process_file_gc_statm (struct proc_stat *ps, char **contents, ssize_t size)
 {
   task_basic_info_t tbi = proc_stat_task_basic_info (ps);
 
-  return asprintf (contents,
+  return procfs_printf (contents, size,
       "%lu %lu 0 0 0 0 0\n",
       tbi->virtual_size  / sysconf(_SC_PAGE_SIZE),
       tbi->resident_size / sysconf(_SC_PAGE_SIZE));
 }
 
 static ssize_t
-process_file_gc_status (struct proc_stat *ps, char **contents)
+process_file_gc_status (struct proc_stat *ps, char **contents, ssize_t size)
 {
   task_basic_info_t tbi = proc_stat_task_basic_info (ps);
   const char *fn = args_filename (proc_stat_args (ps));
 
-  return asprintf (contents,
+  return procfs_printf (contents, size,
       "Name:\t%.*s\n"
       "State:\t%s\n"
       "Tgid:\t%u\n"
@@ -359,8 +367,15 @@ struct process_file_desc
 
   /* Content generator to use for this file.  Once we have acquired the
      necessary information, there can be only memory allocation errors,
-     hence this simplified signature.  */
-  ssize_t (*get_contents) (struct proc_stat *ps, char **contents);
+     hence this simplified signature.  If SIZE is positive, *CONTENTS is
+     a buffer of that many bytes, which it may fill in (see
+     procfs_printf).  */
+  ssize_t (*get_contents) (struct proc_stat *ps, char **contents,
+			   ssize_t size);
+
+  /* The generator formats the contents with procfs_printf, which is worth
+     offering a buffer to.  */
+  int formatted;
 
   /* The cmdline and environ contents don't need any cleaning since they
      point directly into the proc_stat structure.  */
@@ -391,10 +406,31 @@ process_file_get_contents (void *hook, char **contents, ssize_t *contents_len)
     return EIO;
 
   /* Call the actual content generator (see the definitions below).  */
-  *contents_len = file->desc->get_contents (file->ps, contents);
+  *contents_len = file->desc->get_contents (file->ps, contents,
+					    *contents_len);
   return 0;
 }
 
+/* Return a reference to the task of the process, for procfs not to keep
+   the contents once it is gone.  */
+static mach_port_t
+process_file_get_task (void *hook)
+{
+  struct process_file_node *file = hook;
+  task_t task;
+
+  if (proc_stat_set_flags (file->ps, PSTAT_TASK)
+      || ! (proc_stat_flags (file->ps) & PSTAT_TASK))
+    return MACH_PORT_NULL;
+
+  task = proc_stat_task (file->ps);
+  if (! MACH_PORT_VALID (task)
+      || mach_port_mod_refs (mach_task_self (), task,
+			     MACH_PORT_RIGHT_SEND, 1))
+    return MACH_PORT_NULL;
+  return task;
+}
+
 static void
 process_file_cleanup_contents (void *hook, char *contents, ssize_t len)
 {
@@ -410,6 +446,14 @@ process_file_make_node (void *dir_hook, const void *entry_hook)
   static const struct procfs_node_ops ops = {
     .get_contents = process_file_get_contents,
     .cleanup_contents = process_file_cleanup_contents,
+    .get_task = process_file_get_task,
+    .cleanup = free,
+  };
+  static const struct procfs_node_ops formatted_ops = {
+    .get_contents = process_file_get_contents,
+    .cleanup_contents = process_file_cleanup_contents,
+    .needed_length = PROCESS_GC_LENGTH,
+    .get_task = process_file_get_task,
     .cleanup = free,
   };
   struct process_file_node *f;
@@ -422,7 +466,7 @@ process_file_make_node (void *dir_hook, const void *entry_hook)
   f->desc = entry_hook;
   f->ps = dir_hook;
 
-  np = procfs_make_node (&ops, f);
+  np = procfs_make_node (f->desc->formatted ? &formatted_ops : &ops, f);
   if (! np)
     return NULL;
 
@@ -495,6 +539,7 @@ static struct procfs_dir_entry entries[] = {
     .name = "stat",
     .hook = & (struct process_file_desc) {
       .get_contents = process_file_gc_stat,
+      .formatted = 1,
       .needs = PSTAT_PID | PSTAT_ARGS | PSTAT_STATE | PSTAT_PROC_INFO
 	| PSTAT_TASK | PSTAT_TASK_BASIC | PSTAT_THREAD_BASIC
 	| PSTAT_THREAD_SCHED | PSTAT_THREAD_WAIT,
@@ -507,6 +552,7 @@ static struct procfs_dir_entry entries[] = {
     .name = "statm",
     .hook = & (struct process_file_desc) {
       .get_contents = process_file_gc_statm,
+      .formatted = 1,
       .needs = PSTAT_TASK_BASIC,
     },
   },
@@ -514,6 +560,7 @@ static struct procfs_dir_entry entries[] = {
     .name = "status",
     .hook = & (struct process_file_desc) {
       .get_contents = process_file_gc_status,
+      .formatted = 1,
       .needs = PSTAT_PID | PSTAT_ARGS | PSTAT_STATE | PSTAT_PROC_INFO
         | PSTAT_TASK_BASIC | PSTAT_OWNER_UID | PSTAT_NUM_THREADS,
     },
@@ -521,6 +568,118 @@ static struct procfs_dir_entry entries[] = {
   {}
 };
 
+/* Listing the process directory gets the procinfo of every process with
+   a single proc_getprocinfos, and keeps it for a while, so that looking
+   each process up next, as ps and top do, does not take a call to the
+   proc server each.  The procinfo may thus be that old, which is as good
+   as a listing that old.  */
+
+#define SNAPSHOT_TTL	1	/* seconds */
+
+static struct
+{
+  pthread_rwlock_t lock;
+  struct ps_context *pc;
+  procinfo_t procinfos;		/* vm_alloced */
+  mach_msg_type_number_t procinfos_len;
+  int pi_flags;
+  /* The records in PROCINFOS, sorted by pid.  */
+  const struct procinfo_record **index;
+  size_t num;
+  struct timespec taken;
+} snapshot = { .lock = PTHREAD_RWLOCK_INITIALIZER };
+
+static int
+compare_records (const void *a, const void *b)
+{
+  const struct procinfo_record *const *ra = a, *const *rb = b;
+  return ((*ra)->pid > (*rb)->pid) - ((*ra)->pid < (*rb)->pid);
+}
+
+/* Return whether SNAPSHOT, which must be locked, is recent enough.  */
+static int
+snapshot_fresh (struct ps_context *pc)
+{
+  struct timespec now;
+
+  if (! snapshot.index || snapshot.pc != pc)
+    return 0;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec - snapshot.taken.tv_sec < SNAPSHOT_TTL
+    || (now.tv_sec - snapshot.taken.tv_sec == SNAPSHOT_TTL
+	&& now.tv_nsec < snapshot.taken.tv_nsec);
+}
+
+/* Return the record in SNAPSHOT, which must be locked, for PID, or NULL.  */
+static const struct procinfo_record *
+snapshot_find (pid_t pid)
+{
+  struct procinfo_record key = { .pid = pid };
+  const struct procinfo_record *k = &key, **found;
+
+  found = bsearch (&k, snapshot.index, snapshot.num, sizeof *snapshot.index,
+		   compare_records);
+  return found ? *found : NULL;
+}
+
+error_t
+process_list_pids (struct ps_context *pc, pid_t **pids, size_t *num_pids)
+{
+  procinfo_t procinfos;
+  mach_msg_type_number_t procinfos_len;
+  const struct procinfo_record **index;
+  size_t num = 0, off, i;
+  int pi_flags;
+  error_t err;
+
+  err = ps_context_get_procinfos (pc, NULL, 0, PSTAT_OWNER_UID, &pi_flags,
+				  &procinfos, &procinfos_len);
+  if (err)
+    return err;
+
+  for (off = 0; off < procinfos_len; num++)
+    off += ((struct procinfo_record *) (procinfos + off))->size;
+
+  index = malloc (num * sizeof *index);
+  *pids = malloc (num * sizeof **pids);
+  if (num > 0 && (! index || ! *pids))
+    {
+      free (index);
+      free (*pids);
+      munmap (procinfos, procinfos_len * sizeof (int));
+      return ENOMEM;
+    }
+
+  for (off = 0, i = 0; off < procinfos_len; i++)
+    {
+      index[i] = (struct procinfo_record *) (procinfos + off);
+      off += index[i]->size;
+    }
+  qsort (index, num, sizeof *index, compare_records);
+
+  *num_pids = 0;
+  for (i = 0; i < num; i++)
+    if (! index[i]->error)
+      (*pids)[(*num_pids)++] = index[i]->pid;
+
+  pthread_rwlock_wrlock (&snapshot.lock);
+  if (snapshot.index)
+    {
+      free (snapshot.index);
+      munmap (snapshot.procinfos, snapshot.procinfos_len * sizeof (int));
+    }
+  snapshot.pc = pc;
+  snapshot.procinfos = procinfos;
+  snapshot.procinfos_len = procinfos_len;
+  snapshot.pi_flags = pi_flags;
+  snapshot.index = index;
+  snapshot.num = num;
+  clock_gettime (CLOCK_MONOTONIC, &snapshot.taken);
+  pthread_rwlock_unlock (&snapshot.lock);
+
+  return 0;
+}
+
 error_t
 process_lookup_pid (struct ps_context *pc, pid_t pid, struct node **np)
 {
@@ -541,7 +700,16 @@ process_lookup_pid (struct ps_context *pc, pid_t pid, struct node **np)
   if (err)
     return EIO;
 
+  pthread_rwlock_rdlock (&snapshot.lock);
+  if (snapshot_fresh (pc))
+    {
+      const struct procinfo_record *rec = snapshot_find (pid);
+      if (rec && ! rec->error)
+	proc_stat_set_procinfo (ps, rec, snapshot.pi_flags);
+    }
   err = proc_stat_set_flags (ps, PSTAT_OWNER_UID);
+  pthread_rwlock_unlock (&snapshot.lock);
+
   if (err || ! (proc_stat_flags (ps) & PSTAT_OWNER_UID))
     {
       _proc_stat_free (ps);
@@ -25,3 +25,8 @@
 error_t
 process_lookup_pid (struct ps_context *pc, pid_t pid, struct node **np);
 
+/* Return in PIDS and NUM_PIDS a malloced array of the PIDs of the processes
+   published by the proc server referenced by PC, fetching the information
+   process_lookup_pid needs for each at the same time.  */
+error_t
+process_list_pids (struct ps_context *pc, pid_t **pids, size_t *num_pids);
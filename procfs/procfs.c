@@ -18,27 +18,234 @@
    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
 #include <mach.h>
 #include <hurd/netfs.h>
 #include <hurd/fshelp.h>
+#include <hurd/ihash.h>
 #include "procfs.h"
+#include "main.h"
 
 struct netnode
 {
   const struct procfs_node_ops *ops;
   void *hook;
 
-  /* (cached) contents of the node */
+  /* (cached) contents of the node, and when they were made */
   char *contents;
   ssize_t contents_len;
+  struct timespec stamp;
+
+  /* the buffer get_contents is offered, which we keep across refreshes */
+  char *buf;
+  size_t buf_size;
+
+  /* the task the contents are about, if any (see cache_store) */
+  mach_port_t task;
+
+  /* path from the root, naming the contents in the cache, if looked up */
+  char *path;
 
   /* parent directory, if applicable */
   struct node *parent;
 };
 
+/* The contents of files are kept for OPT_CACHE_TTL milliseconds after they
+   are made: in the node itself, for readers that keep the file open, and
+   in CACHE, by the path of the node, for readers that open it each time,
+   which gets them a new node.  Contents about a process are also dropped
+   as soon as its task dies, so that neither a dead process nor another
+   one that has taken its PID is shown.  */
+
+struct cache_entry
+{
+  hurd_ihash_locp_t locp;
+  char *path;
+  char *contents;		/* malloced */
+  ssize_t contents_len;
+  struct timespec stamp;
+  mach_port_t task;
+};
+
+static hurd_ihash_key_t
+cache_hash (const void *key)
+{
+  return hurd_ihash_hash32 (key, strlen (key), 0);
+}
+
+static int
+cache_compare (const void *a, const void *b)
+{
+  return strcmp (a, b) == 0;
+}
+
+static struct hurd_ihash cache
+  = HURD_IHASH_INITIALIZER_GKI (offsetof (struct cache_entry, locp),
+				NULL, NULL, cache_hash, cache_compare);
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec cache_swept;
+
+/* Return whether contents made at STAMP are too old to be used.  */
+static int
+expired (const struct timespec *stamp)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return ((now.tv_sec - stamp->tv_sec) * 1000
+	  + (now.tv_nsec - stamp->tv_nsec) / 1000000) >= opt_cache_ttl;
+}
+
+/* Return whether TASK, if any, has died.  */
+static int
+task_dead (mach_port_t task)
+{
+  mach_port_type_t type;
+
+  return MACH_PORT_VALID (task)
+    && (mach_port_type (mach_task_self (), task, &type)
+	|| (type & MACH_PORT_TYPE_DEAD_NAME));
+}
+
+/* Return another reference to TASK, or MACH_PORT_NULL if it has died.  */
+static mach_port_t
+task_ref (mach_port_t task)
+{
+  if (MACH_PORT_VALID (task)
+      && mach_port_mod_refs (mach_task_self (), task,
+			     MACH_PORT_RIGHT_SEND, 1))
+    return MACH_PORT_NULL;
+  return task;
+}
+
+static void
+cache_entry_free (struct cache_entry *e)
+{
+  hurd_ihash_locp_remove (&cache, e->locp);
+  if (MACH_PORT_VALID (e->task))
+    mach_port_deallocate (mach_task_self (), e->task);
+  free (e->contents);
+  free (e->path);
+  free (e);
+}
+
+/* Drop the entries of CACHE that can't be used any more.  CACHE_LOCK must
+   be held.  */
+static void
+cache_sweep (void)
+{
+  HURD_IHASH_ITERATE (&cache, value)
+    {
+      struct cache_entry *e = value;
+      if (expired (&e->stamp) || task_dead (e->task))
+	cache_entry_free (e);
+    }
+  clock_gettime (CLOCK_MONOTONIC, &cache_swept);
+}
+
+/* Make the contents of the node NP those in the cache, if they are still
+   good.  Return whether it was done.  */
+static int
+cache_find (struct node *np)
+{
+  struct cache_entry *e;
+  int found = 0;
+
+  pthread_mutex_lock (&cache_lock);
+  e = hurd_ihash_find (&cache, (hurd_ihash_key_t) np->nn->path);
+  if (e && (expired (&e->stamp) || task_dead (e->task)))
+    {
+      cache_entry_free (e);
+      e = NULL;
+    }
+  if (e && np->nn->buf_size < e->contents_len)
+    {
+      char *buf = realloc (np->nn->buf, e->contents_len);
+      if (buf)
+	{
+	  np->nn->buf = buf;
+	  np->nn->buf_size = e->contents_len;
+	}
+    }
+  if (e && np->nn->buf_size >= e->contents_len)
+    {
+      memcpy (np->nn->buf, e->contents, e->contents_len);
+      np->nn->contents = np->nn->buf;
+      np->nn->contents_len = e->contents_len;
+      np->nn->stamp = e->stamp;
+      np->nn->task = task_ref (e->task);
+      found = 1;
+    }
+  pthread_mutex_unlock (&cache_lock);
+
+  return found;
+}
+
+/* Remember the contents of the node NP in the cache.  */
+static void
+cache_store (struct node *np)
+{
+  struct cache_entry *e;
+
+  pthread_mutex_lock (&cache_lock);
+
+  if (expired (&cache_swept))
+    cache_sweep ();
+
+  e = hurd_ihash_find (&cache, (hurd_ihash_key_t) np->nn->path);
+  if (! e)
+    {
+      e = calloc (1, sizeof *e);
+      if (e)
+	e->path = strdup (np->nn->path);
+      if (! e || ! e->path
+	  || hurd_ihash_add (&cache, (hurd_ihash_key_t) e->path, e))
+	{
+	  if (e)
+	    free (e->path);
+	  free (e);
+	  e = NULL;
+	}
+    }
+
+  if (e)
+    {
+      char *contents = realloc (e->contents, np->nn->contents_len ?: 1);
+
+      if (MACH_PORT_VALID (e->task))
+	mach_port_deallocate (mach_task_self (), e->task);
+      e->task = MACH_PORT_NULL;
+
+      if (contents)
+	{
+	  memcpy (contents, np->nn->contents, np->nn->contents_len);
+	  e->contents = contents;
+	  e->contents_len = np->nn->contents_len;
+	  e->stamp = np->nn->stamp;
+	  e->task = task_ref (np->nn->task);
+	}
+      else
+	cache_entry_free (e);
+    }
+
+  pthread_mutex_unlock (&cache_lock);
+}
+
+/* Return whether the contents of the node NP may be cached.  Directories
+   are not, as their listings are cheap, and the one of processes should
+   follow them closely.  */
+static int
+cacheable (struct node *np)
+{
+  return opt_cache_ttl > 0 && ! np->nn->ops->lookup;
+}
+
 void
 procfs_cleanup_contents_with_free (void *hook, char *cont, ssize_t len)
 {
@@ -132,15 +339,53 @@ procfs_make_ino (struct node *np, const char *filename)
   return (unsigned long) jrand48 (x);
 }
 
+ssize_t
+procfs_printf (char **contents, ssize_t size, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+
+  if (size > 0)
+    {
+      va_start (ap, fmt);
+      n = vsnprintf (*contents, size, fmt, ap);
+      va_end (ap);
+      if (n >= 0 && n < size)
+	return n;
+    }
+
+  va_start (ap, fmt);
+  n = vasprintf (contents, fmt, ap);
+  va_end (ap);
+  return n;
+}
+
 error_t procfs_get_contents (struct node *np, char **data, ssize_t *data_len)
 {
-  if (! np->nn->contents && np->nn->ops->get_contents)
+  if (! np->nn->contents && np->nn->ops->get_contents
+      && ! (cacheable (np) && np->nn->path && cache_find (np)))
     {
       char *contents;
       ssize_t contents_len;
       error_t err;
 
-      contents_len = -1;
+      if (np->nn->buf_size < np->nn->ops->needed_length)
+	{
+	  char *buf = realloc (np->nn->buf, np->nn->ops->needed_length);
+	  if (buf)
+	    {
+	      np->nn->buf = buf;
+	      np->nn->buf_size = np->nn->ops->needed_length;
+	    }
+	}
+
+      if (np->nn->ops->needed_length && np->nn->buf)
+	{
+	  contents = np->nn->buf;
+	  contents_len = np->nn->buf_size;
+	}
+      else
+	contents_len = -1;
       err = np->nn->ops->get_contents (np->nn->hook, &contents, &contents_len);
       if (err)
 	return err;
@@ -149,6 +394,15 @@ error_t procfs_get_contents (struct node *np, char **data, ssize_t *data_len)
 
       np->nn->contents = contents;
       np->nn->contents_len = contents_len;
+
+      if (cacheable (np))
+	{
+	  clock_gettime (CLOCK_MONOTONIC, &np->nn->stamp);
+	  if (np->nn->ops->get_task)
+	    np->nn->task = np->nn->ops->get_task (np->nn->hook);
+	  if (np->nn->path)
+	    cache_store (np);
+	}
     }
 
   *data = np->nn->contents;
@@ -156,12 +410,27 @@ error_t procfs_get_contents (struct node *np, char **data, ssize_t *data_len)
   return 0;
 }
 
-void procfs_refresh (struct node *np)
+/* Drop the contents of NP, however recent.  */
+static void procfs_forget (struct node *np)
 {
-  if (np->nn->contents && np->nn->ops->cleanup_contents)
+  if (np->nn->contents && np->nn->contents != np->nn->buf
+      && np->nn->ops->cleanup_contents)
     np->nn->ops->cleanup_contents (np->nn->hook, np->nn->contents, np->nn->contents_len);
 
   np->nn->contents = NULL;
+
+  if (MACH_PORT_VALID (np->nn->task))
+    mach_port_deallocate (mach_task_self (), np->nn->task);
+  np->nn->task = MACH_PORT_NULL;
+}
+
+void procfs_refresh (struct node *np)
+{
+  if (np->nn->contents && cacheable (np)
+      && ! expired (&np->nn->stamp) && ! task_dead (np->nn->task))
+    return;
+
+  procfs_forget (np);
 }
 
 error_t procfs_lookup (struct node *np, const char *name, struct node **npp)
@@ -187,6 +456,11 @@ error_t procfs_lookup (struct node *np, const char *name, struct node **npp)
         {
 	  (*npp)->nn_stat.st_ino = procfs_make_ino (np, name);
 	  netfs_nref ((*npp)->nn->parent = np);
+	  if (! (*npp)->nn->path
+	      && asprintf (&(*npp)->nn->path, "%s/%s",
+			   np->nn->path ?: "", name) < 0)
+	    /* The contents are just not cached then.  */
+	    (*npp)->nn->path = NULL;
 	}
     }
 
@@ -195,7 +469,9 @@ error_t procfs_lookup (struct node *np, const char *name, struct node **npp)
 
 void procfs_cleanup (struct node *np)
 {
-  procfs_refresh (np);
+  procfs_forget (np);
+  free (np->nn->buf);
+  free (np->nn->path);
 
   if (np->nn->ops->cleanup)
     np->nn->ops->cleanup (np->nn->hook);
@@ -37,9 +37,17 @@ struct procfs_node_ops
      you would expect; for directories, they are an argz vector of the
      names of the entries.  If upon return, *CONTENTS_LEN is negative or
      unchanged, the call is considered to have failed because of a memory
-     allocation error.  */
+     allocation error.  If NEEDED_LENGTH is not zero, *CONTENTS is a
+     buffer of *CONTENTS_LEN bytes, at least NEEDED_LENGTH, which
+     get_contents may fill in rather than allocating one;
+     cleanup_contents is not called for it.  */
   error_t (*get_contents) (void *hook, char **contents, ssize_t *contents_len);
   void (*cleanup_contents) (void *hook, char *contents, ssize_t contents_len);
+  size_t needed_length;
+
+  /* If the contents are about a process, return a new send right to its
+     task, so that they are not cached once it is gone.  */
+  mach_port_t (*get_task) (void *hook);
 
   /* Lookup NAME in this directory, and store the result in *np.  The
      returned node should be created by lookup() using procfs_make_node() 
@@ -60,6 +68,13 @@ struct procfs_node_ops
 void procfs_cleanup_contents_with_free (void *, char *, ssize_t);
 void procfs_cleanup_contents_with_vm_deallocate (void *, char *, ssize_t);
 
+/* Format the contents of a node with FMT, into the buffer of SIZE bytes
+   at *CONTENTS if SIZE is positive and they fit, or else into a new
+   malloced one returned in *CONTENTS, as asprintf would.  Return their
+   length, or -1 if out of memory.  For use by get_contents.  */
+ssize_t procfs_printf (char **contents, ssize_t size, const char *fmt, ...)
+  __attribute__ ((format (printf, 3, 4)));
+
 /* Create a new node and return it.  Returns NULL if it fails to allocate
    enough memory.  In this case, ops->cleanup will be invoked.  */
 struct node *procfs_make_node (const struct procfs_node_ops *ops, void *hook);
@@ -85,9 +100,10 @@ void procfs_node_chtype (struct node *np, mode_t type);
    corresponding child nodes.  */
 ino64_t procfs_make_ino (struct node *np, const char *filename);
 
-/* Forget the current cached contents for the node.  This is done before reads
-   from offset 0, to ensure that the data are recent even for utilities such as
-   top which keep some nodes open.  */
+/* Forget the current cached contents for the node, unless they are younger
+   than the --cache-ttl option.  This is done before reads from offset 0, to
+   ensure that the data are recent even for utilities such as top which keep
+   some nodes open.  */
 void procfs_refresh (struct node *np);
 
 error_t procfs_get_contents (struct node *np, char **data, ssize_t *data_len);
@@ -32,15 +32,26 @@ static error_t
 proclist_get_contents (void *hook, char **contents, ssize_t *contents_len)
 {
   struct ps_context *pc = hook;
-  pidarray_t pids;
-  mach_msg_type_number_t num_pids;
+  pid_t *pids;
+  size_t num_pids;
+  int vm_alloced = 0;
   error_t err;
   int i;
 
-  num_pids = 0;
-  err = proc_getallpids (pc->server, &pids, &num_pids);
+  err = process_list_pids (pc, &pids, &num_pids);
   if (err)
-    return EIO;
+    {
+      /* The proc server may not know proc_getprocinfos.  */
+      pidarray_t vm_pids = NULL;
+      mach_msg_type_number_t vm_num_pids = 0;
+
+      err = proc_getallpids (pc->server, &vm_pids, &vm_num_pids);
+      if (err)
+	return EIO;
+      pids = vm_pids;
+      num_pids = vm_num_pids;
+      vm_alloced = 1;
+    }
 
   *contents = malloc (num_pids * PID_STR_SIZE);
   if (*contents)
@@ -56,7 +67,11 @@ proclist_get_contents (void *hook, char **contents, ssize_t *contents_len)
   else
     err = ENOMEM;
 
-  vm_deallocate (mach_task_self (), (vm_address_t) pids, num_pids * sizeof pids[0]);
+  if (vm_alloced)
+    vm_deallocate (mach_task_self (), (vm_address_t) pids,
+		   num_pids * sizeof pids[0]);
+  else
+    free (pids);
   return err;
 }
 
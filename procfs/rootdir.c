@@ -38,6 +38,7 @@
 #include "procfs_dir.h"
 #include "main.h"
 #include <net/route.h>
+#include <hurd/ioctl_types.h>
 
 #include "mach_debug_U.h"
 #include "pfinet_U.h"
@@ -154,6 +155,10 @@ get_swapinfo (default_pager_info_t *info)
 
 /* Content generators */
 
+/* Enough for the generators using procfs_printf to fill in the buffer
+   procfs offers them.  */
+#define ROOTDIR_GC_LENGTH 512
+
 static error_t
 rootdir_gc_version (void *hook, char **contents, ssize_t *contents_len)
 {
@@ -164,7 +169,7 @@ rootdir_gc_version (void *hook, char **contents, ssize_t *contents_len)
   if (r < 0)
     return errno;
 
-  *contents_len = asprintf (contents,
+  *contents_len = procfs_printf (contents, *contents_len,
       "Linux version 2.6.1 (%s %s %s %s)\n",
       uts.sysname, uts.release, uts.version, uts.machine);
 
@@ -199,7 +204,8 @@ rootdir_gc_uptime (void *hook, char **contents, ssize_t *contents_len)
      proc(5) specifies that it should be equal to USER_HZ times the idle value
      in ticks from /proc/stat.  So we assume a completely idle system both here
      and there to make that work.  */
-  *contents_len = asprintf (contents, "%.2lf %.2lf\n", up_secs, idle_secs);
+  *contents_len = procfs_printf (contents, *contents_len,
+				 "%.2lf %.2lf\n", up_secs, idle_secs);
 
   return 0;
 }
@@ -232,7 +238,7 @@ rootdir_gc_stat (void *hook, char **contents, ssize_t *contents_len)
   up_ticks = opt_clk_tck * (time.tv_sec * 1000000. + time.tv_usec) / 1000000.;
   idle_ticks = opt_clk_tck * (idletime.tv_sec * 1000000. + idletime.tv_usec) / 1000000.;
 
-  *contents_len = asprintf (contents,
+  *contents_len = procfs_printf (contents, *contents_len,
       "cpu  %lu 0 0 %lu 0 0 0 0 0\n"
       "cpu0 %lu 0 0 %lu 0 0 0 0 0\n"
       "intr 0\n"
@@ -259,7 +265,7 @@ rootdir_gc_loadavg (void *hook, char **contents, ssize_t *contents_len)
     return err;
 
   assert_backtrace (cnt == HOST_LOAD_INFO_COUNT);
-  *contents_len = asprintf (contents,
+  *contents_len = procfs_printf (contents, *contents_len,
       "%.2f %.2f %.2f 1/0 0\n",
       hli.avenrun[0] / (double) LOAD_SCALE,
       hli.avenrun[1] / (double) LOAD_SCALE,
@@ -354,7 +360,7 @@ rootdir_gc_vmstat (void *hook, char **contents, ssize_t *contents_len)
   if (err)
     return EIO;
 
-  *contents_len = asprintf (contents,
+  *contents_len = procfs_printf (contents, *contents_len,
       "nr_free_pages %lu\n"
       "nr_inactive_anon %lu\n"
       "nr_active_anon %lu\n"
@@ -481,6 +487,117 @@ out:
   return err;
 }
 
+/* Get the interface statistics from the IPv4 server into SRC and
+   BUFLEN.  */
+static error_t
+rootdir_get_ifstats (char **src, mach_msg_type_number_t *buflen)
+{
+  error_t err;
+  mach_port_t pfinet;
+  char socket_inet[20];
+
+  snprintf(socket_inet, sizeof(socket_inet), _SERVERS_SOCKET "/%d", AF_INET);
+  pfinet = file_name_lookup (socket_inet, O_RDONLY, 0);
+  if (pfinet == MACH_PORT_NULL)
+    return errno;
+
+  *src = NULL;
+  *buflen = 0;
+  err = pfinet_getifstats (pfinet, src, buflen);
+  mach_port_deallocate (mach_task_self (), pfinet);
+  return err;
+}
+
+/* The interface counters, in the format of Linux's /proc/net/dev.  */
+static error_t
+rootdir_gc_net_dev (void *hook, char **contents, ssize_t *contents_len)
+{
+  error_t err;
+  mach_msg_type_number_t buflen;
+  char *src;
+  ifstatsreq_t *r;
+  FILE *m;
+  int i;
+
+  err = rootdir_get_ifstats (&src, &buflen);
+  if (err)
+    {
+      *contents_len = 0;
+      return err;
+    }
+
+  m = open_memstream (contents, (size_t *) contents_len);
+  if (m == NULL)
+    {
+      err = ENOMEM;
+      goto out;
+    }
+
+  fprintf (m, "Inter-|   Receive                                     "
+	   "           |  Transmit\n"
+	   " face |bytes    packets errs drop fifo frame compressed multicast"
+	   "|bytes    packets errs drop fifo colls carrier compressed\n");
+
+  r = (ifstatsreq_t *) src;
+  for (i = 0; i < buflen / sizeof (ifstatsreq_t); i++, r++)
+    fprintf (m, "%6.16s:%8llu %7llu %4llu %4llu %4u %5u %10u %9u "
+	     "%8llu %7llu %4llu %4llu %4u %5u %7u %10u\n",
+	     r->ifname,
+	     (unsigned long long) r->rx_bytes,
+	     (unsigned long long) r->rx_packets,
+	     (unsigned long long) r->rx_errors,
+	     (unsigned long long) r->rx_dropped, 0, 0, 0, 0,
+	     (unsigned long long) r->tx_bytes,
+	     (unsigned long long) r->tx_packets,
+	     (unsigned long long) r->tx_errors,
+	     (unsigned long long) r->tx_dropped, 0, 0, 0, 0);
+
+  fclose (m);
+
+out:
+  vm_deallocate (mach_task_self (), (vm_address_t) src, buflen);
+  return err;
+}
+
+/* The packets per second each interface received and sent over at
+   least the last second, which Linux does not have.  */
+static error_t
+rootdir_gc_net_dev_rate (void *hook, char **contents, ssize_t *contents_len)
+{
+  error_t err;
+  mach_msg_type_number_t buflen;
+  char *src;
+  ifstatsreq_t *r;
+  FILE *m;
+  int i;
+
+  err = rootdir_get_ifstats (&src, &buflen);
+  if (err)
+    {
+      *contents_len = 0;
+      return err;
+    }
+
+  m = open_memstream (contents, (size_t *) contents_len);
+  if (m == NULL)
+    {
+      err = ENOMEM;
+      goto out;
+    }
+
+  fprintf (m, "%-8s %10s %10s\n", "Iface", "RX pps", "TX pps");
+
+  r = (ifstatsreq_t *) src;
+  for (i = 0; i < buflen / sizeof (ifstatsreq_t); i++, r++)
+    fprintf (m, "%-8.16s %10u %10u\n", r->ifname, r->rx_pps, r->tx_pps);
+
+  fclose (m);
+
+out:
+  vm_deallocate (mach_task_self (), (vm_address_t) src, buflen);
+  return err;
+}
+
 static struct node *rootdir_self_node;
 static struct node *rootdir_mounts_node;
 
@@ -710,6 +827,38 @@ rootdir_file_make_node (void *dir_hook, const void *entry_hook)
 }
 
 
+static const struct procfs_dir_entry rootdir_net_entries[] = {
+  {
+    .name = "dev",
+    .hook = & (struct procfs_node_ops) {
+      .get_contents = rootdir_gc_net_dev,
+      .cleanup_contents = procfs_cleanup_contents_with_free,
+    },
+  },
+  {
+    .name = "dev_rate",
+    .hook = & (struct procfs_node_ops) {
+      .get_contents = rootdir_gc_net_dev_rate,
+      .cleanup_contents = procfs_cleanup_contents_with_free,
+    },
+  },
+  {}
+};
+
+/* The net directory, with the same hook as the root directory.  */
+static struct node *
+rootdir_net_make_node (void *dir_hook, const void *entry_hook)
+{
+  static const struct procfs_dir_ops ops = {
+    .entries = rootdir_net_entries,
+    .entry_ops = {
+      .make_node = rootdir_file_make_node,
+    },
+  };
+  return procfs_dir_make_node (&ops, dir_hook);
+}
+
+
 /* Translator linkage.  */
 
 static pthread_spinlock_t rootdir_translated_node_lock =
@@ -801,6 +950,7 @@ static const struct procfs_dir_entry rootdir_entries[] = {
     .hook = & (struct procfs_node_ops) {
       .get_contents = rootdir_gc_version,
       .cleanup_contents = procfs_cleanup_contents_with_free,
+      .needed_length = ROOTDIR_GC_LENGTH,
     },
   },
   {
@@ -808,6 +958,7 @@ static const struct procfs_dir_entry rootdir_entries[] = {
     .hook = & (struct procfs_node_ops) {
       .get_contents = rootdir_gc_uptime,
       .cleanup_contents = procfs_cleanup_contents_with_free,
+      .needed_length = ROOTDIR_GC_LENGTH,
     },
   },
   {
@@ -815,6 +966,7 @@ static const struct procfs_dir_entry rootdir_entries[] = {
     .hook = & (struct procfs_node_ops) {
       .get_contents = rootdir_gc_stat,
       .cleanup_contents = procfs_cleanup_contents_with_free,
+      .needed_length = ROOTDIR_GC_LENGTH,
     },
   },
   {
@@ -822,6 +974,7 @@ static const struct procfs_dir_entry rootdir_entries[] = {
     .hook = & (struct procfs_node_ops) {
       .get_contents = rootdir_gc_loadavg,
       .cleanup_contents = procfs_cleanup_contents_with_free,
+      .needed_length = ROOTDIR_GC_LENGTH,
     },
   },
   {
@@ -836,6 +989,7 @@ static const struct procfs_dir_entry rootdir_entries[] = {
     .hook = & (struct procfs_node_ops) {
       .get_contents = rootdir_gc_vmstat,
       .cleanup_contents = procfs_cleanup_contents_with_free,
+      .needed_length = ROOTDIR_GC_LENGTH,
     },
   },
   {
@@ -852,6 +1006,12 @@ static const struct procfs_dir_entry rootdir_entries[] = {
       .cleanup_contents = procfs_cleanup_contents_with_free,
     },
   },
+  {
+    .name = "net",
+    .ops = {
+      .make_node = rootdir_net_make_node,
+    },
+  },
   {
     .name = "mounts",
     .hook = ROOTDIR_DEFINE_TRANSLATED_NODE (&rootdir_mounts_node,
@@ -61,6 +61,28 @@ static mach_port_t master_host;
 /* rwlock to protect concurrent close while reading/writing */
 pthread_rwlock_t rumpdisk_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 
+/* _bus_dmamap_load_buffer seems not to call rumpcomp_pci_virt_to_mach
+ * for each page, so rump can only transfer data in and out of memory that
+ * is physically contiguous.  Rather than a page at a time, requests go
+ * through a pool of contiguous buffers allocated up front, in pieces of
+ * up to DMA_BUF_SIZE, unless the caller's pages happen to be contiguous
+ * already.  */
+#define DMA_BUF_SIZE (1024 * 1024)
+#define DMA_BUF_COUNT 4
+
+struct dma_buf
+{
+  vm_address_t addr;
+  struct dma_buf *next;
+};
+
+static struct dma_buf dma_bufs[DMA_BUF_COUNT];
+static struct dma_buf *dma_free_bufs;
+/* The size of the buffers in the pool, or 0 if there are none.  */
+static vm_size_t dma_buf_size;
+static pthread_mutex_t dma_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dma_cond = PTHREAD_COND_INITIALIZER;
+
 /* One of these is associated with each open instance of a device.  */
 struct block_data
 {
@@ -151,6 +173,133 @@ dev_mode_to_rump_mode (const dev_mode_t mode)
   return ret;
 }
 
+/* Allocate the pool of DMA buffers, smaller ones if there is not enough
+ * contiguous memory for DMA_BUF_SIZE.  */
+static void
+dma_pool_init (void)
+{
+  vm_size_t size;
+  int i;
+
+  for (size = DMA_BUF_SIZE; size >= vm_page_size; size /= 2)
+    {
+      for (i = 0; i < DMA_BUF_COUNT; i++)
+	{
+	  rpc_phys_addr_t pap;
+	  kern_return_t ret;
+
+	  ret = vm_allocate_contiguous (master_host, mach_task_self (),
+					&dma_bufs[i].addr, &pap, size,
+					0, 0x100000000ULL, 0);
+	  if (ret != KERN_SUCCESS)
+	    break;
+	  dma_bufs[i].next = dma_free_bufs;
+	  dma_free_bufs = &dma_bufs[i];
+	}
+      if (i > 0)
+	{
+	  dma_buf_size = size;
+	  return;
+	}
+    }
+
+  mach_print ("Cannot allocate DMA buffers, transferring a page at a time\n");
+}
+
+static struct dma_buf *
+dma_buf_get (void)
+{
+  struct dma_buf *buf;
+
+  pthread_mutex_lock (&dma_lock);
+  while (! dma_free_bufs)
+    pthread_cond_wait (&dma_cond, &dma_lock);
+  buf = dma_free_bufs;
+  dma_free_bufs = buf->next;
+  pthread_mutex_unlock (&dma_lock);
+  return buf;
+}
+
+static void
+dma_buf_put (struct dma_buf *buf)
+{
+  pthread_mutex_lock (&dma_lock);
+  buf->next = dma_free_bufs;
+  dma_free_bufs = buf;
+  pthread_cond_signal (&dma_cond);
+  pthread_mutex_unlock (&dma_lock);
+}
+
+/* Return true if the LEN bytes at ADDR, which are at most DMA_BUF_SIZE,
+ * can be handed to rump as they are, because they are page-aligned and
+ * physically contiguous.  Their pages are faulted in first, for writing
+ * if the device is going to write to them, which is when TO_MEMORY is
+ * true.  */
+static bool
+dma_direct (const void *addr, size_t len, bool to_memory)
+{
+  volatile uint8_t dummy_read __attribute__ ((unused));
+  rpc_phys_addr_t pages_buf[DMA_BUF_SIZE / 4096];
+  rpc_phys_addr_array_t pages = pages_buf;
+  mach_msg_type_number_t npages = sizeof pages_buf / sizeof pages_buf[0];
+  vm_size_t i, n;
+  bool contiguous;
+
+  if ((vm_address_t) addr % vm_page_size)
+    return false;
+
+  /* Fault-in the memory pages by touching a single byte of each */
+  n = round_page (len) / vm_page_size;
+  for (i = 0; i < n; i++)
+    if (to_memory)
+      ((volatile uint8_t *) addr)[i * vm_page_size] = 0;
+    else
+      dummy_read = ((volatile uint8_t *) addr)[i * vm_page_size];
+
+  if (n == 1)
+    return true;
+
+  if (vm_pages_phys (master_host, mach_task_self (), (vm_address_t) addr,
+		     n * vm_page_size, &pages, &npages) != KERN_SUCCESS)
+    return false;
+
+  contiguous = npages == n;
+  for (i = 1; contiguous && i < n; i++)
+    contiguous = pages[i] == pages[0] + i * vm_page_size;
+
+  if (pages != pages_buf)
+    vm_deallocate (mach_task_self (), (vm_address_t) pages,
+		   npages * sizeof *pages);
+  return contiguous;
+}
+
+/* Return a page of our own, allocating it into *PAGE the first time, to
+ * copy through when there is no pool; a single page is always
+ * physically contiguous.  Return NULL if it cannot be allocated.  */
+static void *
+bounce_page (vm_address_t *page)
+{
+  if (! *page)
+    {
+      if (vm_allocate (mach_task_self (), page, vm_page_size, TRUE)
+	  != KERN_SUCCESS)
+	{
+	  *page = 0;
+	  return NULL;
+	}
+      /* Fault it in, as the device may write to it.  */
+      *(volatile uint8_t *) *page = 0;
+    }
+  return (void *) *page;
+}
+
+/* The most to hand to rump at once.  */
+static size_t
+dma_chunk_size (void)
+{
+  return dma_buf_size ?: vm_page_size;
+}
+
 static void
 rumpdisk_device_init (void)
 {
@@ -189,6 +338,7 @@ rumpdisk_device_init (void)
 	}
     }
   rump_init ();
+  dma_pool_init ();
 }
 
 static io_return_t
@@ -334,8 +484,8 @@ rumpdisk_device_write (void *d, mach_port_t reply_port,
 		       int *bytes_written)
 {
   struct block_data *bd = d;
+  vm_address_t page = 0;
   ssize_t written;
-  int pagesize = sysconf (_SC_PAGE_SIZE);
 
   if ((bd->mode & D_WRITE) == 0)
     return D_INVALID_OPERATION;
@@ -348,68 +498,60 @@ rumpdisk_device_write (void *d, mach_port_t reply_port,
       return D_INVALID_OPERATION;
     }
 
-  if ((vm_offset_t) data % pagesize)
+  written = 0;
+  while (written < count)
     {
-      /* Not aligned, have to copy to aligned buffer.  */
-      vm_address_t buf;
-      rpc_phys_addr_t pap;
-      kern_return_t ret;
+      const void *src = data + written;
+      size_t todo = count - written;
+      struct dma_buf *buf = NULL;
+      ssize_t done;
       int err;
 
-      /* While at it, make it contiguous */
-      ret = vm_allocate_contiguous (master_host, mach_task_self (), &buf, &pap, count, 0, 0x100000000ULL, 0);
-      if (ret != KERN_SUCCESS)
+      if (todo > dma_chunk_size ())
+	todo = dma_chunk_size ();
+
+      if (! dma_direct (src, todo, false))
 	{
-	  pthread_rwlock_unlock (&rumpdisk_rwlock);
-	  return ENOMEM;
-	}
+	  /* Not aligned or not contiguous, have to copy to a DMA buffer,
+	     or to a page of our own if there is no pool.  */
+	  void *bounce;
 
-      memcpy ((void*) buf, data, count);
+	  if (dma_buf_size)
+	    {
+	      buf = dma_buf_get ();
+	      bounce = (void *) buf->addr;
+	    }
+	  else if (! (bounce = bounce_page (&page)))
+	    {
+	      pthread_rwlock_unlock (&rumpdisk_rwlock);
+	      return D_NO_MEMORY;
+	    }
+	  memcpy (bounce, src, todo);
+	  src = bounce;
+	}
 
-      written = rump_sys_pwrite (bd->rump_fd, (const void *)buf, (size_t)count, (off_t)bn * bd->block_size);
+      done = rump_sys_pwrite (bd->rump_fd, src, todo,
+			      (off_t)bn * bd->block_size + written);
       err = errno;
 
-      vm_deallocate (mach_task_self (), (vm_address_t) buf, count);
+      if (buf)
+	dma_buf_put (buf);
 
-      if (written < 0)
+      if (done < 0)
 	{
+	  if (page)
+	    vm_deallocate (mach_task_self (), page, vm_page_size);
 	  pthread_rwlock_unlock (&rumpdisk_rwlock);
 	  return rump_errno2host (err);
 	}
-    }
-  else
-    {
-      volatile uint8_t dummy_read __attribute__ ((unused));
-      int npages = (count + pagesize - 1) / pagesize;
-      int i;
-
-      /* Fault-in the memory pages by reading a single byte of each */
-      for (i = 0; i < npages; i++)
-	dummy_read = ((volatile uint8_t *)data)[i * pagesize];
-
-      /* XXX: _bus_dmamap_load_buffer seems not to call rumpcomp_pci_virt_to_mach
-       * for each page, so separate out pages ourselves :/ */
-      written = 0;
-      while (written < count)
-	{
-	  size_t todo = count - written;
-	  ssize_t done;
-
-	  if (todo > pagesize)
-	    todo = pagesize;
+      if (done == 0)
+	break;
 
-	  done = rump_sys_pwrite (bd->rump_fd, (const void *)data + written, todo, (off_t)bn * bd->block_size + written);
-
-	  if (done < 0)
-	    {
-	      pthread_rwlock_unlock (&rumpdisk_rwlock);
-	      return rump_errno2host (errno);
-	    }
-
-	  written += done;
-	}
+      written += done;
     }
 
+  if (page)
+    vm_deallocate (mach_task_self (), page, vm_page_size);
   vm_deallocate (mach_task_self (), (vm_address_t) data, count);
 
   *bytes_written = (int)written;
@@ -424,10 +566,9 @@ rumpdisk_device_read (void *d, mach_port_t reply_port,
 		      unsigned *bytes_read)
 {
   struct block_data *bd = d;
-  vm_address_t buf;
+  vm_address_t buf, page = 0;
   int pagesize = sysconf (_SC_PAGE_SIZE);
   int npages = (count + pagesize - 1) / pagesize;
-  int i;
   ssize_t done, err;
   kern_return_t ret;
 
@@ -445,7 +586,6 @@ rumpdisk_device_read (void *d, mach_port_t reply_port,
       return D_INVALID_OPERATION;
     }
 
-  /* TODO: directly write at *data when it is aligned */
   *data = 0;
   ret = vm_allocate (mach_task_self (), &buf, npages * pagesize, TRUE);
   if (ret != KERN_SUCCESS)
@@ -454,32 +594,59 @@ rumpdisk_device_read (void *d, mach_port_t reply_port,
       return ENOMEM;
     }
 
-  /* Ensure physical allocation by writing a single byte of each */
-  for (i = 0; i < npages; i++)
-    ((uint8_t *)buf)[i * pagesize] = 0;
-
-  /* XXX: _bus_dmamap_load_buffer seems not to call rumpcomp_pci_virt_to_mach
-   * for each page, so separate out pages ourselves :/ */
   done = 0;
   while (done < count)
     {
+      void *dest = (void *) buf + done;
       size_t todo = count - done;
+      struct dma_buf *dma = NULL;
 
-      if (todo > pagesize)
-	todo = pagesize;
+      if (todo > dma_chunk_size ())
+	todo = dma_chunk_size ();
 
-      err = rump_sys_pread (bd->rump_fd, (void *)buf + done, todo, (off_t)bn * bd->block_size + done);
+      if (! dma_direct (dest, todo, true))
+	{
+	  /* Read into a DMA buffer, or into a page of our own if there is
+	     no pool, and copy from there.  */
+	  if (dma_buf_size)
+	    {
+	      dma = dma_buf_get ();
+	      dest = (void *) dma->addr;
+	    }
+	  else if (! (dest = bounce_page (&page)))
+	    {
+	      vm_deallocate (mach_task_self (), buf, npages * pagesize);
+	      pthread_rwlock_unlock (&rumpdisk_rwlock);
+	      return D_NO_MEMORY;
+	    }
+	}
+
+      err = rump_sys_pread (bd->rump_fd, dest, todo,
+			    (off_t)bn * bd->block_size + done);
       if (err < 0)
 	{
 	  err = errno;
+	  if (dma)
+	    dma_buf_put (dma);
+	  if (page)
+	    vm_deallocate (mach_task_self (), page, vm_page_size);
 	  vm_deallocate (mach_task_self (), buf, npages * pagesize);
 	  pthread_rwlock_unlock (&rumpdisk_rwlock);
 	  return rump_errno2host (err);
 	}
 
+      if (dest != (void *) buf + done)
+	memcpy ((void *) buf + done, dest, err);
+      if (dma)
+	dma_buf_put (dma);
+      if (err == 0)
+	break;
+
       done += err;
     }
 
+  if (page)
+    vm_deallocate (mach_task_self (), page, vm_page_size);
   *bytes_read = done;
   *data = (void*) buf;
   pthread_rwlock_unlock (&rumpdisk_rwlock);
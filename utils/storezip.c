@@ -0,0 +1,178 @@
+/* Write a store as a chunked compressed image
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   59 Temple Place - Suite 330, Boston, MA 02111, USA. */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <endian.h>
+#include <argp.h>
+#include <error.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#include <hurd/store.h>
+#include <version.h>
+
+const char *argp_program_version = STANDARD_HURD_VERSION (storezip);
+
+static const struct argp_option options[] =
+{
+  {"output", 'o', "FILE", 0, "Write the image to FILE (required)"},
+  {"chunk-size", 'c', "BYTES", 0,
+   "Uncompressed size of each chunk (a power of two, default 65536)"},
+  {"level", 'l', "LEVEL", 0, "zlib compression level (1-9, default 9)"},
+  {0}
+};
+
+static const char *output;
+static size_t chunk_size = 65536;
+static int level = Z_BEST_COMPRESSION;
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case 'o':
+      output = arg;
+      break;
+
+    case 'c':
+      chunk_size = strtoul (arg, 0, 0);
+      if (chunk_size < STORE_CZIP_MIN_CHUNK
+	  || chunk_size > STORE_CZIP_MAX_CHUNK
+	  || (chunk_size & (chunk_size - 1)))
+	argp_error (state, "%s: Invalid chunk size", arg);
+      break;
+
+    case 'l':
+      level = atoi (arg);
+      if (level < 1 || level > 9)
+	argp_error (state, "%s: Invalid compression level", arg);
+      break;
+
+    case ARGP_KEY_SUCCESS:
+      if (! output)
+	argp_error (state, "No output file specified");
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  error_t err;
+  struct store *s;
+  char *name;
+  int fd;
+  size_t num_chunks, i;
+  uint64_t *index;
+  uint64_t pos;
+  void *cbuf;
+  uLongf cbuf_size;
+  struct store_czip_header hdr;
+  const struct argp_child kids[] = { { &store_argp }, { 0 }};
+  struct argp argp =
+    { options, parse_opt, 0,
+      "Write the contents of a store as a chunked compressed image,"
+      " for use with the czip store class", kids };
+  struct store_argp_params p = { 0 };
+
+  argp_parse (&argp, argc, argv, 0, 0, &p);
+  err = store_parsed_name (p.result, &name);
+  if (err)
+    error (2, err, "store_parsed_name");
+
+  err = store_parsed_open (p.result, STORE_READONLY, &s);
+  if (err)
+    error (4, err, "%s", name);
+
+  if (chunk_size < s->block_size)
+    error (3, 0, "%s: Chunk size smaller than block size", name);
+
+  fd = open (output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    error (6, errno, "%s", output);
+
+  num_chunks = (s->size + chunk_size - 1) / chunk_size;
+  index = malloc ((num_chunks + 1) * sizeof index[0]);
+  cbuf_size = compressBound (chunk_size);
+  cbuf = malloc (cbuf_size);
+  if (! index || ! cbuf)
+    error (7, ENOMEM, "%s", output);
+
+  /* Chunks follow the header and the index, which are written last.  */
+  pos = sizeof hdr + (num_chunks + 1) * sizeof index[0];
+
+  for (i = 0; i < num_chunks; i++)
+    {
+      store_offset_t left = s->size - (store_offset_t) i * chunk_size;
+      size_t amount = left > chunk_size ? chunk_size : left;
+      void *data = 0;
+      size_t data_len = 0;
+      const void *out;
+      uLongf out_len = cbuf_size;
+
+      err = store_read (s, ((store_offset_t) i * chunk_size)
+			   >> s->log2_block_size,
+			amount, &data, &data_len);
+      if (! err && data_len != amount)
+	err = EIO;
+      if (err)
+	error (5, err, "%s", name);
+
+      if (compress2 (cbuf, &out_len, data, amount, level) == Z_OK
+	  && out_len < amount)
+	out = cbuf;
+      else
+	/* Didn't shrink; store it as is.  */
+	{
+	  out = data;
+	  out_len = amount;
+	}
+
+      index[i] = htole64 (pos);
+      if (pwrite (fd, out, out_len, pos) != out_len)
+	error (6, errno, "%s", output);
+      pos += out_len;
+
+      munmap (data, data_len);
+    }
+  index[num_chunks] = htole64 (pos);
+
+  memcpy (hdr.magic, STORE_CZIP_MAGIC, sizeof hdr.magic);
+  hdr.chunk_size = htole32 (chunk_size);
+  hdr.num_chunks = htole32 (num_chunks);
+  hdr.size = htole64 (s->size);
+
+  if (pwrite (fd, &hdr, sizeof hdr, 0) != sizeof hdr
+      || pwrite (fd, index, (num_chunks + 1) * sizeof index[0], sizeof hdr)
+	 != (num_chunks + 1) * sizeof index[0])
+    error (6, errno, "%s", output);
+
+  if (close (fd) < 0)
+    error (6, errno, "%s", output);
+
+  exit (0);
+}